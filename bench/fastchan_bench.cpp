@@ -14,6 +14,7 @@
 template <size_t min_size>
 static void BoostSPSC_Put(benchmark::State& state) {
     boost::lockfree::spsc_queue<uint8_t, boost::lockfree::capacity<min_size>> c;
+    // boost's queue has no close and never blocks, so its reader is stopped with a flag
     std::atomic_bool shouldRun = true;
     std::thread reader([&]() {
         while (shouldRun) {
@@ -43,6 +44,7 @@ BENCHMARK_TEMPLATE(BoostSPSC_Put, 1'048'576);
 template <size_t min_size>
 static void BoostSPSC_Get(benchmark::State& state) {
     boost::lockfree::spsc_queue<uint8_t, boost::lockfree::capacity<min_size>> c;
+    // boost's queue has no close and never blocks, so its writer is stopped with a flag
     std::atomic_bool shouldRun = true;
     std::thread reader([&]() {
         while (shouldRun) {
@@ -72,13 +74,11 @@ BENCHMARK_TEMPLATE(BoostSPSC_Get, 1'048'576);
 template <size_t min_size, int num_producers, class wait_type>
 static void MPSC_BlockingBoth_Put(benchmark::State& state) {
     fastchan::MPSC<uint8_t, min_size, wait_type, wait_type> c;
-    std::atomic_bool shouldRunWriter = true;
-    std::atomic_bool shouldRunReader = true;
-    std::atomic<uint8_t> stoppedWriters = 0;
 
+    // the reader drains whatever's left once the channel's closed and then stops
     std::thread reader([&]() {
-        while (shouldRunReader) {
-            auto&& it = c.get();
+        uint8_t it;
+        while (c.get(it)) {
         }
     });
 
@@ -86,10 +86,9 @@ static void MPSC_BlockingBoth_Put(benchmark::State& state) {
     std::array<std::thread, num_producers - 1> producers;
     for (auto i = 0; i < num_producers - 1; ++i) {
         producers[i] = std::thread([&]() {
-            while (shouldRunWriter) {
+            while (!c.isClosed()) {
                 c.put(0);
             }
-            stoppedWriters++;
         });
     }
 
@@ -98,14 +97,8 @@ static void MPSC_BlockingBoth_Put(benchmark::State& state) {
         c.put(0);
     }
 
-    shouldRunWriter = false;
-    while (stoppedWriters != num_producers - 1) {
-        std::this_thread::yield();
-    }
-    shouldRunReader = false;
-
-    // clear any blocks
-    c.put(0);
+    // closing wakes up anyone blocked on either side
+    c.close();
 
     for (auto i = 0; i < num_producers - 1; ++i) {
         producers[i].join();
@@ -207,45 +200,28 @@ BENCHMARK_TEMPLATE(MPSC_BlockingBoth_Put, 1'048'576, 5, fastchan::CVWaitStrategy
 template <size_t min_size, int num_producers, class wait_type>
 static void MPSC_BlockingBoth_Get(benchmark::State& state) {
     fastchan::MPSC<uint8_t, min_size, wait_type, wait_type> c;
-    std::atomic_bool shouldRunWriter = true;
-    std::atomic_bool shouldRunReader = true;
-    std::atomic<uint8_t> stoppedWriters = 0;
 
     std::array<std::thread, num_producers> producers;
     for (auto i = 0; i < num_producers; ++i) {
         producers[i] = std::thread([&]() {
-            while (shouldRunWriter) {
+            while (!c.isClosed()) {
                 c.put(0);
             }
-            stoppedWriters++;
         });
     }
 
     // Code inside this loop is measured repeatedly
+    uint8_t it;
     for (auto _ : state) {
-        auto&& it = c.get();
-    }
-
-    std::thread reader([&]() {
-        while (shouldRunReader) {
-            auto&& it = c.get();
-        }
-    });
-
-    shouldRunWriter = false;
-    while (stoppedWriters != num_producers) {
-        std::this_thread::yield();
+        c.get(it);
     }
-    shouldRunReader = false;
 
-    // clear any blocks
-    c.put(0);
+    // closing wakes up any producers blocked on a full channel
+    c.close();
 
     for (auto i = 0; i < num_producers; ++i) {
         producers[i].join();
     }
-
-    reader.join();
 }
 
 BENCHMARK_TEMPLATE(MPSC_BlockingBoth_Get, 16, 1, fastchan::YieldWaitStrategy);
@@ -281,12 +257,11 @@ BENCHMARK_TEMPLATE(MPSC_BlockingBoth_Get, 1'048'576, 5, fastchan::YieldWaitStrat
 template <size_t min_size, int num_producers>
 static void MPSC_NonBlockingGet_Put(benchmark::State& state) {
     fastchan::MPSC<uint8_t, min_size> c;
-    std::atomic_bool shouldRunWriter = true;
-    std::atomic_bool shouldRunReader = true;
-    std::atomic<uint8_t> stoppedWriters = 0;
+
+    // the reader drains whatever's left once the channel's closed and then stops
     std::thread reader([&]() {
-        while (shouldRunReader.load(std::memory_order_relaxed)) {
-            auto&& it = c.get();
+        uint8_t it;
+        while (c.get(it)) {
         }
     });
 
@@ -294,10 +269,9 @@ static void MPSC_NonBlockingGet_Put(benchmark::State& state) {
     std::array<std::thread, num_producers - 1> producers;
     for (auto i = 0; i < num_producers - 1; ++i) {
         producers[i] = std::thread([&]() {
-            while (shouldRunWriter) {
+            while (!c.isClosed()) {
                 c.put(0);
             }
-            stoppedWriters++;
         });
     }
 
@@ -305,14 +279,9 @@ static void MPSC_NonBlockingGet_Put(benchmark::State& state) {
     for (auto _ : state) {
         c.put(0);
     }
-    shouldRunWriter = false;
-    while (stoppedWriters != num_producers - 1) {
-        std::this_thread::yield();
-    }
-    shouldRunReader = false;
 
-    // clear any blocks
-    c.get();
+    // closing wakes up anyone blocked on either side
+    c.close();
 
     for (auto i = 0; i < num_producers - 1; ++i) {
         producers[i].join();
@@ -353,45 +322,29 @@ BENCHMARK_TEMPLATE(MPSC_NonBlockingGet_Put, 1'048'576, 5);
 template <size_t min_size, int num_producers>
 static void MPSC_NonBlockingGet_Get(benchmark::State& state) {
     fastchan::MPSC<uint8_t, min_size> c;
-    std::atomic_bool shouldRunWriter = true;
-    std::atomic_bool shouldRunReader = true;
-    std::atomic<uint8_t> stoppedWriters = 0;
 
     // create n producers
     std::array<std::thread, num_producers> producers;
     for (auto i = 0; i < num_producers; ++i) {
         producers[i] = std::thread([&]() {
-            while (shouldRunWriter) {
+            while (!c.isClosed()) {
                 c.put(0);
             }
-            stoppedWriters++;
         });
     }
 
     // Code inside this loop is measured repeatedly
+    uint8_t it;
     for (auto _ : state) {
-        auto&& it = c.get();
+        c.get(it);
     }
 
-    std::thread reader([&]() {
-        while (shouldRunReader) {
-            auto&& it = c.get();
-        }
-    });
-
-    shouldRunWriter = false;
-    while (stoppedWriters != num_producers) {
-        std::this_thread::yield();
-    }
-    shouldRunReader = false;
-
-    // clear any blocks
-    c.get();
+    // closing wakes up any producers blocked on a full channel
+    c.close();
 
     for (auto i = 0; i < num_producers; ++i) {
         producers[i].join();
     }
-    reader.join();
 }
 
 BENCHMARK_TEMPLATE(MPSC_NonBlockingGet_Get, 16, 1);
@@ -427,10 +380,11 @@ BENCHMARK_TEMPLATE(MPSC_NonBlockingGet_Get, 1'048'576, 5);
 template <size_t min_size, int num_producers, int loop>
 static void MPSC_NonBlockingBoth_Put(benchmark::State& state) {
     fastchan::MPSC<uint8_t, min_size> c;
-    std::atomic_bool shouldRun = true;
+
+    // the reader drains whatever's left once the channel's closed and then stops
     std::thread reader([&]() {
-        while (shouldRun) {
-            auto&& it = c.get();
+        uint8_t it;
+        while (c.get(it)) {
         }
     });
 
@@ -438,8 +392,7 @@ static void MPSC_NonBlockingBoth_Put(benchmark::State& state) {
     std::array<std::thread, num_producers - 1> producers;
     for (auto i = 0; i < num_producers - 1; ++i) {
         producers[i] = std::thread([&]() {
-            auto otherWork = 0;
-            while (shouldRun) {
+            while (!c.isClosed()) {
                 c.put(0);
             }
         });
@@ -449,9 +402,10 @@ static void MPSC_NonBlockingBoth_Put(benchmark::State& state) {
     for (auto _ : state) {
         c.put(0);
     }
-    shouldRun = false;
 
-    // clear any blocks
+    // closing wakes up anyone blocked on either side
+    c.close();
+
     for (auto i = 0; i < num_producers - 1; ++i) {
         producers[i].join();
     }
@@ -521,22 +475,23 @@ BENCHMARK_TEMPLATE(MPSC_NonBlockingBoth_Put, 1'048'576, 5, 100);
 template <size_t min_size, int num_producers, int loop>
 static void MPSC_NonBlockingBoth_Get(benchmark::State& state) {
     fastchan::MPSC<uint8_t, min_size> c;
-    std::atomic_bool shouldRun = true;
     std::array<std::thread, num_producers> producers;
     for (auto i = 0; i < num_producers; ++i) {
         producers[i] = std::thread([&]() {
-            auto otherWork = 0;
-            while (shouldRun) {
+            while (!c.isClosed()) {
                 c.put(0);
             }
         });
     }
 
     // Code inside this loop is measured repeatedly
+    uint8_t it;
     for (auto _ : state) {
-        auto&& it = c.get();
+        c.get(it);
     }
-    shouldRun = false;
+
+    // closing wakes up any producers blocked on a full channel
+    c.close();
 
     for (auto i = 0; i < num_producers; ++i) {
         producers[i].join();
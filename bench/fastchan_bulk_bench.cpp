@@ -0,0 +1,178 @@
+#include <benchmark/benchmark.h>
+
+#include <bulk.hpp>
+#include <cstdint>
+#include <mpsc.hpp>
+#include <spsc.hpp>
+#include <vector>
+
+struct Tick {
+    uint64_t ts;
+    double px;
+    uint32_t qty;
+};
+
+// every benchmark takes the batch size in bytes, from 1 KiB to 64 KiB
+static void batchSizes(benchmark::internal::Benchmark *b) { b->RangeMultiplier(2)->Range(1 << 10, 64 << 10); }
+
+static std::vector<Tick> makeTicks(std::size_t count) {
+    std::vector<Tick> ticks(count);
+    for (std::size_t i = 0; i < count; ++i) {
+        ticks[i] = Tick{i, double(i), uint32_t(i + 1)};
+    }
+    return ticks;
+}
+
+// what putBatch in MPSC used to do, a masked copy per element
+static void Copy_PerElement(benchmark::State &state) {
+    auto count = std::size_t(state.range(0)) / sizeof(Tick);
+    auto src = makeTicks(count);
+    std::vector<Tick> dst(count);
+    const std::size_t mask = ~std::size_t(0);
+
+    for (auto _ : state) {
+        for (std::size_t i = 0; i < count; ++i) {
+            dst[i & mask] = src[i];
+        }
+        benchmark::ClobberMemory();
+    }
+    state.SetBytesProcessed(state.iterations() * count * sizeof(Tick));
+}
+
+BENCHMARK(Copy_PerElement)->Apply(batchSizes);
+
+static void Copy_Bulk(benchmark::State &state) {
+    auto count = std::size_t(state.range(0)) / sizeof(Tick);
+    auto src = makeTicks(count);
+    std::vector<Tick> dst(count);
+
+    for (auto _ : state) {
+        fastchan::bulkCopy(dst.data(), src.data(), count);
+        benchmark::ClobberMemory();
+    }
+    state.SetBytesProcessed(state.iterations() * count * sizeof(Tick));
+}
+
+BENCHMARK(Copy_Bulk)->Apply(batchSizes);
+
+#if defined(__SSE2__)
+// what bulkCopy would do with FASTCHAN_NONTEMPORAL_BYTES down at the batch size, against Copy_Bulk
+static void Copy_NonTemporal(benchmark::State &state) {
+    auto count = std::size_t(state.range(0)) / sizeof(Tick);
+    auto src = makeTicks(count);
+    std::vector<Tick> dst(count);
+
+    for (auto _ : state) {
+        fastchan::detail::streamCopy(reinterpret_cast<char *>(dst.data()), reinterpret_cast<const char *>(src.data()), count * sizeof(Tick));
+        benchmark::ClobberMemory();
+    }
+    state.SetBytesProcessed(state.iterations() * count * sizeof(Tick));
+}
+
+BENCHMARK(Copy_NonTemporal)->Apply(batchSizes);
+#endif
+
+// a copy followed by the consumer reading the batch, which is what a channel hands over for: with non-temporal stores
+// the reads come back from memory rather than the cache
+template <bool non_temporal>
+static void Copy_ThenRead(benchmark::State &state) {
+    auto count = std::size_t(state.range(0)) / sizeof(Tick);
+    auto src = makeTicks(count);
+    std::vector<Tick> dst(count);
+
+    for (auto _ : state) {
+#if defined(__SSE2__)
+        if constexpr (non_temporal) {
+            fastchan::detail::streamCopy(reinterpret_cast<char *>(dst.data()), reinterpret_cast<const char *>(src.data()), count * sizeof(Tick));
+        } else
+#endif
+        {
+            fastchan::bulkCopy(dst.data(), src.data(), count);
+        }
+        uint64_t sum = 0;
+        for (auto &tick : dst) {
+            sum += tick.qty;
+        }
+        benchmark::DoNotOptimize(sum);
+    }
+    state.SetBytesProcessed(state.iterations() * count * sizeof(Tick));
+}
+
+BENCHMARK_TEMPLATE(Copy_ThenRead, false)->Apply(batchSizes);
+#if defined(__SSE2__)
+BENCHMARK_TEMPLATE(Copy_ThenRead, true)->Apply(batchSizes);
+#endif
+
+// a batch through a channel and back out again on one thread, so it's just the copies and the index updates
+template <template <class, size_t, class, class> class Chan>
+static void PutGetBatch(benchmark::State &state) {
+    auto count = std::size_t(state.range(0)) / sizeof(Tick);
+    auto src = makeTicks(count);
+    std::vector<Tick> dst(count);
+    Chan<Tick, (64 << 10) / sizeof(Tick), fastchan::NoOpWaitStrategy, fastchan::NoOpWaitStrategy> c;
+
+    for (auto _ : state) {
+        c.putBatch(src.data(), count);
+        benchmark::DoNotOptimize(c.getBatch(dst.data(), count));
+    }
+    state.SetBytesProcessed(state.iterations() * count * sizeof(Tick));
+}
+
+BENCHMARK_TEMPLATE(PutGetBatch, fastchan::SPSC)->Apply(batchSizes);
+BENCHMARK_TEMPLATE(PutGetBatch, fastchan::MPSC)->Apply(batchSizes);
+
+// scanning a batch for the first Tick with a zero qty, which is only in the last one
+static void Find_PerElement(benchmark::State &state) {
+    auto count = std::size_t(state.range(0)) / sizeof(Tick);
+    auto ticks = makeTicks(count);
+    ticks.back().qty = 0;
+
+    for (auto _ : state) {
+        auto *data = ticks.data();
+        benchmark::ClobberMemory();
+        std::size_t i = 0;
+        while (i < count && data[i].qty != 0) {
+            ++i;
+        }
+        benchmark::DoNotOptimize(i);
+    }
+    state.SetBytesProcessed(state.iterations() * count * sizeof(Tick));
+}
+
+BENCHMARK(Find_PerElement)->Apply(batchSizes);
+
+static void Find_Bulk(benchmark::State &state) {
+    auto count = std::size_t(state.range(0)) / sizeof(Tick);
+    auto ticks = makeTicks(count);
+    ticks.back().qty = 0;
+
+    for (auto _ : state) {
+        auto *data = ticks.data();
+        benchmark::ClobberMemory();
+        benchmark::DoNotOptimize(fastchan::bulkFind(data, count, &Tick::qty, 0u));
+    }
+    state.SetBytesProcessed(state.iterations() * count * sizeof(Tick));
+}
+
+BENCHMARK(Find_Bulk)->Apply(batchSizes);
+
+// the same over contiguous keys, e.g. sequence numbers
+static void Find_BulkContiguous(benchmark::State &state) {
+    auto count = std::size_t(state.range(0)) / sizeof(uint64_t);
+    std::vector<uint64_t> seqs(count);
+    for (std::size_t i = 0; i < count; ++i) {
+        seqs[i] = i;
+    }
+
+    for (auto _ : state) {
+        auto *data = seqs.data();
+        benchmark::ClobberMemory();
+        benchmark::DoNotOptimize(fastchan::bulkFind(data, count, uint64_t(count - 1)));
+    }
+    state.SetBytesProcessed(state.iterations() * count * sizeof(uint64_t));
+}
+
+BENCHMARK(Find_BulkContiguous)->Apply(batchSizes);
+
+// Run the benchmark
+BENCHMARK_MAIN();
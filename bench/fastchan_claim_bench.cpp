@@ -0,0 +1,81 @@
+#include <benchmark/benchmark.h>
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mpsc.hpp>
+#include <thread>
+#include <vector>
+
+// the claim on its own, every thread taking the next index as fast as it can the way the MPSC's producers do: a CAS
+// from the index it expects, retried from whatever it finds whenever another thread got there first, or a fetch_add
+alignas(hardware_destructive_interference_size) static std::atomic<std::size_t> next_index{0};
+
+static void Claim_CAS(benchmark::State& state) {
+    uint64_t retries = 0;
+    auto expected = next_index.load(std::memory_order_acquire);
+    for (auto _ : state) {
+        while (!next_index.compare_exchange_strong(expected, expected + 1, std::memory_order_acq_rel, std::memory_order_acquire)) {
+            ++retries;
+        }
+        ++expected;
+    }
+    state.counters["retries_per_claim"] = benchmark::Counter(double(retries) / double(state.iterations()), benchmark::Counter::kAvgThreads);
+    state.SetItemsProcessed(state.iterations());
+}
+
+static void Claim_FetchAdd(benchmark::State& state) {
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(next_index.fetch_add(1, std::memory_order_acq_rel));
+    }
+    state.counters["retries_per_claim"] = benchmark::Counter(0, benchmark::Counter::kAvgThreads);
+    state.SetItemsProcessed(state.iterations());
+}
+
+BENCHMARK(Claim_CAS)->ThreadRange(2, 32)->UseRealTime();
+BENCHMARK(Claim_FetchAdd)->ThreadRange(2, 32)->UseRealTime();
+
+// the whole channel, num_producers putting as fast as they can into an MPSC the consumer gets from, which is the
+// throughput of all of them together. The producers stop once it's closed, and the consumer drains whatever's been
+// claimed by then, as a fetch_add claim past the end waits for its slot even once the channel's closed.
+template <int num_producers, class claim_strategy>
+static void MPSC_Claim_Get(benchmark::State& state) {
+    auto c = std::make_unique<fastchan::MPSC<uint64_t, 1024, fastchan::YieldWaitStrategy, fastchan::YieldWaitStrategy, claim_strategy>>();
+
+    std::vector<std::thread> producers;
+    for (auto i = 0; i < num_producers; ++i) {
+        producers.emplace_back([&]() {
+            uint64_t v = 0;
+            while (!c->isClosed()) {
+                c->put(v++);
+            }
+        });
+    }
+
+    uint64_t it;
+    for (auto _ : state) {
+        c->get(it);
+    }
+
+    c->close();
+    while (c->get(it)) {
+    }
+    for (auto& producer : producers) {
+        producer.join();
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+
+BENCHMARK_TEMPLATE(MPSC_Claim_Get, 2, fastchan::CASClaim)->UseRealTime();
+BENCHMARK_TEMPLATE(MPSC_Claim_Get, 2, fastchan::FetchAddClaim)->UseRealTime();
+BENCHMARK_TEMPLATE(MPSC_Claim_Get, 4, fastchan::CASClaim)->UseRealTime();
+BENCHMARK_TEMPLATE(MPSC_Claim_Get, 4, fastchan::FetchAddClaim)->UseRealTime();
+BENCHMARK_TEMPLATE(MPSC_Claim_Get, 8, fastchan::CASClaim)->UseRealTime();
+BENCHMARK_TEMPLATE(MPSC_Claim_Get, 8, fastchan::FetchAddClaim)->UseRealTime();
+BENCHMARK_TEMPLATE(MPSC_Claim_Get, 16, fastchan::CASClaim)->UseRealTime();
+BENCHMARK_TEMPLATE(MPSC_Claim_Get, 16, fastchan::FetchAddClaim)->UseRealTime();
+BENCHMARK_TEMPLATE(MPSC_Claim_Get, 32, fastchan::CASClaim)->UseRealTime();
+BENCHMARK_TEMPLATE(MPSC_Claim_Get, 32, fastchan::FetchAddClaim)->UseRealTime();
+
+// Run the benchmark
+BENCHMARK_MAIN();
@@ -0,0 +1,81 @@
+#include <benchmark/benchmark.h>
+
+#include <conflating.hpp>
+#include <cstdint>
+#include <spsc.hpp>
+
+// the producer publishes overload updates for every key per round, i.e. 10x more than the consumer needs to keep a
+// display of the latest value per key current
+constexpr int overload = 10;
+
+struct Quote {
+    uint64_t ts;
+    double px;
+    uint32_t qty;
+};
+
+static inline void consume(const Quote &q) {
+    // stand in for the per update work of a consumer, e.g. repricing a risk snapshot
+    double acc = q.px;
+    for (int i = 0; i < 64; ++i) {
+        acc = acc * 1.0000001 + q.qty;
+    }
+    benchmark::DoNotOptimize(acc);
+}
+
+template <size_t num_keys>
+static void SPSC_Overload(benchmark::State &state) {
+    fastchan::SPSC<Quote, num_keys * overload, fastchan::NoOpWaitStrategy, fastchan::NoOpWaitStrategy> c;
+    uint64_t ts = 0;
+    int64_t consumed = 0;
+
+    for (auto _ : state) {
+        for (int i = 0; i < overload; ++i) {
+            for (size_t key = 0; key < num_keys; ++key) {
+                c.put(Quote{++ts, double(key), uint32_t(i)});
+            }
+        }
+
+        while (!c.isEmpty()) {
+            consume(c.get());
+            ++consumed;
+        }
+    }
+
+    state.counters["consumed_per_round"] = benchmark::Counter(double(consumed) / double(state.iterations()));
+    state.SetItemsProcessed(state.iterations() * overload * num_keys);
+}
+
+BENCHMARK_TEMPLATE(SPSC_Overload, 16);
+BENCHMARK_TEMPLATE(SPSC_Overload, 256);
+BENCHMARK_TEMPLATE(SPSC_Overload, 4096);
+
+template <size_t num_keys>
+static void Conflating_Overload(benchmark::State &state) {
+    fastchan::Conflating<Quote, num_keys, fastchan::NoOpWaitStrategy> c;
+    uint64_t ts = 0;
+    int64_t consumed = 0;
+
+    for (auto _ : state) {
+        for (int i = 0; i < overload; ++i) {
+            for (size_t key = 0; key < num_keys; ++key) {
+                c.put(key, Quote{++ts, double(key), uint32_t(i)});
+            }
+        }
+
+        while (!c.isEmpty()) {
+            consume(c.get().second);
+            ++consumed;
+        }
+    }
+
+    state.counters["consumed_per_round"] = benchmark::Counter(double(consumed) / double(state.iterations()));
+    state.SetItemsProcessed(state.iterations() * overload * num_keys);
+}
+
+BENCHMARK_TEMPLATE(Conflating_Overload, 16);
+BENCHMARK_TEMPLATE(Conflating_Overload, 256);
+BENCHMARK_TEMPLATE(Conflating_Overload, 4096);
+
+// Run the benchmark
+BENCHMARK_MAIN();
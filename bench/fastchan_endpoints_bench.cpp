@@ -0,0 +1,84 @@
+#include <benchmark/benchmark.h>
+
+#include <cstdint>
+#include <endpoints.hpp>
+#include <memory>
+#include <spsc.hpp>
+#include <thread>
+
+// a put and a get on the same thread, so it's only the cost of the calls themselves with no other thread in the way.
+// The channel's on the heap as it is for the endpoints, and for any channel shared between threads.
+template <size_t min_size, class wait_type>
+static void SPSC_PutGet(benchmark::State& state) {
+    auto c = std::make_unique<fastchan::SPSC<uint64_t, min_size, wait_type, wait_type>>();
+    uint64_t i = 0;
+    for (auto _ : state) {
+        c->put(i++);
+        auto&& it = c->get();
+        benchmark::DoNotOptimize(it);
+    }
+}
+
+// the same through a Sender and Receiver, which should cost the same once NDEBUG compiles out the thread checks
+template <size_t min_size, class wait_type>
+static void Endpoints_PutGet(benchmark::State& state) {
+    auto [tx, rx] = fastchan::make_spsc<uint64_t, min_size, wait_type, wait_type>();
+    uint64_t i = 0;
+    for (auto _ : state) {
+        tx.put(i++);
+        auto&& it = rx.get();
+        benchmark::DoNotOptimize(it);
+    }
+}
+
+BENCHMARK_TEMPLATE(SPSC_PutGet, 1024, fastchan::PauseWaitStrategy);
+BENCHMARK_TEMPLATE(Endpoints_PutGet, 1024, fastchan::PauseWaitStrategy);
+BENCHMARK_TEMPLATE(SPSC_PutGet, 1024, fastchan::CVWaitStrategy);
+BENCHMARK_TEMPLATE(Endpoints_PutGet, 1024, fastchan::CVWaitStrategy);
+
+// a producer thread putting as fast as a reader thread gets
+template <size_t min_size, class wait_type>
+static void SPSC_Put(benchmark::State& state) {
+    fastchan::SPSC<uint8_t, min_size, wait_type, wait_type> c;
+    std::thread reader([&]() {
+        uint8_t it;
+        while (c.get(it)) {
+            benchmark::DoNotOptimize(it);
+        }
+    });
+
+    for (auto _ : state) {
+        c.put(0);
+    }
+
+    c.close();
+    reader.join();
+}
+
+template <size_t min_size, class wait_type>
+static void Endpoints_Put(benchmark::State& state) {
+    auto [tx, rx] = fastchan::make_spsc<uint8_t, min_size, wait_type, wait_type>();
+    std::thread reader([rx = std::move(rx)]() mutable {
+        uint8_t it;
+        while (rx.get(it)) {
+            benchmark::DoNotOptimize(it);
+        }
+    });
+
+    for (auto _ : state) {
+        tx.put(0);
+    }
+
+    tx.close();
+    reader.join();
+}
+
+BENCHMARK_TEMPLATE(SPSC_Put, 1024, fastchan::PauseWaitStrategy)->UseRealTime();
+BENCHMARK_TEMPLATE(Endpoints_Put, 1024, fastchan::PauseWaitStrategy)->UseRealTime();
+BENCHMARK_TEMPLATE(SPSC_Put, 1024, fastchan::YieldWaitStrategy)->UseRealTime();
+BENCHMARK_TEMPLATE(Endpoints_Put, 1024, fastchan::YieldWaitStrategy)->UseRealTime();
+BENCHMARK_TEMPLATE(SPSC_Put, 1024, fastchan::CVWaitStrategy)->UseRealTime();
+BENCHMARK_TEMPLATE(Endpoints_Put, 1024, fastchan::CVWaitStrategy)->UseRealTime();
+
+// Run the benchmark
+BENCHMARK_MAIN();
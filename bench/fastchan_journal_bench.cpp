@@ -0,0 +1,160 @@
+#include <benchmark/benchmark.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <cstdint>
+#include <filesystem>
+#include <journal.hpp>
+#include <spsc.hpp>
+#include <string>
+#include <thread>
+#include <vector>
+
+struct Tick {
+    uint64_t ts;
+    double px;
+    uint32_t qty;
+};
+
+static std::string journalPath() { return (std::filesystem::temp_directory_path() / "fastchan_bench.journal").string(); }
+
+// the producer's put rate with a consumer that just drops everything, as the baseline for the recording consumers
+template <size_t min_size>
+static void SPSC_Put_Get(benchmark::State& state) {
+    fastchan::SPSC<Tick, min_size, fastchan::PauseWaitStrategy, fastchan::PauseWaitStrategy> c;
+    std::thread reader([&]() {
+        Tick it;
+        while (c.get(it)) {
+            benchmark::DoNotOptimize(it);
+        }
+    });
+
+    uint64_t i = 0;
+    for (auto _ : state) {
+        c.put(Tick{++i, 1.5, 10});
+    }
+    c.close();
+    reader.join();
+    state.SetBytesProcessed(state.iterations() * sizeof(Tick));
+}
+
+BENCHMARK_TEMPLATE(SPSC_Put_Get, 1024);
+BENCHMARK_TEMPLATE(SPSC_Put_Get, 65'536);
+
+// what we do today, copy every element out with get and write it
+template <size_t min_size>
+static void SPSC_Put_GetWrite(benchmark::State& state) {
+    fastchan::SPSC<Tick, min_size, fastchan::PauseWaitStrategy, fastchan::PauseWaitStrategy> c;
+    auto path = journalPath();
+    int fd = ::open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    std::thread reader([&]() {
+        Tick it;
+        while (c.get(it)) {
+            [[maybe_unused]] auto written = ::write(fd, &it, sizeof(it));
+        }
+    });
+
+    uint64_t i = 0;
+    for (auto _ : state) {
+        c.put(Tick{++i, 1.5, 10});
+    }
+    c.close();
+    reader.join();
+    ::close(fd);
+    std::filesystem::remove(path);
+    state.SetBytesProcessed(state.iterations() * sizeof(Tick));
+}
+
+BENCHMARK_TEMPLATE(SPSC_Put_GetWrite, 1024);
+BENCHMARK_TEMPLATE(SPSC_Put_GetWrite, 65'536);
+
+template <size_t min_size>
+static void SPSC_Put_JournalTap(benchmark::State& state) {
+    using Chan = fastchan::SPSC<Tick, min_size, fastchan::PauseWaitStrategy, fastchan::PauseWaitStrategy>;
+    Chan c;
+    auto path = journalPath();
+    const std::size_t rotate_bytes = state.range(0);
+    fastchan::JournalStats stats;
+    std::thread reader([&]() {
+        fastchan::JournalTap<Chan> tap(c, path, rotate_bytes);
+        while (!c.isClosed()) {
+            if (tap.poll() == 0) {
+                fastchan::cpu_pause();
+            }
+        }
+        // everything put before the close is committed by now
+        while (tap.poll() > 0) {
+        }
+        stats = tap.stats();
+    });
+
+    uint64_t i = 0;
+    for (auto _ : state) {
+        c.put(Tick{++i, 1.5, 10});
+    }
+    c.close();
+    reader.join();
+
+    for (uint64_t file = 0; file < stats.files; ++file) {
+        std::filesystem::remove(file ? path + "." + std::to_string(file) : path);
+    }
+
+    state.SetBytesProcessed(state.iterations() * sizeof(Tick));
+    state.counters["tap_records_per_frame"] = double(stats.records) / double(stats.frames);
+    state.counters["tap_bytes_per_second"] = stats.bytesPerSecond();
+    state.counters["files"] = double(stats.files);
+}
+
+BENCHMARK_TEMPLATE(SPSC_Put_JournalTap, 1024)->Arg(0)->Arg(256 << 20);
+BENCHMARK_TEMPLATE(SPSC_Put_JournalTap, 65'536)->Arg(0)->Arg(256 << 20);
+
+// a recording of 1M ticks in frames of 1024, 100us apart, i.e. ~10M msgs/s at the original pace
+static std::string recordJournal() {
+    auto path = (std::filesystem::temp_directory_path() / "fastchan_bench_replay.journal").string();
+    fastchan::JournalWriter<Tick> writer(path);
+    std::vector<Tick> batch(1024);
+    for (uint64_t frame = 0; frame < 1024; ++frame) {
+        for (uint64_t i = 0; i < batch.size(); ++i) {
+            batch[i] = Tick{frame * batch.size() + i, 1.5, 10};
+        }
+        writer.append(batch.data(), batch.size(), frame * 100'000);
+    }
+    return path;
+}
+
+// replays the recording at state.range(0) times its original pace, 0 being flat out
+template <class Chan>
+static void Journal_Replay(benchmark::State& state) {
+    auto path = recordJournal();
+    const double speed = double(state.range(0));
+    uint64_t records = 0;
+    uint64_t elapsed_ns = 0;
+
+    for (auto _ : state) {
+        Chan c;
+        std::thread reader([&]() {
+            std::size_t consumed = 0;
+            while (consumed < 1024 * 1024) {
+                consumed += c.drain([](const Tick* data, std::size_t) { benchmark::DoNotOptimize(data); });
+            }
+        });
+
+        auto stats = fastchan::JournalReplay<Chan>(c, path).run(speed);
+        reader.join();
+
+        records += stats.records;
+        elapsed_ns += stats.elapsed_ns;
+    }
+
+    std::filesystem::remove(path);
+    state.counters["replay_records_per_second"] = double(records) * 1e9 / double(elapsed_ns);
+}
+
+BENCHMARK_TEMPLATE(Journal_Replay, fastchan::SPSC<Tick, 65'536, fastchan::PauseWaitStrategy, fastchan::PauseWaitStrategy>)
+    ->Arg(0)
+    ->Arg(1)
+    ->Arg(10)
+    ->Unit(benchmark::kMillisecond);
+
+// Run the benchmark
+BENCHMARK_MAIN();
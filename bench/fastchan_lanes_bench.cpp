@@ -0,0 +1,114 @@
+#include <benchmark/benchmark.h>
+
+#include <array>
+#include <cstdint>
+#include <lanes.hpp>
+#include <mpsc.hpp>
+#include <thread>
+
+// MPSC_BlockingBoth_Put from fastchan_bench, so the two can be compared side by side for the same producer counts
+template <size_t min_size, int num_producers, class wait_type>
+static void MPSC_BlockingBoth_Put(benchmark::State& state) {
+    fastchan::MPSC<uint8_t, min_size, wait_type, wait_type> c;
+
+    // the reader drains whatever's left once the channel's closed and then stops
+    std::thread reader([&]() {
+        uint8_t it;
+        while (c.get(it)) {
+            benchmark::DoNotOptimize(it);
+        }
+    });
+
+    // create n-1 producers
+    std::array<std::thread, num_producers - 1> producers;
+    for (auto i = 0; i < num_producers - 1; ++i) {
+        producers[i] = std::thread([&]() {
+            while (!c.isClosed()) {
+                c.put(0);
+            }
+        });
+    }
+
+    for (auto _ : state) {
+        c.put(0);
+    }
+
+    // closing wakes up anyone blocked on either side
+    c.close();
+
+    for (auto i = 0; i < num_producers - 1; ++i) {
+        producers[i].join();
+    }
+
+    reader.join();
+}
+
+// the same with every producer on a lane of its own, each lane is min_size so the total capacity grows with the lanes
+template <size_t min_size, int num_producers, class wait_type>
+static void LaneMPSC_BlockingBoth_Put(benchmark::State& state) {
+    fastchan::LaneMPSC<uint8_t, min_size, num_producers, wait_type, wait_type> c;
+
+    // the reader drains whatever's left in the lanes once the channel's closed and then stops
+    std::thread reader([&]() {
+        uint8_t it;
+        while (c.get(it)) {
+            benchmark::DoNotOptimize(it);
+        }
+    });
+
+    // create n-1 producers
+    std::array<std::thread, num_producers - 1> producers;
+    for (auto i = 0; i < num_producers - 1; ++i) {
+        producers[i] = std::thread([&]() {
+            auto producer = c.registerProducer();
+            while (!c.isClosed()) {
+                producer->put(0);
+            }
+        });
+    }
+
+    auto producer = c.registerProducer();
+    for (auto _ : state) {
+        producer->put(0);
+    }
+
+    // closing wakes up anyone blocked on either side
+    c.close();
+
+    for (auto i = 0; i < num_producers - 1; ++i) {
+        producers[i].join();
+    }
+
+    reader.join();
+}
+
+BENCHMARK_TEMPLATE(MPSC_BlockingBoth_Put, 1024, 1, fastchan::PauseWaitStrategy);
+BENCHMARK_TEMPLATE(MPSC_BlockingBoth_Put, 1024, 2, fastchan::PauseWaitStrategy);
+BENCHMARK_TEMPLATE(MPSC_BlockingBoth_Put, 1024, 5, fastchan::PauseWaitStrategy);
+BENCHMARK_TEMPLATE(LaneMPSC_BlockingBoth_Put, 1024, 1, fastchan::PauseWaitStrategy);
+BENCHMARK_TEMPLATE(LaneMPSC_BlockingBoth_Put, 1024, 2, fastchan::PauseWaitStrategy);
+BENCHMARK_TEMPLATE(LaneMPSC_BlockingBoth_Put, 1024, 5, fastchan::PauseWaitStrategy);
+
+BENCHMARK_TEMPLATE(MPSC_BlockingBoth_Put, 65'536, 1, fastchan::PauseWaitStrategy);
+BENCHMARK_TEMPLATE(MPSC_BlockingBoth_Put, 65'536, 2, fastchan::PauseWaitStrategy);
+BENCHMARK_TEMPLATE(MPSC_BlockingBoth_Put, 65'536, 5, fastchan::PauseWaitStrategy);
+BENCHMARK_TEMPLATE(LaneMPSC_BlockingBoth_Put, 65'536, 1, fastchan::PauseWaitStrategy);
+BENCHMARK_TEMPLATE(LaneMPSC_BlockingBoth_Put, 65'536, 2, fastchan::PauseWaitStrategy);
+BENCHMARK_TEMPLATE(LaneMPSC_BlockingBoth_Put, 65'536, 5, fastchan::PauseWaitStrategy);
+
+BENCHMARK_TEMPLATE(MPSC_BlockingBoth_Put, 1024, 1, fastchan::YieldWaitStrategy);
+BENCHMARK_TEMPLATE(MPSC_BlockingBoth_Put, 1024, 2, fastchan::YieldWaitStrategy);
+BENCHMARK_TEMPLATE(MPSC_BlockingBoth_Put, 1024, 5, fastchan::YieldWaitStrategy);
+BENCHMARK_TEMPLATE(LaneMPSC_BlockingBoth_Put, 1024, 1, fastchan::YieldWaitStrategy);
+BENCHMARK_TEMPLATE(LaneMPSC_BlockingBoth_Put, 1024, 2, fastchan::YieldWaitStrategy);
+BENCHMARK_TEMPLATE(LaneMPSC_BlockingBoth_Put, 1024, 5, fastchan::YieldWaitStrategy);
+
+BENCHMARK_TEMPLATE(MPSC_BlockingBoth_Put, 65'536, 1, fastchan::YieldWaitStrategy);
+BENCHMARK_TEMPLATE(MPSC_BlockingBoth_Put, 65'536, 2, fastchan::YieldWaitStrategy);
+BENCHMARK_TEMPLATE(MPSC_BlockingBoth_Put, 65'536, 5, fastchan::YieldWaitStrategy);
+BENCHMARK_TEMPLATE(LaneMPSC_BlockingBoth_Put, 65'536, 1, fastchan::YieldWaitStrategy);
+BENCHMARK_TEMPLATE(LaneMPSC_BlockingBoth_Put, 65'536, 2, fastchan::YieldWaitStrategy);
+BENCHMARK_TEMPLATE(LaneMPSC_BlockingBoth_Put, 65'536, 5, fastchan::YieldWaitStrategy);
+
+// Run the benchmark
+BENCHMARK_MAIN();
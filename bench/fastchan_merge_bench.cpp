@@ -0,0 +1,78 @@
+#include <benchmark/benchmark.h>
+
+#include <cstdint>
+#include <memory>
+#include <merge.hpp>
+#include <spsc.hpp>
+#include <vector>
+
+struct Event {
+    uint64_t ts;
+    uint64_t lane;
+};
+
+struct EventTime {
+    uint64_t operator()(const Event& e) const { return e.ts; }
+};
+
+using Feed = fastchan::SPSC<Event, 1024, fastchan::NoOpWaitStrategy, fastchan::NoOpWaitStrategy>;
+
+// every lane starts out with depth entries, interleaved by timestamp, and whatever's merged out goes straight back
+// into its lane with a later timestamp, so every lane keeps the same depth and no lane ever holds the merge up
+static constexpr uint64_t depth = 256;
+
+static std::vector<std::unique_ptr<Feed>> prefill(uint64_t lanes) {
+    std::vector<std::unique_ptr<Feed>> feeds;
+    for (uint64_t lane = 0; lane < lanes; ++lane) {
+        feeds.push_back(std::make_unique<Feed>());
+        for (uint64_t i = 0; i < depth; ++i) {
+            feeds.back()->put(Event{i * lanes + lane, lane});
+        }
+    }
+    return feeds;
+}
+
+static void OrderedMerge_Get(benchmark::State& state) {
+    uint64_t lanes = state.range(0);
+    auto feeds = prefill(lanes);
+    std::vector<Feed*> chans;
+    for (auto& feed : feeds) {
+        chans.push_back(feed.get());
+    }
+    fastchan::OrderedMerge<Feed, EventTime> merge(chans);
+
+    for (auto _ : state) {
+        auto e = merge.poll();
+        feeds[e->lane]->put(Event{e->ts + depth * lanes, e->lane});
+        benchmark::DoNotOptimize(e);
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+
+// the hand rolled loop that peeks at every lane for the oldest head on every get, for comparison
+static void PeekScan_Get(benchmark::State& state) {
+    uint64_t lanes = state.range(0);
+    auto feeds = prefill(lanes);
+
+    for (auto _ : state) {
+        const Event* oldest = nullptr;
+        std::size_t best = 0;
+        for (std::size_t lane = 0; lane < lanes; ++lane) {
+            auto head = feeds[lane]->peek();
+            if (head != nullptr && (oldest == nullptr || head->ts < oldest->ts)) {
+                oldest = head;
+                best = lane;
+            }
+        }
+        auto e = feeds[best]->get();
+        feeds[e.lane]->put(Event{e.ts + depth * lanes, e.lane});
+        benchmark::DoNotOptimize(e);
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+
+BENCHMARK(OrderedMerge_Get)->RangeMultiplier(2)->Range(2, 64);
+BENCHMARK(PeekScan_Get)->RangeMultiplier(2)->Range(2, 64);
+
+// Run the benchmark
+BENCHMARK_MAIN();
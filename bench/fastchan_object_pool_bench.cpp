@@ -0,0 +1,142 @@
+#include <benchmark/benchmark.h>
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <mpsc.hpp>
+#include <object_pool.hpp>
+#include <spsc.hpp>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+template <size_t bytes>
+struct Buffer {
+    uint64_t seq;
+    std::array<char, bytes - sizeof(uint64_t)> payload;
+};
+
+// what we do today, the producer allocates a buffer, puts the pointer and the consumer frees it
+template <template <class, size_t, class, class> class Chan, size_t bytes>
+static void Put_NewDelete(benchmark::State& state) {
+    Chan<Buffer<bytes>*, 1024, fastchan::YieldWaitStrategy, fastchan::YieldWaitStrategy> c;
+    std::thread reader([&]() {
+        while (true) {
+            auto* buffer = c.get();
+            if (buffer == nullptr) {
+                return;
+            }
+            benchmark::DoNotOptimize(buffer->payload[0]);
+            delete buffer;
+        }
+    });
+
+    uint64_t i = 0;
+    for (auto _ : state) {
+        auto* buffer = new Buffer<bytes>;
+        buffer->seq = ++i;
+        buffer->payload[0] = char(i);
+        c.put(buffer);
+    }
+
+    c.put(nullptr);
+    reader.join();
+    state.SetItemsProcessed(state.iterations());
+}
+
+BENCHMARK_TEMPLATE(Put_NewDelete, fastchan::SPSC, 64)->UseRealTime();
+BENCHMARK_TEMPLATE(Put_NewDelete, fastchan::SPSC, 4096)->UseRealTime();
+BENCHMARK_TEMPLATE(Put_NewDelete, fastchan::MPSC, 64)->UseRealTime();
+BENCHMARK_TEMPLATE(Put_NewDelete, fastchan::MPSC, 4096)->UseRealTime();
+
+// the same with the buffers recycled through an ObjectPool, the consumer returns them just by dropping the handle
+template <template <class, size_t, class, class> class Chan, size_t bytes>
+static void Put_ObjectPool(benchmark::State& state) {
+    fastchan::ObjectPool<Buffer<bytes>> pool(2048);
+    Chan<fastchan::Handle<Buffer<bytes>>, 1024, fastchan::YieldWaitStrategy, fastchan::YieldWaitStrategy> c;
+    std::thread reader([&]() {
+        while (true) {
+            auto buffer = c.get();
+            if (!buffer) {
+                return;
+            }
+            benchmark::DoNotOptimize(buffer->payload[0]);
+        }
+    });
+
+    uint64_t i = 0;
+    for (auto _ : state) {
+        auto buffer = pool.acquire();
+        buffer->seq = ++i;
+        buffer->payload[0] = char(i);
+        c.put(std::move(buffer));
+    }
+
+    c.put(fastchan::Handle<Buffer<bytes>>{});
+    reader.join();
+    state.SetItemsProcessed(state.iterations());
+}
+
+BENCHMARK_TEMPLATE(Put_ObjectPool, fastchan::SPSC, 64)->UseRealTime();
+BENCHMARK_TEMPLATE(Put_ObjectPool, fastchan::SPSC, 4096)->UseRealTime();
+BENCHMARK_TEMPLATE(Put_ObjectPool, fastchan::MPSC, 64)->UseRealTime();
+BENCHMARK_TEMPLATE(Put_ObjectPool, fastchan::MPSC, 4096)->UseRealTime();
+
+// state.range(0) producers sharing one MPSC, allocating their own buffers or sharing one pool of them
+template <bool pooled>
+static void MultiProducer_Alloc(benchmark::State& state) {
+    using Buf = Buffer<1024>;
+    using Item = std::conditional_t<pooled, fastchan::Handle<Buf>, Buf*>;
+    fastchan::ObjectPool<Buf> pool(4096);
+    fastchan::MPSC<Item, 1024, fastchan::YieldWaitStrategy, fastchan::YieldWaitStrategy> c;
+
+    auto produce = [&]() {
+        if constexpr (pooled) {
+            auto buffer = pool.acquire();
+            buffer->seq = 1;
+            c.put(std::move(buffer));
+        } else {
+            auto* buffer = new Buf;
+            buffer->seq = 1;
+            c.put(buffer);
+        }
+    };
+
+    std::atomic<uint64_t> consumed = 0;
+    std::thread reader([&]() {
+        while (auto buffer = c.get()) {
+            benchmark::DoNotOptimize(buffer->seq);
+            if constexpr (!pooled) {
+                delete buffer;
+            }
+            consumed.store(consumed.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+        }
+    });
+
+    // the benchmark thread is one of the producers, the others put as many as it does
+    std::vector<std::thread> producers;
+    for (int64_t i = 1; i < state.range(0); ++i) {
+        producers.emplace_back([&]() {
+            for (benchmark::IterationCount n = 0; n < state.max_iterations; ++n) {
+                produce();
+            }
+        });
+    }
+
+    for (auto _ : state) {
+        produce();
+    }
+    for (auto& producer : producers) {
+        producer.join();
+    }
+
+    c.put(Item{});
+    reader.join();
+    state.SetItemsProcessed(int64_t(consumed.load()));
+}
+
+BENCHMARK_TEMPLATE(MultiProducer_Alloc, false)->Arg(1)->Arg(2)->Arg(4)->UseRealTime();
+BENCHMARK_TEMPLATE(MultiProducer_Alloc, true)->Arg(1)->Arg(2)->Arg(4)->UseRealTime();
+
+// Run the benchmark
+BENCHMARK_MAIN();
@@ -0,0 +1,89 @@
+#include <benchmark/benchmark.h>
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <occupancy.hpp>
+#include <spsc.hpp>
+#include <thread>
+
+// a producer that puts in bursts bigger than the channel, to a consumer that has work to do on every entry, so the
+// channel fills up on every burst. Both runs have the same 256 slots, the only difference being whether the producer
+// holds back once the watermark's high and gets on with work of its own instead of waiting on a put.
+static constexpr std::size_t burst = 1024;
+
+using Chan = fastchan::Monitored<fastchan::SPSC<uint64_t, 256, fastchan::YieldWaitStrategy, fastchan::YieldWaitStrategy>, 16>;
+
+static void consumerWork(uint64_t v) {
+    for (int i = 0; i < 32; ++i) {
+        fastchan::cpu_pause();
+    }
+    benchmark::DoNotOptimize(v);
+}
+
+// producerWork is the producer's own work that can wait, e.g. housekeeping or building the next burst
+static void producerWork(uint64_t &done) {
+    for (int i = 0; i < 8; ++i) {
+        fastchan::cpu_pause();
+    }
+    ++done;
+}
+
+template <bool throttle>
+static void Occupancy_Burst(benchmark::State& state) {
+    auto c = std::make_unique<Chan>(0.75, 0.25);
+    std::thread reader([&]() {
+        uint64_t v;
+        while (c->get(v)) {
+            consumerWork(v);
+        }
+    });
+
+    uint64_t puts = 0, stalls = 0, own_work = 0;
+    for (auto _ : state) {
+        for (std::size_t i = 0; i < burst; ++i) {
+            if constexpr (throttle) {
+                while (c->isAboveWatermark()) {
+                    producerWork(own_work);
+                }
+            }
+            // a put that finds the channel full is one that waits
+            if (c->isFull()) {
+                ++stalls;
+            }
+            c->put(puts++);
+        }
+    }
+
+    c->close();
+    reader.join();
+
+    auto stats = c->occupancy();
+    state.counters["stalls_per_burst"] = benchmark::Counter(double(stalls) / double(state.iterations()));
+    state.counters["own_work_per_burst"] = benchmark::Counter(double(own_work) / double(state.iterations()));
+    state.counters["full"] = benchmark::Counter(stats.fullFraction());
+    state.counters["p99"] = benchmark::Counter(double(stats.percentile(0.99)));
+    state.counters["recommended"] = benchmark::Counter(double(stats.recommendedCapacity()));
+    state.SetItemsProcessed(int64_t(puts));
+}
+
+BENCHMARK_TEMPLATE(Occupancy_Burst, false)->UseRealTime();
+BENCHMARK_TEMPLATE(Occupancy_Burst, true)->UseRealTime();
+
+// what the sampling costs a put, against the same channel without the wrapper
+template <class C>
+static void Occupancy_PutGet(benchmark::State& state) {
+    auto c = std::make_unique<C>();
+    uint64_t v = 0;
+    for (auto _ : state) {
+        c->put(v);
+        c->get(v);
+    }
+    benchmark::DoNotOptimize(v);
+}
+
+BENCHMARK_TEMPLATE(Occupancy_PutGet, fastchan::SPSC<uint64_t, 256, fastchan::PauseWaitStrategy, fastchan::PauseWaitStrategy>);
+BENCHMARK_TEMPLATE(Occupancy_PutGet, fastchan::Monitored<fastchan::SPSC<uint64_t, 256, fastchan::PauseWaitStrategy, fastchan::PauseWaitStrategy>>);
+
+// Run the benchmark
+BENCHMARK_MAIN();
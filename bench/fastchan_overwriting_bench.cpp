@@ -0,0 +1,93 @@
+#include <benchmark/benchmark.h>
+
+#include <cstdint>
+#include <mpsc.hpp>
+#include <overwriting.hpp>
+#include <spsc.hpp>
+#include <thread>
+
+// the consumer is deliberately slower than the producer so the blocking channels spend their time waiting on a
+// full buffer while the overwriting ones keep going and drop the oldest entries instead
+static inline void slowConsumer() {
+    for (int i = 0; i < 32; ++i) {
+        fastchan::cpu_pause();
+    }
+}
+
+template <size_t min_size, class wait_type>
+static void SPSC_SlowConsumer_Put(benchmark::State& state) {
+    fastchan::SPSC<uint64_t, min_size, wait_type, wait_type> c;
+    std::thread reader([&]() {
+        uint64_t it;
+        while (c.get(it)) {
+            slowConsumer();
+        }
+    });
+
+    uint64_t i = 0;
+    for (auto _ : state) {
+        c.put(++i);
+    }
+    c.close();
+    reader.join();
+}
+
+BENCHMARK_TEMPLATE(SPSC_SlowConsumer_Put, 1024, fastchan::PauseWaitStrategy);
+BENCHMARK_TEMPLATE(SPSC_SlowConsumer_Put, 65'536, fastchan::PauseWaitStrategy);
+BENCHMARK_TEMPLATE(SPSC_SlowConsumer_Put, 1024, fastchan::YieldWaitStrategy);
+BENCHMARK_TEMPLATE(SPSC_SlowConsumer_Put, 65'536, fastchan::YieldWaitStrategy);
+
+template <size_t min_size, class wait_type>
+static void MPSC_SlowConsumer_Put(benchmark::State& state) {
+    fastchan::MPSC<uint64_t, min_size, wait_type, wait_type> c;
+    std::thread reader([&]() {
+        uint64_t it;
+        while (c.get(it)) {
+            slowConsumer();
+        }
+    });
+
+    uint64_t i = 0;
+    for (auto _ : state) {
+        c.put(++i);
+    }
+    c.close();
+    reader.join();
+}
+
+BENCHMARK_TEMPLATE(MPSC_SlowConsumer_Put, 1024, fastchan::PauseWaitStrategy);
+BENCHMARK_TEMPLATE(MPSC_SlowConsumer_Put, 65'536, fastchan::PauseWaitStrategy);
+BENCHMARK_TEMPLATE(MPSC_SlowConsumer_Put, 1024, fastchan::YieldWaitStrategy);
+BENCHMARK_TEMPLATE(MPSC_SlowConsumer_Put, 65'536, fastchan::YieldWaitStrategy);
+
+template <class Chan>
+static void Overwriting_SlowConsumer_Put(benchmark::State& state) {
+    Chan c;
+    std::thread reader([&]() {
+        uint64_t it;
+        while (c.get(it)) {
+            slowConsumer();
+        }
+    });
+
+    uint64_t i = 0;
+    for (auto _ : state) {
+        c.put(++i);
+    }
+    c.close();
+    reader.join();
+
+    state.counters["dropped"] = benchmark::Counter(double(c.dropped()), benchmark::Counter::kAvgIterations);
+}
+
+BENCHMARK_TEMPLATE(Overwriting_SlowConsumer_Put, fastchan::OverwritingSPSC<uint64_t, 1024, fastchan::PauseWaitStrategy>);
+BENCHMARK_TEMPLATE(Overwriting_SlowConsumer_Put, fastchan::OverwritingSPSC<uint64_t, 65'536, fastchan::PauseWaitStrategy>);
+BENCHMARK_TEMPLATE(Overwriting_SlowConsumer_Put, fastchan::OverwritingSPSC<uint64_t, 1024, fastchan::YieldWaitStrategy>);
+BENCHMARK_TEMPLATE(Overwriting_SlowConsumer_Put, fastchan::OverwritingSPSC<uint64_t, 65'536, fastchan::YieldWaitStrategy>);
+BENCHMARK_TEMPLATE(Overwriting_SlowConsumer_Put, fastchan::OverwritingMPSC<uint64_t, 1024, fastchan::PauseWaitStrategy>);
+BENCHMARK_TEMPLATE(Overwriting_SlowConsumer_Put, fastchan::OverwritingMPSC<uint64_t, 65'536, fastchan::PauseWaitStrategy>);
+BENCHMARK_TEMPLATE(Overwriting_SlowConsumer_Put, fastchan::OverwritingMPSC<uint64_t, 1024, fastchan::YieldWaitStrategy>);
+BENCHMARK_TEMPLATE(Overwriting_SlowConsumer_Put, fastchan::OverwritingMPSC<uint64_t, 65'536, fastchan::YieldWaitStrategy>);
+
+// Run the benchmark
+BENCHMARK_MAIN();
@@ -0,0 +1,91 @@
+#include <benchmark/benchmark.h>
+
+#include <cstdint>
+#include <pipeline.hpp>
+#include <spsc.hpp>
+#include <string>
+#include <thread>
+
+struct Raw {
+    uint64_t seq;
+    uint32_t px_ticks;
+};
+
+struct Normalized {
+    uint64_t seq;
+    double px;
+};
+
+using RawChan = fastchan::SPSC<Raw, 4096, fastchan::PauseWaitStrategy, fastchan::PauseWaitStrategy>;
+using NormChan = fastchan::SPSC<Normalized, 4096, fastchan::PauseWaitStrategy, fastchan::PauseWaitStrategy>;
+
+// what we do today, a thread per stage moving one entry at a time with get and put
+static void HandWired_Pipeline(benchmark::State& state) {
+    RawChan raw;
+    NormChan normalized;
+    NormChan enriched;
+
+    // every stage drains its input once it's closed and then closes its output, so the close ripples down the line
+    std::thread normalize([&]() {
+        Raw r;
+        while (raw.get(r)) {
+            normalized.put(Normalized{r.seq, double(r.px_ticks) / 4});
+        }
+        normalized.close();
+    });
+    std::thread enrich([&]() {
+        Normalized n;
+        while (normalized.get(n)) {
+            enriched.put(Normalized{n.seq, n.px + 1});
+        }
+        enriched.close();
+    });
+    std::thread publish([&]() {
+        Normalized n;
+        while (enriched.get(n)) {
+            benchmark::DoNotOptimize(n);
+        }
+    });
+
+    uint64_t i = 0;
+    for (auto _ : state) {
+        raw.put(Raw{++i, uint32_t(i)});
+    }
+    raw.close();
+
+    normalize.join();
+    enrich.join();
+    publish.join();
+
+    state.SetItemsProcessed(state.iterations());
+}
+
+BENCHMARK(HandWired_Pipeline)->UseRealTime();
+
+// the same three stages on a Pipeline, with state.range(0) as the largest batch a stage takes off its input at once
+static void Pipeline_Throughput(benchmark::State& state) {
+    fastchan::Pipeline<fastchan::PauseWaitStrategy> pipeline(fastchan::Topology::fromAffinity(1), std::size_t(state.range(0)));
+    auto& raw = pipeline.channel<RawChan>();
+    auto& normalized = pipeline.stage<NormChan>("normalize", raw, [](const Raw& r) { return Normalized{r.seq, double(r.px_ticks) / 4}; });
+    auto& enriched = pipeline.stage<NormChan>("enrich", normalized, [](const Normalized& n) { return Normalized{n.seq, n.px + 1}; });
+    pipeline.sink("publish", enriched, [](const Normalized* data, std::size_t) { benchmark::DoNotOptimize(data); });
+    pipeline.start();
+
+    uint64_t i = 0;
+    for (auto _ : state) {
+        raw.put(Raw{++i, uint32_t(i)});
+    }
+    pipeline.stop();
+
+    state.SetItemsProcessed(state.iterations());
+    for (auto& stage : pipeline.stats()) {
+        state.counters[stage.name + "_utilisation"] = stage.utilisation();
+        state.counters[stage.name + "_avg_batch"] = stage.avgBatch();
+        state.counters[stage.name + "_avg_occupancy"] = stage.avgOccupancy();
+    }
+}
+
+BENCHMARK(Pipeline_Throughput)->Arg(1)->Arg(16)->Arg(256)->UseRealTime();
+
+// Run the benchmark
+BENCHMARK_MAIN();
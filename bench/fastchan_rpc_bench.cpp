@@ -0,0 +1,68 @@
+#include <benchmark/benchmark.h>
+
+#include <atomic>
+#include <cstdint>
+#include <rpc.hpp>
+#include <spsc.hpp>
+#include <thread>
+
+// a round trip through an RPCChannel to a server thread that adds one
+template <class request_wait_type, class reply_wait_type>
+static void RPCChannel_RoundTrip(benchmark::State& state) {
+    fastchan::RPCChannel<uint64_t, uint64_t, 16, request_wait_type, reply_wait_type> rpc;
+    std::atomic_bool running = true;
+
+    std::thread server([&]() {
+        while (running) {
+            rpc.try_serve_for([](const uint64_t& v) { return v + 1; }, std::chrono::milliseconds(1));
+        }
+    });
+
+    uint64_t i = 0;
+    for (auto _ : state) {
+        auto reply = rpc.call(i).get();
+        benchmark::DoNotOptimize(reply);
+        ++i;
+    }
+
+    running = false;
+    server.join();
+}
+
+// the same round trip through two SPSCs paired by hand, one for requests and one for replies
+template <class wait_type>
+static void SPSCPair_RoundTrip(benchmark::State& state) {
+    fastchan::SPSC<uint64_t, 16, wait_type, wait_type> requests;
+    fastchan::SPSC<uint64_t, 16, wait_type, wait_type> replies;
+    std::atomic_bool running = true;
+
+    std::thread server([&]() {
+        while (running) {
+            if (auto request = requests.try_get_for(std::chrono::milliseconds(1))) {
+                replies.put(*request + 1);
+            }
+        }
+    });
+
+    uint64_t i = 0;
+    for (auto _ : state) {
+        requests.put(i);
+        auto reply = replies.get();
+        benchmark::DoNotOptimize(reply);
+        ++i;
+    }
+
+    running = false;
+    server.join();
+}
+
+BENCHMARK_TEMPLATE(RPCChannel_RoundTrip, fastchan::PauseWaitStrategy, fastchan::PauseWaitStrategy)->UseRealTime();
+BENCHMARK_TEMPLATE(RPCChannel_RoundTrip, fastchan::YieldWaitStrategy, fastchan::YieldWaitStrategy)->UseRealTime();
+BENCHMARK_TEMPLATE(RPCChannel_RoundTrip, fastchan::CVWaitStrategy, fastchan::CVWaitStrategy)->UseRealTime();
+BENCHMARK_TEMPLATE(RPCChannel_RoundTrip, fastchan::SpinCVWaitStrategy<256>, fastchan::SpinCVWaitStrategy<256>)->UseRealTime();
+BENCHMARK_TEMPLATE(SPSCPair_RoundTrip, fastchan::PauseWaitStrategy)->UseRealTime();
+BENCHMARK_TEMPLATE(SPSCPair_RoundTrip, fastchan::YieldWaitStrategy)->UseRealTime();
+BENCHMARK_TEMPLATE(SPSCPair_RoundTrip, fastchan::CVWaitStrategy)->UseRealTime();
+
+// Run the benchmark
+BENCHMARK_MAIN();
@@ -0,0 +1,117 @@
+#include <benchmark/benchmark.h>
+
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include <seqlock.hpp>
+#include <thread>
+#include <vector>
+
+struct TopOfBook {
+    uint64_t ts;
+    double bid_px;
+    double ask_px;
+    uint32_t bid_qty;
+    uint32_t ask_qty;
+};
+
+template <typename T>
+class MutexCell {
+   public:
+    void put(const T &value) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        value_ = value;
+    }
+
+    T get() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return value_;
+    }
+
+   private:
+    std::mutex mutex_;
+    T value_{};
+};
+
+// the writer publishes in the measured loop while state.range(0) readers hammer the cell, reads is the aggregate
+// read rate across all readers
+template <class Cell>
+static void ReaderScaling(benchmark::State &state) {
+    Cell cell;
+    const auto num_readers = state.range(0);
+    std::atomic_bool shouldRun = true;
+    std::atomic<uint64_t> reads = 0;
+
+    std::vector<std::thread> readers;
+    for (auto i = 0; i < num_readers; ++i) {
+        readers.emplace_back([&]() {
+            uint64_t local = 0;
+            while (shouldRun.load(std::memory_order_relaxed)) {
+                auto val = cell.get();
+                benchmark::DoNotOptimize(val);
+                ++local;
+            }
+            reads.fetch_add(local, std::memory_order_relaxed);
+        });
+    }
+
+    uint64_t ts = 0;
+    for (auto _ : state) {
+        cell.put(TopOfBook{++ts, 99.5, 100.5, 10, 12});
+    }
+    shouldRun = false;
+
+    for (auto &reader : readers) {
+        reader.join();
+    }
+
+    state.counters["reads"] = benchmark::Counter(double(reads.load()), benchmark::Counter::kIsRate);
+    state.counters["reads_per_reader"] = benchmark::Counter(double(reads.load()) / double(num_readers), benchmark::Counter::kIsRate);
+}
+
+BENCHMARK_TEMPLATE(ReaderScaling, fastchan::SeqLockCell<TopOfBook, fastchan::NoOpWaitStrategy>)->RangeMultiplier(2)->Range(1, 32)->UseRealTime();
+BENCHMARK_TEMPLATE(ReaderScaling, MutexCell<TopOfBook>)->RangeMultiplier(2)->Range(1, 32)->UseRealTime();
+
+// readers block in getNext until the writer moves the version on
+template <class wait_type>
+static void SeqLock_GetNext(benchmark::State &state) {
+    fastchan::SeqLockCell<TopOfBook, wait_type> cell;
+    const auto num_readers = state.range(0);
+    std::atomic_bool shouldRun = true;
+    std::atomic<uint64_t> reads = 0;
+
+    std::vector<std::thread> readers;
+    for (auto i = 0; i < num_readers; ++i) {
+        readers.emplace_back([&]() {
+            uint64_t local = 0;
+            std::size_t version = 0;
+            while (shouldRun.load(std::memory_order_relaxed)) {
+                auto val = cell.getNext(version);
+                benchmark::DoNotOptimize(val);
+                ++local;
+            }
+            reads.fetch_add(local, std::memory_order_relaxed);
+        });
+    }
+
+    uint64_t ts = 0;
+    for (auto _ : state) {
+        cell.put(TopOfBook{++ts, 99.5, 100.5, 10, 12});
+    }
+    shouldRun = false;
+
+    // clear any blocks
+    cell.put(TopOfBook{});
+    for (auto &reader : readers) {
+        reader.join();
+    }
+
+    state.counters["reads"] = benchmark::Counter(double(reads.load()), benchmark::Counter::kIsRate);
+}
+
+BENCHMARK_TEMPLATE(SeqLock_GetNext, fastchan::PauseWaitStrategy)->RangeMultiplier(2)->Range(1, 32)->UseRealTime();
+BENCHMARK_TEMPLATE(SeqLock_GetNext, fastchan::YieldWaitStrategy)->RangeMultiplier(2)->Range(1, 32)->UseRealTime();
+BENCHMARK_TEMPLATE(SeqLock_GetNext, fastchan::CVWaitStrategy)->RangeMultiplier(2)->Range(1, 32)->UseRealTime();
+
+// Run the benchmark
+BENCHMARK_MAIN();
@@ -0,0 +1,119 @@
+#include <benchmark/benchmark.h>
+
+#include <array>
+#include <cstdint>
+#include <mpsc.hpp>
+#include <sharded.hpp>
+#include <thread>
+
+// MPSC_BlockingBoth_Put from fastchan_bench, so the two can be compared side by side for the same producer counts
+template <size_t min_size, int num_producers, class wait_type>
+static void MPSC_BlockingBoth_Put(benchmark::State& state) {
+    fastchan::MPSC<uint8_t, min_size, wait_type, wait_type> c;
+
+    // the reader drains whatever's left once the channel's closed and then stops
+    std::thread reader([&]() {
+        uint8_t it;
+        while (c.get(it)) {
+            benchmark::DoNotOptimize(it);
+        }
+    });
+
+    // create n-1 producers
+    std::array<std::thread, num_producers - 1> producers;
+    for (auto i = 0; i < num_producers - 1; ++i) {
+        producers[i] = std::thread([&]() {
+            while (!c.isClosed()) {
+                c.put(0);
+            }
+        });
+    }
+
+    for (auto _ : state) {
+        c.put(0);
+    }
+
+    // closing wakes up anyone blocked on either side
+    c.close();
+
+    for (auto i = 0; i < num_producers - 1; ++i) {
+        producers[i].join();
+    }
+
+    reader.join();
+}
+
+// the same spread across num_shards shards, each min_size so the total capacity grows with the shards. The reader
+// takes whatever's there in batches, which is what a sharded channel is for.
+template <size_t min_size, int num_producers, size_t num_shards, class wait_type, class affinity_type>
+static void ShardedMPSC_BlockingBoth_Put(benchmark::State& state) {
+    fastchan::ShardedMPSC<uint8_t, min_size, num_shards, wait_type, wait_type, affinity_type> c;
+
+    // the reader waits in get when there's nothing to take in a batch, which returns false once the channel's closed
+    // and drained
+    std::thread reader([&]() {
+        std::array<uint8_t, 256> batch;
+        uint8_t it;
+        while (c.getBatch(batch.data(), batch.size()) > 0 || c.get(it)) {
+            benchmark::ClobberMemory();
+        }
+    });
+
+    // create n-1 producers
+    std::array<std::thread, num_producers - 1> producers;
+    for (auto i = 0; i < num_producers - 1; ++i) {
+        producers[i] = std::thread([&]() {
+            while (!c.isClosed()) {
+                c.put(0);
+            }
+        });
+    }
+
+    for (auto _ : state) {
+        c.put(0);
+    }
+
+    // closing wakes up anyone blocked on either side
+    c.close();
+
+    for (auto i = 0; i < num_producers - 1; ++i) {
+        producers[i].join();
+    }
+
+    reader.join();
+}
+
+BENCHMARK_TEMPLATE(MPSC_BlockingBoth_Put, 1024, 1, fastchan::PauseWaitStrategy)->UseRealTime();
+BENCHMARK_TEMPLATE(MPSC_BlockingBoth_Put, 1024, 4, fastchan::PauseWaitStrategy)->UseRealTime();
+BENCHMARK_TEMPLATE(MPSC_BlockingBoth_Put, 1024, 16, fastchan::PauseWaitStrategy)->UseRealTime();
+BENCHMARK_TEMPLATE(MPSC_BlockingBoth_Put, 1024, 32, fastchan::PauseWaitStrategy)->UseRealTime();
+BENCHMARK_TEMPLATE(MPSC_BlockingBoth_Put, 1024, 64, fastchan::PauseWaitStrategy)->UseRealTime();
+BENCHMARK_TEMPLATE(ShardedMPSC_BlockingBoth_Put, 1024, 1, 16, fastchan::PauseWaitStrategy, fastchan::ThreadAffinity)->UseRealTime();
+BENCHMARK_TEMPLATE(ShardedMPSC_BlockingBoth_Put, 1024, 4, 16, fastchan::PauseWaitStrategy, fastchan::ThreadAffinity)->UseRealTime();
+BENCHMARK_TEMPLATE(ShardedMPSC_BlockingBoth_Put, 1024, 16, 16, fastchan::PauseWaitStrategy, fastchan::ThreadAffinity)->UseRealTime();
+BENCHMARK_TEMPLATE(ShardedMPSC_BlockingBoth_Put, 1024, 32, 16, fastchan::PauseWaitStrategy, fastchan::ThreadAffinity)->UseRealTime();
+BENCHMARK_TEMPLATE(ShardedMPSC_BlockingBoth_Put, 1024, 64, 16, fastchan::PauseWaitStrategy, fastchan::ThreadAffinity)->UseRealTime();
+BENCHMARK_TEMPLATE(ShardedMPSC_BlockingBoth_Put, 1024, 1, 16, fastchan::PauseWaitStrategy, fastchan::CPUAffinity)->UseRealTime();
+BENCHMARK_TEMPLATE(ShardedMPSC_BlockingBoth_Put, 1024, 4, 16, fastchan::PauseWaitStrategy, fastchan::CPUAffinity)->UseRealTime();
+BENCHMARK_TEMPLATE(ShardedMPSC_BlockingBoth_Put, 1024, 16, 16, fastchan::PauseWaitStrategy, fastchan::CPUAffinity)->UseRealTime();
+BENCHMARK_TEMPLATE(ShardedMPSC_BlockingBoth_Put, 1024, 32, 16, fastchan::PauseWaitStrategy, fastchan::CPUAffinity)->UseRealTime();
+BENCHMARK_TEMPLATE(ShardedMPSC_BlockingBoth_Put, 1024, 64, 16, fastchan::PauseWaitStrategy, fastchan::CPUAffinity)->UseRealTime();
+
+BENCHMARK_TEMPLATE(MPSC_BlockingBoth_Put, 1024, 1, fastchan::YieldWaitStrategy)->UseRealTime();
+BENCHMARK_TEMPLATE(MPSC_BlockingBoth_Put, 1024, 4, fastchan::YieldWaitStrategy)->UseRealTime();
+BENCHMARK_TEMPLATE(MPSC_BlockingBoth_Put, 1024, 16, fastchan::YieldWaitStrategy)->UseRealTime();
+BENCHMARK_TEMPLATE(MPSC_BlockingBoth_Put, 1024, 32, fastchan::YieldWaitStrategy)->UseRealTime();
+BENCHMARK_TEMPLATE(MPSC_BlockingBoth_Put, 1024, 64, fastchan::YieldWaitStrategy)->UseRealTime();
+BENCHMARK_TEMPLATE(ShardedMPSC_BlockingBoth_Put, 1024, 1, 16, fastchan::YieldWaitStrategy, fastchan::ThreadAffinity)->UseRealTime();
+BENCHMARK_TEMPLATE(ShardedMPSC_BlockingBoth_Put, 1024, 4, 16, fastchan::YieldWaitStrategy, fastchan::ThreadAffinity)->UseRealTime();
+BENCHMARK_TEMPLATE(ShardedMPSC_BlockingBoth_Put, 1024, 16, 16, fastchan::YieldWaitStrategy, fastchan::ThreadAffinity)->UseRealTime();
+BENCHMARK_TEMPLATE(ShardedMPSC_BlockingBoth_Put, 1024, 32, 16, fastchan::YieldWaitStrategy, fastchan::ThreadAffinity)->UseRealTime();
+BENCHMARK_TEMPLATE(ShardedMPSC_BlockingBoth_Put, 1024, 64, 16, fastchan::YieldWaitStrategy, fastchan::ThreadAffinity)->UseRealTime();
+BENCHMARK_TEMPLATE(ShardedMPSC_BlockingBoth_Put, 1024, 1, 16, fastchan::YieldWaitStrategy, fastchan::CPUAffinity)->UseRealTime();
+BENCHMARK_TEMPLATE(ShardedMPSC_BlockingBoth_Put, 1024, 4, 16, fastchan::YieldWaitStrategy, fastchan::CPUAffinity)->UseRealTime();
+BENCHMARK_TEMPLATE(ShardedMPSC_BlockingBoth_Put, 1024, 16, 16, fastchan::YieldWaitStrategy, fastchan::CPUAffinity)->UseRealTime();
+BENCHMARK_TEMPLATE(ShardedMPSC_BlockingBoth_Put, 1024, 32, 16, fastchan::YieldWaitStrategy, fastchan::CPUAffinity)->UseRealTime();
+BENCHMARK_TEMPLATE(ShardedMPSC_BlockingBoth_Put, 1024, 64, 16, fastchan::YieldWaitStrategy, fastchan::CPUAffinity)->UseRealTime();
+
+// Run the benchmark
+BENCHMARK_MAIN();
@@ -0,0 +1,139 @@
+#include <arpa/inet.h>
+#include <benchmark/benchmark.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <mpsc.hpp>
+#include <socket_bridge.hpp>
+#include <spsc.hpp>
+#include <thread>
+#include <utility>
+
+struct Msg {
+    uint64_t ts_ns;
+    uint64_t seq;
+    char payload[48];
+};
+
+static uint64_t nowNs() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// a connected pair of loopback sockets, UDP for SOCK_DGRAM and TCP for SOCK_STREAM
+static std::pair<int, int> loopbackPair(int type) {
+    sockaddr_in addr{};
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    socklen_t len = sizeof(addr);
+
+    int a = ::socket(AF_INET, type, 0);
+    int b = ::socket(AF_INET, type, 0);
+    int size = 4 << 20;
+    ::setsockopt(b, SOL_SOCKET, SO_RCVBUF, &size, sizeof(size));
+
+    sockaddr_in addr_b = addr;
+    ::bind(b, reinterpret_cast<sockaddr*>(&addr_b), len);
+    ::getsockname(b, reinterpret_cast<sockaddr*>(&addr_b), &len);
+
+    if (type == SOCK_STREAM) {
+        ::listen(b, 1);
+        ::connect(a, reinterpret_cast<sockaddr*>(&addr_b), len);
+        int accepted = ::accept(b, nullptr, nullptr);
+        ::close(b);
+        b = accepted;
+        int one = 1;
+        ::setsockopt(a, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+    } else {
+        sockaddr_in addr_a = addr;
+        ::bind(a, reinterpret_cast<sockaddr*>(&addr_a), len);
+        ::getsockname(a, reinterpret_cast<sockaddr*>(&addr_a), &len);
+        ::connect(a, reinterpret_cast<sockaddr*>(&addr_b), len);
+        ::connect(b, reinterpret_cast<sockaddr*>(&addr_a), len);
+    }
+
+    return {a, b};
+}
+
+// the producer puts into an MPSC, a forwarder moves it onto a loopback socket, and a receiver bridges it into an SPSC
+// it reads back from. batched forwards with SocketSender, otherwise it's one get and one send per message.
+template <bool batched>
+static void Bridge_Forward(benchmark::State& state) {
+    using Out = fastchan::MPSC<Msg, 4096, fastchan::YieldWaitStrategy, fastchan::YieldWaitStrategy>;
+    using In = fastchan::SPSC<Msg, 4096, fastchan::NoOpWaitStrategy, fastchan::NoOpWaitStrategy>;
+    Out out;
+    In in;
+    auto sockets = loopbackPair(int(state.range(0)));
+
+    std::atomic_bool producing = true;
+    std::atomic_bool receiving = true;
+    uint64_t syscalls = 0;
+    std::thread forwarder([&]() {
+        if constexpr (batched) {
+            fastchan::SocketSender<Out> sender(out, sockets.first);
+            while (producing || !out.isEmpty()) {
+                if (sender.poll() == 0) {
+                    std::this_thread::yield();
+                }
+            }
+            syscalls = sender.stats().syscalls;
+        } else {
+            while (producing || !out.isEmpty()) {
+                if (out.isEmpty()) {
+                    std::this_thread::yield();
+                    continue;
+                }
+                auto msg = out.get();
+                ::send(sockets.first, &msg, sizeof(msg), MSG_NOSIGNAL);
+                ++syscalls;
+            }
+        }
+    });
+
+    uint64_t received = 0;
+    uint64_t latency_ns = 0;
+    std::thread receiver([&]() {
+        fastchan::SocketReceiver<In> bridge(in, sockets.second, 256);
+        while (receiving) {
+            if (bridge.poll() == 0) {
+                std::this_thread::yield();
+            }
+            in.drain([&](const Msg* data, std::size_t count) {
+                auto now = nowNs();
+                for (std::size_t i = 0; i < count; ++i) {
+                    latency_ns += now - data[i].ts_ns;
+                }
+                received += count;
+            });
+        }
+    });
+
+    uint64_t seq = 0;
+    for (auto _ : state) {
+        out.put(Msg{nowNs(), ++seq, {}});
+    }
+    producing = false;
+    forwarder.join();
+
+    // give whatever is still in flight a moment to arrive, anything after that counts as dropped
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    receiving = false;
+    receiver.join();
+    ::close(sockets.first);
+    ::close(sockets.second);
+
+    state.SetItemsProcessed(state.iterations());
+    state.counters["msgs_per_syscall"] = double(seq) / double(syscalls ? syscalls : 1);
+    state.counters["avg_latency_us"] = received ? double(latency_ns) / double(received) / 1e3 : 0;
+    state.counters["dropped"] = double(seq - received);
+}
+
+BENCHMARK_TEMPLATE(Bridge_Forward, false)->Arg(SOCK_DGRAM)->Arg(SOCK_STREAM)->UseRealTime();
+BENCHMARK_TEMPLATE(Bridge_Forward, true)->Arg(SOCK_DGRAM)->Arg(SOCK_STREAM)->UseRealTime();
+
+// Run the benchmark
+BENCHMARK_MAIN();
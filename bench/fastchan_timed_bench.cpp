@@ -0,0 +1,83 @@
+#include <benchmark/benchmark.h>
+
+#include <chrono>
+#include <cstdint>
+#include <mpsc.hpp>
+#include <spsc.hpp>
+#include <thread>
+
+using namespace std::chrono_literals;
+
+// the cost of the deadline check on a busy channel, compared against the plain blocking get
+template <size_t min_size, class wait_type>
+static void SPSC_Get(benchmark::State& state) {
+    fastchan::SPSC<uint8_t, min_size, wait_type, wait_type> c;
+    std::thread writer([&]() {
+        while (!c.isClosed()) {
+            c.put(0);
+        }
+    });
+
+    for (auto _ : state) {
+        auto&& it = c.get();
+        benchmark::DoNotOptimize(it);
+    }
+
+    // closing wakes the writer if it's blocked on a full channel
+    c.close();
+    writer.join();
+}
+
+BENCHMARK_TEMPLATE(SPSC_Get, 1024, fastchan::PauseWaitStrategy);
+BENCHMARK_TEMPLATE(SPSC_Get, 1024, fastchan::YieldWaitStrategy);
+BENCHMARK_TEMPLATE(SPSC_Get, 1024, fastchan::CVWaitStrategy);
+
+template <size_t min_size, class wait_type>
+static void SPSC_TryGetFor(benchmark::State& state) {
+    fastchan::SPSC<uint8_t, min_size, wait_type, wait_type> c;
+    std::thread writer([&]() {
+        while (!c.isClosed()) {
+            c.put(0);
+        }
+    });
+
+    for (auto _ : state) {
+        auto&& it = c.try_get_for(200us);
+        benchmark::DoNotOptimize(it);
+    }
+
+    // closing wakes the writer if it's blocked on a full channel
+    c.close();
+    writer.join();
+}
+
+BENCHMARK_TEMPLATE(SPSC_TryGetFor, 1024, fastchan::PauseWaitStrategy);
+BENCHMARK_TEMPLATE(SPSC_TryGetFor, 1024, fastchan::YieldWaitStrategy);
+BENCHMARK_TEMPLATE(SPSC_TryGetFor, 1024, fastchan::CVWaitStrategy);
+
+// how far past the deadline a timed get on an empty channel returns
+template <class Chan>
+static void TryGetFor_Overshoot(benchmark::State& state) {
+    Chan c;
+    const auto timeout = std::chrono::microseconds(state.range(0));
+    int64_t overshoot = 0;
+
+    for (auto _ : state) {
+        auto start = std::chrono::steady_clock::now();
+        auto&& it = c.try_get_for(timeout);
+        benchmark::DoNotOptimize(it);
+        overshoot += std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start - timeout).count();
+    }
+
+    state.counters["overshoot_ns"] = benchmark::Counter(double(overshoot), benchmark::Counter::kAvgIterations);
+}
+
+BENCHMARK_TEMPLATE(TryGetFor_Overshoot, fastchan::SPSC<uint8_t, 1024, fastchan::PauseWaitStrategy, fastchan::PauseWaitStrategy>)->Arg(10)->Arg(200);
+BENCHMARK_TEMPLATE(TryGetFor_Overshoot, fastchan::SPSC<uint8_t, 1024, fastchan::YieldWaitStrategy, fastchan::YieldWaitStrategy>)->Arg(10)->Arg(200);
+BENCHMARK_TEMPLATE(TryGetFor_Overshoot, fastchan::SPSC<uint8_t, 1024, fastchan::CVWaitStrategy, fastchan::CVWaitStrategy>)->Arg(10)->Arg(200);
+BENCHMARK_TEMPLATE(TryGetFor_Overshoot, fastchan::MPSC<uint8_t, 1024, fastchan::PauseWaitStrategy, fastchan::PauseWaitStrategy>)->Arg(10)->Arg(200);
+BENCHMARK_TEMPLATE(TryGetFor_Overshoot, fastchan::MPSC<uint8_t, 1024, fastchan::YieldWaitStrategy, fastchan::YieldWaitStrategy>)->Arg(10)->Arg(200);
+BENCHMARK_TEMPLATE(TryGetFor_Overshoot, fastchan::MPSC<uint8_t, 1024, fastchan::CVWaitStrategy, fastchan::CVWaitStrategy>)->Arg(10)->Arg(200);
+
+// Run the benchmark
+BENCHMARK_MAIN();
@@ -0,0 +1,159 @@
+#include <benchmark/benchmark.h>
+
+#include <array>
+#include <cstdint>
+#include <memory>
+#include <spsc.hpp>
+#include <thread>
+#include <variant.hpp>
+#include <variant>
+
+// a market data feed: mostly quotes, then trades and heartbeats, and every so often a book snapshot that's an order
+// of magnitude bigger than the rest
+struct Quote {
+    uint64_t seq;
+    double bid;
+    double ask;
+    uint32_t bid_qty;
+    uint32_t ask_qty;
+};
+
+struct Trade {
+    uint64_t seq;
+    double price;
+    uint32_t qty;
+};
+
+struct Heartbeat {
+    uint64_t seq;
+};
+
+struct Snapshot {
+    uint64_t seq;
+    std::array<double, 40> levels;
+};
+
+using Messages = std::variant<Quote, Trade, Heartbeat, Snapshot>;
+
+// mix is which message the seq'th is: 70% quotes, 20% trades, 8% heartbeats and 2% snapshots, spread out
+static constexpr auto mix = [] {
+    std::array<uint8_t, 100> kinds{};
+    for (std::size_t i = 0; i < kinds.size(); ++i) {
+        kinds[(i * 37) % kinds.size()] = i < 70 ? 0 : i < 90 ? 1 : i < 98 ? 2 : 3;
+    }
+    return kinds;
+}();
+
+// Sum is the visitor, it reads every message so neither channel gets away without copying them
+struct Sum {
+    uint64_t total = 0;
+
+    void operator()(const Quote& m) { total += m.seq + m.bid_qty; }
+    void operator()(const Trade& m) { total += m.seq + m.qty; }
+    void operator()(const Heartbeat& m) { total += m.seq; }
+    void operator()(const Snapshot& m) { total += m.seq + uint64_t(m.levels[39]); }
+};
+
+template <class Chan>
+static void putNext(Chan& c, uint64_t seq) {
+    switch (mix[seq % mix.size()]) {
+        case 0:
+            c.put(Quote{seq, 99.5, 100.5, 10, 20});
+            break;
+        case 1:
+            c.put(Trade{seq, 100.0, 5});
+            break;
+        case 2:
+            c.put(Heartbeat{seq});
+            break;
+        default:
+            c.put(Snapshot{seq, {}});
+            break;
+    }
+}
+
+// both channels get the same number of bytes, which is min_size slots of the std::variant
+template <size_t min_size, class wait_type>
+using SlotChan = fastchan::SPSC<Messages, min_size, wait_type, wait_type>;
+
+template <size_t min_size, class wait_type>
+using RecordChan = fastchan::VariantSPSC<Messages, min_size * sizeof(Messages), wait_type, wait_type>;
+
+// a put and a get on the same thread
+template <size_t min_size, class wait_type>
+static void SPSCOfVariant_PutGet(benchmark::State& state) {
+    auto c = std::make_unique<SlotChan<min_size, wait_type>>();
+    Sum sum;
+    uint64_t seq = 0;
+    for (auto _ : state) {
+        putNext(*c, seq++);
+        std::visit(sum, c->get());
+    }
+    benchmark::DoNotOptimize(sum.total);
+}
+
+template <size_t min_size, class wait_type>
+static void VariantSPSC_PutGet(benchmark::State& state) {
+    auto c = std::make_unique<RecordChan<min_size, wait_type>>();
+    Sum sum;
+    uint64_t seq = 0;
+    for (auto _ : state) {
+        putNext(*c, seq++);
+        c->get(sum);
+    }
+    benchmark::DoNotOptimize(sum.total);
+}
+
+BENCHMARK_TEMPLATE(SPSCOfVariant_PutGet, 256, fastchan::PauseWaitStrategy);
+BENCHMARK_TEMPLATE(VariantSPSC_PutGet, 256, fastchan::PauseWaitStrategy);
+
+// a producer thread putting the mix as fast as a reader thread visits it
+template <size_t min_size, class wait_type>
+static void SPSCOfVariant_Put(benchmark::State& state) {
+    auto c = std::make_unique<SlotChan<min_size, wait_type>>();
+    std::thread reader([&]() {
+        Sum sum;
+        Messages it;
+        while (c->get(it)) {
+            std::visit(sum, it);
+        }
+        benchmark::DoNotOptimize(sum.total);
+    });
+
+    uint64_t seq = 0;
+    for (auto _ : state) {
+        putNext(*c, seq++);
+    }
+
+    c->close();
+    reader.join();
+}
+
+template <size_t min_size, class wait_type>
+static void VariantSPSC_Put(benchmark::State& state) {
+    auto c = std::make_unique<RecordChan<min_size, wait_type>>();
+    std::thread reader([&]() {
+        Sum sum;
+        while (c->get(sum)) {
+        }
+        benchmark::DoNotOptimize(sum.total);
+    });
+
+    uint64_t seq = 0;
+    for (auto _ : state) {
+        putNext(*c, seq++);
+    }
+
+    c->close();
+    reader.join();
+}
+
+BENCHMARK_TEMPLATE(SPSCOfVariant_Put, 256, fastchan::PauseWaitStrategy)->UseRealTime();
+BENCHMARK_TEMPLATE(VariantSPSC_Put, 256, fastchan::PauseWaitStrategy)->UseRealTime();
+BENCHMARK_TEMPLATE(SPSCOfVariant_Put, 256, fastchan::YieldWaitStrategy)->UseRealTime();
+BENCHMARK_TEMPLATE(VariantSPSC_Put, 256, fastchan::YieldWaitStrategy)->UseRealTime();
+BENCHMARK_TEMPLATE(SPSCOfVariant_Put, 256, fastchan::CVWaitStrategy)->UseRealTime();
+BENCHMARK_TEMPLATE(VariantSPSC_Put, 256, fastchan::CVWaitStrategy)->UseRealTime();
+
+// Run the benchmark
+BENCHMARK_MAIN();
@@ -0,0 +1,218 @@
+#include <benchmark/benchmark.h>
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <fstream>
+#include <mutex>
+#include <mpsc.hpp>
+#include <optional>
+#include <spsc.hpp>
+#include <thread>
+#include <utility>
+#include <wait_strategy.hpp>
+
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+// YieldNotifyStrategy yields like YieldWaitStrategy but claims to need notify, which is what every strategy cost
+// before the traits could tell the channels otherwise
+struct YieldNotifyStrategy : public fastchan::YieldWaitStrategy {
+    static constexpr bool needs_notify = true;
+
+    inline void notify() { notifies_.fetch_add(1, std::memory_order_relaxed); }
+
+   private:
+    std::atomic<uint64_t> notifies_{0};
+};
+
+// AlwaysNotifyCVStrategy is CVWaitStrategy without the waiter tracking, i.e. a mutex and notify_all on every notify
+struct AlwaysNotifyCVStrategy {
+    template <class Predicate>
+    inline void wait(Predicate p) {
+        std::unique_lock<std::mutex> lock(mutex_);
+        cv_.wait_for(lock, std::chrono::nanoseconds(100), p);
+    }
+    template <class Predicate>
+    inline void wait_until(Predicate p, const fastchan::Deadline &deadline) {
+        std::unique_lock<std::mutex> lock(mutex_);
+        cv_.wait_until(lock, deadline.time_point(), p);
+    }
+    inline void notify() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        cv_.notify_all();
+    }
+
+   private:
+    std::condition_variable cv_;
+    std::mutex mutex_;
+};
+
+// a busy channel with the consumer timed, so it's the put/get round trip including any notify and spinning
+template <template <class, size_t, class, class> class Chan, class wait_type>
+static void PutGet(benchmark::State &state) {
+    Chan<uint64_t, 1024, wait_type, wait_type> c;
+    std::thread writer([&]() {
+        uint64_t i = 0;
+        while (!c.isClosed()) {
+            c.put(i++);
+        }
+    });
+
+    for (auto _ : state) {
+        auto &&it = c.get();
+        benchmark::DoNotOptimize(it);
+    }
+
+    // closing wakes the writer if it's blocked on a full channel
+    c.close();
+    writer.join();
+}
+
+BENCHMARK_TEMPLATE(PutGet, fastchan::SPSC, fastchan::PauseWaitStrategy);
+BENCHMARK_TEMPLATE(PutGet, fastchan::SPSC, fastchan::WFEWaitStrategy);
+BENCHMARK_TEMPLATE(PutGet, fastchan::SPSC, fastchan::YieldWaitStrategy);
+BENCHMARK_TEMPLATE(PutGet, fastchan::SPSC, YieldNotifyStrategy);
+BENCHMARK_TEMPLATE(PutGet, fastchan::SPSC, AlwaysNotifyCVStrategy);
+BENCHMARK_TEMPLATE(PutGet, fastchan::SPSC, fastchan::CVWaitStrategy);
+BENCHMARK_TEMPLATE(PutGet, fastchan::SPSC, fastchan::SpinCVWaitStrategy<64>);
+BENCHMARK_TEMPLATE(PutGet, fastchan::SPSC, fastchan::SpinCVWaitStrategy<1024>);
+BENCHMARK_TEMPLATE(PutGet, fastchan::MPSC, fastchan::PauseWaitStrategy);
+BENCHMARK_TEMPLATE(PutGet, fastchan::MPSC, fastchan::WFEWaitStrategy);
+BENCHMARK_TEMPLATE(PutGet, fastchan::MPSC, fastchan::YieldWaitStrategy);
+BENCHMARK_TEMPLATE(PutGet, fastchan::MPSC, YieldNotifyStrategy);
+BENCHMARK_TEMPLATE(PutGet, fastchan::MPSC, AlwaysNotifyCVStrategy);
+BENCHMARK_TEMPLATE(PutGet, fastchan::MPSC, fastchan::CVWaitStrategy);
+BENCHMARK_TEMPLATE(PutGet, fastchan::MPSC, fastchan::SpinCVWaitStrategy<64>);
+BENCHMARK_TEMPLATE(PutGet, fastchan::MPSC, fastchan::SpinCVWaitStrategy<1024>);
+
+// mixed load, the producer sends bursts of 256 with a gap between them so the consumer alternates between keeping up
+// and parking on an empty channel
+template <template <class, size_t, class, class> class Chan, class wait_type>
+static void PutGet_Bursty(benchmark::State &state) {
+    Chan<uint64_t, 1024, wait_type, wait_type> c;
+    std::thread writer([&]() {
+        uint64_t i = 0;
+        while (!c.isClosed()) {
+            for (int burst = 0; burst < 256; ++burst) {
+                c.put(i++);
+            }
+            std::this_thread::sleep_for(std::chrono::microseconds(20));
+        }
+    });
+
+    for (auto _ : state) {
+        auto &&it = c.get();
+        benchmark::DoNotOptimize(it);
+    }
+
+    // closing wakes the writer if it's blocked on a full channel
+    c.close();
+    writer.join();
+}
+
+BENCHMARK_TEMPLATE(PutGet_Bursty, fastchan::SPSC, AlwaysNotifyCVStrategy);
+BENCHMARK_TEMPLATE(PutGet_Bursty, fastchan::SPSC, fastchan::CVWaitStrategy);
+BENCHMARK_TEMPLATE(PutGet_Bursty, fastchan::MPSC, AlwaysNotifyCVStrategy);
+BENCHMARK_TEMPLATE(PutGet_Bursty, fastchan::MPSC, fastchan::CVWaitStrategy);
+
+// the round trip through a ping and a pong channel with an echo thread in between, so it's how long the waiting side
+// takes to notice a put, twice over
+template <class wait_type>
+static void PingPong(benchmark::State &state) {
+    fastchan::SPSC<uint64_t, 16, wait_type, wait_type> ping, pong;
+    std::thread echo([&]() {
+        uint64_t it;
+        while (ping.get(it)) {
+            pong.put(it);
+        }
+    });
+
+    uint64_t i = 0;
+    for (auto _ : state) {
+        ping.put(i++);
+        auto &&it = pong.get();
+        benchmark::DoNotOptimize(it);
+    }
+
+    ping.close();
+    echo.join();
+}
+
+BENCHMARK_TEMPLATE(PingPong, fastchan::PauseWaitStrategy)->UseRealTime();
+BENCHMARK_TEMPLATE(PingPong, fastchan::TPauseWaitStrategy<>)->UseRealTime();
+BENCHMARK_TEMPLATE(PingPong, fastchan::UMWaitStrategy<>)->UseRealTime();
+BENCHMARK_TEMPLATE(PingPong, fastchan::CVWaitStrategy)->UseRealTime();
+
+// smtSiblings is a pair of hyperthreads on the same core, from the kernel's topology for cpu0
+static std::optional<std::pair<int, int>> smtSiblings() {
+#ifdef __linux__
+    std::ifstream list("/sys/devices/system/cpu/cpu0/topology/thread_siblings_list");
+    int first, second;
+    char sep;
+    if (list >> first >> sep >> second && first != second) {
+        return std::make_pair(first, sep == '-' ? first + 1 : second);
+    }
+#endif
+    return std::nullopt;
+}
+
+#ifdef __linux__
+static void pinTo(int cpu) {
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(cpu, &set);
+    pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+}
+#endif
+
+// how much work a thread gets through on one hyperthread while a consumer waits on an empty channel on the other, so
+// the less of the core the wait takes up, the more work there is per second. There's no pinning other than on Linux.
+template <class wait_type>
+static void SiblingWork(benchmark::State &state) {
+#ifdef __linux__
+    auto siblings = smtSiblings();
+    if (!siblings) {
+        state.SkipWithError("there are no SMT siblings to pin to");
+        return;
+    }
+
+    cpu_set_t before;
+    pthread_getaffinity_np(pthread_self(), sizeof(before), &before);
+    pinTo(siblings->first);
+
+    fastchan::SPSC<uint64_t, 16, wait_type, wait_type> c;
+    std::thread waiter([&]() {
+        pinTo(siblings->second);
+        uint64_t it;
+        while (c.get(it)) {
+        }
+    });
+
+    uint64_t x = 1;
+    for (auto _ : state) {
+        for (int i = 0; i < 1000; ++i) {
+            x = x * 6364136223846793005ull + 1442695040888963407ull;
+        }
+        benchmark::DoNotOptimize(x);
+    }
+    state.counters["work"] = benchmark::Counter(double(state.iterations()) * 1000, benchmark::Counter::kIsRate);
+
+    c.close();
+    waiter.join();
+    pthread_setaffinity_np(pthread_self(), sizeof(before), &before);
+#else
+    state.SkipWithError("pinning to SMT siblings needs Linux");
+#endif
+}
+
+BENCHMARK_TEMPLATE(SiblingWork, fastchan::PauseWaitStrategy)->UseRealTime();
+BENCHMARK_TEMPLATE(SiblingWork, fastchan::TPauseWaitStrategy<>)->UseRealTime();
+BENCHMARK_TEMPLATE(SiblingWork, fastchan::UMWaitStrategy<>)->UseRealTime();
+BENCHMARK_TEMPLATE(SiblingWork, fastchan::CVWaitStrategy)->UseRealTime();
+
+// Run the benchmark
+BENCHMARK_MAIN();
@@ -0,0 +1,111 @@
+#include <benchmark/benchmark.h>
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mpsc.hpp>
+#include <thread>
+#include <vector>
+#include <work_stealing.hpp>
+
+constexpr int64_t num_leaves = 4096;
+
+// leaves have skewed costs, every 16th one is 64x the work of the rest, so dealing them out evenly leaves workers idle
+static int64_t leafWork(int64_t leaf) {
+    int64_t iterations = leaf % 16 == 0 ? 64 * 256 : 256;
+    int64_t acc = leaf;
+    for (int64_t i = 0; i < iterations; ++i) {
+        acc = acc * 6364136223846793005ll + 1442695040888963407ll;
+    }
+    return acc;
+}
+
+struct Split {
+    fastchan::WorkStealingPool<>* pool;
+    std::atomic<int64_t>* pending;
+    int64_t begin;
+    int64_t end;
+};
+
+static void split(void* arg) {
+    auto* range = static_cast<Split*>(arg);
+    while (range->end - range->begin > 1) {
+        auto mid = range->begin + (range->end - range->begin) / 2;
+        range->pool->submit(split, new Split{range->pool, range->pending, mid, range->end});
+        range->end = mid;
+    }
+    benchmark::DoNotOptimize(leafWork(range->begin));
+    range->pending->fetch_sub(1, std::memory_order_release);
+    delete range;
+}
+
+// a fork join over the leaves, split recursively on a work stealing pool
+static void ForkJoin_WorkStealing(benchmark::State& state) {
+    fastchan::WorkStealingPool<> pool(std::size_t(state.range(0)));
+    std::atomic<int64_t> pending = 0;
+
+    for (auto _ : state) {
+        pending.store(num_leaves, std::memory_order_relaxed);
+        pool.submit(split, new Split{&pool, &pending, 0, num_leaves});
+        while (pending.load(std::memory_order_acquire) > 0) {
+            std::this_thread::yield();
+        }
+    }
+
+    uint64_t stolen = 0;
+    pool.stop();
+    for (auto& stats : pool.stats()) {
+        stolen += stats.stolen;
+    }
+    state.SetItemsProcessed(state.iterations() * num_leaves);
+    state.counters["stolen_per_join"] = benchmark::Counter(double(stolen), benchmark::Counter::kAvgIterations);
+}
+
+BENCHMARK(ForkJoin_WorkStealing)->Arg(1)->Arg(2)->Arg(4)->UseRealTime();
+
+// what we do today, a dispatcher dealing the leaves out round robin onto an MPSC per worker
+static void ForkJoin_MPSCPerWorker(benchmark::State& state) {
+    using Inbox = fastchan::MPSC<int64_t, 4096, fastchan::YieldWaitStrategy, fastchan::YieldWaitStrategy>;
+    std::vector<std::unique_ptr<Inbox>> inboxes;
+    for (int64_t i = 0; i < state.range(0); ++i) {
+        inboxes.push_back(std::make_unique<Inbox>());
+    }
+
+    std::atomic<int64_t> pending = 0;
+    std::vector<std::thread> workers;
+    for (auto& inbox : inboxes) {
+        workers.emplace_back([&pending, &inbox]() {
+            while (true) {
+                auto leaf = inbox->get();
+                if (leaf < 0) {
+                    return;
+                }
+                benchmark::DoNotOptimize(leafWork(leaf));
+                pending.fetch_sub(1, std::memory_order_release);
+            }
+        });
+    }
+
+    for (auto _ : state) {
+        pending.store(num_leaves, std::memory_order_relaxed);
+        for (int64_t leaf = 0; leaf < num_leaves; ++leaf) {
+            inboxes[leaf % inboxes.size()]->put(leaf);
+        }
+        while (pending.load(std::memory_order_acquire) > 0) {
+            std::this_thread::yield();
+        }
+    }
+
+    for (auto& inbox : inboxes) {
+        inbox->put(-1);
+    }
+    for (auto& worker : workers) {
+        worker.join();
+    }
+    state.SetItemsProcessed(state.iterations() * num_leaves);
+}
+
+BENCHMARK(ForkJoin_MPSCPerWorker)->Arg(1)->Arg(2)->Arg(4)->UseRealTime();
+
+// Run the benchmark
+BENCHMARK_MAIN();
@@ -15,19 +15,15 @@
 #include "mpsc.hpp"
 #include "rigtorp/SPSCQueue.h"
 #include "spsc.hpp"
+#include "topology.hpp"
 
 using namespace fastchan;
 
 constexpr int num_iterations = 100'000'000;
 
 void set_affinity(int core_id) {
-    cpu_set_t cpuset;
-    CPU_ZERO(&cpuset);
-    CPU_SET(core_id, &cpuset);
-
-    int result = pthread_setaffinity_np(pthread_self(), sizeof(cpu_set_t), &cpuset);
-    if (result != 0) {
-        std::cerr << "Error setting thread affinity: " << result << std::endl;
+    if (!pinThisThread(core_id)) {
+        std::cerr << "Error setting thread affinity to core " << core_id << std::endl;
     }
 }
 
@@ -48,10 +44,9 @@ void consumer(Chan &chan, int cpu_id = -1) {
         set_affinity(cpu_id);
     }
 
-    int consumed = 0;
-    while (consumed < num_iterations) {
-        auto item = chan.get();
-        consumed++;
+    // the consumer drains the channel until it's closed once every producer's done
+    int item;
+    while (chan.get(item)) {
     }
 }
 
@@ -70,6 +65,7 @@ void run_benchmark(const std::string &name, int num_producers) {
     for (auto &t : producers) {
         t.join();
     }
+    chan.close();
     consumer_thread.join();
 
     auto end = std::chrono::steady_clock::now();
@@ -111,12 +107,15 @@ void run_spsc_benchmark_for_all_cpu_pairs(const std::string &name) {
                 consumer_ready.store(true, std::memory_order_release);
                 set_affinity(consumer_cpu);
                 int val;
-                for (int i = 0; i < num_iterations; ++i) {
-                    val = chan.get();
-                    if (val != i) {
+                int i = 0;
+                while (chan.get(val)) {
+                    if (val != i++) {
                         throw std::runtime_error("invalid result");
                     }
                 }
+                if (i != num_iterations) {
+                    throw std::runtime_error("missing results");
+                }
             });
 
             std::atomic<bool> start_bench = false;
@@ -130,6 +129,7 @@ void run_spsc_benchmark_for_all_cpu_pairs(const std::string &name) {
                 for (int i = 0; i < num_iterations; ++i) {
                     chan.put(i);
                 }
+                chan.close();
             });
 
             while (!producer_ready.load(std::memory_order_acquire) || !consumer_ready.load(std::memory_order_acquire)) {
@@ -140,8 +140,6 @@ void run_spsc_benchmark_for_all_cpu_pairs(const std::string &name) {
             start_bench.store(true, std::memory_order_release);
             producer_thread.join();
             consumer_thread.join();
-            while (!chan.isEmpty())
-                ;
 
             auto end = std::chrono::steady_clock::now();
             auto elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count();
@@ -221,10 +219,34 @@ class RigtorpSPSC {
         return val;
     }
 
+    // get waits for the next value like the one above, but returns false once the queue's been closed and drained
+    inline bool get(T &value) noexcept {
+        while (!q.front()) {
+            if (closed.load(std::memory_order_acquire)) {
+                if (!q.front()) {
+                    return false;
+                }
+                break;
+            }
+            if constexpr (std::is_same<GetWaitStrategy, PauseWaitStrategy>::value) {
+                fastchan::cpu_pause();
+            } else if constexpr (std::is_same<GetWaitStrategy, YieldWaitStrategy>::value) {
+                std::this_thread::yield();
+            }
+        }
+        value = *q.front();
+        q.pop();
+        return true;
+    }
+
+    // the queue has no close of its own, so the wrapper keeps the flag for it
+    inline void close() noexcept { closed.store(true, std::memory_order_release); }
+
     inline bool isEmpty() noexcept { return q.front() == nullptr; }
 
    private:
     rigtorp::SPSCQueue<T> q{min_size};
+    std::atomic_bool closed{false};
 };
 
 int main() {
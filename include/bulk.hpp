@@ -0,0 +1,235 @@
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
+
+#ifndef FASTCHANBULK_HPP
+#define FASTCHANBULK_HPP
+
+// copies of at least this many bytes bypass the cache with non-temporal stores, so a big batch doesn't evict
+// everything else on the way through. That makes the consumer read it back from memory though, which is several times
+// slower while the batch would still have fitted in L2, hence the default: Copy_NonTemporal and Copy_ThenRead in the
+// bulk bench show them losing at every batch size from 1 to 64 KiB. Override it with -DFASTCHAN_NONTEMPORAL_BYTES=n,
+// or 0 to never use them.
+#ifndef FASTCHAN_NONTEMPORAL_BYTES
+#define FASTCHAN_NONTEMPORAL_BYTES (1024 * 1024)
+#endif
+
+namespace fastchan {
+
+namespace detail {
+
+#if defined(__SSE2__)
+#if defined(__AVX512F__)
+constexpr std::size_t stream_width = 64;
+#elif defined(__AVX2__)
+constexpr std::size_t stream_width = 32;
+#else
+constexpr std::size_t stream_width = 16;
+#endif
+
+// streamCopy copies bytes with non-temporal stores in the widest vectors available, with memcpy for the unaligned
+// head and the tail. The sfence orders the streaming stores before whatever publishes them, as those are weakly
+// ordered even on x86. It's kept out of line as it's only for big copies, where the call is noise.
+[[gnu::noinline]] inline void streamCopy(char *dst, const char *src, std::size_t bytes) noexcept {
+    auto head = std::min(bytes, (stream_width - reinterpret_cast<uintptr_t>(dst) % stream_width) % stream_width);
+    std::memcpy(dst, src, head);
+    dst += head;
+    src += head;
+    bytes -= head;
+
+    for (; bytes >= stream_width; bytes -= stream_width, dst += stream_width, src += stream_width) {
+#if defined(__AVX512F__)
+        _mm512_stream_si512(reinterpret_cast<__m512i *>(dst), _mm512_loadu_si512(src));
+#elif defined(__AVX2__)
+        _mm256_stream_si256(reinterpret_cast<__m256i *>(dst), _mm256_loadu_si256(reinterpret_cast<const __m256i *>(src)));
+#else
+        _mm_stream_si128(reinterpret_cast<__m128i *>(dst), _mm_loadu_si128(reinterpret_cast<const __m128i *>(src)));
+#endif
+    }
+    _mm_sfence();
+
+    std::memcpy(dst, src, bytes);
+}
+#endif
+
+template <class K>
+constexpr bool simd_key = (std::is_integral<K>::value || std::is_enum<K>::value) && (sizeof(K) == 4 || sizeof(K) == 8);
+
+// findKey returns the index of the first of count records of stride bytes from base whose K at the start equals
+// value, or count if there's none. Contiguous keys are loaded a vector at a time, keys inside larger records are
+// gathered, which only pays off on x86 so NEON only handles the contiguous case.
+template <class K, std::size_t stride>
+std::size_t findKey(const char *base, std::size_t count, K value) noexcept {
+    std::size_t i = 0;
+
+    if constexpr (simd_key<K>) {
+        [[maybe_unused]] constexpr bool contiguous = stride == sizeof(K);
+        // gather offsets are 32 bit for 32 bit keys
+        [[maybe_unused]] constexpr bool gatherable = stride * 16 <= std::size_t(INT32_MAX);
+#if defined(__AVX512F__)
+        if constexpr (sizeof(K) == 8 && (contiguous || gatherable)) {
+            const auto needle = _mm512_set1_epi64(int64_t(value));
+            const auto offsets = _mm512_setr_epi64(0, stride, 2 * stride, 3 * stride, 4 * stride, 5 * stride, 6 * stride, 7 * stride);
+            for (; i + 8 <= count; i += 8) {
+                auto p = base + i * stride;
+                __m512i keys;
+                if constexpr (contiguous) {
+                    keys = _mm512_loadu_si512(p);
+                } else {
+                    keys = _mm512_i64gather_epi64(offsets, p, 1);
+                }
+                if (auto mask = _mm512_cmpeq_epi64_mask(keys, needle)) {
+                    return i + __builtin_ctz(mask);
+                }
+            }
+        } else if constexpr (sizeof(K) == 4 && (contiguous || gatherable)) {
+            const auto needle = _mm512_set1_epi32(int32_t(value));
+            const auto offsets = _mm512_setr_epi32(0, stride, 2 * stride, 3 * stride, 4 * stride, 5 * stride, 6 * stride, 7 * stride, 8 * stride, 9 * stride,
+                                                   10 * stride, 11 * stride, 12 * stride, 13 * stride, 14 * stride, 15 * stride);
+            for (; i + 16 <= count; i += 16) {
+                auto p = base + i * stride;
+                __m512i keys;
+                if constexpr (contiguous) {
+                    keys = _mm512_loadu_si512(p);
+                } else {
+                    keys = _mm512_i32gather_epi32(offsets, p, 1);
+                }
+                if (auto mask = _mm512_cmpeq_epi32_mask(keys, needle)) {
+                    return i + __builtin_ctz(mask);
+                }
+            }
+        }
+#elif defined(__AVX2__)
+        if constexpr (sizeof(K) == 8 && (contiguous || gatherable)) {
+            const auto needle = _mm256_set1_epi64x(int64_t(value));
+            const auto offsets = _mm256_setr_epi64x(0, stride, 2 * stride, 3 * stride);
+            for (; i + 4 <= count; i += 4) {
+                auto p = base + i * stride;
+                __m256i keys;
+                if constexpr (contiguous) {
+                    keys = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(p));
+                } else {
+                    keys = _mm256_i64gather_epi64(reinterpret_cast<const long long *>(p), offsets, 1);
+                }
+                if (auto mask = _mm256_movemask_pd(_mm256_castsi256_pd(_mm256_cmpeq_epi64(keys, needle)))) {
+                    return i + __builtin_ctz(mask);
+                }
+            }
+        } else if constexpr (sizeof(K) == 4 && (contiguous || gatherable)) {
+            const auto needle = _mm256_set1_epi32(int32_t(value));
+            const auto offsets = _mm256_setr_epi32(0, stride, 2 * stride, 3 * stride, 4 * stride, 5 * stride, 6 * stride, 7 * stride);
+            for (; i + 8 <= count; i += 8) {
+                auto p = base + i * stride;
+                __m256i keys;
+                if constexpr (contiguous) {
+                    keys = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(p));
+                } else {
+                    keys = _mm256_i32gather_epi32(reinterpret_cast<const int *>(p), offsets, 1);
+                }
+                if (auto mask = _mm256_movemask_ps(_mm256_castsi256_ps(_mm256_cmpeq_epi32(keys, needle)))) {
+                    return i + __builtin_ctz(mask);
+                }
+            }
+        }
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+        if constexpr (sizeof(K) == 8 && contiguous) {
+            const auto needle = vdupq_n_u64(uint64_t(value));
+            for (; i + 2 <= count; i += 2) {
+                auto eq = vceqq_u64(vld1q_u64(reinterpret_cast<const uint64_t *>(base + i * stride)), needle);
+                if (vmaxvq_u32(vreinterpretq_u32_u64(eq))) {
+                    return i + (vgetq_lane_u64(eq, 0) ? 0 : 1);
+                }
+            }
+        } else if constexpr (sizeof(K) == 4 && contiguous) {
+            const auto needle = vdupq_n_u32(uint32_t(value));
+            for (; i + 4 <= count; i += 4) {
+                if (vmaxvq_u32(vceqq_u32(vld1q_u32(reinterpret_cast<const uint32_t *>(base + i * stride)), needle))) {
+                    break;
+                }
+            }
+        }
+#endif
+    }
+
+    if constexpr (stride == sizeof(K)) {
+        auto keys = reinterpret_cast<const K *>(base);
+        return std::size_t(std::find(keys + i, keys + count, value) - keys);
+    }
+
+    for (; i < count; ++i) {
+        K key;
+        std::memcpy(&key, base + i * stride, sizeof(K));
+        if (key == value) {
+            return i;
+        }
+    }
+    return count;
+}
+
+}  // namespace detail
+
+// bulkCopy copies count values from src to dst, which must not overlap. Trivially copyable values are copied as raw
+// bytes, with non-temporal stores on x86 once a copy reaches FASTCHAN_NONTEMPORAL_BYTES, and everything else is copy
+// assigned one by one. Below the threshold memcpy is already as fast as hand written vectors get.
+template <typename T>
+inline void bulkCopy(T *dst, const T *src, std::size_t count) noexcept {
+    if constexpr (std::is_trivially_copyable<T>::value) {
+        if (count == 0) {
+            return;
+        }
+#if defined(__SSE2__)
+        if (FASTCHAN_NONTEMPORAL_BYTES > 0 && count * sizeof(T) >= std::size_t(FASTCHAN_NONTEMPORAL_BYTES)) {
+            detail::streamCopy(reinterpret_cast<char *>(dst), reinterpret_cast<const char *>(src), count * sizeof(T));
+            return;
+        }
+#endif
+        std::memcpy(static_cast<void *>(dst), src, count * sizeof(T));
+    } else {
+        std::copy_n(src, count, dst);
+    }
+}
+
+// bulkFind returns the index of the first of count values equal to value, or count if there's none, e.g. to find a
+// sentinel in what drain hands over. 32 and 64 bit integers and enums are compared with AVX-512, AVX2 or NEON as
+// available at compile time, anything else one by one.
+template <typename T>
+inline std::size_t bulkFind(const T *data, std::size_t count, const T &value) noexcept {
+    if constexpr (detail::simd_key<T>) {
+        return detail::findKey<T, sizeof(T)>(reinterpret_cast<const char *>(data), count, value);
+    } else {
+        return std::size_t(std::find(data, data + count, value) - data);
+    }
+}
+
+// bulkFind with a member pointer compares that member of each value instead, e.g. bulkFind(ticks, n, &Tick::qty, 0u)
+// to filter a batch of Ticks on one field. For 32 and 64 bit integer members that's done with AVX-512 or AVX2 gathers
+// on x86, and one by one elsewhere.
+template <typename T, typename K>
+inline std::size_t bulkFind(const T *data, std::size_t count, K T::*member, const K &value) noexcept {
+    if (count == 0) {
+        return 0;
+    }
+    auto offset = reinterpret_cast<const char *>(&(data->*member)) - reinterpret_cast<const char *>(data);
+    if constexpr (detail::simd_key<K> && std::is_trivially_copyable<T>::value) {
+        return detail::findKey<K, sizeof(T)>(reinterpret_cast<const char *>(data) + offset, count, value);
+    } else {
+        for (std::size_t i = 0; i < count; ++i) {
+            if (data[i].*member == value) {
+                return i;
+            }
+        }
+        return count;
+    }
+}
+
+}  // namespace fastchan
+
+#endif
@@ -1,5 +1,14 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
 #include <limits>
 
+#if defined(__x86_64__) || defined(__i386__)
+#include <cpuid.h>
+#endif
+
 #ifndef FASTCHANCOMMON_HPP
 #define FASTCHANCOMMON_HPP
 
@@ -9,16 +18,115 @@ namespace fastchan {
 #define CHAR_BIT __CHAR_BIT__
 #endif
 
+// FASTCHAN_SCHEDULE_POINT marks the places in the channels where it matters if the other side runs in between, e.g.
+// between writing a slot and publishing it. It does nothing unless it's defined before the first include, as the
+// stress test does to pause or yield there at random and so shake out orderings a plain run would rarely hit.
+#ifndef FASTCHAN_SCHEDULE_POINT
+#define FASTCHAN_SCHEDULE_POINT()
+#endif
+
+// cpu_pause is the spin loop hint. On aarch64 that's an isb rather than yield, which is a nop on most cores and so
+// spins far too hot, while an isb takes a few tens of cycles much like x86's pause.
 inline void cpu_pause() {
 #if defined(__x86_64__) || defined(__i386__)
     asm volatile("pause" ::: "memory");
-#elif defined(__arm__) || defined(__aarch64__)
+#elif defined(__aarch64__)
+    asm volatile("isb sy" ::: "memory");
+#elif defined(__arm__)
     asm volatile("yield" ::: "memory");
 #else
     // do nothing
 #endif
 }
 
+// cpu_ticks is a cheap monotonic tick source for checking deadlines in spin loops. It's the TSC on x86, the virtual
+// counter on aarch64, and falls back to the steady clock in nanoseconds elsewhere. On x86 it assumes an invariant
+// TSC which is synchronised across cores, as on any recent CPU.
+inline uint64_t cpu_ticks() noexcept {
+#if defined(__x86_64__) || defined(__i386__)
+    return __builtin_ia32_rdtsc();
+#elif defined(__aarch64__)
+    uint64_t ticks;
+    asm volatile("mrs %0, cntvct_el0" : "=r"(ticks));
+    return ticks;
+#else
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+#endif
+}
+
+namespace detail {
+
+// calibrateTicksPerNs times the TSC against the steady clock over a few 200us windows. Each end of a window reads
+// the TSC between two reads of the clock, and a window where those are more than 2us apart is thrown away as the
+// thread was preempted there. It takes the median of the rest, or the window with the tightest ends if there are none.
+inline double calibrateTicksPerNs() noexcept {
+#if defined(__x86_64__) || defined(__i386__)
+    using clock = std::chrono::steady_clock;
+    constexpr int samples = 5;
+    double good[samples];
+    int found = 0;
+    double best = 0;
+    auto best_slack = clock::duration::max();
+    for (int attempt = 0; attempt < 2 * samples && found < samples; ++attempt) {
+        auto before_start = clock::now();
+        auto start_ticks = cpu_ticks();
+        auto after_start = clock::now();
+        auto before_end = after_start;
+        while (before_end - after_start < std::chrono::microseconds(200)) {
+            before_end = clock::now();
+        }
+        auto end_ticks = cpu_ticks();
+        auto after_end = clock::now();
+
+        auto slack = std::max(after_start - before_start, after_end - before_end);
+        auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>((before_end - before_start) + (after_end - after_start)).count() / 2.0;
+        auto sample = double(end_ticks - start_ticks) / ns;
+        if (slack <= std::chrono::microseconds(2)) {
+            good[found++] = sample;
+        }
+        if (slack < best_slack) {
+            best_slack = slack;
+            best = sample;
+        }
+    }
+    if (found == 0) {
+        return best;
+    }
+    std::sort(good, good + found);
+    return good[found / 2];
+#elif defined(__aarch64__)
+    uint64_t freq;
+    asm volatile("mrs %0, cntfrq_el0" : "=r"(freq));
+    return double(freq) / 1e9;
+#else
+    return 1.0;
+#endif
+}
+
+inline std::atomic<double> ticks_per_ns{0};
+
+// ticks_calibrated runs the calibration during static initialisation, so no timed call has to wait for it
+inline const bool ticks_calibrated = (ticks_per_ns.store(calibrateTicksPerNs(), std::memory_order_release), true);
+
+}  // namespace detail
+
+// cpu_ticks_per_ns is the tick rate, calibrated against the steady clock before main where the frequency isn't
+// architectural. It's 0 until then, e.g. in another static initialiser, and callers fall back to the steady clock.
+inline double cpu_ticks_per_ns() noexcept { return detail::ticks_per_ns.load(std::memory_order_acquire); }
+
+// cpu_has_waitpkg is whether the CPU has UMONITOR, UMWAIT and TPAUSE, from cpuid on first use
+inline bool cpu_has_waitpkg() noexcept {
+#if defined(__x86_64__) || defined(__i386__)
+    static const bool has_waitpkg = [] {
+        unsigned int eax, ebx, ecx, edx;
+        return __get_cpuid_count(7, 0, &eax, &ebx, &ecx, &edx) && (ecx & (1u << 5));
+    }();
+    return has_waitpkg;
+#else
+    return false;
+#endif
+}
+
 constexpr size_t roundUpNextPowerOfTwo(size_t v) {
     v--;
     for (size_t i = 1; i < sizeof(v) * CHAR_BIT; i *= 2) {
@@ -28,7 +136,15 @@ constexpr size_t roundUpNextPowerOfTwo(size_t v) {
 }
 }  // namespace fastchan
 
-#ifdef __cpp_lib_hardware_interference_size
+// hardware_destructive_interference_size is what the Common, Producer and Consumer parts of the channels are padded out
+// to. On aarch64 that's 128 whatever the compiler says, as Graviton and Apple cores prefetch cache lines in pairs, so
+// anything within 128 bytes of a line the other side writes to is falsely shared. FASTCHAN_INTERFERENCE_SIZE overrides
+// it for cores that need something else.
+#if defined(FASTCHAN_INTERFERENCE_SIZE)
+constexpr std::size_t hardware_destructive_interference_size = FASTCHAN_INTERFERENCE_SIZE;
+#elif defined(__aarch64__)
+constexpr std::size_t hardware_destructive_interference_size = 128;
+#elif defined(__cpp_lib_hardware_interference_size)
 using std::hardware_destructive_interference_size;
 #else
 constexpr std::size_t hardware_destructive_interference_size = 64;
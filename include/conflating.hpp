@@ -0,0 +1,155 @@
+#include <array>
+#include <atomic>
+#include <optional>
+#include <type_traits>
+#include <utility>
+
+#include "common.hpp"
+#include "spsc.hpp"
+#include "wait_strategy.hpp"
+
+#ifndef FASTCHANCONFLATING_HPP
+#define FASTCHANCONFLATING_HPP
+
+namespace fastchan {
+
+// Conflating is a single producer single consumer last-value channel keyed by a dense index in [0, num_keys).
+// A put for a key that hasn't been consumed yet overwrites the pending value in place, so the consumer only
+// ever sees the latest value for each dirty key, once. Keys are handed over through an SPSC ring which can never
+// fill up since a key is queued at most once at any given time, so put never blocks.
+template <typename T, size_t num_keys, class GetWaitStrategy = YieldWaitStrategy>
+class Conflating {
+    using GetWait = WaitStrategyTraits<GetWaitStrategy>;
+
+    static_assert(std::is_trivially_copyable<T>::value, "Conflating requires a trivially copyable T");
+
+   public:
+    using value_type = std::pair<std::size_t, T>;
+    using get_t = typename std::conditional<!GetWait::returns_immediately, value_type, std::optional<value_type>>::type;
+
+    Conflating() = default;
+
+    void put(std::size_t key, const T &value) noexcept {
+        auto &slot = slots_[key];
+        slot.write(value);
+
+        // only queue the key if the consumer has already picked up the last one
+        if (!slot.pending_.exchange(true, std::memory_order_acq_rel)) {
+            dirty_keys_.put(key);
+        }
+    }
+
+    get_t get() noexcept {
+        while (true) {
+            std::size_t key;
+            if (consumer_.held_key_ != num_keys) {
+                // isEmpty already took it off and cleared pending
+                key = std::exchange(consumer_.held_key_, num_keys);
+            } else {
+                if constexpr (GetWait::returns_immediately) {
+                    auto next = dirty_keys_.get();
+                    if (!next) {
+                        return std::nullopt;
+                    }
+                    key = *next;
+                } else {
+                    key = dirty_keys_.get();
+                }
+                slots_[key].pending_.exchange(false, std::memory_order_acq_rel);
+            }
+
+            auto &slot = slots_[key];
+
+            T value;
+            auto seq = slot.read(value);
+
+            // a put may land between clearing pending and reading, in which case we've already delivered the value
+            // that the re-queued key points to
+            if (seq == consumer_.delivered_seq_[key]) {
+                continue;
+            }
+
+            consumer_.delivered_seq_[key] = seq;
+            return value_type{key, value};
+        }
+    }
+
+    // size is the number of keys queued for get. It's for the consumer only, as it goes through isEmpty first, and
+    // may still count a key behind the first one whose latest value was already delivered.
+    std::size_t size() noexcept {
+        if (isEmpty()) {
+            return 0;
+        }
+        return dirty_keys_.size() + (consumer_.held_key_ != num_keys ? 1 : 0);
+    }
+
+    // isEmpty is whether get would find nothing to deliver. A put racing a get can queue a key again for the value
+    // get then delivers, and get skips over those, so isEmpty drops them the same way on the way to the first key
+    // with a newer value. It's for the consumer only.
+    bool isEmpty() noexcept {
+        if (consumer_.held_key_ != num_keys) {
+            return false;
+        }
+        while (auto next = dirty_keys_.peek()) {
+            auto key = *next;
+            auto &slot = slots_[key];
+            if (slot.seq_.load(std::memory_order_acquire) != consumer_.delivered_seq_[key]) {
+                return false;
+            }
+
+            // it's been delivered, unless a put lands before pending's cleared without queuing it again, in which
+            // case get has to deliver it from here
+            dirty_keys_.get(key);
+            slot.pending_.exchange(false, std::memory_order_acq_rel);
+            if (slot.seq_.load(std::memory_order_acquire) != consumer_.delivered_seq_[key]) {
+                consumer_.held_key_ = key;
+                return false;
+            }
+        }
+        return true;
+    }
+
+   private:
+    struct alignas(hardware_destructive_interference_size) Slot {
+        std::atomic<std::size_t> seq_{0};
+        std::atomic<bool> pending_{false};
+        T value_{};
+
+        inline void write(const T &value) noexcept {
+            auto seq = seq_.load(std::memory_order_relaxed);
+            seq_.store(seq + 1, std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_release);
+            value_ = value;
+            seq_.store(seq + 2, std::memory_order_release);
+        }
+
+        inline std::size_t read(T &value) const noexcept {
+            while (true) {
+                auto before = seq_.load(std::memory_order_acquire);
+                value = value_;
+                std::atomic_thread_fence(std::memory_order_acquire);
+                auto after = seq_.load(std::memory_order_relaxed);
+                if (before == after && (before & 1) == 0) {
+                    return before;
+                }
+
+                // the producer is mid write, retry
+                cpu_pause();
+            }
+        }
+    };
+
+    struct alignas(hardware_destructive_interference_size) Consumer {
+        std::array<std::size_t, num_keys> delivered_seq_{};
+        // a key isEmpty took off the queue for get to deliver, or num_keys for none
+        std::size_t held_key_ = num_keys;
+    };
+
+    std::array<Slot, num_keys> slots_;
+    SPSC<std::size_t, num_keys, NoOpWaitStrategy, GetWaitStrategy> dirty_keys_;
+    Consumer consumer_;
+};
+
+}  // namespace fastchan
+
+#endif
@@ -0,0 +1,237 @@
+#include <atomic>
+#include <cassert>
+#include <chrono>
+#include <limits>
+#include <memory>
+#include <optional>
+#include <thread>
+#include <utility>
+
+#include "common.hpp"
+#include "spsc.hpp"
+#include "wait_strategy.hpp"
+
+#ifndef FASTCHANENDPOINTS_HPP
+#define FASTCHANENDPOINTS_HPP
+
+namespace fastchan {
+
+namespace detail {
+
+// ThreadBound has an endpoint assert in debug builds that it's only ever used from one thread, the first to use it
+// after it was made or moved, as moving it is how it's handed to another thread. It's empty in release builds, where
+// checkThread compiles out.
+class ThreadBound {
+   protected:
+    ThreadBound() = default;
+    ThreadBound(ThreadBound &&) noexcept {}
+    ThreadBound &operator=(ThreadBound &&) noexcept {
+#ifndef NDEBUG
+        owner_.store(std::thread::id(), std::memory_order_relaxed);
+#endif
+        return *this;
+    }
+
+    inline void checkThread() noexcept {
+#ifndef NDEBUG
+        auto self = std::this_thread::get_id();
+        if (owner_.load(std::memory_order_relaxed) != self) {
+            auto unbound = std::thread::id();
+            [[maybe_unused]] bool bound = owner_.compare_exchange_strong(unbound, self, std::memory_order_relaxed);
+            assert(bound && "a Sender or Receiver can only be used from one thread at a time, move it to hand it over");
+        }
+#endif
+    }
+
+#ifndef NDEBUG
+   private:
+    std::atomic<std::thread::id> owner_{};
+#endif
+};
+
+struct Endpoints;
+
+}  // namespace detail
+
+// Sender is the one producer end of an SPSC made by make_spsc. It can only be moved, so there's never a second
+// producer to race it, and it keeps the producer's cached indices itself. The channel is closed once it's dropped.
+template <class Chan>
+class alignas(hardware_destructive_interference_size) Sender : detail::ThreadBound {
+   public:
+    using value_type = typename Chan::value_type;
+    using put_t = typename Chan::put_t;
+
+    Sender(Sender &&other) noexcept = default;
+
+    Sender &operator=(Sender &&other) noexcept {
+        if (this != &other) {
+            release();
+            chan_ = std::move(other.chan_);
+            cache_ = other.cache_;
+            ThreadBound::operator=(std::move(other));
+        }
+        return *this;
+    }
+
+    Sender(const Sender &) = delete;
+    Sender &operator=(const Sender &) = delete;
+
+    ~Sender() { release(); }
+
+    put_t put(const value_type &value) noexcept {
+        checkThread();
+        return chan_->putValue(cache_, value);
+    }
+
+    put_t put(value_type &&value) noexcept {
+        checkThread();
+        return chan_->putValue(cache_, std::move(value));
+    }
+
+    std::size_t putBatch(const value_type *values, std::size_t count) noexcept {
+        checkThread();
+        return chan_->putBatch(cache_, values, count);
+    }
+
+    template <class Rep, class Period>
+    bool try_put_for(const value_type &value, const std::chrono::duration<Rep, Period> &timeout) noexcept {
+        checkThread();
+        return chan_->putUntil(cache_, value, Deadline(timeout));
+    }
+
+    template <class Clock, class Duration>
+    bool try_put_until(const value_type &value, const std::chrono::time_point<Clock, Duration> &deadline) noexcept {
+        checkThread();
+        return chan_->putUntil(cache_, value, Deadline(deadline));
+    }
+
+    void close() noexcept { chan_->close(); }
+
+    bool isClosed() const noexcept { return chan_->isClosed(); }
+
+    bool isFull() const noexcept { return chan_->isFull(); }
+
+   private:
+    friend struct detail::Endpoints;
+
+    explicit Sender(std::shared_ptr<Chan> chan) noexcept : chan_(std::move(chan)) {}
+
+    void release() noexcept {
+        if (chan_ != nullptr) {
+            chan_->close();
+            chan_.reset();
+        }
+    }
+
+    std::shared_ptr<Chan> chan_;
+    typename Chan::ProducerCache cache_;
+};
+
+// Receiver is the one consumer end of an SPSC made by make_spsc, as Sender is for the producer. Dropping it closes
+// the channel too, so a Sender waiting for room is woken and its puts fail from then on.
+template <class Chan>
+class alignas(hardware_destructive_interference_size) Receiver : detail::ThreadBound {
+   public:
+    using value_type = typename Chan::value_type;
+    using get_t = typename Chan::get_t;
+
+    Receiver(Receiver &&other) noexcept = default;
+
+    Receiver &operator=(Receiver &&other) noexcept {
+        if (this != &other) {
+            release();
+            chan_ = std::move(other.chan_);
+            cache_ = other.cache_;
+            ThreadBound::operator=(std::move(other));
+        }
+        return *this;
+    }
+
+    Receiver(const Receiver &) = delete;
+    Receiver &operator=(const Receiver &) = delete;
+
+    ~Receiver() { release(); }
+
+    get_t get() noexcept {
+        checkThread();
+        return chan_->getValue(cache_);
+    }
+
+    bool get(value_type &value) noexcept {
+        checkThread();
+        return chan_->getValue(cache_, value);
+    }
+
+    const value_type *peek() noexcept {
+        checkThread();
+        return chan_->peek(cache_);
+    }
+
+    template <class F>
+    std::size_t drain(F &&f, std::size_t max = std::numeric_limits<std::size_t>::max()) {
+        checkThread();
+        return chan_->drain(cache_, f, max);
+    }
+
+    std::size_t getBatch(value_type *values, std::size_t max) noexcept {
+        checkThread();
+        return chan_->getBatch(cache_, values, max);
+    }
+
+    template <class Rep, class Period>
+    std::optional<value_type> try_get_for(const std::chrono::duration<Rep, Period> &timeout) noexcept {
+        checkThread();
+        return chan_->getUntil(cache_, Deadline(timeout));
+    }
+
+    template <class Clock, class Duration>
+    std::optional<value_type> try_get_until(const std::chrono::time_point<Clock, Duration> &deadline) noexcept {
+        checkThread();
+        return chan_->getUntil(cache_, Deadline(deadline));
+    }
+
+    void close() noexcept { chan_->close(); }
+
+    bool isClosed() const noexcept { return chan_->isClosed(); }
+
+    std::size_t size() const noexcept { return chan_->size(); }
+
+    bool isEmpty() const noexcept { return chan_->isEmpty(); }
+
+   private:
+    friend struct detail::Endpoints;
+
+    explicit Receiver(std::shared_ptr<Chan> chan) noexcept : chan_(std::move(chan)) {}
+
+    void release() noexcept {
+        if (chan_ != nullptr) {
+            chan_->close();
+            chan_.reset();
+        }
+    }
+
+    std::shared_ptr<Chan> chan_;
+    typename Chan::ConsumerCache cache_;
+};
+
+namespace detail {
+
+struct Endpoints {
+    template <class Chan>
+    static std::pair<Sender<Chan>, Receiver<Chan>> make() {
+        auto chan = std::make_shared<Chan>();
+        return {Sender<Chan>(chan), Receiver<Chan>(std::move(chan))};
+    }
+};
+
+}  // namespace detail
+
+// make_spsc makes an SPSC and hands back its only Sender and Receiver, e.g. auto [tx, rx] = make_spsc<int, 1024>()
+template <typename T, size_t min_size, class PutWaitStrategy = YieldWaitStrategy, class GetWaitStrategy = YieldWaitStrategy>
+std::pair<Sender<SPSC<T, min_size, PutWaitStrategy, GetWaitStrategy>>, Receiver<SPSC<T, min_size, PutWaitStrategy, GetWaitStrategy>>> make_spsc() {
+    return detail::Endpoints::make<SPSC<T, min_size, PutWaitStrategy, GetWaitStrategy>>();
+}
+
+}  // namespace fastchan
+
+#endif
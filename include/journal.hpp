@@ -0,0 +1,410 @@
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <string>
+#include <system_error>
+#include <type_traits>
+#include <utility>
+
+#include "common.hpp"
+#include "wait_strategy.hpp"
+
+#ifndef FASTCHANJOURNAL_HPP
+#define FASTCHANJOURNAL_HPP
+
+namespace fastchan {
+
+// A journal file is a JournalHeader followed by frames. Every frame is a JournalFrame followed by count records of
+// record_size bytes each, copied verbatim out of the channel.
+struct JournalHeader {
+    char magic[8] = {'F', 'C', 'J', 'R', 'N', 'L', '0', '1'};
+    uint32_t version = 1;
+    uint32_t record_size = 0;
+};
+
+struct JournalFrame {
+    // steady clock time at which the tap picked the records up
+    uint64_t timestamp_ns;
+    uint64_t count;
+};
+
+struct JournalStats {
+    uint64_t records = 0;
+    uint64_t frames = 0;
+    uint64_t bytes = 0;
+    uint64_t files = 0;
+    uint64_t elapsed_ns = 0;
+    // records a replay couldn't put because the channel was closed, at which point it stops
+    uint64_t dropped = 0;
+
+    double recordsPerSecond() const noexcept { return elapsed_ns ? double(records) * 1e9 / double(elapsed_ns) : 0; }
+    double bytesPerSecond() const noexcept { return elapsed_ns ? double(bytes) * 1e9 / double(elapsed_ns) : 0; }
+};
+
+inline uint64_t journalTimestamp() noexcept {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// JournalWriter appends frames of T to an mmap'd file, growing the mapping a chunk at a time. With rotate_bytes set
+// it moves on to path.1, path.2, ... once a file would grow past that size. Errors are thrown as std::system_error.
+template <typename T>
+class JournalWriter {
+    static_assert(std::is_trivially_copyable<T>::value, "JournalWriter requires a trivially copyable T");
+
+   public:
+    explicit JournalWriter(std::string path, std::size_t rotate_bytes = 0, std::size_t chunk_bytes = 64 << 20)
+        : path_(std::move(path)),
+          rotate_bytes_(rotate_bytes),
+          chunk_bytes_(roundUpToPage(rotate_bytes ? std::min(chunk_bytes, rotate_bytes) : chunk_bytes)),
+          start_ns_(journalTimestamp()) {
+        open();
+    }
+
+    JournalWriter(const JournalWriter &) = delete;
+    JournalWriter &operator=(const JournalWriter &) = delete;
+
+    ~JournalWriter() { close(); }
+
+    void append(const T *data, std::size_t count, uint64_t timestamp_ns = journalTimestamp()) {
+        if (count == 0) {
+            return;
+        }
+
+        auto bytes = sizeof(JournalFrame) + count * sizeof(T);
+        if (rotate_bytes_ && offset_ > sizeof(JournalHeader) && offset_ + bytes > rotate_bytes_) {
+            close();
+            open();
+        }
+
+        reserve(bytes);
+        JournalFrame frame{timestamp_ns, count};
+        std::memcpy(map_ + (offset_ - map_offset_), &frame, sizeof(frame));
+        std::memcpy(map_ + (offset_ - map_offset_) + sizeof(frame), data, count * sizeof(T));
+        offset_ += bytes;
+
+        stats_.records += count;
+        stats_.frames++;
+        stats_.bytes += bytes;
+    }
+
+    // sync schedules the dirty pages for writeback without waiting for them
+    void sync() {
+        if (map_ && ::msync(map_, map_size_, MS_ASYNC) != 0) {
+            throw std::system_error(errno, std::generic_category(), "msync " + currentPath());
+        }
+    }
+
+    JournalStats stats() const noexcept {
+        auto stats = stats_;
+        stats.elapsed_ns = journalTimestamp() - start_ns_;
+        return stats;
+    }
+
+    const std::string &currentPath() const noexcept { return current_path_; }
+
+    // close trims the current file to its last frame, nothing can be appended afterwards
+    void close() noexcept {
+        if (fd_ < 0) {
+            return;
+        }
+
+        unmap();
+        // trim the preallocated tail so the file ends with the last frame
+        [[maybe_unused]] auto result = ::ftruncate(fd_, offset_);
+        ::close(fd_);
+        fd_ = -1;
+    }
+
+   private:
+    static std::size_t roundUpToPage(std::size_t bytes) {
+        static const std::size_t page = std::size_t(::sysconf(_SC_PAGESIZE));
+        return (bytes + page - 1) / page * page;
+    }
+
+    void open() {
+        current_path_ = file_index_ ? path_ + "." + std::to_string(file_index_) : path_;
+        fd_ = ::open(current_path_.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+        if (fd_ < 0) {
+            throw std::system_error(errno, std::generic_category(), "open " + current_path_);
+        }
+
+        offset_ = 0;
+        try {
+            reserve(sizeof(JournalHeader));
+        } catch (...) {
+            // don't leave the fd or a file without a header behind, a reader would take it for a corrupt journal
+            unmap();
+            ::close(fd_);
+            fd_ = -1;
+            ::unlink(current_path_.c_str());
+            throw;
+        }
+        ++file_index_;
+        stats_.files++;
+
+        JournalHeader header;
+        header.record_size = sizeof(T);
+        std::memcpy(map_, &header, sizeof(header));
+        offset_ = sizeof(header);
+        stats_.bytes += sizeof(header);
+    }
+
+    void reserve(std::size_t bytes) {
+        if (map_ && offset_ + bytes <= map_offset_ + map_size_) {
+            return;
+        }
+
+        unmap();
+        map_offset_ = offset_ / roundUpToPage(1) * roundUpToPage(1);
+        map_size_ = std::max(chunk_bytes_, roundUpToPage(offset_ - map_offset_ + bytes));
+        if (::ftruncate(fd_, map_offset_ + map_size_) != 0) {
+            throw std::system_error(errno, std::generic_category(), "ftruncate " + currentPath());
+        }
+
+        int flags = MAP_SHARED;
+#ifdef MAP_POPULATE
+        // fault the chunk in up front rather than on the tap's hot path
+        flags |= MAP_POPULATE;
+#endif
+        auto map = ::mmap(nullptr, map_size_, PROT_READ | PROT_WRITE, flags, fd_, off_t(map_offset_));
+        if (map == MAP_FAILED) {
+            throw std::system_error(errno, std::generic_category(), "mmap " + currentPath());
+        }
+        map_ = static_cast<char *>(map);
+    }
+
+    void unmap() noexcept {
+        if (map_) {
+            ::munmap(map_, map_size_);
+            map_ = nullptr;
+        }
+    }
+
+    const std::string path_;
+    const std::size_t rotate_bytes_;
+    const std::size_t chunk_bytes_;
+    const uint64_t start_ns_;
+
+    std::string current_path_;
+    int fd_ = -1;
+    std::size_t file_index_ = 0;
+    std::size_t offset_ = 0;
+
+    char *map_ = nullptr;
+    std::size_t map_offset_ = 0;
+    std::size_t map_size_ = 0;
+
+    JournalStats stats_;
+};
+
+// JournalTap is the consumer of a channel which records everything that passes through it. Every poll drains what
+// has been committed straight out of the channel's buffer, as at most two frames per wraparound, and releases the
+// slots back to the producer as soon as they've been copied into the journal.
+template <class Chan>
+class JournalTap {
+   public:
+    using value_type = typename Chan::value_type;
+
+    JournalTap(Chan &chan, std::string path, std::size_t rotate_bytes = 0) : chan_(chan), writer_(std::move(path), rotate_bytes) {}
+
+    // poll records up to max entries that are available right now and returns how many it recorded
+    std::size_t poll(std::size_t max = std::numeric_limits<std::size_t>::max()) {
+        auto timestamp_ns = journalTimestamp();
+        return chan_.drain([this, timestamp_ns](const value_type *data, std::size_t count) { writer_.append(data, count, timestamp_ns); }, max);
+    }
+
+    void sync() { writer_.sync(); }
+
+    void close() noexcept { writer_.close(); }
+
+    JournalStats stats() const noexcept { return writer_.stats(); }
+
+   private:
+    Chan &chan_;
+    JournalWriter<value_type> writer_;
+};
+
+// JournalReader maps a journal file read-only and walks its frames. A frame cut short at the end of the file, e.g.
+// after a crash, is ignored. Errors are thrown as std::system_error.
+template <typename T>
+class JournalReader {
+    static_assert(std::is_trivially_copyable<T>::value, "JournalReader requires a trivially copyable T");
+
+   public:
+    explicit JournalReader(const std::string &path) : path_(path) {
+        int fd = ::open(path.c_str(), O_RDONLY);
+        if (fd < 0) {
+            throw std::system_error(errno, std::generic_category(), "open " + path);
+        }
+
+        struct stat st;
+        if (::fstat(fd, &st) != 0) {
+            auto error = errno;
+            ::close(fd);
+            throw std::system_error(error, std::generic_category(), "fstat " + path);
+        }
+        size_ = std::size_t(st.st_size);
+
+        if (size_ > 0) {
+            auto map = ::mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (map == MAP_FAILED) {
+                auto error = errno;
+                ::close(fd);
+                throw std::system_error(error, std::generic_category(), "mmap " + path);
+            }
+            map_ = static_cast<const char *>(map);
+#ifdef MADV_SEQUENTIAL
+            ::madvise(const_cast<char *>(map_), size_, MADV_SEQUENTIAL);
+#endif
+        }
+        ::close(fd);
+
+        JournalHeader header;
+        if (size_ < sizeof(header)) {
+            unmap();
+            throw std::system_error(std::make_error_code(std::errc::invalid_argument), "journal header " + path);
+        }
+        std::memcpy(&header, map_, sizeof(header));
+        if (std::memcmp(header.magic, JournalHeader{}.magic, sizeof(header.magic)) != 0 || header.record_size != sizeof(T)) {
+            unmap();
+            throw std::system_error(std::make_error_code(std::errc::invalid_argument), "journal header " + path);
+        }
+    }
+
+    JournalReader(const JournalReader &) = delete;
+    JournalReader &operator=(const JournalReader &) = delete;
+
+    ~JournalReader() { unmap(); }
+
+    // forEachFrame calls f(const JournalFrame &frame, const T *records) for every complete frame in order, with the
+    // records pointing straight into the mapping. An f that returns bool stops it by returning false.
+    template <class F>
+    void forEachFrame(F &&f) const {
+        auto offset = sizeof(JournalHeader);
+        while (offset + sizeof(JournalFrame) <= size_) {
+            JournalFrame frame;
+            std::memcpy(&frame, map_ + offset, sizeof(frame));
+            offset += sizeof(frame);
+            if (frame.count > (size_ - offset) / sizeof(T)) {
+                break;
+            }
+
+            if constexpr (std::is_same<decltype(f(frame, reinterpret_cast<const T *>(map_ + offset))), bool>::value) {
+                if (!f(frame, reinterpret_cast<const T *>(map_ + offset))) {
+                    break;
+                }
+            } else {
+                f(frame, reinterpret_cast<const T *>(map_ + offset));
+            }
+            offset += frame.count * sizeof(T);
+        }
+    }
+
+    std::size_t bytes() const noexcept { return size_; }
+
+   private:
+    void unmap() noexcept {
+        if (map_) {
+            ::munmap(const_cast<char *>(map_), size_);
+            map_ = nullptr;
+        }
+    }
+
+    const std::string path_;
+    const char *map_ = nullptr;
+    std::size_t size_ = 0;
+};
+
+// JournalReplay feeds a channel from a recorded journal, following on to path.1, path.2, ... if it was rotated.
+// Every frame goes in with the channel's putBatch, which waits for room as per the channel's put wait strategy. With
+// ReturnImmediateStrategy it returns as soon as the channel's full, and the replay backs off as per IdleWaitStrategy
+// until there's room again. Once the channel's closed it stops, counting what was left of the frame it was putting as
+// dropped.
+template <class Chan, class IdleWaitStrategy = YieldWaitStrategy>
+class JournalReplay {
+    using Idle = WaitStrategyTraits<IdleWaitStrategy>;
+
+   public:
+    using value_type = typename Chan::value_type;
+
+    JournalReplay(Chan &chan, std::string path) : chan_(chan), path_(std::move(path)) {}
+
+    // run replays the whole journal and returns how it went. With a speed of 1 frames go out with their original
+    // spacing, 10 replays ten times as fast, and 0 goes flat out. Pacing spins on cpu_ticks so it's accurate down to
+    // the spacing of the recorded frames.
+    JournalStats run(double speed = 1.0) {
+        JournalStats stats;
+        const auto start_ns = journalTimestamp();
+        const auto start_ticks = cpu_ticks();
+        const auto ticks_per_ns = speed > 0 ? cpu_ticks_per_ns() / speed : 0;
+        bool first = true;
+        uint64_t first_timestamp_ns = 0;
+
+        bool closed = false;
+        for (std::size_t file = 0; !closed; ++file) {
+            auto path = file ? path_ + "." + std::to_string(file) : path_;
+            if (file > 0 && ::access(path.c_str(), F_OK) != 0) {
+                break;
+            }
+
+            JournalReader<value_type> reader(path);
+            stats.files++;
+            stats.bytes += reader.bytes();
+
+            reader.forEachFrame([&](const JournalFrame &frame, const value_type *records) {
+                if (first) {
+                    first = false;
+                    first_timestamp_ns = frame.timestamp_ns;
+                }
+
+                if (speed > 0 && frame.timestamp_ns > first_timestamp_ns) {
+                    auto target = start_ticks + uint64_t(double(frame.timestamp_ns - first_timestamp_ns) * ticks_per_ns);
+                    while (cpu_ticks() < target) {
+                        cpu_pause();
+                    }
+                }
+
+                std::size_t done = 0;
+                while (done < frame.count) {
+                    auto put = chan_.putBatch(records + done, frame.count - done);
+                    done += put;
+                    if (put == 0 && chan_.isClosed()) {
+                        break;
+                    }
+                    if (done < frame.count) {
+                        Idle::wait(idle_, [this] { return !chan_.isFull() || chan_.isClosed(); });
+                    }
+                }
+
+                stats.records += done;
+                if (done < frame.count) {
+                    stats.dropped += frame.count - done;
+                    closed = true;
+                    return false;
+                }
+                stats.frames++;
+                return true;
+            });
+        }
+
+        stats.elapsed_ns = journalTimestamp() - start_ns;
+        return stats;
+    }
+
+   private:
+    Chan &chan_;
+    const std::string path_;
+    IdleWaitStrategy idle_;
+};
+
+}  // namespace fastchan
+
+#endif
@@ -0,0 +1,319 @@
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <optional>
+#include <type_traits>
+#include <utility>
+
+#include "common.hpp"
+#include "spsc.hpp"
+#include "wait_strategy.hpp"
+
+#ifndef FASTCHANLANES_HPP
+#define FASTCHANLANES_HPP
+
+namespace fastchan {
+
+// RoundRobin has the consumer of a LaneMPSC take one entry from each lane in turn
+struct RoundRobin {};
+
+// ByKey has the consumer of a LaneMPSC take the oldest entry with the smallest key(entry), e.g. a timestamp. That's
+// only in order among the entries that are there when it looks, as an entry that's yet to be put can be older still.
+template <class Key>
+struct ByKey {
+    Key key;
+};
+
+// LaneMPSC is an MPSC for a handful of producers, each of which registers for a lane of its own. A lane is an SPSC, so
+// producers neither race each other for an index nor wait on each other to commit and never share a cache line, and
+// the consumer merges the lanes as per Merge. Producers put through the Producer handle they registered with, which
+// hands the lane back once it goes out of scope. Whatever it put that the consumer has yet to get stays in the lane
+// for whoever registers for it next. The channel has to outlive its Producers.
+template <typename T, size_t min_size, size_t max_producers, class PutWaitStrategy = YieldWaitStrategy, class GetWaitStrategy = YieldWaitStrategy,
+          class Merge = RoundRobin>
+class LaneMPSC {
+    using GetWait = WaitStrategyTraits<GetWaitStrategy>;
+    // the consumer only gets from a lane once it's seen an entry there, so the lanes themselves never wait for one
+    using Lane = SPSC<T, min_size, PutWaitStrategy, NoOpWaitStrategy>;
+
+    static_assert(max_producers > 0 && max_producers <= 64, "LaneMPSC keeps track of its lanes in a 64 bit mask");
+
+   public:
+    using value_type = T;
+    using put_t = typename Lane::put_t;
+    using get_t = typename std::conditional<!GetWait::returns_immediately, T, std::optional<T>>::type;
+
+    // Producer is the move only handle a producer puts through
+    class Producer {
+       public:
+        Producer(Producer &&other) noexcept : chan_(std::exchange(other.chan_, nullptr)), lane_(other.lane_) {}
+
+        Producer &operator=(Producer &&other) noexcept {
+            if (this != &other) {
+                release();
+                chan_ = std::exchange(other.chan_, nullptr);
+                lane_ = other.lane_;
+            }
+            return *this;
+        }
+
+        Producer(const Producer &) = delete;
+        Producer &operator=(const Producer &) = delete;
+
+        ~Producer() { release(); }
+
+        put_t put(const T &value) noexcept {
+            return chan_->notifyAfter([&] { return chan_->lanes_[lane_].put(value); });
+        }
+
+        put_t put(T &&value) noexcept {
+            return chan_->notifyAfter([&] { return chan_->lanes_[lane_].put(std::move(value)); });
+        }
+
+        // putBatch puts count values in order, as SPSC::putBatch does on the lane
+        std::size_t putBatch(const T *values, std::size_t count) noexcept {
+            return chan_->notifyAfter([&] { return chan_->lanes_[lane_].putBatch(values, count); });
+        }
+
+        template <class Rep, class Period>
+        bool try_put_for(const T &value, const std::chrono::duration<Rep, Period> &timeout) noexcept {
+            return chan_->notifyAfter([&] { return chan_->lanes_[lane_].try_put_for(value, timeout); });
+        }
+
+        template <class Clock, class Duration>
+        bool try_put_until(const T &value, const std::chrono::time_point<Clock, Duration> &deadline) noexcept {
+            return chan_->notifyAfter([&] { return chan_->lanes_[lane_].try_put_until(value, deadline); });
+        }
+
+        std::size_t lane() const noexcept { return lane_; }
+
+       private:
+        friend class LaneMPSC;
+
+        Producer(LaneMPSC *chan, std::size_t lane) noexcept : chan_(chan), lane_(lane) {}
+
+        void release() noexcept {
+            if (chan_ != nullptr) {
+                // release so that whoever claims the lane next carries on from where this producer left it
+                chan_->registry_.claimed_.fetch_and(~(uint64_t(1) << lane_), std::memory_order_release);
+                chan_ = nullptr;
+            }
+        }
+
+        LaneMPSC *chan_;
+        std::size_t lane_;
+    };
+
+    LaneMPSC() = default;
+
+    explicit LaneMPSC(Merge merge) : merge_(std::move(merge)) {}
+
+    // registerProducer claims the lowest free lane, or returns nullopt when all max_producers of them are taken
+    std::optional<Producer> registerProducer() noexcept {
+        auto claimed = registry_.claimed_.load(std::memory_order_relaxed);
+        while (true) {
+            auto free = ~claimed & all_lanes;
+            if (free == 0) {
+                return std::nullopt;
+            }
+
+            std::size_t lane = __builtin_ctzll(free);
+            if (registry_.claimed_.compare_exchange_weak(claimed, claimed | (uint64_t(1) << lane), std::memory_order_acquire,
+                                                         std::memory_order_relaxed)) {
+                // the consumer only looks at lanes below the highest one ever claimed
+                auto lanes = registry_.num_lanes_.load(std::memory_order_relaxed);
+                while (lanes <= lane && !registry_.num_lanes_.compare_exchange_weak(lanes, lane + 1, std::memory_order_release,
+                                                                                    std::memory_order_relaxed)) {
+                }
+                return Producer(this, lane);
+            }
+        }
+    }
+
+    // get waits as per the get wait strategy for the next entry. Once the channel's been closed and drained it
+    // returns a default constructed T rather than waiting, or std::nullopt with ReturnImmediateStrategy.
+    get_t get() noexcept {
+        T value{};
+        if (!get(value)) {
+            if constexpr (GetWait::returns_immediately) {
+                return std::nullopt;
+            }
+        }
+        return value;
+    }
+
+    // get moves the next entry into value as above, but returns false once the channel's been closed and drained so
+    // the consumer can tell that apart from a real entry. With ReturnImmediateStrategy it also returns false when
+    // there's nothing to get yet.
+    bool get(T &value) noexcept {
+        while (true) {
+            // closed is read first, so anything put before the close is in a lane by the time next looks
+            auto closed = isClosed();
+            auto lane = next();
+            if (lane < max_producers) {
+                value = lanes_[lane].get();
+                return true;
+            }
+
+            if (closed) {
+                return false;
+            }
+            if constexpr (GetWait::returns_immediately) {
+                return false;
+            } else {
+                GetWait::wait(common_.get_wait_, [this] { return !isEmpty() || isClosed(); });
+            }
+        }
+    }
+
+    // getBatch copies up to max entries out to values and returns how many it copied. With RoundRobin it takes
+    // everything each lane has in turn, with ByKey it takes them one at a time in order. It never waits.
+    std::size_t getBatch(T *values, std::size_t max) noexcept {
+        std::size_t done = 0;
+        if constexpr (std::is_same<Merge, RoundRobin>::value) {
+            auto lanes = registry_.num_lanes_.load(std::memory_order_acquire);
+            for (std::size_t i = 0; i < lanes && done < max; ++i) {
+                auto lane = consumer_.next_lane_ < lanes ? consumer_.next_lane_ : 0;
+                consumer_.next_lane_ = lane + 1;
+                done += lanes_[lane].getBatch(values + done, max - done);
+            }
+        } else {
+            for (auto lane = next(); done < max && lane < max_producers; lane = next()) {
+                values[done++] = lanes_[lane].get();
+            }
+        }
+        return done;
+    }
+
+    // try_get_for and try_get_until wait as per the get wait strategy, but give up once the deadline has passed
+    template <class Rep, class Period>
+    std::optional<T> try_get_for(const std::chrono::duration<Rep, Period> &timeout) noexcept {
+        return getUntil(Deadline(timeout));
+    }
+
+    template <class Clock, class Duration>
+    std::optional<T> try_get_until(const std::chrono::time_point<Clock, Duration> &deadline) noexcept {
+        return getUntil(Deadline(deadline));
+    }
+
+    // close closes every lane, so puts fail from then on and producers waiting on a full lane wake up, and wakes the
+    // consumer, which carries on with whatever's left in the lanes and then reports the channel closed as SPSC does
+    void close() noexcept {
+        for (auto &lane : lanes_) {
+            lane.close();
+        }
+        GetWait::notify(common_.get_wait_);
+    }
+
+    bool isClosed() const noexcept { return lanes_[0].isClosed(); }
+
+    std::size_t size() const noexcept {
+        std::size_t size = 0;
+        auto lanes = registry_.num_lanes_.load(std::memory_order_acquire);
+        for (std::size_t lane = 0; lane < lanes; ++lane) {
+            size += lanes_[lane].size();
+        }
+        return size;
+    }
+
+    bool isEmpty() const noexcept {
+        auto lanes = registry_.num_lanes_.load(std::memory_order_acquire);
+        for (std::size_t lane = 0; lane < lanes; ++lane) {
+            if (!lanes_[lane].isEmpty()) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+   private:
+    static constexpr uint64_t all_lanes = max_producers == 64 ? ~uint64_t(0) : (uint64_t(1) << max_producers) - 1;
+
+    // notifyAfter wakes the consumer once put has put anything into a lane, and returns whatever put returned
+    template <class Put>
+    auto notifyAfter(Put &&put) noexcept {
+        if constexpr (std::is_void<decltype(put())>::value) {
+            put();
+            GetWait::notify(common_.get_wait_);
+        } else {
+            auto result = put();
+            if (result) {
+                GetWait::notify(common_.get_wait_);
+            }
+            return result;
+        }
+    }
+
+    // next picks the lane to get from as per Merge, or returns max_producers when they're all empty
+    std::size_t next() noexcept {
+        auto lanes = registry_.num_lanes_.load(std::memory_order_acquire);
+        if constexpr (std::is_same<Merge, RoundRobin>::value) {
+            auto lane = consumer_.next_lane_;
+            for (std::size_t i = 0; i < lanes; ++i) {
+                if (lane >= lanes) {
+                    lane = 0;
+                }
+                if (lanes_[lane].peek() != nullptr) {
+                    consumer_.next_lane_ = lane + 1;
+                    return lane;
+                }
+                ++lane;
+            }
+            return max_producers;
+        } else {
+            auto best = max_producers;
+            const T *oldest = nullptr;
+            for (std::size_t lane = 0; lane < lanes; ++lane) {
+                auto head = lanes_[lane].peek();
+                if (head != nullptr && (oldest == nullptr || merge_.key(*head) < merge_.key(*oldest))) {
+                    best = lane;
+                    oldest = head;
+                }
+            }
+            return best;
+        }
+    }
+
+    std::optional<T> getUntil(const Deadline &deadline) noexcept {
+        while (true) {
+            auto lane = next();
+            if (lane < max_producers) {
+                return lanes_[lane].get();
+            }
+            if (deadline.expired()) {
+                return std::nullopt;
+            }
+            if (isClosed()) {
+                // have one last look, as a put may have landed between next and the close
+                lane = next();
+                return lane < max_producers ? std::optional<T>(lanes_[lane].get()) : std::nullopt;
+            }
+            GetWait::wait_until(common_.get_wait_, [this] { return !isEmpty() || isClosed(); }, deadline);
+        }
+    }
+
+    std::array<Lane, max_producers> lanes_;
+
+    struct alignas(hardware_destructive_interference_size) Common {
+        GetWaitStrategy get_wait_{};
+    };
+
+    struct alignas(hardware_destructive_interference_size) Registry {
+        std::atomic<uint64_t> claimed_{0};
+        std::atomic<std::size_t> num_lanes_{0};
+    };
+
+    struct alignas(hardware_destructive_interference_size) Consumer {
+        std::size_t next_lane_{0};
+    };
+
+    Common common_;
+    Registry registry_;
+    Consumer consumer_;
+    Merge merge_;
+};
+
+}  // namespace fastchan
+
+#endif
@@ -0,0 +1,223 @@
+#include <chrono>
+#include <cstdint>
+#include <limits>
+#include <optional>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "wait_strategy.hpp"
+
+#ifndef FASTCHANMERGE_HPP
+#define FASTCHANMERGE_HPP
+
+namespace fastchan {
+
+// OrderedMerge is a k-way merge over channels which are each in order of key(entry) on their own, e.g. per venue
+// feeds keyed by exchange timestamp, that hands their entries out in one global order. The next entry is the smallest
+// of the ones at the heads of the channels, found with a tournament tree over what peek() returns, and it's only
+// handed out once every channel has advanced past it: a channel that's empty must have last handed out an entry with
+// a key at least as large, as it can't come up with anything older after that. Until every channel has handed out
+// something that holds the merge up, as does a channel that's gone quiet, so lateness bounds how long the merge waits
+// for the stragglers before it hands the head out regardless. Anything older they come up with afterwards is handed
+// out late, i.e. out of order, and counted in late().
+//
+// It's the consumer of all of its channels, which need peek() like SPSC, and backs off between polls as per
+// IdleWaitStrategy.
+template <class Chan, class Key, class IdleWaitStrategy = PauseWaitStrategy>
+class OrderedMerge {
+    using Idle = WaitStrategyTraits<IdleWaitStrategy>;
+
+   public:
+    using value_type = typename Chan::value_type;
+    using key_type = std::decay_t<std::invoke_result_t<const Key &, const value_type &>>;
+
+    explicit OrderedMerge(std::vector<Chan *> channels, Key key = Key(), std::chrono::nanoseconds lateness = std::chrono::nanoseconds::max())
+        : channels_(std::move(channels)), key_(std::move(key)), lateness_(lateness), lanes_(channels_.size()) {
+        while (leaves_ < channels_.size()) {
+            leaves_ *= 2;
+        }
+        tree_.assign(2 * leaves_, uint32_t(channels_.size()));
+        for (uint32_t lane = 0; lane < channels_.size(); ++lane) {
+            tree_[leaves_ + lane] = lane;
+            empty_.push_back(lane);
+        }
+    }
+
+    // poll hands out the next entry in order if it can, without waiting
+    std::optional<value_type> poll() noexcept {
+        std::optional<value_type> value;
+        next([&](value_type &&v) { value.emplace(std::move(v)); });
+        return value;
+    }
+
+    // get waits as per IdleWaitStrategy until it can hand out the next entry in order
+    value_type get() noexcept {
+        while (true) {
+            if (auto value = poll()) {
+                return std::move(*value);
+            }
+            Idle::wait(idle_, [this] { return arrived(); });
+        }
+    }
+
+    // try_get_for and try_get_until wait as per IdleWaitStrategy, but give up once the deadline has passed
+    template <class Rep, class Period>
+    std::optional<value_type> try_get_for(const std::chrono::duration<Rep, Period> &timeout) noexcept {
+        return getUntil(Deadline(timeout));
+    }
+
+    template <class Clock, class Duration>
+    std::optional<value_type> try_get_until(const std::chrono::time_point<Clock, Duration> &deadline) noexcept {
+        return getUntil(Deadline(deadline));
+    }
+
+    // drain hands up to max entries to f(value_type &&) in order, as many as it can without waiting, and returns how
+    // many it handed out
+    template <class F>
+    std::size_t drain(F &&f, std::size_t max = std::numeric_limits<std::size_t>::max()) {
+        std::size_t count = 0;
+        while (count < max && next(f)) {
+            ++count;
+        }
+        return count;
+    }
+
+    // late is how many entries have been handed out without waiting for every channel to catch up, as lateness ran out
+    std::size_t late() const noexcept { return late_; }
+
+   private:
+    struct Lane {
+        const value_type *head = nullptr;
+        key_type key{};
+        // progress is the key of the last entry handed out from the lane, which is all we know about it when it's empty
+        key_type progress{};
+        bool started = false;
+    };
+
+    template <class F>
+    bool next(F &&f) {
+        // pick up whatever's arrived on the empty channels
+        for (std::size_t i = 0; i < empty_.size();) {
+            auto lane = empty_[i];
+            if (refresh(lane)) {
+                empty_[i] = empty_.back();
+                empty_.pop_back();
+            } else {
+                ++i;
+            }
+        }
+
+        // the root only loses to padding when there are no channels, and can still be an empty lane when they're all empty
+        auto winner = tree_[1];
+        if (winner >= channels_.size() || lanes_[winner].head == nullptr) {
+            return false;
+        }
+
+        const auto &key = lanes_[winner].key;
+        bool behind = false;
+        for (auto lane : empty_) {
+            if (!lanes_[lane].started || lanes_[lane].progress < key) {
+                behind = true;
+                break;
+            }
+        }
+
+        if (behind) {
+            if (lateness_ == std::chrono::nanoseconds::max()) {
+                return false;
+            }
+            if (!held_until_) {
+                held_until_.emplace(lateness_);
+            }
+            if (!held_until_->expired()) {
+                return false;
+            }
+            ++late_;
+        }
+        held_until_.reset();
+
+        auto &lane = lanes_[winner];
+        lane.progress = lane.key;
+        lane.started = true;
+        if constexpr (std::is_same<typename Chan::get_t, value_type>::value) {
+            f(channels_[winner]->get());
+        } else {
+            f(std::move(*channels_[winner]->get()));
+        }
+
+        if (!refresh(winner)) {
+            lane.head = nullptr;
+            empty_.push_back(winner);
+            replay(winner);
+        }
+        return true;
+    }
+
+    // refresh peeks at the channel of an empty or just consumed lane, and replays its match if there's an entry
+    bool refresh(uint32_t lane) noexcept {
+        auto head = channels_[lane]->peek();
+        if (head == nullptr) {
+            return false;
+        }
+        lanes_[lane].head = head;
+        lanes_[lane].key = key_(*head);
+        replay(lane);
+        return true;
+    }
+
+    // winner of two lanes, the one with the smaller head and the lower lane on a tie, with empty lanes always losing
+    uint32_t winner(uint32_t a, uint32_t b) const noexcept {
+        if (a >= channels_.size() || lanes_[a].head == nullptr) {
+            return b;
+        }
+        if (b >= channels_.size() || lanes_[b].head == nullptr) {
+            return a;
+        }
+        return lanes_[b].key < lanes_[a].key ? b : a;
+    }
+
+    void replay(uint32_t lane) noexcept {
+        for (auto node = (leaves_ + lane) / 2; node > 0; node /= 2) {
+            tree_[node] = winner(tree_[2 * node], tree_[2 * node + 1]);
+        }
+    }
+
+    // arrived is whether poll may have something new to go on, for the idle wait
+    bool arrived() const noexcept {
+        for (auto lane : empty_) {
+            if (!channels_[lane]->isEmpty()) {
+                return true;
+            }
+        }
+        return held_until_ && held_until_->expired();
+    }
+
+    std::optional<value_type> getUntil(const Deadline &deadline) noexcept {
+        while (true) {
+            if (auto value = poll()) {
+                return value;
+            }
+            if (deadline.expired()) {
+                return std::nullopt;
+            }
+            Idle::wait_until(idle_, [this] { return arrived(); }, deadline);
+        }
+    }
+
+    std::vector<Chan *> channels_;
+    Key key_;
+    std::chrono::nanoseconds lateness_;
+    std::vector<Lane> lanes_;
+    std::vector<uint32_t> empty_;
+    // tree_ is the tournament tree, tree_[1] is the overall winner and the leaves start at tree_[leaves_]
+    std::vector<uint32_t> tree_;
+    std::size_t leaves_ = 1;
+    std::optional<Deadline> held_until_;
+    std::size_t late_ = 0;
+    IdleWaitStrategy idle_;
+};
+
+}  // namespace fastchan
+
+#endif
@@ -1,104 +1,489 @@
+#include <algorithm>
 #include <array>
 #include <atomic>
+#include <chrono>
 #include <condition_variable>
+#include <cstdint>
+#include <limits>
 #include <mutex>
 #include <optional>
 #include <thread>
+#include <type_traits>
+#include <utility>
 
+#include "bulk.hpp"
 #include "common.hpp"
 #include "wait_strategy.hpp"
 
+#ifndef FASTCHANMPSC_HPP
+#define FASTCHANMPSC_HPP
+
 namespace fastchan {
 
-template <typename T, size_t min_size, class PutWaitStrategy = YieldWaitStrategy, class GetWaitStrategy = YieldWaitStrategy>
+// CASClaim and FetchAddClaim are how an MPSC's producers claim their slots. With CASClaim a producer only claims a slot
+// once it's seen it free, retrying its compare and swap whenever another producer got there first, which happens more
+// the more producers there are. With FetchAddClaim the puts that wait claim with a fetch_add, which never fails and
+// never retries. They still wait for room before claiming, so it's only producers racing for the last free slots that
+// claim past the end of the buffer, and those wait for their slot to come free rather than give it back. Puts that
+// can give up, with ReturnImmediateStrategy or a deadline, claim with a CAS either way.
+struct CASClaim {};
+struct FetchAddClaim {};
+
+template <typename T, size_t min_size, class PutWaitStrategy = YieldWaitStrategy, class GetWaitStrategy = YieldWaitStrategy,
+          class ClaimStrategy = CASClaim>
 class MPSC {
+    using PutWait = WaitStrategyTraits<PutWaitStrategy>;
+    using GetWait = WaitStrategyTraits<GetWaitStrategy>;
+
+    static_assert(std::is_same<ClaimStrategy, CASClaim>::value || std::is_same<ClaimStrategy, FetchAddClaim>::value,
+                  "an MPSC claims its slots with either CASClaim or FetchAddClaim");
+    // fetch_add_claims is whether the puts that wait claim with a fetch_add, those that can give up never do
+    static constexpr bool fetch_add_claims = std::is_same<ClaimStrategy, FetchAddClaim>::value && !PutWait::returns_immediately;
+
    public:
-    using put_t = typename std::conditional<!std::is_same<PutWaitStrategy, ReturnImmediateStrategy>::value, void, bool>::type;
-    using get_t = typename std::conditional<!std::is_same<GetWaitStrategy, ReturnImmediateStrategy>::value, T, std::optional<T>>::type;
+    using value_type = T;
+    using put_t = typename std::conditional<!PutWait::returns_immediately, void, bool>::type;
+    using get_t = typename std::conditional<!GetWait::returns_immediately, T, std::optional<T>>::type;
 
     MPSC() = default;
 
-    put_t put(const T &value) noexcept {
+    put_t put(const T &value) noexcept { return putValue(value); }
+
+    // put moves value into the buffer, e.g. for a move only Handle from an ObjectPool
+    put_t put(T &&value) noexcept { return putValue(std::move(value)); }
+
+    // get waits as per the get wait strategy for the next entry. Once the channel's been closed and drained it
+    // returns a default constructed T rather than waiting, or std::nullopt with ReturnImmediateStrategy.
+    get_t get() noexcept {
+        if (consumer_.reader_index_2_ >= consumer_.last_committed_index_cache_ && !awaitEntry()) {
+            if constexpr (GetWait::returns_immediately) {
+                return std::nullopt;
+            } else {
+                return T{};
+            }
+        }
+        return take();
+    }
+
+    // get moves the next entry into value as above, but returns false once the channel's been closed and drained so
+    // the consumer can tell that apart from a real entry. With ReturnImmediateStrategy it also returns false when
+    // there's nothing to get yet.
+    bool get(T &value) noexcept {
+        if (consumer_.reader_index_2_ >= consumer_.last_committed_index_cache_ && !awaitEntry()) {
+            return false;
+        }
+        value = take();
+        return true;
+    }
+
+    // putBatch puts count values in order, claiming as many slots as are free at a time and committing them with a
+    // single store. It waits as per the put wait strategy until they've all been put, other than with
+    // ReturnImmediateStrategy where it stops as soon as the buffer is full. It returns the number of values put.
+    std::size_t putBatch(const T *values, std::size_t count) noexcept {
+        auto &p = producer();
+        std::size_t done = 0;
+        if constexpr (fetch_add_claims) {
+            // at most a buffer's worth at a time, as slots past that are only freed once the ones before them are got
+            while (done < count) {
+                auto claimed = std::min(count - done, contents_.size());
+                if (!claim(p, claimed)) {
+                    return done;
+                }
+                FASTCHAN_SCHEDULE_POINT();
+                auto start = p.write_index_cache_ & common_.index_mask_;
+                auto first = std::min(claimed, contents_.size() - start);
+                bulkCopy(&contents_[start], values + done, first);
+                bulkCopy(&contents_[0], values + done + first, claimed - first);
+                publish(p, claimed);
+                done += claimed;
+            }
+            return done;
+        }
+        while (done < count) {
+            std::size_t claimed;
+            do {
+                while (p.write_index_cache_ > (p.reader_index_cache_ + common_.index_mask_)) {
+                    p.write_index_cache_ = next_free_index_.load(std::memory_order_acquire);
+                    if (p.write_index_cache_ & closed_bit) {
+                        return done;
+                    }
+                    p.reader_index_cache_ = consumer_.reader_index_.load(std::memory_order_acquire);
+                    if (p.write_index_cache_ <= (p.reader_index_cache_ + common_.index_mask_)) {
+                        break;
+                    }
+                    if constexpr (PutWait::returns_immediately) {
+                        return done;
+                    } else {
+                        PutWait::wait(common_.put_wait_, [this, &p] { return hasRoom(p) || isClosed(); }, &consumer_.reader_index_);
+                    }
+                }
+                claimed = std::min(count - done, p.reader_index_cache_ + common_.index_mask_ + 1 - p.write_index_cache_);
+            } while (!next_free_index_.compare_exchange_strong(p.write_index_cache_, p.write_index_cache_ + claimed, std::memory_order_acq_rel,
+                                                                std::memory_order_acquire));
+
+            FASTCHAN_SCHEDULE_POINT();
+            auto start = p.write_index_cache_ & common_.index_mask_;
+            auto first = std::min(claimed, contents_.size() - start);
+            bulkCopy(&contents_[start], values + done, first);
+            bulkCopy(&contents_[0], values + done + first, claimed - first);
+            publish(p, claimed);
+            done += claimed;
+        }
+
+        return done;
+    }
+
+    // drain hands up to max committed entries to f in place, as at most two contiguous ranges when they wrap around
+    // the end of the buffer, by calling f(const T *data, std::size_t count). An f that takes
+    // (const T *first, std::size_t first_count, const T *second, std::size_t second_count) gets both at once instead,
+    // with second_count 0 when they don't wrap, e.g. for a single writev. The entries are only released back to
+    // the producers once f returns. It never waits and returns the number of entries drained.
+    template <class F>
+    std::size_t drain(F &&f, std::size_t max = std::numeric_limits<std::size_t>::max()) {
+        consumer_.last_committed_index_cache_ = last_committed_index_.load(std::memory_order_acquire);
+        auto count = std::min(consumer_.last_committed_index_cache_ - consumer_.reader_index_2_, max);
+        if (count == 0) {
+            return 0;
+        }
+
+        auto start = consumer_.reader_index_2_ & common_.index_mask_;
+        auto first = std::min(count, contents_.size() - start);
+        if constexpr (std::is_invocable<F &, const T *, std::size_t, const T *, std::size_t>::value) {
+            f(&contents_[start], first, &contents_[0], count - first);
+        } else {
+            f(&contents_[start], first);
+            if (count > first) {
+                f(&contents_[0], count - first);
+            }
+        }
+        FASTCHAN_SCHEDULE_POINT();
+
+        consumer_.reader_index_2_ += count;
+        consumer_.reader_index_.store(consumer_.reader_index_2_, std::memory_order_release);
+
+        PutWait::notify(common_.put_wait_);
+
+        return count;
+    }
+
+    // getBatch copies up to max committed entries out to values, in order, and returns how many it copied. As with
+    // drain it never waits.
+    std::size_t getBatch(T *values, std::size_t max) noexcept {
+        std::size_t done = 0;
+        return drain(
+            [&](const T *data, std::size_t count) {
+                bulkCopy(values + done, data, count);
+                done += count;
+            },
+            max);
+    }
+
+    // try_put_for and try_put_until wait as per the put wait strategy for a free slot, but give up once the deadline
+    // has passed or the channel's been closed. Once a slot is claimed the put always completes, as with
+    // ReturnImmediateStrategy.
+    template <class Rep, class Period>
+    bool try_put_for(const T &value, const std::chrono::duration<Rep, Period> &timeout) noexcept {
+        return putUntil(value, Deadline(timeout));
+    }
+
+    template <class Clock, class Duration>
+    bool try_put_until(const T &value, const std::chrono::time_point<Clock, Duration> &deadline) noexcept {
+        return putUntil(value, Deadline(deadline));
+    }
+
+    // try_get_for and try_get_until wait as per the get wait strategy, but give up once the deadline has passed or the
+    // channel's been closed and drained
+    template <class Rep, class Period>
+    std::optional<T> try_get_for(const std::chrono::duration<Rep, Period> &timeout) noexcept {
+        return getUntil(Deadline(timeout));
+    }
+
+    template <class Clock, class Duration>
+    std::optional<T> try_get_until(const std::chrono::time_point<Clock, Duration> &deadline) noexcept {
+        return getUntil(Deadline(deadline));
+    }
+
+    // close stops the channel taking any more values and wakes up everything waiting on it, whatever the wait
+    // strategies. Puts fail from then on, returning false, or dropping the value when put_t is void, while gets carry
+    // on with whatever's left and then report the channel closed rather than wait. The closed bit is folded into
+    // next_free_index_, so a producer only finds it when its claim fails, or in what its fetch_add returns, and any
+    // put that's claimed its slot before the close is still committed and got before the consumer sees the channel
+    // drained. With FetchAddClaim that includes claims past the end of the buffer, which wait for the consumer to
+    // drain the channel.
+    void close() noexcept {
+        auto claimed = next_free_index_.fetch_or(closed_bit, std::memory_order_seq_cst);
+        closed_at_.store(claimed & ~closed_bit, std::memory_order_release);
+        GetWait::notify(common_.get_wait_);
+        PutWait::notify(common_.put_wait_);
+    }
+
+    bool isClosed() const noexcept { return next_free_index_.load(std::memory_order_acquire) & closed_bit; }
+
+    std::size_t size() const noexcept {
+        return last_committed_index_.load(std::memory_order_acquire) - consumer_.reader_index_.load(std::memory_order_acquire);
+    }
+
+    bool isEmpty() const noexcept { return consumer_.reader_index_.load(std::memory_order_acquire) >= last_committed_index_.load(std::memory_order_acquire); }
+
+    bool isFull() const noexcept {
+        // this isFull is about whether there's all writer slots to the buffer are taken rather than whether those
+        // changes have actually been committed
+        return (next_free_index_.load(std::memory_order_acquire) & ~closed_bit) > (consumer_.reader_index_.load(std::memory_order_acquire) + common_.index_mask_);
+    }
+
+    // capacity is min_size rounded up to the next power of two, which is how many entries fit at once
+    std::size_t capacity() const noexcept { return common_.index_mask_ + 1; }
+
+   private:
+    struct Producer;
+
+    // closed_bit is the top bit of next_free_index_, which would take centuries of puts to reach
+    static constexpr std::size_t closed_bit = std::size_t(1) << (std::numeric_limits<std::size_t>::digits - 1);
+
+    // producer returns this thread's cached indices. They're shared by every MPSC of the same type on this thread, so
+    // they're reset whenever the thread moves to a different instance as a stale reader index would let it overrun.
+    Producer &producer() noexcept {
         alignas(hardware_destructive_interference_size) thread_local static Producer p;
+        if (p.instance_id_ != common_.instance_id_) {
+            p = Producer{};
+            p.instance_id_ = common_.instance_id_;
+        }
+        return p;
+    }
+
+    template <class U>
+    put_t putValue(U &&value) noexcept {
+        auto &p = producer();
+        if constexpr (fetch_add_claims) {
+            if (claim(p, 1)) {
+                FASTCHAN_SCHEDULE_POINT();
+                contents_[p.write_index_cache_ & common_.index_mask_] = std::forward<U>(value);
+                publish(p, 1);
+            }
+            return;
+        }
         do {
+            // a claim against a closed channel fails as the closed bit's set, and leaves the cached index with it set
+            // too, so it always ends up here
             while (p.write_index_cache_ > (p.reader_index_cache_ + common_.index_mask_)) {
                 p.write_index_cache_ = next_free_index_.load(std::memory_order_acquire);
-                p.reader_index_cache_ = consumer_.reader_index_.load(std::memory_order_relaxed);
-                if constexpr (std::is_same<PutWaitStrategy, ReturnImmediateStrategy>::value) {
+                if (p.write_index_cache_ & closed_bit) {
+                    if constexpr (PutWait::returns_immediately) {
+                        return false;
+                    } else {
+                        return;
+                    }
+                }
+                p.reader_index_cache_ = consumer_.reader_index_.load(std::memory_order_acquire);
+                if (p.write_index_cache_ <= (p.reader_index_cache_ + common_.index_mask_)) {
+                    break;
+                }
+                if constexpr (PutWait::returns_immediately) {
                     return false;
                 } else {
-                    common_.put_wait_.wait(
-                        [this] { return p.write_index_cache_ <= (consumer_.reader_index_.load(std::memory_order_relaxed) + common_.index_mask_); });
+                    PutWait::wait(common_.put_wait_, [this, &p] { return hasRoom(p) || isClosed(); }, &consumer_.reader_index_);
                 }
             }
         } while (
             !next_free_index_.compare_exchange_strong(p.write_index_cache_, p.write_index_cache_ + 1, std::memory_order_acq_rel, std::memory_order_acquire));
 
-        contents_[p.write_index_cache_ & common_.index_mask_] = value;
+        FASTCHAN_SCHEDULE_POINT();
+        contents_[p.write_index_cache_ & common_.index_mask_] = std::forward<U>(value);
+        publish(p, 1);
 
-        // commit in the correct order to avoid problems
-        while (last_committed_index_.load(std::memory_order_relaxed) != p.write_index_cache_) {
-            // we don't return at this point even in case of ReturnImmediatelyStrategy as we've already taken the token
-            common_.put_wait_.wait([this] { return last_committed_index_.load(std::memory_order_relaxed) == p.write_index_cache_; });
+        if constexpr (PutWait::returns_immediately) {
+            return true;
         }
+    }
 
-        last_committed_index_.store(++p.write_index_cache_, std::memory_order_release);
+    // claim takes the next count slots with a fetch_add, leaving the first in p.write_index_cache_, and returns false
+    // when the channel was closed before it. It waits for room first, as a claim that's waiting holds up every commit
+    // after it, so a claim only goes past the end of the buffer when it races other producers for the last slots. It
+    // then waits for the consumer to get to the entries a lap before it, even once the channel's been closed, as the
+    // claims after it have been made already and it has to commit for them to.
+    inline bool claim(Producer &p, std::size_t count) noexcept {
+        auto next_free = next_free_index_.load(std::memory_order_acquire);
+        while ((next_free & ~closed_bit) + count - 1 > (p.reader_index_cache_ + common_.index_mask_)) {
+            if (next_free & closed_bit) {
+                return false;
+            }
+            p.reader_index_cache_ = consumer_.reader_index_.load(std::memory_order_acquire);
+            if (next_free + count - 1 <= (p.reader_index_cache_ + common_.index_mask_)) {
+                break;
+            }
+            PutWait::wait(
+                common_.put_wait_,
+                [this, next_free, count] {
+                    return next_free + count - 1 <= (consumer_.reader_index_.load(std::memory_order_acquire) + common_.index_mask_) || isClosed();
+                },
+                &consumer_.reader_index_);
+            next_free = next_free_index_.load(std::memory_order_acquire);
+        }
 
-        common_.get_wait_.notify();
-        common_.put_wait_.notify();
+        auto first = next_free_index_.fetch_add(count, std::memory_order_acq_rel);
+        if (first & closed_bit) {
+            return false;
+        }
+        p.write_index_cache_ = first;
 
-        if constexpr (std::is_same<PutWaitStrategy, ReturnImmediateStrategy>::value) {
-            return true;
+        auto last = first + count - 1;
+        while (last > (p.reader_index_cache_ + common_.index_mask_)) {
+            p.reader_index_cache_ = consumer_.reader_index_.load(std::memory_order_acquire);
+            if (last <= (p.reader_index_cache_ + common_.index_mask_)) {
+                break;
+            }
+            PutWait::wait(
+                common_.put_wait_, [this, last] { return last <= (consumer_.reader_index_.load(std::memory_order_acquire) + common_.index_mask_); },
+                &consumer_.reader_index_);
         }
+        return true;
     }
 
-    get_t get() noexcept {
+    // publish commits the count slots from p.write_index_cache_ once they've been written
+    inline void publish(Producer &p, std::size_t count) noexcept {
+        FASTCHAN_SCHEDULE_POINT();
+        // commit in the correct order to avoid problems. The acquire carries the earlier producers' writes along to the
+        // consumer, whose acquire of our commit would otherwise only cover our own slots.
+        while (last_committed_index_.load(std::memory_order_acquire) != p.write_index_cache_) {
+            // we don't return at this point even in case of ReturnImmediatelyStrategy as we've already taken the token
+            PutWait::wait(
+                common_.put_wait_, [this, &p] { return last_committed_index_.load(std::memory_order_relaxed) == p.write_index_cache_; },
+                &last_committed_index_);
+        }
+
+        p.write_index_cache_ += count;
+        last_committed_index_.store(p.write_index_cache_, std::memory_order_release);
+        FASTCHAN_SCHEDULE_POINT();
+
+        GetWait::notify(common_.get_wait_);
+        PutWait::notify(common_.put_wait_);
+    }
+
+    bool putUntil(const T &value, const Deadline &deadline) noexcept {
+        auto &p = producer();
+        do {
+            while (p.write_index_cache_ > (p.reader_index_cache_ + common_.index_mask_)) {
+                p.write_index_cache_ = next_free_index_.load(std::memory_order_acquire);
+                if (p.write_index_cache_ & closed_bit) {
+                    return false;
+                }
+                p.reader_index_cache_ = consumer_.reader_index_.load(std::memory_order_acquire);
+                if (p.write_index_cache_ <= (p.reader_index_cache_ + common_.index_mask_)) {
+                    break;
+                }
+                if (deadline.expired()) {
+                    return false;
+                }
+                PutWait::wait_until(common_.put_wait_, [this, &p] { return hasRoom(p) || isClosed(); }, deadline);
+            }
+        } while (
+            !next_free_index_.compare_exchange_strong(p.write_index_cache_, p.write_index_cache_ + 1, std::memory_order_acq_rel, std::memory_order_acquire));
+
+        FASTCHAN_SCHEDULE_POINT();
+        contents_[p.write_index_cache_ & common_.index_mask_] = value;
+        publish(p, 1);
+
+        return true;
+    }
+
+    bool hasRoom(const Producer &p) const noexcept {
+        return p.write_index_cache_ <= (consumer_.reader_index_.load(std::memory_order_acquire) + common_.index_mask_);
+    }
+
+    // awaitEntry is get's slow path, for when the cached index says there's nothing to get. It waits as per the get
+    // wait strategy and returns false once the channel's closed and drained, or as soon as there's nothing to get
+    // with ReturnImmediateStrategy.
+    bool awaitEntry() noexcept {
         while (consumer_.reader_index_2_ >= consumer_.last_committed_index_cache_) {
-            consumer_.last_committed_index_cache_ = last_committed_index_.load(std::memory_order_relaxed);
-            if constexpr (std::is_same<GetWaitStrategy, ReturnImmediateStrategy>::value) {
-                return std::nullopt;
+            consumer_.last_committed_index_cache_ = last_committed_index_.load(std::memory_order_acquire);
+            if (consumer_.reader_index_2_ < consumer_.last_committed_index_cache_) {
+                break;
+            }
+            if constexpr (GetWait::returns_immediately) {
+                return false;
             } else {
-                common_.get_wait_.wait([this] { return consumer_.reader_index_2_ < last_committed_index_.load(std::memory_order_relaxed); });
+                if (isDrained()) {
+                    return false;
+                }
+                FASTCHAN_SCHEDULE_POINT();
+                GetWait::wait(
+                    common_.get_wait_,
+                    [this] { return consumer_.reader_index_2_ < last_committed_index_.load(std::memory_order_relaxed) || isClosed(); },
+                    &last_committed_index_);
             }
         }
+        return true;
+    }
+
+    // isDrained is whether the channel's closed and every slot claimed before the close has been got. Slots that are
+    // claimed but not yet committed are still to come. It goes by the claims the close counted rather than
+    // next_free_index_, which a fetch_add claim moves on even once it's closed.
+    bool isDrained() const noexcept { return consumer_.reader_index_2_ >= closed_at_.load(std::memory_order_acquire); }
 
-        auto contents = contents_[consumer_.reader_index_2_ & common_.index_mask_];
+    T take() noexcept {
+        auto contents = std::move(contents_[consumer_.reader_index_2_ & common_.index_mask_]);
+        FASTCHAN_SCHEDULE_POINT();
         consumer_.reader_index_.store(++consumer_.reader_index_2_, std::memory_order_release);
 
-        common_.put_wait_.notify();
+        PutWait::notify(common_.put_wait_);
 
         return contents;
     }
 
-    std::size_t size() const noexcept {
-        return last_committed_index_.load(std::memory_order_acquire) - consumer_.reader_index_.load(std::memory_order_acquire);
-    }
-
-    bool isEmpty() const noexcept { return consumer_.reader_index_.load(std::memory_order_acquire) >= last_committed_index_.load(std::memory_order_acquire); }
+    std::optional<T> getUntil(const Deadline &deadline) noexcept {
+        while (consumer_.reader_index_2_ >= consumer_.last_committed_index_cache_) {
+            consumer_.last_committed_index_cache_ = last_committed_index_.load(std::memory_order_acquire);
+            if (consumer_.reader_index_2_ < consumer_.last_committed_index_cache_) {
+                break;
+            }
+            if (deadline.expired() || isDrained()) {
+                return std::nullopt;
+            }
+            GetWait::wait_until(common_.get_wait_, [this] {
+                return consumer_.reader_index_2_ < last_committed_index_.load(std::memory_order_acquire) || isClosed();
+            }, deadline);
+        }
 
-    bool isFull() const noexcept {
-        // this isFull is about whether there's all writer slots to the buffer are taken rather than whether those
-        // changes have actually been committed
-        return next_free_index_.load(std::memory_order_acquire) > (consumer_.reader_index_.load(std::memory_order_acquire) + common_.index_mask_);
+        return take();
     }
 
-   private:
     std::array<T, roundUpNextPowerOfTwo(min_size)> contents_;
 
+    // The orderings are the least each side needs, and none of them costs more than a plain load or store on x86:
+    //  - a producer loads reader_index_ with acquire before claiming, and the consumer stores it with release once a
+    //    slot's been moved out of, so a slot is never overwritten while it's still being read
+    //  - claims are a CAS or a fetch_add on next_free_index_, which hands out slots and carries the closed bit, and
+    //    carries no data. A fetch_add claim past the end loads reader_index_ with acquire until its slots are free.
+    //  - close counts the claims made before it with the fetch_or that sets the closed bit, and releases the count in
+    //    closed_at_, which only the consumer's slow path reads to tell when the channel's drained
+    //  - commits go in claim order. A producer waits for last_committed_index_ to reach its claim with acquire and then
+    //    releases it past its own slots, so the consumer's acquire covers every earlier producer's slots as well as
+    //    the last one's, which a relaxed wait would leave out
+    //  - the consumer loads last_committed_index_ with acquire before reading a slot, in get as much as in drain
+    //  - the wait predicates only decide when to look again, the index is always loaded with acquire before a slot is
+    //    touched
     alignas(hardware_destructive_interference_size) std::atomic<std::size_t> next_free_index_{0};
+    std::atomic<std::size_t> closed_at_{std::numeric_limits<std::size_t>::max()};
     alignas(hardware_destructive_interference_size) std::atomic<std::size_t> last_committed_index_{0};
 
     struct alignas(hardware_destructive_interference_size) Common {
         GetWaitStrategy get_wait_{};
         PutWaitStrategy put_wait_{};
         const std::size_t index_mask_ = roundUpNextPowerOfTwo(min_size) - 1;
+        const uint64_t instance_id_ = nextInstanceId();
     };
 
     struct alignas(hardware_destructive_interference_size) Producer {
         std::size_t reader_index_cache_{0};
         std::size_t write_index_cache_{0};
+        uint64_t instance_id_{0};
     };
 
+    static uint64_t nextInstanceId() noexcept {
+        static std::atomic<uint64_t> next_id{1};
+        return next_id.fetch_add(1, std::memory_order_relaxed);
+    }
+
     struct alignas(hardware_destructive_interference_size) Consumer {
         std::size_t last_committed_index_cache_{0};
         std::size_t reader_index_2_{0};
@@ -110,3 +495,5 @@ class MPSC {
 };
 
 }  // namespace fastchan
+
+#endif
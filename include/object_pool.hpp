@@ -0,0 +1,171 @@
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <type_traits>
+#include <utility>
+
+#include "common.hpp"
+#include "wait_strategy.hpp"
+
+#ifndef FASTCHANOBJECT_POOL_HPP
+#define FASTCHANOBJECT_POOL_HPP
+
+namespace fastchan {
+
+// FreeList is a lock-free stack of slot indices in [0, size), a Treiber stack over an index array rather than nodes
+// so it never allocates. The head carries a tag which is bumped on every change to rule out ABA.
+class FreeList {
+   public:
+    static constexpr uint32_t npos = ~uint32_t(0);
+
+    explicit FreeList(uint32_t size) : next_(new std::atomic<uint32_t>[size]) {
+        for (uint32_t i = 0; i < size; ++i) {
+            next_[i].store(i + 1 < size ? i + 1 : npos, std::memory_order_relaxed);
+        }
+        head_.store(pack(0, size ? 0 : npos), std::memory_order_release);
+    }
+
+    // pop returns a free index, or npos if there are none left
+    uint32_t pop() noexcept {
+        auto head = head_.load(std::memory_order_acquire);
+        while (true) {
+            auto index = indexOf(head);
+            if (index == npos) {
+                return npos;
+            }
+            // next_ may be stale if another thread has taken index in the meantime, in which case the tag won't match
+            auto next = next_[index].load(std::memory_order_relaxed);
+            if (head_.compare_exchange_weak(head, pack(tagOf(head) + 1, next), std::memory_order_acquire, std::memory_order_acquire)) {
+                return index;
+            }
+        }
+    }
+
+    void push(uint32_t index) noexcept {
+        auto head = head_.load(std::memory_order_relaxed);
+        do {
+            next_[index].store(indexOf(head), std::memory_order_relaxed);
+        } while (!head_.compare_exchange_weak(head, pack(tagOf(head) + 1, index), std::memory_order_release, std::memory_order_relaxed));
+
+        if (on_push_) {
+            on_push_(on_push_context_);
+        }
+    }
+
+    // onPush sets f(context) to be called after every push, e.g. to wake up whoever's waiting for a free index. It's
+    // not synchronised with push, so it has to be set before any.
+    void onPush(void (*f)(void *), void *context) noexcept {
+        on_push_ = f;
+        on_push_context_ = context;
+    }
+
+    bool isEmpty() const noexcept { return indexOf(head_.load(std::memory_order_acquire)) == npos; }
+
+   private:
+    static constexpr uint64_t pack(uint32_t tag, uint32_t index) noexcept { return (uint64_t(tag) << 32) | index; }
+    static constexpr uint32_t tagOf(uint64_t head) noexcept { return uint32_t(head >> 32); }
+    static constexpr uint32_t indexOf(uint64_t head) noexcept { return uint32_t(head); }
+
+    alignas(hardware_destructive_interference_size) std::atomic<uint64_t> head_{pack(0, npos)};
+    std::unique_ptr<std::atomic<uint32_t>[]> next_;
+    void (*on_push_)(void *) = nullptr;
+    void *on_push_context_ = nullptr;
+};
+
+// Handle owns one object out of an ObjectPool and hands it back when it's destroyed or reset. It's move only, so it
+// can be put into an SPSC/MPSC with put(std::move(handle)) and comes back out of get on the consumer side, which then
+// returns it to the pool just by letting it go out of scope. The pool has to outlive every handle, including those
+// still sitting in a channel.
+template <typename T>
+class Handle {
+   public:
+    Handle() noexcept = default;
+
+    Handle(FreeList *free_list, T *object, uint32_t index) noexcept : free_list_(free_list), object_(object), index_(index) {}
+
+    Handle(Handle &&other) noexcept : free_list_(other.free_list_), object_(other.object_), index_(other.index_) { other.object_ = nullptr; }
+
+    Handle &operator=(Handle &&other) noexcept {
+        if (this != &other) {
+            reset();
+            free_list_ = other.free_list_;
+            object_ = other.object_;
+            index_ = other.index_;
+            other.object_ = nullptr;
+        }
+        return *this;
+    }
+
+    Handle(const Handle &) = delete;
+    Handle &operator=(const Handle &) = delete;
+
+    ~Handle() { reset(); }
+
+    // reset returns the object to its pool straight away
+    void reset() noexcept {
+        if (object_) {
+            free_list_->push(index_);
+            object_ = nullptr;
+        }
+    }
+
+    T *get() const noexcept { return object_; }
+    T &operator*() const noexcept { return *object_; }
+    T *operator->() const noexcept { return object_; }
+    explicit operator bool() const noexcept { return object_ != nullptr; }
+
+   private:
+    FreeList *free_list_ = nullptr;
+    T *object_ = nullptr;
+    uint32_t index_ = 0;
+};
+
+// ObjectPool preallocates size objects of T up front and recycles them through a FreeList, so acquiring and releasing
+// one is a single CAS each with no allocation, from any thread. Objects are default constructed once and then reused
+// as they are, which suits payload buffers that get overwritten anyway. Each one sits on its own cache line(s) so a
+// producer filling one doesn't contend with a consumer reading its neighbour. acquire waits as per the wait strategy
+// when the pool is exhausted, other than with ReturnImmediateStrategy where it returns an empty Handle. A strategy that
+// needs notifying is notified whenever a Handle hands its object back.
+template <typename T, class WaitStrategy = YieldWaitStrategy>
+class ObjectPool {
+    using Wait = WaitStrategyTraits<WaitStrategy>;
+
+   public:
+    explicit ObjectPool(uint32_t size) : size_(size), free_list_(size), slots_(new Slot[size]) {
+        if constexpr (Wait::needs_notify) {
+            free_list_.onPush([](void *pool) { Wait::notify(static_cast<ObjectPool *>(pool)->wait_); }, this);
+        }
+    }
+
+    ObjectPool(const ObjectPool &) = delete;
+    ObjectPool &operator=(const ObjectPool &) = delete;
+
+    Handle<T> acquire() noexcept {
+        auto index = free_list_.pop();
+        while (index == FreeList::npos) {
+            if constexpr (Wait::returns_immediately) {
+                return Handle<T>{};
+            } else {
+                Wait::wait(wait_, [this] { return !free_list_.isEmpty(); });
+            }
+            index = free_list_.pop();
+        }
+        return Handle<T>(&free_list_, &slots_[index].object_, index);
+    }
+
+    uint32_t size() const noexcept { return size_; }
+
+   private:
+    struct alignas(hardware_destructive_interference_size) Slot {
+        T object_{};
+    };
+
+    const uint32_t size_;
+    FreeList free_list_;
+    std::unique_ptr<Slot[]> slots_;
+    WaitStrategy wait_{};
+};
+
+}  // namespace fastchan
+
+#endif
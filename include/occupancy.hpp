@@ -0,0 +1,255 @@
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <type_traits>
+#include <utility>
+
+#include "common.hpp"
+
+#ifndef FASTCHANOCCUPANCY_HPP
+#define FASTCHANOCCUPANCY_HPP
+
+namespace fastchan {
+
+namespace detail {
+
+// occupancyBucket is the histogram bucket n entries fall into, its bit width: 0 for none, k for 2^(k-1) to 2^k - 1
+constexpr std::size_t occupancyBucket(std::size_t n) noexcept {
+    std::size_t bucket = 0;
+    for (; n != 0; n >>= 1) {
+        ++bucket;
+    }
+    return bucket;
+}
+
+}  // namespace detail
+
+// OccupancyStats is a snapshot of a Monitored channel's occupancy histogram. samples[0] counts the samples that found
+// the channel empty and samples[k] those that found 2^(k-1) to 2^k - 1 entries in it. The capacity is a power of two,
+// so a full channel is the only occupancy in the bucket after it, and each bucket is what a channel of that size
+// would have held at most.
+struct OccupancyStats {
+    std::size_t capacity = 0;
+    std::array<uint64_t, 65> samples{};
+    // how many times the occupancy went over the high watermark
+    uint64_t high_crossings = 0;
+
+    uint64_t total() const noexcept {
+        uint64_t total = 0;
+        for (auto n : samples) {
+            total += n;
+        }
+        return total;
+    }
+
+    // aboveFraction is the share of samples with at least n entries, rounded up to a power of two, in the channel,
+    // i.e. how often a channel of capacity n would have been full and the put after the sample would have waited
+    double aboveFraction(std::size_t n) const noexcept {
+        auto all = total();
+        if (all == 0) {
+            return 0;
+        }
+        uint64_t above = 0;
+        for (auto bucket = detail::occupancyBucket(roundUpNextPowerOfTwo(n)); bucket < samples.size(); ++bucket) {
+            above += samples[bucket];
+        }
+        return double(above) / double(all);
+    }
+
+    // fullFraction is the share of samples that found the channel full
+    double fullFraction() const noexcept { return aboveFraction(capacity); }
+
+    // percentile is the occupancy that p of the samples were at or below, rounded up to the top of its bucket
+    std::size_t percentile(double p) const noexcept {
+        auto all = total();
+        uint64_t seen = 0;
+        for (std::size_t bucket = 0; bucket < samples.size(); ++bucket) {
+            seen += samples[bucket];
+            if (all != 0 && double(seen) >= p * double(all)) {
+                return bucket == 0 ? 0 : std::min(capacity, (std::size_t(1) << bucket) - 1);
+            }
+        }
+        return capacity;
+    }
+
+    // recommendedCapacity is the smallest power of two that would have been full for at most max_full_fraction of the
+    // samples, to build the channel with next time. A channel that was full more often than that can't tell how much
+    // more it would have held, so it gets twice its capacity and another look once it's run with that.
+    std::size_t recommendedCapacity(double max_full_fraction = 0.001) const noexcept {
+        if (total() == 0) {
+            return capacity;
+        }
+        for (std::size_t size = 2; size <= capacity; size *= 2) {
+            if (aboveFraction(size) <= max_full_fraction) {
+                return size;
+            }
+        }
+        return capacity * 2;
+    }
+};
+
+// Monitored wraps an SPSC or MPSC with an occupancy histogram and a watermark, so an upstream stage can see the
+// channel filling up and throttle itself before its puts start to wait. Every sample_every'th put on each producer
+// thread takes the channel's size, which is a load of the index pair it keeps anyway, and counts it in the histogram.
+// The watermark goes high once a sample reaches the high fraction of the capacity and low again once one's back at
+// or below the low fraction, calling the callback from the thread that moved it. Gets go straight to the channel and
+// cost nothing extra, as do puts through a Sender, which bypass the wrapper.
+//
+//   fastchan::Monitored<fastchan::SPSC<Tick, 1024>> c(0.75, 0.5);
+//   c.onWatermark([&](bool high) { throttle = high; });
+//   c.put(tick);
+//   if (c.isAboveWatermark()) { /* shed, coalesce or slow down rather than wait on put */ }
+//   auto stats = c.occupancy(); // stats.recommendedCapacity() is the min_size to build it with next time
+template <class Chan, uint32_t sample_every = 32>
+class Monitored : public Chan {
+    static_assert(sample_every > 0, "Monitored has to sample every so many puts");
+
+   public:
+    using typename Chan::put_t;
+    using typename Chan::value_type;
+    using T = value_type;
+
+    Monitored() : Monitored(0.75, 0.5) {}
+
+    // high and low are fractions of the capacity, low has to be below high for the watermark to ever go low again
+    explicit Monitored(double high, double low = 0.5)
+        : high_(std::size_t(high * double(Chan::capacity()))), low_(std::size_t(low * double(Chan::capacity()))) {}
+
+    // onWatermark sets f(bool high) to be called whenever the watermark changes, from the thread that changed it.
+    // It's not synchronised with the puts, so it has to be set before the producers start. It's called from inside
+    // put, which is noexcept, so anything it throws is caught and dropped.
+    template <class F>
+    void onWatermark(F &&f) {
+        on_watermark_ = std::forward<F>(f);
+    }
+
+    // isAboveWatermark is whether the watermark's high. Once it is, it looks at the channel again every time it's
+    // asked, so a producer that's holding back its puts sees it go low again without having to put anything.
+    bool isAboveWatermark() noexcept {
+        if (!stats_.above_.load(std::memory_order_relaxed)) {
+            return false;
+        }
+        watermark(occupancyNow());
+        return stats_.above_.load(std::memory_order_relaxed);
+    }
+
+    put_t put(const T &value) noexcept { return putValue(value); }
+
+    put_t put(T &&value) noexcept { return putValue(std::move(value)); }
+
+    std::size_t putBatch(const T *values, std::size_t count) noexcept {
+        auto done = Chan::putBatch(values, count);
+        sample(done);
+        return done;
+    }
+
+    template <class Rep, class Period>
+    bool try_put_for(const T &value, const std::chrono::duration<Rep, Period> &timeout) noexcept {
+        auto put = Chan::try_put_for(value, timeout);
+        sample(1);
+        return put;
+    }
+
+    template <class Clock, class Duration>
+    bool try_put_until(const T &value, const std::chrono::time_point<Clock, Duration> &deadline) noexcept {
+        auto put = Chan::try_put_until(value, deadline);
+        sample(1);
+        return put;
+    }
+
+    OccupancyStats occupancy() const noexcept {
+        OccupancyStats stats;
+        stats.capacity = Chan::capacity();
+        for (std::size_t i = 0; i < stats.samples.size(); ++i) {
+            stats.samples[i] = stats_.samples_[i].load(std::memory_order_relaxed);
+        }
+        stats.high_crossings = stats_.high_crossings_.load(std::memory_order_relaxed);
+        return stats;
+    }
+
+    // resetOccupancy clears the histogram, e.g. once a warm up's over, but leaves the watermark as it is
+    void resetOccupancy() noexcept {
+        for (auto &n : stats_.samples_) {
+            n.store(0, std::memory_order_relaxed);
+        }
+        stats_.high_crossings_.store(0, std::memory_order_relaxed);
+    }
+
+   private:
+    template <class U>
+    inline put_t putValue(U &&value) noexcept {
+        if constexpr (std::is_void<put_t>::value) {
+            Chan::put(std::forward<U>(value));
+            sample(1);
+        } else {
+            auto put = Chan::put(std::forward<U>(value));
+            sample(1);
+            return put;
+        }
+    }
+
+    // sample counts down the puts on this thread, which it shares with every Monitored of the same type, as it only
+    // decides how often to sample. A sample's taken after the put, so a full channel means the next put would wait.
+    inline void sample(std::size_t puts) noexcept {
+        thread_local static std::size_t countdown = sample_every;
+        if (countdown > puts) {
+            countdown -= puts;
+            return;
+        }
+        countdown = sample_every;
+
+        auto size = occupancyNow();
+        stats_.samples_[detail::occupancyBucket(size)].fetch_add(1, std::memory_order_relaxed);
+        watermark(size);
+    }
+
+    // occupancyNow is the channel's size. The indices are loaded one after the other, and on an MPSC the consumer can
+    // get past the committed index in between, which comes out as more than the capacity when it's about empty anyway.
+    inline std::size_t occupancyNow() const noexcept {
+        auto size = Chan::size();
+        return size > Chan::capacity() ? 0 : size;
+    }
+
+    // watermark only costs the comparisons on a sample, the callback's indirect call is out of line behind a crossing
+    inline void watermark(std::size_t size) noexcept {
+        if (size >= high_) {
+            if (!stats_.above_.load(std::memory_order_relaxed) && !stats_.above_.exchange(true, std::memory_order_relaxed)) {
+                stats_.high_crossings_.fetch_add(1, std::memory_order_relaxed);
+                notifyWatermark(true);
+            }
+        } else if (size <= low_) {
+            if (stats_.above_.load(std::memory_order_relaxed) && stats_.above_.exchange(false, std::memory_order_relaxed)) {
+                notifyWatermark(false);
+            }
+        }
+    }
+
+    [[gnu::noinline, gnu::cold]] void notifyWatermark(bool high) noexcept {
+        if (!on_watermark_) {
+            return;
+        }
+        try {
+            on_watermark_(high);
+        } catch (...) {
+        }
+    }
+
+    // the stats are only touched on samples, and on a line of their own so they don't slow down the channel's
+    struct alignas(hardware_destructive_interference_size) Stats {
+        std::array<std::atomic<uint64_t>, 65> samples_{};
+        std::atomic<uint64_t> high_crossings_{0};
+        std::atomic_bool above_{false};
+    };
+
+    const std::size_t high_;
+    const std::size_t low_;
+    std::function<void(bool)> on_watermark_;
+    Stats stats_;
+};
+
+}  // namespace fastchan
+
+#endif
@@ -0,0 +1,233 @@
+#include <array>
+#include <atomic>
+#include <optional>
+#include <type_traits>
+
+#include "common.hpp"
+#include "wait_strategy.hpp"
+
+#ifndef FASTCHANOVERWRITING_HPP
+#define FASTCHANOVERWRITING_HPP
+
+namespace fastchan {
+
+// Overwriting is a lossy ringbuffer where put never blocks nor fails. Once the buffer is full the oldest
+// entries are overwritten. Every slot carries a sequence which encodes the index it currently holds, so the
+// consumer validates each read seqlock style, detects when it has been lapped, skips ahead to the oldest entry
+// that's still available and accounts for everything it skipped in dropped(). In multi producer mode a producer
+// that finds its slot still being written a lap behind counts its own value as overwritten rather than wait.
+//
+// Use OverwritingSPSC or OverwritingMPSC rather than this directly.
+template <typename T, size_t min_size, bool multi_producer, class GetWaitStrategy = YieldWaitStrategy>
+class Overwriting {
+    using GetWait = WaitStrategyTraits<GetWaitStrategy>;
+
+    static_assert(std::is_trivially_copyable<T>::value, "Overwriting requires a trivially copyable T as reads can race with writes");
+
+   public:
+    using get_t = typename std::conditional<!GetWait::returns_immediately, T, std::optional<T>>::type;
+
+    Overwriting() = default;
+
+    void put(const T &value) noexcept {
+        if constexpr (multi_producer) {
+            auto index = producer_.next_free_index_.fetch_add(1, std::memory_order_acq_rel);
+            auto &slot = contents_[index & common_.index_mask_];
+            auto seq = slot.seq_.load(std::memory_order_relaxed);
+            while (true) {
+                if (seq > writing(index)) {
+                    // a producer that claimed a later index has already lapped us, our value is the oldest anyway
+                    GetWait::notify(common_.get_wait_);
+                    return;
+                }
+
+                if (seq & 1) {
+                    // a producer a lap behind is still writing this slot. Rather than wait for it, give up the index
+                    // as overwritten, which the consumer skips and counts in dropped() like any other, and leave it
+                    // to that producer to free the slot once it's done.
+                    if (slot.seq_.compare_exchange_weak(seq, abandoned(index), std::memory_order_relaxed)) {
+                        GetWait::notify(common_.get_wait_);
+                        return;
+                    }
+                    continue;
+                }
+
+                if (slot.seq_.compare_exchange_weak(seq, writing(index), std::memory_order_acquire, std::memory_order_relaxed)) {
+                    break;
+                }
+            }
+
+            std::atomic_thread_fence(std::memory_order_release);
+            slot.value_ = value;
+
+            // a producer a lap ahead may have given up its index on the slot meanwhile, which drops ours with it, and
+            // the slot's only free for the next lap once we're done with it
+            seq = writing(index);
+            while (!slot.seq_.compare_exchange_weak(seq, seq == writing(index) ? published(index) : seq + 1, std::memory_order_release,
+                                                    std::memory_order_relaxed)) {
+            }
+        } else {
+            auto index = producer_.next_free_index_2_;
+            auto &slot = contents_[index & common_.index_mask_];
+            slot.seq_.store(writing(index), std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_release);
+            slot.value_ = value;
+            slot.seq_.store(published(index), std::memory_order_release);
+            producer_.next_free_index_.store(++producer_.next_free_index_2_, std::memory_order_release);
+        }
+
+        GetWait::notify(common_.get_wait_);
+    }
+
+    // get waits as per the get wait strategy for the next entry. Once the channel's been closed and the consumer's
+    // caught up it returns a default constructed T rather than waiting, or std::nullopt with ReturnImmediateStrategy.
+    get_t get() noexcept {
+        T value{};
+        if (!get(value)) {
+            if constexpr (GetWait::returns_immediately) {
+                return std::nullopt;
+            }
+        }
+        return value;
+    }
+
+    // get reads the next entry into value as above, but returns false once the channel's been closed and the consumer's
+    // caught up so it can tell that apart from a real entry. With ReturnImmediateStrategy it also returns false when
+    // there's nothing to get yet.
+    bool get(T &value) noexcept {
+        while (true) {
+            // closed is read first, so whatever was put before the close is published by the time the slot's looked at
+            auto closed = isClosed();
+            auto index = consumer_.reader_index_2_;
+            auto &slot = contents_[index & common_.index_mask_];
+
+            auto before = slot.seq_.load(std::memory_order_acquire);
+            if (before == published(index)) {
+                value = slot.value_;
+                std::atomic_thread_fence(std::memory_order_acquire);
+                if (slot.seq_.load(std::memory_order_relaxed) == before) {
+                    consumer_.reader_index_.store(++consumer_.reader_index_2_, std::memory_order_relaxed);
+                    return true;
+                }
+
+                // overwritten while we were reading it
+                skip();
+                continue;
+            }
+
+            if (before > published(index)) {
+                skip();
+                continue;
+            }
+
+            // nothing published at this index yet, but in multi producer mode a producer can stall after claiming
+            // the index while the others lap it
+            if (producer_.next_free_index_.load(std::memory_order_acquire) > index + capacity) {
+                skip();
+                continue;
+            }
+
+            if (closed) {
+                return false;
+            }
+            if constexpr (GetWait::returns_immediately) {
+                return false;
+            } else {
+                GetWait::wait(common_.get_wait_, [this, &slot, index] {
+                    return slot.seq_.load(std::memory_order_acquire) >= published(index) ||
+                           producer_.next_free_index_.load(std::memory_order_acquire) > index + capacity || isClosed();
+                });
+            }
+        }
+    }
+
+    // close wakes the consumer, which carries on with whatever's still there and then reports the channel closed
+    // rather than wait. As put never fails it still takes values after a close, so close from the producer, or once
+    // every producer's done, when everything put has to be seen by the consumer.
+    void close() noexcept {
+        common_.closed_.store(true, std::memory_order_seq_cst);
+        GetWait::notify(common_.get_wait_);
+    }
+
+    bool isClosed() const noexcept { return common_.closed_.load(std::memory_order_acquire); }
+
+    // dropped is the total number of entries the consumer has skipped because they were overwritten
+    std::size_t dropped() const noexcept { return consumer_.dropped_.load(std::memory_order_relaxed); }
+
+    // size is the number of entries the consumer can still read, which never exceeds the capacity
+    std::size_t size() const noexcept {
+        auto written = producer_.next_free_index_.load(std::memory_order_acquire);
+        auto read = consumer_.reader_index_.load(std::memory_order_relaxed);
+        if (written <= read) {
+            return 0;
+        }
+        return written - read > capacity ? capacity : written - read;
+    }
+
+    bool isEmpty() const noexcept {
+        return producer_.next_free_index_.load(std::memory_order_acquire) <= consumer_.reader_index_.load(std::memory_order_relaxed);
+    }
+
+   private:
+    static constexpr std::size_t capacity = roundUpNextPowerOfTwo(min_size);
+
+    // the sequence of a slot is odd while a producer is writing to it, whichever index that's for, and even once it's
+    // free. It's writing while index is being written, then published once it's there to get. In multi producer mode
+    // it's abandoned when a producer gave up index because the slot was still being written a lap behind, and
+    // abandoned + 1 once that write's done, neither of which has anything at index to get.
+    static constexpr std::size_t writing(std::size_t index) noexcept { return 4 * index + 1; }
+    static constexpr std::size_t published(std::size_t index) noexcept { return 4 * index + 2; }
+    static constexpr std::size_t abandoned(std::size_t index) noexcept { return 4 * index + 3; }
+
+    inline void skip() noexcept {
+        auto oldest = producer_.next_free_index_.load(std::memory_order_acquire);
+        oldest = oldest > capacity ? oldest - capacity : 0;
+        // the producer publishes the slot before it moves the index along, so always make progress
+        if (oldest <= consumer_.reader_index_2_) {
+            oldest = consumer_.reader_index_2_ + 1;
+        }
+
+        consumer_.dropped_.store(consumer_.dropped_.load(std::memory_order_relaxed) + (oldest - consumer_.reader_index_2_), std::memory_order_relaxed);
+        consumer_.reader_index_2_ = oldest;
+        consumer_.reader_index_.store(oldest, std::memory_order_relaxed);
+    }
+
+    struct Slot {
+        std::atomic<std::size_t> seq_{0};
+        T value_{};
+    };
+
+    std::array<Slot, capacity> contents_;
+
+    struct alignas(hardware_destructive_interference_size) Common {
+        GetWaitStrategy get_wait_{};
+        const std::size_t index_mask_ = capacity - 1;
+        std::atomic_bool closed_{false};
+    };
+
+    struct alignas(hardware_destructive_interference_size) Producer {
+        std::size_t next_free_index_2_{0};
+        std::atomic<std::size_t> next_free_index_{0};
+    };
+
+    // reader_index_2_ is the consumer's own and reader_index_ its copy for size and isEmpty, which any thread can call
+    struct alignas(hardware_destructive_interference_size) Consumer {
+        std::size_t reader_index_2_{0};
+        std::atomic<std::size_t> reader_index_{0};
+        std::atomic<std::size_t> dropped_{0};
+    };
+
+    Common common_;
+    Producer producer_;
+    Consumer consumer_;
+};
+
+template <typename T, size_t min_size, class GetWaitStrategy = YieldWaitStrategy>
+using OverwritingSPSC = Overwriting<T, min_size, false, GetWaitStrategy>;
+
+template <typename T, size_t min_size, class GetWaitStrategy = YieldWaitStrategy>
+using OverwritingMPSC = Overwriting<T, min_size, true, GetWaitStrategy>;
+
+}  // namespace fastchan
+
+#endif
@@ -0,0 +1,304 @@
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <string>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "common.hpp"
+#include "topology.hpp"
+#include "wait_strategy.hpp"
+
+#ifndef FASTCHANPIPELINE_HPP
+#define FASTCHANPIPELINE_HPP
+
+namespace fastchan {
+
+// StageStats is a snapshot of one stage's counters. A stage that's the bottleneck shows up with a utilisation close
+// to 1 and a backlog on its input, while the stages after it are mostly idle with small batches.
+struct StageStats {
+    std::string name;
+    int core = -1;
+    uint64_t items = 0;
+    // polls is every attempt to drain the input, batches only those that found something
+    uint64_t polls = 0;
+    uint64_t batches = 0;
+    // the input backlog seen at every poll, summed up and at its highest
+    uint64_t occupancy_sum = 0;
+    uint64_t occupancy_max = 0;
+    // time spent processing batches, against the time since the pipeline started
+    uint64_t busy_ns = 0;
+    uint64_t elapsed_ns = 0;
+    // results a stage couldn't put because its output was closed, after which it drains its input into the void
+    uint64_t dropped = 0;
+
+    double itemsPerSecond() const noexcept { return elapsed_ns ? double(items) * 1e9 / double(elapsed_ns) : 0; }
+    double avgBatch() const noexcept { return batches ? double(items) / double(batches) : 0; }
+    double avgOccupancy() const noexcept { return polls ? double(occupancy_sum) / double(polls) : 0; }
+    double utilisation() const noexcept { return elapsed_ns ? double(busy_ns) / double(elapsed_ns) : 0; }
+};
+
+// Pipeline chains stages, each running on its own thread, through SPSC/MPSC channels. Every stage drains whatever is
+// committed on its input in place, at most max_batch at a time, and hands its results to the next channel with a
+// single putBatch. Threads are pinned as per the topology, in the order the stages were added, and an idle stage
+// backs off as per IdleWaitStrategy. Stages can be added until start, and the pipeline owns the channels it creates.
+// It runs once, from start to stop.
+//
+//   fastchan::Pipeline<> pipeline(fastchan::Topology{2, 3, 4});
+//   auto &raw = pipeline.channel<fastchan::SPSC<Raw, 1024>>();
+//   auto &decoded = pipeline.stage<fastchan::SPSC<Decoded, 1024>>("decode", raw, [](const Raw &r) { return decode(r); });
+//   pipeline.sink("publish", decoded, [](const Decoded &d) { publish(d); });
+//   pipeline.start();
+template <class IdleWaitStrategy = YieldWaitStrategy>
+class Pipeline {
+    using Idle = WaitStrategyTraits<IdleWaitStrategy>;
+
+   public:
+    explicit Pipeline(Topology topology = {}, std::size_t max_batch = 256) : topology_(std::move(topology)), max_batch_(max_batch) {}
+
+    Pipeline(const Pipeline &) = delete;
+    Pipeline &operator=(const Pipeline &) = delete;
+
+    ~Pipeline() { stop(); }
+
+    // channel creates a channel owned by the pipeline, e.g. for a source outside of it to put into
+    template <class Chan>
+    Chan &channel() {
+        auto chan = std::make_shared<Chan>();
+        channels_.push_back(chan);
+        return *chan;
+    }
+
+    // stage maps every entry on in through f(const In &) -> Out into a new channel of type OutChan, which it returns
+    template <class OutChan, class InChan, class F>
+    OutChan &stage(std::string name, InChan &in, F f) {
+        auto &out = channel<OutChan>();
+        stage(std::move(name), in, out, std::move(f));
+        return out;
+    }
+
+    // stage maps every entry on in through f into an existing channel, e.g. an MPSC several stages fan in to
+    template <class InChan, class OutChan, class F>
+    void stage(std::string name, InChan &in, OutChan &out, F f) {
+        workers_.push_back(std::make_unique<MapWorker<InChan, OutChan, F>>(std::move(name), in, out, std::move(f), max_batch_));
+    }
+
+    // sink consumes every entry on in, either one at a time through f(const In &) or a batch at a time through
+    // f(const In *data, std::size_t count)
+    template <class InChan, class F>
+    void sink(std::string name, InChan &in, F f) {
+        workers_.push_back(std::make_unique<SinkWorker<InChan, F>>(std::move(name), in, std::move(f), max_batch_));
+    }
+
+    // start starts a thread for every stage. A pipeline runs once, so a start after the first, whether it's still
+    // running or has been stopped, does nothing.
+    void start() {
+        if (started_) {
+            return;
+        }
+        started_ = true;
+        start_ticks_ = cpu_ticks();
+        for (std::size_t i = 0; i < workers_.size(); ++i) {
+            auto &worker = *workers_[i];
+            worker.core_ = topology_.coreFor(i);
+            worker.thread_ = std::thread([this, &worker, i] {
+                topology_.pin(i);
+                worker.run();
+            });
+        }
+    }
+
+    // stop stops the stages in the order they were added, each one only once everything before it has stopped and
+    // it's drained its input, so nothing in flight is lost. Sources outside of the pipeline should be done first.
+    void stop() {
+        for (auto &worker : workers_) {
+            if (worker->thread_.joinable()) {
+                worker->stop_.store(true, std::memory_order_release);
+                worker->thread_.join();
+            }
+        }
+    }
+
+    // stats can be called while the pipeline is running to see where the backlog builds up
+    std::vector<StageStats> stats() const {
+        std::vector<StageStats> stats;
+        for (auto &worker : workers_) {
+            stats.push_back(worker->snapshot(start_ticks_));
+        }
+        return stats;
+    }
+
+   private:
+    // every counter only has a single writer, so they're bumped with relaxed load/store pairs rather than RMWs
+    struct Counters {
+        std::atomic<uint64_t> items_{0};
+        std::atomic<uint64_t> polls_{0};
+        std::atomic<uint64_t> batches_{0};
+        std::atomic<uint64_t> occupancy_sum_{0};
+        std::atomic<uint64_t> occupancy_max_{0};
+        std::atomic<uint64_t> busy_ticks_{0};
+        std::atomic<uint64_t> end_ticks_{0};
+        std::atomic<uint64_t> dropped_{0};
+    };
+
+    static inline void bump(std::atomic<uint64_t> &counter, uint64_t by) noexcept {
+        counter.store(counter.load(std::memory_order_relaxed) + by, std::memory_order_relaxed);
+    }
+
+    class Worker {
+       public:
+        explicit Worker(std::string name) : name_(std::move(name)) {}
+        virtual ~Worker() = default;
+
+        virtual void run() = 0;
+
+        StageStats snapshot(uint64_t start_ticks) const {
+            StageStats stats;
+            stats.name = name_;
+            stats.core = core_;
+            stats.items = counters_.items_.load(std::memory_order_relaxed);
+            stats.polls = counters_.polls_.load(std::memory_order_relaxed);
+            stats.batches = counters_.batches_.load(std::memory_order_relaxed);
+            stats.occupancy_sum = counters_.occupancy_sum_.load(std::memory_order_relaxed);
+            stats.occupancy_max = counters_.occupancy_max_.load(std::memory_order_relaxed);
+            stats.dropped = counters_.dropped_.load(std::memory_order_relaxed);
+            stats.busy_ns = uint64_t(double(counters_.busy_ticks_.load(std::memory_order_relaxed)) / cpu_ticks_per_ns());
+
+            auto end_ticks = counters_.end_ticks_.load(std::memory_order_relaxed);
+            if (start_ticks) {
+                stats.elapsed_ns = uint64_t(double((end_ticks ? end_ticks : cpu_ticks()) - start_ticks) / cpu_ticks_per_ns());
+            }
+            return stats;
+        }
+
+        const std::string name_;
+        int core_ = -1;
+        std::thread thread_;
+        std::atomic_bool stop_{false};
+
+       protected:
+        // loop polls the input until stopped, then drains whatever is left on it
+        template <class InChan, class Poll>
+        void loop(InChan &in, Poll poll) {
+            IdleWaitStrategy idle;
+            while (true) {
+                auto occupancy = in.size();
+                bump(counters_.polls_, 1);
+                bump(counters_.occupancy_sum_, occupancy);
+                if (occupancy > counters_.occupancy_max_.load(std::memory_order_relaxed)) {
+                    counters_.occupancy_max_.store(occupancy, std::memory_order_relaxed);
+                }
+
+                auto start = cpu_ticks();
+                auto count = poll();
+                if (count > 0) {
+                    bump(counters_.items_, count);
+                    bump(counters_.batches_, 1);
+                    bump(counters_.busy_ticks_, cpu_ticks() - start);
+                    continue;
+                }
+
+                if (stop_.load(std::memory_order_acquire)) {
+                    // anything put upstream before stop was called is visible by now
+                    while (auto count = poll()) {
+                        bump(counters_.items_, count);
+                        bump(counters_.batches_, 1);
+                    }
+                    break;
+                }
+                Idle::wait(idle, [&] { return !in.isEmpty() || stop_.load(std::memory_order_relaxed); });
+            }
+            counters_.end_ticks_.store(cpu_ticks(), std::memory_order_relaxed);
+        }
+
+        Counters counters_;
+    };
+
+    template <class InChan, class OutChan, class F>
+    class MapWorker : public Worker {
+        using In = typename InChan::value_type;
+        using Out = typename OutChan::value_type;
+
+       public:
+        MapWorker(std::string name, InChan &in, OutChan &out, F f, std::size_t max_batch)
+            : Worker(std::move(name)), in_(in), out_(out), f_(std::move(f)), max_batch_(max_batch), results_(max_batch) {}
+
+        void run() override {
+            this->loop(in_, [this] {
+                return in_.drain(
+                    [this](const In *data, std::size_t count) {
+                        for (std::size_t i = 0; i < count; ++i) {
+                            results_[i] = f_(data[i]);
+                        }
+                        // with ReturnImmediateStrategy putBatch returns early when the output is full, back off and keep at it
+                        // until it's closed, which drops the rest
+                        std::size_t done = 0;
+                        while (done < count) {
+                            auto put = out_.putBatch(results_.data() + done, count - done);
+                            done += put;
+                            if (put == 0 && out_.isClosed()) {
+                                bump(this->counters_.dropped_, count - done);
+                                break;
+                            }
+                            if (done < count) {
+                                Idle::wait(idle_, [this] { return !out_.isFull() || out_.isClosed(); });
+                            }
+                        }
+                    },
+                    max_batch_);
+            });
+        }
+
+       private:
+        InChan &in_;
+        OutChan &out_;
+        F f_;
+        const std::size_t max_batch_;
+        std::vector<Out> results_;
+        IdleWaitStrategy idle_;
+    };
+
+    template <class InChan, class F>
+    class SinkWorker : public Worker {
+        using In = typename InChan::value_type;
+
+       public:
+        SinkWorker(std::string name, InChan &in, F f, std::size_t max_batch) : Worker(std::move(name)), in_(in), f_(std::move(f)), max_batch_(max_batch) {}
+
+        void run() override {
+            this->loop(in_, [this] {
+                return in_.drain(
+                    [this](const In *data, std::size_t count) {
+                        if constexpr (std::is_invocable<F &, const In *, std::size_t>::value) {
+                            f_(data, count);
+                        } else {
+                            for (std::size_t i = 0; i < count; ++i) {
+                                f_(data[i]);
+                            }
+                        }
+                    },
+                    max_batch_);
+            });
+        }
+
+       private:
+        InChan &in_;
+        F f_;
+        const std::size_t max_batch_;
+    };
+
+    const Topology topology_;
+    const std::size_t max_batch_;
+    uint64_t start_ticks_ = 0;
+    bool started_ = false;
+    std::vector<std::shared_ptr<void>> channels_;
+    std::vector<std::unique_ptr<Worker>> workers_;
+};
+
+}  // namespace fastchan
+
+#endif
@@ -0,0 +1,264 @@
+#include <array>
+#include <cassert>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <limits>
+#include <optional>
+#include <utility>
+
+#include "common.hpp"
+#include "mpsc.hpp"
+#include "wait_strategy.hpp"
+
+#ifndef FASTCHANRPC_HPP
+#define FASTCHANRPC_HPP
+
+namespace fastchan {
+
+// RPCChannel is a request/response pair for synchronous calls from any number of client threads to one server
+// thread. A call claims one of max_in_flight reply slots, whose index goes along with the request as its correlation
+// id, so the server writes the response straight into the caller's slot rather than into a reply ring that every
+// caller would have to pick its own response out of. The caller waits on its slot through the Future the call
+// returns, as per ReplyWaitStrategy, while the server waits for requests as per RequestWaitStrategy and handles
+// whatever's arrived in one batch. Response has to be default constructible as the slots hold one each.
+template <class Request, class Response, size_t max_in_flight, class RequestWaitStrategy = PauseWaitStrategy,
+          class ReplyWaitStrategy = PauseWaitStrategy>
+class RPCChannel {
+    using ReplyWait = WaitStrategyTraits<ReplyWaitStrategy>;
+
+    struct Call {
+        Request request;
+        uint32_t slot;
+    };
+
+    // a put never waits for the server, as there's at most max_in_flight calls queued behind the batch it's serving,
+    // whose slots may already be free again before it's released them all. Callers only wait on each other to commit.
+    using Requests = MPSC<Call, 2 * max_in_flight, ReplyWaitStrategy, RequestWaitStrategy>;
+
+    static_assert(max_in_flight > 0 && max_in_flight <= std::numeric_limits<uint32_t>::max(), "max_in_flight has to fit a uint32_t slot index");
+
+   public:
+    // Future is the move only handle to the response of a call. Dropping it before the response has been taken is
+    // fine, the slot is freed once the server has replied. As with std::future, one that's been moved from or whose
+    // response has been taken isn't valid any more, and only valid() may be called on it.
+    class Future {
+       public:
+        Future(Future &&other) noexcept : chan_(std::exchange(other.chan_, nullptr)), slot_(other.slot_) {}
+
+        Future &operator=(Future &&other) noexcept {
+            if (this != &other) {
+                release();
+                chan_ = std::exchange(other.chan_, nullptr);
+                slot_ = other.slot_;
+            }
+            return *this;
+        }
+
+        Future(const Future &) = delete;
+        Future &operator=(const Future &) = delete;
+
+        ~Future() { release(); }
+
+        bool valid() const noexcept { return chan_ != nullptr; }
+
+        bool isReady() const noexcept {
+            assert(valid() && "isReady on a future that's been moved from or whose response has been taken");
+            return chan_->slots_[slot_].state_.load(std::memory_order_acquire) == ready;
+        }
+
+        // get waits as per ReplyWaitStrategy for the response and takes it, after which the future isn't valid
+        Response get() noexcept {
+            assert(valid() && "get on a future that's been moved from or whose response has been taken");
+            auto &slot = chan_->slots_[slot_];
+            while (slot.state_.load(std::memory_order_acquire) != ready) {
+                ReplyWait::wait(slot.wait_, [&] { return slot.state_.load(std::memory_order_acquire) == ready; });
+            }
+            return take();
+        }
+
+        // try_get_for and try_get_until wait as per ReplyWaitStrategy, but give up once the deadline has passed and
+        // leave the future as it was
+        template <class Rep, class Period>
+        std::optional<Response> try_get_for(const std::chrono::duration<Rep, Period> &timeout) noexcept {
+            return getUntil(Deadline(timeout));
+        }
+
+        template <class Clock, class Duration>
+        std::optional<Response> try_get_until(const std::chrono::time_point<Clock, Duration> &deadline) noexcept {
+            return getUntil(Deadline(deadline));
+        }
+
+       private:
+        friend class RPCChannel;
+
+        Future(RPCChannel *chan, uint32_t slot) noexcept : chan_(chan), slot_(slot) {}
+
+        Response take() noexcept {
+            auto &slot = chan_->slots_[slot_];
+            auto response = std::move(slot.response_);
+            chan_->free(slot);
+            chan_ = nullptr;
+            return response;
+        }
+
+        std::optional<Response> getUntil(const Deadline &deadline) noexcept {
+            assert(valid() && "try_get on a future that's been moved from or whose response has been taken");
+            auto &slot = chan_->slots_[slot_];
+            while (slot.state_.load(std::memory_order_acquire) != ready) {
+                if (deadline.expired()) {
+                    return std::nullopt;
+                }
+                ReplyWait::wait_until(slot.wait_, [&] { return slot.state_.load(std::memory_order_acquire) == ready; }, deadline);
+            }
+            return take();
+        }
+
+        void release() noexcept {
+            if (chan_ != nullptr) {
+                auto &slot = chan_->slots_[slot_];
+                // the server frees an abandoned slot once it's replied, or it's ours to free if it already has
+                auto state = pending;
+                if (!slot.state_.compare_exchange_strong(state, abandoned, std::memory_order_acq_rel, std::memory_order_acquire)) {
+                    chan_->free(slot);
+                }
+                chan_ = nullptr;
+            }
+        }
+
+        RPCChannel *chan_;
+        uint32_t slot_;
+    };
+
+    RPCChannel() = default;
+
+    // call sends request to the server, waiting as per ReplyWaitStrategy while all max_in_flight slots are taken
+    Future call(Request request) noexcept {
+        auto slot = claim();
+        while (slot == max_in_flight) {
+            ReplyWait::wait(common_.free_wait_, [this] { return in_flight_.load(std::memory_order_acquire) < max_in_flight; });
+            slot = claim();
+        }
+        return send(std::move(request), slot);
+    }
+
+    // try_call sends request to the server unless all max_in_flight slots are taken
+    std::optional<Future> try_call(Request request) noexcept {
+        auto slot = claim();
+        if (slot == max_in_flight) {
+            return std::nullopt;
+        }
+        return send(std::move(request), slot);
+    }
+
+    // serve hands up to max of the requests that have arrived to handler(const Request &), which returns the
+    // response, and returns how many it handled. It never waits.
+    template <class Handler>
+    std::size_t serve(Handler &&handler, std::size_t max = max_in_flight) {
+        return requests_.drain(
+            [&](const Call *calls, std::size_t count) {
+                for (std::size_t i = 0; i < count; ++i) {
+                    reply(calls[i].slot, handler(calls[i].request));
+                }
+            },
+            max);
+    }
+
+    // try_serve_for and try_serve_until wait as per RequestWaitStrategy for a request to arrive and then serve it
+    // along with whatever else has arrived, up to max. They return how many requests they handled, 0 once the
+    // deadline has passed.
+    template <class Handler, class Rep, class Period>
+    std::size_t try_serve_for(Handler &&handler, const std::chrono::duration<Rep, Period> &timeout, std::size_t max = max_in_flight) {
+        return serveUntil(handler, Deadline(timeout), max);
+    }
+
+    template <class Handler, class Clock, class Duration>
+    std::size_t try_serve_until(Handler &&handler, const std::chrono::time_point<Clock, Duration> &deadline, std::size_t max = max_in_flight) {
+        return serveUntil(handler, Deadline(deadline), max);
+    }
+
+    // inFlight is the number of calls whose slot has yet to be freed
+    std::size_t inFlight() const noexcept { return in_flight_.load(std::memory_order_acquire); }
+
+   private:
+    static constexpr uint32_t free_slot = 0;
+    static constexpr uint32_t pending = 1;
+    static constexpr uint32_t ready = 2;
+    static constexpr uint32_t abandoned = 3;
+
+    struct alignas(hardware_destructive_interference_size) Slot {
+        std::atomic<uint32_t> state_{free_slot};
+        ReplyWaitStrategy wait_{};
+        Response response_{};
+    };
+
+    // claim takes a free slot, starting from where the last call left off as that's the one most likely to be free, or
+    // returns max_in_flight when they're all taken
+    uint32_t claim() noexcept {
+        if (in_flight_.fetch_add(1, std::memory_order_acq_rel) >= max_in_flight) {
+            in_flight_.fetch_sub(1, std::memory_order_acq_rel);
+            return max_in_flight;
+        }
+
+        // there's a free slot for us now, though another caller may get to the one we try first
+        while (true) {
+            auto slot = uint32_t(next_slot_.fetch_add(1, std::memory_order_relaxed) % max_in_flight);
+            auto state = free_slot;
+            if (slots_[slot].state_.compare_exchange_strong(state, pending, std::memory_order_acquire, std::memory_order_relaxed)) {
+                return slot;
+            }
+        }
+    }
+
+    void free(Slot &slot) noexcept {
+        slot.state_.store(free_slot, std::memory_order_release);
+        in_flight_.fetch_sub(1, std::memory_order_acq_rel);
+        ReplyWait::notify(common_.free_wait_);
+    }
+
+    Future send(Request &&request, uint32_t slot) noexcept {
+        requests_.put(Call{std::move(request), slot});
+        return Future(this, slot);
+    }
+
+    void reply(uint32_t index, Response &&response) noexcept {
+        auto &slot = slots_[index];
+        slot.response_ = std::move(response);
+        auto state = pending;
+        if (slot.state_.compare_exchange_strong(state, ready, std::memory_order_acq_rel, std::memory_order_acquire)) {
+            ReplyWait::notify(slot.wait_);
+        } else {
+            // the caller's gone, so nobody else will free it
+            free(slot);
+        }
+    }
+
+    template <class Handler>
+    std::size_t serveUntil(Handler &handler, const Deadline &deadline, std::size_t max) {
+        if (max == 0) {
+            return 0;
+        }
+        auto call = requests_.try_get_until(deadline.time_point());
+        if (!call) {
+            return 0;
+        }
+        reply(call->slot, handler(call->request));
+        return 1 + serve(handler, max - 1);
+    }
+
+    std::array<Slot, max_in_flight> slots_;
+    Requests requests_;
+
+    alignas(hardware_destructive_interference_size) std::atomic<std::size_t> in_flight_{0};
+    alignas(hardware_destructive_interference_size) std::atomic<std::size_t> next_slot_{0};
+
+    struct alignas(hardware_destructive_interference_size) Common {
+        ReplyWaitStrategy free_wait_{};
+    };
+
+    Common common_;
+};
+
+}  // namespace fastchan
+
+#endif
@@ -0,0 +1,90 @@
+#include <atomic>
+#include <optional>
+#include <type_traits>
+
+#include "common.hpp"
+#include "wait_strategy.hpp"
+
+#ifndef FASTCHANSEQLOCK_HPP
+#define FASTCHANSEQLOCK_HPP
+
+namespace fastchan {
+
+// SeqLockCell publishes the latest value of T from a single writer to any number of readers. Writes are wait-free,
+// reads are optimistic and retry if they raced with a write. The version is odd while a write is in progress and
+// moves forward by 2 on every put, so readers can use it to tell whether there's anything new.
+template <typename T, class WaitStrategy = YieldWaitStrategy>
+class SeqLockCell {
+    using Wait = WaitStrategyTraits<WaitStrategy>;
+
+    static_assert(std::is_trivially_copyable<T>::value, "SeqLockCell requires a trivially copyable T as reads can race with writes");
+
+   public:
+    using get_t = typename std::conditional<!Wait::returns_immediately, T, std::optional<T>>::type;
+
+    SeqLockCell() = default;
+    explicit SeqLockCell(const T &value) : value_(value) {}
+
+    void put(const T &value) noexcept {
+        auto seq = seq_.load(std::memory_order_relaxed);
+        seq_.store(seq + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        value_ = value;
+        seq_.store(seq + 2, std::memory_order_release);
+
+        Wait::notify(common_.wait_);
+    }
+
+    T get() const noexcept {
+        std::size_t version;
+        return get(version);
+    }
+
+    // get returns the latest value along with the version it was read at
+    T get(std::size_t &version) const noexcept {
+        T value;
+        while (true) {
+            auto before = seq_.load(std::memory_order_acquire);
+            value = value_;
+            std::atomic_thread_fence(std::memory_order_acquire);
+            auto after = seq_.load(std::memory_order_relaxed);
+            if (before == after && (before & 1) == 0) {
+                version = before;
+                return value;
+            }
+
+            // the writer is mid write, retry
+            cpu_pause();
+        }
+    }
+
+    // getNext waits as per the wait strategy until there's a value newer than version, then returns it and
+    // updates version
+    get_t getNext(std::size_t &version) noexcept {
+        while (seq_.load(std::memory_order_acquire) <= version + 1) {
+            if constexpr (Wait::returns_immediately) {
+                return std::nullopt;
+            } else {
+                Wait::wait(common_.wait_, [this, version] { return seq_.load(std::memory_order_acquire) > version + 1; });
+            }
+        }
+
+        return get(version);
+    }
+
+    std::size_t version() const noexcept { return seq_.load(std::memory_order_acquire) & ~std::size_t(1); }
+
+   private:
+    struct alignas(hardware_destructive_interference_size) Common {
+        WaitStrategy wait_{};
+    };
+
+    alignas(hardware_destructive_interference_size) std::atomic<std::size_t> seq_{0};
+    T value_{};
+
+    Common common_;
+};
+
+}  // namespace fastchan
+
+#endif
@@ -0,0 +1,274 @@
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <limits>
+#include <optional>
+#include <type_traits>
+#include <utility>
+
+#if defined(__linux__)
+#include <sched.h>
+#endif
+
+#include "common.hpp"
+#include "mpsc.hpp"
+#include "wait_strategy.hpp"
+
+#ifndef FASTCHANSHARDED_HPP
+#define FASTCHANSHARDED_HPP
+
+namespace fastchan {
+
+// ThreadAffinity numbers producer threads in the order they first put and spreads them evenly across the shards. A
+// thread always puts to the same shard, so its entries come out in the order it put them.
+struct ThreadAffinity {
+    std::size_t operator()() const noexcept {
+        static std::atomic<std::size_t> next_thread{0};
+        thread_local const std::size_t thread = next_thread.fetch_add(1, std::memory_order_relaxed);
+        return thread;
+    }
+};
+
+// CPUAffinity puts to the shard of the core the producer is running on, so producers only ever share a shard with
+// those on the same core, that can't contend with them other than by being preempted. There's no order between the
+// entries of a producer that's moved to another core in between, as they're in different shards. Other than on Linux
+// it's ThreadAffinity.
+struct CPUAffinity {
+    std::size_t operator()() const noexcept {
+#if defined(__linux__)
+        auto cpu = sched_getcpu();
+        if (cpu >= 0) {
+            return std::size_t(cpu);
+        }
+#endif
+        return ThreadAffinity()();
+    }
+};
+
+// ShardedMPSC is an MPSC for many producers that spreads them across num_shards MPSCs as per Affinity, so only the
+// producers on the same shard contend for its indices. The consumer takes up to a shard's worth of entries from a
+// shard at a time before moving on to the next one, and batches of them with getBatch and drain. Entries only come
+// out in order per shard, i.e. per producer with ThreadAffinity.
+template <typename T, size_t min_size, size_t num_shards, class PutWaitStrategy = YieldWaitStrategy, class GetWaitStrategy = YieldWaitStrategy,
+          class Affinity = ThreadAffinity>
+class ShardedMPSC {
+    using GetWait = WaitStrategyTraits<GetWaitStrategy>;
+    // the consumer only gets from a shard once it's seen an entry there, so the shards themselves never wait for one
+    using Shard = MPSC<T, min_size, PutWaitStrategy, NoOpWaitStrategy>;
+
+    static_assert(num_shards > 0, "ShardedMPSC needs at least one shard");
+
+   public:
+    using value_type = T;
+    using put_t = typename Shard::put_t;
+    using get_t = typename std::conditional<!GetWait::returns_immediately, T, std::optional<T>>::type;
+
+    ShardedMPSC() = default;
+
+    explicit ShardedMPSC(Affinity affinity) : affinity_(std::move(affinity)) {}
+
+    put_t put(const T &value) noexcept {
+        return notifyAfter([&] { return shards_[shard()].put(value); });
+    }
+
+    put_t put(T &&value) noexcept {
+        return notifyAfter([&] { return shards_[shard()].put(std::move(value)); });
+    }
+
+    // putBatch puts count values in order on this producer's shard, as MPSC::putBatch does
+    std::size_t putBatch(const T *values, std::size_t count) noexcept {
+        return notifyAfter([&] { return shards_[shard()].putBatch(values, count); });
+    }
+
+    template <class Rep, class Period>
+    bool try_put_for(const T &value, const std::chrono::duration<Rep, Period> &timeout) noexcept {
+        return notifyAfter([&] { return shards_[shard()].try_put_for(value, timeout); });
+    }
+
+    template <class Clock, class Duration>
+    bool try_put_until(const T &value, const std::chrono::time_point<Clock, Duration> &deadline) noexcept {
+        return notifyAfter([&] { return shards_[shard()].try_put_until(value, deadline); });
+    }
+
+    // get waits as per the get wait strategy for the next entry. Once the channel's been closed and drained it
+    // returns a default constructed T rather than waiting, or std::nullopt with ReturnImmediateStrategy.
+    get_t get() noexcept {
+        T value{};
+        if (!get(value)) {
+            if constexpr (GetWait::returns_immediately) {
+                return std::nullopt;
+            }
+        }
+        return value;
+    }
+
+    // get moves the next entry into value as above, but returns false once the channel's been closed and drained so
+    // the consumer can tell that apart from a real entry. With ReturnImmediateStrategy it also returns false when
+    // there's nothing to get yet.
+    bool get(T &value) noexcept {
+        while (true) {
+            // closed is read first, so anything put before the close is in a shard by the time next looks
+            auto closed = isClosed();
+            auto shard = next();
+            if (shard < num_shards) {
+                value = shards_[shard].get();
+                return true;
+            }
+
+            if (closed) {
+                return false;
+            }
+            if constexpr (GetWait::returns_immediately) {
+                return false;
+            } else {
+                GetWait::wait(common_.get_wait_, [this] { return !isEmpty() || isClosed(); });
+            }
+        }
+    }
+
+    // drain hands up to max committed entries to f(const T *data, std::size_t count) in place, everything each shard
+    // has in turn starting from the one the consumer is on, and returns how many it handed out. It never waits.
+    template <class F>
+    std::size_t drain(F &&f, std::size_t max = std::numeric_limits<std::size_t>::max()) {
+        std::size_t done = 0;
+        for (std::size_t i = 0; i < num_shards && done < max; ++i) {
+            done += shards_[consumer_.shard_].drain(f, max - done);
+            if (done < max) {
+                moveOn();
+            }
+        }
+        return done;
+    }
+
+    // getBatch copies up to max committed entries out to values as drain hands them out, and returns how many it copied
+    std::size_t getBatch(T *values, std::size_t max) noexcept {
+        std::size_t done = 0;
+        return drain(
+            [&](const T *data, std::size_t count) {
+                bulkCopy(values + done, data, count);
+                done += count;
+            },
+            max);
+    }
+
+    // try_get_for and try_get_until wait as per the get wait strategy, but give up once the deadline has passed
+    template <class Rep, class Period>
+    std::optional<T> try_get_for(const std::chrono::duration<Rep, Period> &timeout) noexcept {
+        return getUntil(Deadline(timeout));
+    }
+
+    template <class Clock, class Duration>
+    std::optional<T> try_get_until(const std::chrono::time_point<Clock, Duration> &deadline) noexcept {
+        return getUntil(Deadline(deadline));
+    }
+
+    // close closes every shard, so puts fail from then on and producers waiting on a full shard wake up, and wakes the
+    // consumer, which carries on with whatever's left in the shards and then reports the channel closed as MPSC does
+    void close() noexcept {
+        for (auto &shard : shards_) {
+            shard.close();
+        }
+        GetWait::notify(common_.get_wait_);
+    }
+
+    bool isClosed() const noexcept { return shards_[0].isClosed(); }
+
+    std::size_t size() const noexcept {
+        std::size_t size = 0;
+        for (const auto &shard : shards_) {
+            size += shard.size();
+        }
+        return size;
+    }
+
+    bool isEmpty() const noexcept {
+        for (const auto &shard : shards_) {
+            if (!shard.isEmpty()) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+   private:
+    static constexpr std::size_t shard_size = roundUpNextPowerOfTwo(min_size);
+
+    std::size_t shard() const noexcept {
+        if constexpr ((num_shards & (num_shards - 1)) == 0) {
+            return affinity_() & (num_shards - 1);
+        } else {
+            return affinity_() % num_shards;
+        }
+    }
+
+    // notifyAfter wakes the consumer once put has put anything into a shard, and returns whatever put returned
+    template <class Put>
+    auto notifyAfter(Put &&put) noexcept {
+        if constexpr (std::is_void<decltype(put())>::value) {
+            put();
+            GetWait::notify(common_.get_wait_);
+        } else {
+            auto result = put();
+            if (result) {
+                GetWait::notify(common_.get_wait_);
+            }
+            return result;
+        }
+    }
+
+    void moveOn() noexcept {
+        consumer_.shard_ = consumer_.shard_ + 1 < num_shards ? consumer_.shard_ + 1 : 0;
+        consumer_.taken_ = 0;
+    }
+
+    // next picks the shard to get from, staying on the current one until it's empty or a shard's worth has been taken
+    // from it, or returns num_shards when they're all empty
+    std::size_t next() noexcept {
+        for (std::size_t i = 0; i <= num_shards; ++i) {
+            if (consumer_.taken_ < shard_size && !shards_[consumer_.shard_].isEmpty()) {
+                ++consumer_.taken_;
+                return consumer_.shard_;
+            }
+            moveOn();
+        }
+        return num_shards;
+    }
+
+    std::optional<T> getUntil(const Deadline &deadline) noexcept {
+        while (true) {
+            auto shard = next();
+            if (shard < num_shards) {
+                return shards_[shard].get();
+            }
+            if (deadline.expired()) {
+                return std::nullopt;
+            }
+            if (isClosed()) {
+                // have one last look, as a put may have landed between next and the close
+                shard = next();
+                return shard < num_shards ? std::optional<T>(shards_[shard].get()) : std::nullopt;
+            }
+            GetWait::wait_until(common_.get_wait_, [this] { return !isEmpty() || isClosed(); }, deadline);
+        }
+    }
+
+    std::array<Shard, num_shards> shards_;
+
+    struct alignas(hardware_destructive_interference_size) Common {
+        GetWaitStrategy get_wait_{};
+    };
+
+    struct alignas(hardware_destructive_interference_size) Consumer {
+        std::size_t shard_{0};
+        std::size_t taken_{0};
+    };
+
+    Common common_;
+    Consumer consumer_;
+    Affinity affinity_;
+};
+
+}  // namespace fastchan
+
+#endif
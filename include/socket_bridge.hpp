@@ -0,0 +1,321 @@
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <system_error>
+#include <type_traits>
+#include <vector>
+
+#include "common.hpp"
+#include "wait_strategy.hpp"
+
+#ifndef FASTCHANSOCKET_BRIDGE_HPP
+#define FASTCHANSOCKET_BRIDGE_HPP
+
+namespace fastchan {
+
+struct BridgeStats {
+    uint64_t messages = 0;
+    uint64_t bytes = 0;
+    uint64_t syscalls = 0;
+    // datagrams that weren't exactly one record long, receive side only
+    uint64_t malformed = 0;
+    // records a sender gave up on when it was closed while the socket pushed back, send side only
+    uint64_t dropped = 0;
+};
+
+inline bool isDatagramSocket(int fd) {
+    int type = 0;
+    socklen_t len = sizeof(type);
+    if (::getsockopt(fd, SOL_SOCKET, SO_TYPE, &type, &len) != 0) {
+        throw std::system_error(errno, std::generic_category(), "getsockopt SO_TYPE");
+    }
+    return type == SOCK_DGRAM || type == SOCK_SEQPACKET;
+}
+
+// waitForSocket waits in poll until fd is ready for events or closed is set, a millisecond at a time so a close is
+// seen, and returns whether it's ready. It's for a non-blocking socket that pushes back.
+inline bool waitForSocket(int fd, short events, const std::atomic_bool &closed) {
+    pollfd pfd{fd, events, 0};
+    while (!closed.load(std::memory_order_acquire)) {
+        auto ready = ::poll(&pfd, 1, 1);
+        if (ready > 0) {
+            return true;
+        }
+        if (ready < 0 && errno != EINTR) {
+            throw std::system_error(errno, std::generic_category(), "poll");
+        }
+    }
+    return false;
+}
+
+// SocketSender is the consumer of a channel which forwards everything that passes through it to a connected socket.
+// Every poll drains what has been committed straight out of the channel's buffer: on a datagram socket every record
+// goes out as its own datagram, batched up to batch_size per sendmmsg, on a stream socket everything drained goes out
+// with one sendmsg, over both ranges when they wrap around the end of the buffer. The slots are only released once
+// the socket has taken them, so a socket that pushes back fills the channel and the producers then wait as per their
+// put wait strategy. The sender itself waits for the socket as per WaitStrategy: one that can block parks in poll
+// until the socket's writable, while one that can't backs off with its own wait and tries again. Either way close
+// stops it waiting. Errors are thrown as std::system_error.
+template <class Chan, class WaitStrategy = CVWaitStrategy>
+class SocketSender {
+    using Wait = WaitStrategyTraits<WaitStrategy>;
+
+   public:
+    using value_type = typename Chan::value_type;
+    static_assert(std::is_trivially_copyable<value_type>::value, "SocketSender requires a trivially copyable value_type");
+
+    SocketSender(Chan &chan, int fd, std::size_t batch_size = 64)
+        : chan_(chan), fd_(fd), datagram_(isDatagramSocket(fd)), iovecs_(batch_size), messages_(batch_size) {
+        for (std::size_t i = 0; i < batch_size; ++i) {
+            messages_[i].msg_hdr.msg_iov = &iovecs_[i];
+            messages_[i].msg_hdr.msg_iovlen = 1;
+        }
+    }
+
+    // poll forwards up to max entries that are available right now and returns how many it forwarded. Once closed
+    // it forwards nothing.
+    std::size_t poll(std::size_t max = std::numeric_limits<std::size_t>::max()) {
+        if (closed_.load(std::memory_order_acquire)) {
+            return 0;
+        }
+
+        std::size_t sent = 0;
+        chan_.drain(
+            [this, &sent](const value_type *first, std::size_t first_count, const value_type *second, std::size_t second_count) {
+                auto count = first_count + second_count;
+                sent = datagram_ ? sendDatagrams(first, first_count, second, count) : sendStream(first, first_count, second, second_count);
+                stats_.messages += sent;
+                stats_.bytes += sent * sizeof(value_type);
+                stats_.dropped += count - sent;
+            },
+            max);
+        return sent;
+    }
+
+    // close stops the sender waiting for a socket that pushes back, giving up on what it hasn't sent yet, and makes
+    // every poll from then on forward nothing. It can be called from any thread. On a stream socket that can leave a
+    // record half written, which would misframe everything after it, so the sender then shuts down its side of the
+    // socket: the peer sees the stream end part way through the record rather than carry on out of step.
+    void close() noexcept { closed_.store(true, std::memory_order_release); }
+
+    bool isClosed() const noexcept { return closed_.load(std::memory_order_acquire); }
+
+    const BridgeStats &stats() const noexcept { return stats_; }
+
+   private:
+    // awaitSocket is what the sender does when the socket pushes back, it returns false once closed
+    bool awaitSocket() {
+        if constexpr (Wait::can_block) {
+            return waitForSocket(fd_, POLLOUT, closed_);
+        } else {
+            Wait::wait(wait_, [this] { return closed_.load(std::memory_order_relaxed); });
+            return !closed_.load(std::memory_order_acquire);
+        }
+    }
+
+    // sendDatagrams sends the records in first and then second, count in all, and returns how many it sent
+    std::size_t sendDatagrams(const value_type *first, std::size_t first_count, const value_type *second, std::size_t count) {
+        std::size_t done = 0;
+        while (done < count) {
+            auto batch = std::min(count - done, messages_.size());
+            for (std::size_t i = 0; i < batch; ++i) {
+                auto at = done + i;
+                iovecs_[i].iov_base = const_cast<value_type *>(at < first_count ? first + at : second + (at - first_count));
+                iovecs_[i].iov_len = sizeof(value_type);
+            }
+
+            ++stats_.syscalls;
+            auto sent = ::sendmmsg(fd_, messages_.data(), unsigned(batch), MSG_NOSIGNAL);
+            if (sent < 0) {
+                if (errno == EAGAIN || errno == EWOULDBLOCK) {
+                    if (!awaitSocket()) {
+                        break;
+                    }
+                } else if (errno != EINTR) {
+                    throw std::system_error(errno, std::generic_category(), "sendmmsg");
+                }
+                continue;
+            }
+
+            done += std::size_t(sent);
+        }
+        return done;
+    }
+
+    // sendStream writes both ranges with a single sendmsg, carrying on from where it left off when the socket only
+    // takes part of them, and returns how many whole records it sent. A close that tears a record shuts the socket
+    // down for writing, see close.
+    std::size_t sendStream(const value_type *first, std::size_t first_count, const value_type *second, std::size_t second_count) {
+        iovec iov[2] = {{const_cast<value_type *>(first), first_count * sizeof(value_type)},
+                        {const_cast<value_type *>(second), second_count * sizeof(value_type)}};
+        msghdr msg{};
+        msg.msg_iov = iov;
+        msg.msg_iovlen = second_count ? 2 : 1;
+
+        std::size_t bytes = 0;
+        while (msg.msg_iovlen > 0) {
+            ++stats_.syscalls;
+            auto sent = ::sendmsg(fd_, &msg, MSG_NOSIGNAL);
+            if (sent < 0) {
+                if (errno == EAGAIN || errno == EWOULDBLOCK) {
+                    if (!awaitSocket()) {
+                        break;
+                    }
+                } else if (errno != EINTR) {
+                    throw std::system_error(errno, std::generic_category(), "sendmsg");
+                }
+                continue;
+            }
+
+            bytes += std::size_t(sent);
+            auto left = std::size_t(sent);
+            while (msg.msg_iovlen > 0 && left >= msg.msg_iov->iov_len) {
+                left -= msg.msg_iov->iov_len;
+                ++msg.msg_iov;
+                --msg.msg_iovlen;
+            }
+            if (left > 0) {
+                msg.msg_iov->iov_base = static_cast<char *>(msg.msg_iov->iov_base) + left;
+                msg.msg_iov->iov_len -= left;
+            }
+        }
+        if (bytes % sizeof(value_type) != 0) {
+            ::shutdown(fd_, SHUT_WR);
+        }
+        return bytes / sizeof(value_type);
+    }
+
+    Chan &chan_;
+    const int fd_;
+    const bool datagram_;
+    std::vector<iovec> iovecs_;
+    std::vector<mmsghdr> messages_;
+    WaitStrategy wait_;
+    std::atomic_bool closed_{false};
+    BridgeStats stats_;
+};
+
+// SocketReceiver is a producer of a channel which feeds it with everything arriving on a socket. Every poll reads
+// whatever the socket has right now without blocking, up to batch_size records via a single recvmmsg on a datagram
+// socket or a single recv on a stream socket, and hands them over with putBatch. A full channel makes putBatch wait
+// as per the put wait strategy, leaving the data in the socket buffer in the meantime, or with
+// ReturnImmediateStrategy the records that didn't fit are held back and put first on the next poll.
+template <class Chan>
+class SocketReceiver {
+   public:
+    using value_type = typename Chan::value_type;
+    static_assert(std::is_trivially_copyable<value_type>::value, "SocketReceiver requires a trivially copyable value_type");
+
+    SocketReceiver(Chan &chan, int fd, std::size_t batch_size = 64)
+        : chan_(chan), fd_(fd), datagram_(isDatagramSocket(fd)), records_(batch_size), iovecs_(batch_size), messages_(batch_size) {
+        for (std::size_t i = 0; i < batch_size; ++i) {
+            iovecs_[i].iov_base = &records_[i];
+            iovecs_[i].iov_len = sizeof(value_type);
+            messages_[i].msg_hdr.msg_iov = &iovecs_[i];
+            messages_[i].msg_hdr.msg_iovlen = 1;
+        }
+    }
+
+    // poll moves what's available on the socket right now into the channel and returns the number of records put
+    std::size_t poll() {
+        if (begin_ < end_) {
+            return putPending();
+        }
+
+        if (datagram_) {
+            receiveDatagrams();
+        } else {
+            receiveStream();
+        }
+        return putPending();
+    }
+
+    // isClosed is set once the peer has shut down a stream socket
+    bool isClosed() const noexcept { return closed_; }
+
+    const BridgeStats &stats() const noexcept { return stats_; }
+
+   private:
+    std::size_t putPending() {
+        auto put = chan_.putBatch(&records_[begin_], end_ - begin_);
+        begin_ += put;
+        stats_.messages += put;
+        return put;
+    }
+
+    void receiveDatagrams() {
+        begin_ = end_ = 0;
+
+        ++stats_.syscalls;
+        auto received = ::recvmmsg(fd_, messages_.data(), unsigned(messages_.size()), MSG_DONTWAIT, nullptr);
+        if (received < 0) {
+            if (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR) {
+                return;
+            }
+            throw std::system_error(errno, std::generic_category(), "recvmmsg");
+        }
+
+        for (int i = 0; i < received; ++i) {
+            if (messages_[i].msg_len != sizeof(value_type) || (messages_[i].msg_hdr.msg_flags & MSG_TRUNC)) {
+                ++stats_.malformed;
+                continue;
+            }
+            if (end_ != std::size_t(i)) {
+                records_[end_] = records_[i];
+            }
+            ++end_;
+            stats_.bytes += sizeof(value_type);
+        }
+    }
+
+    void receiveStream() {
+        // carry a record split across reads over to the front of the buffer
+        auto *bytes = reinterpret_cast<char *>(records_.data());
+        std::memmove(bytes, bytes + end_ * sizeof(value_type), partial_bytes_);
+        begin_ = end_ = 0;
+
+        ++stats_.syscalls;
+        auto received = ::recv(fd_, bytes + partial_bytes_, records_.size() * sizeof(value_type) - partial_bytes_, MSG_DONTWAIT);
+        if (received < 0) {
+            if (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR) {
+                return;
+            }
+            throw std::system_error(errno, std::generic_category(), "recv");
+        }
+        if (received == 0) {
+            closed_ = true;
+            return;
+        }
+
+        stats_.bytes += std::size_t(received);
+        auto available = partial_bytes_ + std::size_t(received);
+        end_ = available / sizeof(value_type);
+        partial_bytes_ = available % sizeof(value_type);
+    }
+
+    Chan &chan_;
+    const int fd_;
+    const bool datagram_;
+    std::vector<value_type> records_;
+    std::vector<iovec> iovecs_;
+    std::vector<mmsghdr> messages_;
+
+    // records_[begin_, end_) are waiting to go into the channel, followed by partial_bytes_ of an incomplete record
+    std::size_t begin_ = 0;
+    std::size_t end_ = 0;
+    std::size_t partial_bytes_ = 0;
+    bool closed_ = false;
+    BridgeStats stats_;
+};
+
+}  // namespace fastchan
+
+#endif
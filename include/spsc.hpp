@@ -1,77 +1,389 @@
+#include <algorithm>
 #include <array>
 #include <atomic>
+#include <chrono>
 #include <condition_variable>
 #include <cwctype>
+#include <limits>
 #include <mutex>
 #include <optional>
 #include <thread>
 #include <type_traits>
+#include <utility>
 
+#include "bulk.hpp"
 #include "common.hpp"
 #include "wait_strategy.hpp"
 
+#ifndef FASTCHANSPSC_HPP
+#define FASTCHANSPSC_HPP
+
 namespace fastchan {
 
+// Sender and Receiver are the single producer and single consumer endpoints of an SPSC from make_spsc, in endpoints.hpp
+template <class Chan>
+class Sender;
+template <class Chan>
+class Receiver;
+
 template <typename T, size_t min_size, class PutWaitStrategy = YieldWaitStrategy, class GetWaitStrategy = YieldWaitStrategy>
 class SPSC {
+    using PutWait = WaitStrategyTraits<PutWaitStrategy>;
+    using GetWait = WaitStrategyTraits<GetWaitStrategy>;
+
    public:
-    using put_t = typename std::conditional<!std::is_same<PutWaitStrategy, ReturnImmediateStrategy>::value, void, bool>::type;
-    using get_t = typename std::conditional<!std::is_same<GetWaitStrategy, ReturnImmediateStrategy>::value, T, std::optional<T>>::type;
+    using value_type = T;
+    using put_t = typename std::conditional<!PutWait::returns_immediately, void, bool>::type;
+    using get_t = typename std::conditional<!GetWait::returns_immediately, T, std::optional<T>>::type;
 
     SPSC() = default;
 
-    put_t put(const T &value) noexcept {
-        while (producer_.next_free_index_2_ > (producer_.reader_index_cache_ + common_.index_mask_)) {
-            producer_.reader_index_cache_ = consumer_.reader_index_.load(std::memory_order_acquire);
-            if constexpr (std::is_same<PutWaitStrategy, ReturnImmediateStrategy>::value) {
+    put_t put(const T &value) noexcept { return putValue(producer_, value); }
+
+    // put moves value into the buffer, e.g. for a move only Handle from an ObjectPool
+    put_t put(T &&value) noexcept { return putValue(producer_, std::move(value)); }
+
+    // get waits as per the get wait strategy for the next entry. Once the channel's been closed and drained it
+    // returns a default constructed T rather than waiting, or std::nullopt with ReturnImmediateStrategy.
+    get_t get() noexcept { return getValue(consumer_); }
+
+    // get moves the next entry into value as above, but returns false once the channel's been closed and drained so
+    // the consumer can tell that apart from a real entry. With ReturnImmediateStrategy it also returns false when
+    // there's nothing to get yet.
+    bool get(T &value) noexcept { return getValue(consumer_, value); }
+
+    // peek returns the oldest entry without consuming it, or nullptr when there's none. It's for the consumer only and
+    // the entry stays where it is until the next get, drain or getBatch, which is also what a peek guarantees to find.
+    const T *peek() noexcept { return peek(consumer_); }
+
+    // putBatch puts count values in order, copying as many as fit at a time and publishing them with a single store.
+    // It waits as per the put wait strategy until they've all been put, other than with ReturnImmediateStrategy where
+    // it stops as soon as the buffer is full. It returns the number of values put.
+    std::size_t putBatch(const T *values, std::size_t count) noexcept { return putBatch(producer_, values, count); }
+
+    // drain hands up to max committed entries to f in place, as at most two contiguous ranges when they wrap around
+    // the end of the buffer, by calling f(const T *data, std::size_t count). An f that takes
+    // (const T *first, std::size_t first_count, const T *second, std::size_t second_count) gets both at once instead,
+    // with second_count 0 when they don't wrap, e.g. for a single writev. The entries are only released back to
+    // the producer once f returns. It never waits and returns the number of entries drained.
+    template <class F>
+    std::size_t drain(F &&f, std::size_t max = std::numeric_limits<std::size_t>::max()) {
+        return drain(consumer_, f, max);
+    }
+
+    // getBatch copies up to max committed entries out to values, in order, and returns how many it copied. As with
+    // drain it never waits.
+    std::size_t getBatch(T *values, std::size_t max) noexcept { return getBatch(consumer_, values, max); }
+
+    // try_put_for and try_put_until wait as per the put wait strategy, but give up once the deadline has passed or the
+    // channel's been closed. ReturnImmediateStrategy spins until the deadline here as the caller has explicitly asked
+    // for a bounded wait.
+    template <class Rep, class Period>
+    bool try_put_for(const T &value, const std::chrono::duration<Rep, Period> &timeout) noexcept {
+        return putUntil(producer_, value, Deadline(timeout));
+    }
+
+    template <class Clock, class Duration>
+    bool try_put_until(const T &value, const std::chrono::time_point<Clock, Duration> &deadline) noexcept {
+        return putUntil(producer_, value, Deadline(deadline));
+    }
+
+    // try_get_for and try_get_until wait as per the get wait strategy, but give up once the deadline has passed or the
+    // channel's been closed and drained
+    template <class Rep, class Period>
+    std::optional<T> try_get_for(const std::chrono::duration<Rep, Period> &timeout) noexcept {
+        return getUntil(consumer_, Deadline(timeout));
+    }
+
+    template <class Clock, class Duration>
+    std::optional<T> try_get_until(const std::chrono::time_point<Clock, Duration> &deadline) noexcept {
+        return getUntil(consumer_, Deadline(deadline));
+    }
+
+    // close stops the channel taking any more values and wakes up everything waiting on it, whatever the wait
+    // strategies. Puts fail from then on, returning false, or dropping the value when put_t is void, while gets carry
+    // on with whatever's left and then report the channel closed rather than wait. It can be called from any thread,
+    // but a put racing a close from somewhere other than the producer may still land after the consumer's seen the
+    // channel drained, so close from the producer when every value put has to be got.
+    void close() noexcept {
+        producer_.closed_.store(true, std::memory_order_seq_cst);
+        GetWait::notify(common_.get_wait_);
+        PutWait::notify(common_.put_wait_);
+    }
+
+    bool isClosed() const noexcept { return producer_.closed_.load(std::memory_order_acquire); }
+
+    std::size_t size() const noexcept {
+        return producer_.next_free_index_.load(std::memory_order_acquire) - consumer_.reader_index_.load(std::memory_order_acquire);
+    }
+
+    bool isEmpty() const noexcept {
+        return consumer_.reader_index_.load(std::memory_order_acquire) >= producer_.next_free_index_.load(std::memory_order_acquire);
+    }
+
+    bool isFull() const noexcept {
+        return producer_.next_free_index_.load(std::memory_order_relaxed) > (consumer_.reader_index_.load(std::memory_order_acquire) + common_.index_mask_);
+    }
+
+    // capacity is min_size rounded up to the next power of two, which is how many entries fit at once
+    std::size_t capacity() const noexcept { return common_.index_mask_ + 1; }
+
+   private:
+    template <class Chan>
+    friend class Sender;
+    template <class Chan>
+    friend class Receiver;
+
+    // ProducerCache and ConsumerCache are each side's own view of the indices. The channel's own put and get use the
+    // ones in producer_ and consumer_, while a Sender or Receiver holds its own so they stay with the thread using it.
+    struct ProducerCache {
+        std::size_t reader_index_cache_{0};
+        std::size_t next_free_index_2_{0};
+    };
+
+    struct ConsumerCache {
+        std::size_t next_free_index_cache_{0};
+        std::size_t reader_index_2_{0};
+    };
+
+    // the producer checks closed_ on every put, but it's on the producer's own cache line next to the indices it's
+    // already using, so it's an L1 hit and a branch that's never taken until the channel's closed
+    template <class U>
+    put_t putValue(ProducerCache &p, U &&value) noexcept {
+        if (producer_.closed_.load(std::memory_order_relaxed)) {
+            if constexpr (PutWait::returns_immediately) {
+                return false;
+            } else {
+                return;
+            }
+        }
+
+        while (p.next_free_index_2_ > (p.reader_index_cache_ + common_.index_mask_)) {
+            p.reader_index_cache_ = consumer_.reader_index_.load(std::memory_order_acquire);
+            if (p.next_free_index_2_ <= (p.reader_index_cache_ + common_.index_mask_)) {
+                break;
+            }
+            if constexpr (PutWait::returns_immediately) {
                 return false;
             } else {
-                common_.put_wait_.wait(
-                    [this] { return producer_.next_free_index_2_ <= (consumer_.reader_index_.load(std::memory_order_acquire) + common_.index_mask_); });
+                PutWait::wait(common_.put_wait_, [this, &p] { return hasRoom(p) || isClosed(); }, &consumer_.reader_index_);
+                if (isClosed()) {
+                    return;
+                }
             }
         }
 
-        contents_[producer_.next_free_index_2_ & common_.index_mask_] = value;
-        producer_.next_free_index_.store(++producer_.next_free_index_2_, std::memory_order_release);
+        // the index is read once before the value's written, as otherwise it's read again after in case the write
+        // went to it, which it could as far as the compiler knows when T is a size_t
+        auto next_free = p.next_free_index_2_++;
+        contents_[next_free & common_.index_mask_] = std::forward<U>(value);
+        FASTCHAN_SCHEDULE_POINT();
+        producer_.next_free_index_.store(next_free + 1, std::memory_order_release);
+        FASTCHAN_SCHEDULE_POINT();
 
-        common_.get_wait_.notify();
+        GetWait::notify(common_.get_wait_);
 
-        if constexpr (std::is_same<PutWaitStrategy, ReturnImmediateStrategy>::value) {
+        if constexpr (PutWait::returns_immediately) {
             return true;
         }
     }
 
-    get_t get() noexcept {
-        while (consumer_.reader_index_2_ >= consumer_.next_free_index_cache_) {
-            consumer_.next_free_index_cache_ = producer_.next_free_index_.load(std::memory_order_acquire);
-            if constexpr (std::is_same<GetWaitStrategy, ReturnImmediateStrategy>::value) {
+    std::size_t putBatch(ProducerCache &p, const T *values, std::size_t count) noexcept {
+        std::size_t done = 0;
+        while (done < count) {
+            if (producer_.closed_.load(std::memory_order_relaxed)) {
+                return done;
+            }
+            while (p.next_free_index_2_ > (p.reader_index_cache_ + common_.index_mask_)) {
+                p.reader_index_cache_ = consumer_.reader_index_.load(std::memory_order_acquire);
+                if (p.next_free_index_2_ <= (p.reader_index_cache_ + common_.index_mask_)) {
+                    break;
+                }
+                if constexpr (PutWait::returns_immediately) {
+                    return done;
+                } else {
+                    PutWait::wait(common_.put_wait_, [this, &p] { return hasRoom(p) || isClosed(); }, &consumer_.reader_index_);
+                    if (isClosed()) {
+                        return done;
+                    }
+                }
+            }
+
+            auto free = p.reader_index_cache_ + common_.index_mask_ + 1 - p.next_free_index_2_;
+            auto n = std::min(count - done, free);
+            auto start = p.next_free_index_2_ & common_.index_mask_;
+            auto first = std::min(n, contents_.size() - start);
+            bulkCopy(&contents_[start], values + done, first);
+            bulkCopy(&contents_[0], values + done + first, n - first);
+            FASTCHAN_SCHEDULE_POINT();
+
+            p.next_free_index_2_ += n;
+            producer_.next_free_index_.store(p.next_free_index_2_, std::memory_order_release);
+            done += n;
+
+            GetWait::notify(common_.get_wait_);
+        }
+
+        return done;
+    }
+
+    bool putUntil(ProducerCache &p, const T &value, const Deadline &deadline) noexcept {
+        if (producer_.closed_.load(std::memory_order_relaxed)) {
+            return false;
+        }
+
+        while (p.next_free_index_2_ > (p.reader_index_cache_ + common_.index_mask_)) {
+            p.reader_index_cache_ = consumer_.reader_index_.load(std::memory_order_acquire);
+            if (p.next_free_index_2_ <= (p.reader_index_cache_ + common_.index_mask_)) {
+                break;
+            }
+            if (deadline.expired() || isClosed()) {
+                return false;
+            }
+            PutWait::wait_until(common_.put_wait_, [this, &p] { return hasRoom(p) || isClosed(); }, deadline);
+        }
+
+        contents_[p.next_free_index_2_ & common_.index_mask_] = value;
+        FASTCHAN_SCHEDULE_POINT();
+        producer_.next_free_index_.store(++p.next_free_index_2_, std::memory_order_release);
+
+        GetWait::notify(common_.get_wait_);
+
+        return true;
+    }
+
+    bool hasRoom(const ProducerCache &p) const noexcept {
+        return p.next_free_index_2_ <= (consumer_.reader_index_.load(std::memory_order_acquire) + common_.index_mask_);
+    }
+
+    get_t getValue(ConsumerCache &c) noexcept {
+        if (c.reader_index_2_ >= c.next_free_index_cache_ && !awaitEntry(c)) {
+            if constexpr (GetWait::returns_immediately) {
                 return std::nullopt;
             } else {
-                common_.get_wait_.wait([this] { return consumer_.reader_index_2_ < producer_.next_free_index_.load(std::memory_order_acquire); });
+                return T{};
             }
         }
+        return take(c);
+    }
 
-        auto contents = contents_[consumer_.reader_index_2_ & common_.index_mask_];
-        consumer_.reader_index_.store(++consumer_.reader_index_2_, std::memory_order_release);
+    bool getValue(ConsumerCache &c, T &value) noexcept {
+        if (c.reader_index_2_ >= c.next_free_index_cache_ && !awaitEntry(c)) {
+            return false;
+        }
+        value = take(c);
+        return true;
+    }
 
-        common_.put_wait_.notify();
+    const T *peek(ConsumerCache &c) noexcept {
+        if (c.reader_index_2_ >= c.next_free_index_cache_) {
+            c.next_free_index_cache_ = producer_.next_free_index_.load(std::memory_order_acquire);
+            if (c.reader_index_2_ >= c.next_free_index_cache_) {
+                return nullptr;
+            }
+        }
+        return &contents_[c.reader_index_2_ & common_.index_mask_];
+    }
 
-        return contents;
+    template <class F>
+    std::size_t drain(ConsumerCache &c, F &f, std::size_t max) {
+        c.next_free_index_cache_ = producer_.next_free_index_.load(std::memory_order_acquire);
+        auto count = std::min(c.next_free_index_cache_ - c.reader_index_2_, max);
+        if (count == 0) {
+            return 0;
+        }
+
+        auto start = c.reader_index_2_ & common_.index_mask_;
+        auto first = std::min(count, contents_.size() - start);
+        if constexpr (std::is_invocable<F &, const T *, std::size_t, const T *, std::size_t>::value) {
+            f(&contents_[start], first, &contents_[0], count - first);
+        } else {
+            f(&contents_[start], first);
+            if (count > first) {
+                f(&contents_[0], count - first);
+            }
+        }
+        FASTCHAN_SCHEDULE_POINT();
+
+        c.reader_index_2_ += count;
+        consumer_.reader_index_.store(c.reader_index_2_, std::memory_order_release);
+
+        PutWait::notify(common_.put_wait_);
+
+        return count;
     }
 
-    std::size_t size() const noexcept {
-        return producer_.next_free_index_.load(std::memory_order_acquire) - consumer_.reader_index_.load(std::memory_order_acquire);
+    std::size_t getBatch(ConsumerCache &c, T *values, std::size_t max) noexcept {
+        std::size_t done = 0;
+        auto copy = [&](const T *data, std::size_t count) {
+            bulkCopy(values + done, data, count);
+            done += count;
+        };
+        return drain(c, copy, max);
     }
 
-    bool isEmpty() const noexcept {
-        return consumer_.reader_index_.load(std::memory_order_acquire) >= producer_.next_free_index_.load(std::memory_order_acquire);
+    // awaitEntry is get's slow path, for when the cached index says there's nothing to get. It waits as per the get
+    // wait strategy and returns false once the channel's closed and drained, or as soon as there's nothing to get
+    // with ReturnImmediateStrategy.
+    bool awaitEntry(ConsumerCache &c) noexcept {
+        while (c.reader_index_2_ >= c.next_free_index_cache_) {
+            c.next_free_index_cache_ = producer_.next_free_index_.load(std::memory_order_acquire);
+            if (c.reader_index_2_ < c.next_free_index_cache_) {
+                break;
+            }
+            if constexpr (GetWait::returns_immediately) {
+                return false;
+            } else {
+                if (isDrained(c)) {
+                    return false;
+                }
+                FASTCHAN_SCHEDULE_POINT();
+                GetWait::wait(
+                    common_.get_wait_,
+                    [this, &c] { return c.reader_index_2_ < producer_.next_free_index_.load(std::memory_order_acquire) || isClosed(); },
+                    &producer_.next_free_index_);
+            }
+        }
+        return true;
     }
 
-    bool isFull() const noexcept {
-        return producer_.next_free_index_.load(std::memory_order_relaxed) > (consumer_.reader_index_.load(std::memory_order_acquire) + common_.index_mask_);
+    // isDrained is whether the channel's closed with nothing left to get. The index is loaded again after seeing
+    // closed_ so anything put before the close is found.
+    bool isDrained(ConsumerCache &c) noexcept {
+        if (!isClosed()) {
+            return false;
+        }
+        c.next_free_index_cache_ = producer_.next_free_index_.load(std::memory_order_acquire);
+        return c.reader_index_2_ >= c.next_free_index_cache_;
+    }
+
+    T take(ConsumerCache &c) noexcept {
+        auto contents = std::move(contents_[c.reader_index_2_ & common_.index_mask_]);
+        FASTCHAN_SCHEDULE_POINT();
+        consumer_.reader_index_.store(++c.reader_index_2_, std::memory_order_release);
+
+        PutWait::notify(common_.put_wait_);
+
+        return contents;
+    }
+
+    std::optional<T> getUntil(ConsumerCache &c, const Deadline &deadline) noexcept {
+        while (c.reader_index_2_ >= c.next_free_index_cache_) {
+            c.next_free_index_cache_ = producer_.next_free_index_.load(std::memory_order_acquire);
+            if (c.reader_index_2_ < c.next_free_index_cache_) {
+                break;
+            }
+            if (deadline.expired() || isDrained(c)) {
+                return std::nullopt;
+            }
+            GetWait::wait_until(common_.get_wait_, [this, &c] {
+                return c.reader_index_2_ < producer_.next_free_index_.load(std::memory_order_acquire) || isClosed();
+            }, deadline);
+        }
+
+        return take(c);
     }
 
-   private:
     std::array<T, roundUpNextPowerOfTwo(min_size)> contents_;
 
     struct alignas(hardware_destructive_interference_size) Common {
@@ -80,15 +392,23 @@ class SPSC {
         const std::size_t index_mask_ = roundUpNextPowerOfTwo(min_size) - 1;
     };
 
-    struct alignas(hardware_destructive_interference_size) Producer {
-        std::size_t reader_index_cache_{0};
-        std::size_t next_free_index_2_{0};
+    // The orderings are the least each side needs, and none of them costs more than a plain load or store on x86:
+    //  - next_free_index_ is stored with release once the slot's written, and loaded with acquire before it's read, so
+    //    the consumer never sees the index ahead of the contents
+    //  - reader_index_ is stored with release once the slot's been moved out of, and loaded with acquire before the
+    //    producer writes to it again, so a slot is never overwritten while it's still being read
+    //  - closed_ is loaded relaxed on the put fast path as it only has to be seen eventually. A put racing a close
+    //    from the consumer's side can land after the consumer's found the channel drained, the same as if it had been
+    //    dropped. isDrained loads next_free_index_ again after acquiring closed_, so a close from the producer's side
+    //    never loses anything it put before closing
+    //  - the wait predicates only decide when to look again, the index is always loaded with acquire before a slot is
+    //    touched
+    struct alignas(hardware_destructive_interference_size) Producer : ProducerCache {
         std::atomic<std::size_t> next_free_index_{0};
+        std::atomic_bool closed_{false};
     };
 
-    struct alignas(hardware_destructive_interference_size) Consumer {
-        std::size_t next_free_index_cache_{0};
-        std::size_t reader_index_2_{0};
+    struct alignas(hardware_destructive_interference_size) Consumer : ConsumerCache {
         std::atomic<std::size_t> reader_index_{0};
     };
 
@@ -98,3 +418,4 @@ class SPSC {
 };
 }  // namespace fastchan
 
+#endif
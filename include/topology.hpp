@@ -0,0 +1,73 @@
+#include <pthread.h>
+#include <sched.h>
+
+#include <algorithm>
+#include <cstddef>
+#include <initializer_list>
+#include <utility>
+#include <vector>
+
+#ifndef FASTCHANTOPOLOGY_HPP
+#define FASTCHANTOPOLOGY_HPP
+
+namespace fastchan {
+
+// pinThisThread pins the calling thread to a single core, returning false if the OS refused
+inline bool pinThisThread(int core_id) noexcept {
+#ifdef __linux__
+    cpu_set_t cpuset;
+    CPU_ZERO(&cpuset);
+    CPU_SET(core_id, &cpuset);
+    return pthread_setaffinity_np(pthread_self(), sizeof(cpu_set_t), &cpuset) == 0;
+#else
+    return false;
+#endif
+}
+
+// Topology maps workers, numbered in the order they're started, onto the cores they should be pinned to. Workers
+// beyond the end of the list wrap around, and an empty topology leaves every thread unpinned.
+class Topology {
+   public:
+    Topology() = default;
+
+    Topology(std::initializer_list<int> cores) : cores_(cores) {}
+
+    explicit Topology(std::vector<int> cores) : cores_(std::move(cores)) {}
+
+    // fromAffinity lists the cores this process is allowed to run on, skipping the first skip of them, e.g. to leave
+    // core 0 to the OS
+    static Topology fromAffinity(std::size_t skip = 0) {
+        std::vector<int> cores;
+#ifdef __linux__
+        cpu_set_t cpuset;
+        CPU_ZERO(&cpuset);
+        if (sched_getaffinity(0, sizeof(cpuset), &cpuset) == 0) {
+            for (int core = 0; core < CPU_SETSIZE; ++core) {
+                if (CPU_ISSET(core, &cpuset)) {
+                    cores.push_back(core);
+                }
+            }
+        }
+#endif
+        cores.erase(cores.begin(), cores.begin() + std::min(skip, cores.size()));
+        return Topology(std::move(cores));
+    }
+
+    // coreFor returns the core for the given worker, or -1 if it shouldn't be pinned
+    int coreFor(std::size_t worker) const noexcept { return cores_.empty() ? -1 : cores_[worker % cores_.size()]; }
+
+    // pin pins the calling thread as the given worker, doing nothing if it shouldn't be pinned
+    bool pin(std::size_t worker) const noexcept {
+        auto core = coreFor(worker);
+        return core < 0 || pinThisThread(core);
+    }
+
+    const std::vector<int> &cores() const noexcept { return cores_; }
+
+   private:
+    std::vector<int> cores_;
+};
+
+}  // namespace fastchan
+
+#endif
@@ -0,0 +1,317 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <new>
+#include <type_traits>
+#include <utility>
+#include <variant>
+
+#include "common.hpp"
+#include "wait_strategy.hpp"
+
+#ifndef FASTCHANVARIANT_HPP
+#define FASTCHANVARIANT_HPP
+
+namespace fastchan {
+
+template <typename Variant, size_t min_bytes, class PutWaitStrategy = YieldWaitStrategy, class GetWaitStrategy = YieldWaitStrategy>
+class VariantSPSC;
+
+// VariantSPSC is an SPSC for a set of message types, given as the alternatives of a std::variant which is only ever
+// used as the list of types. Rather than a slot sized for the largest of them, each message is a record of its own
+// size in a byte ring: a small header with the type's index and the record's size, then the message constructed in
+// place. A record never wraps, the producer pads out the end of the ring instead and starts again from the front. The
+// consumer hands each message to a visitor, f(M &) for whichever M it is, through a jump table with an entry per
+// type, and destroys it once f returns.
+template <class... Types, size_t min_bytes, class PutWaitStrategy, class GetWaitStrategy>
+class VariantSPSC<std::variant<Types...>, min_bytes, PutWaitStrategy, GetWaitStrategy> {
+    using PutWait = WaitStrategyTraits<PutWaitStrategy>;
+    using GetWait = WaitStrategyTraits<GetWaitStrategy>;
+
+    struct Header {
+        uint32_t tag;
+        uint32_t size;
+    };
+
+    static constexpr std::size_t record_align = std::max({alignof(Header), alignof(uint64_t), alignof(Types)...});
+    static constexpr std::size_t header_size = (sizeof(Header) + record_align - 1) & ~(record_align - 1);
+    static constexpr std::size_t capacity = roundUpNextPowerOfTwo(min_bytes);
+    static constexpr uint32_t padding_tag = std::numeric_limits<uint32_t>::max();
+
+    template <class M>
+    static constexpr std::size_t record_size = (header_size + sizeof(M) + record_align - 1) & ~(record_align - 1);
+
+    template <class M>
+    static constexpr uint32_t tag_of() {
+        constexpr bool matches[] = {std::is_same<M, Types>::value...};
+        for (uint32_t i = 0; i < sizeof...(Types); ++i) {
+            if (matches[i]) {
+                return i;
+            }
+        }
+        return padding_tag;
+    }
+
+    template <class M>
+    static constexpr std::size_t count_of = (std::size_t(std::is_same<M, Types>::value) + ...);
+
+    static_assert(sizeof...(Types) > 0, "VariantSPSC needs at least one message type");
+    static_assert(((count_of<Types> == 1) && ...), "each message type can only be listed once");
+    static_assert(capacity >= 2 * std::max({record_size<Types>...}), "min_bytes has to fit at least two of the largest message");
+
+   public:
+    using put_t = typename std::conditional<!PutWait::returns_immediately, void, bool>::type;
+
+    VariantSPSC() = default;
+
+    VariantSPSC(const VariantSPSC &) = delete;
+    VariantSPSC &operator=(const VariantSPSC &) = delete;
+
+    // whatever's left is destroyed along with the channel
+    ~VariantSPSC() {
+        if constexpr (!(std::is_trivially_destructible<Types>::value && ...)) {
+            auto discard = [](auto &) {};
+            drain(discard);
+        }
+    }
+
+    // put copies or moves msg, which has to be one of the message types, into the ring as per the put wait strategy
+    template <class M>
+    put_t put(M &&msg) noexcept {
+        return emplace<std::decay_t<M>>(std::forward<M>(msg));
+    }
+
+    // emplace constructs an M in place from args, so a message never has to be built anywhere else first
+    template <class M, class... Args>
+    put_t emplace(Args &&...args) noexcept {
+        static_assert(tag_of<M>() != padding_tag, "M isn't one of the channel's message types");
+        constexpr auto size = record_size<M>;
+
+        if (producer_.closed_.load(std::memory_order_relaxed)) {
+            if constexpr (PutWait::returns_immediately) {
+                return false;
+            } else {
+                return;
+            }
+        }
+
+        // a record that doesn't fit before the end of the ring needs room for padding out the end as well
+        auto to_end = capacity - (producer_.write_index_2_ & (capacity - 1));
+        auto needed = to_end < size ? to_end + size : size;
+        while (producer_.write_index_2_ + needed > producer_.read_index_cache_ + capacity) {
+            producer_.read_index_cache_ = consumer_.read_index_.load(std::memory_order_acquire);
+            if (producer_.write_index_2_ + needed <= producer_.read_index_cache_ + capacity) {
+                break;
+            }
+            if constexpr (PutWait::returns_immediately) {
+                return false;
+            } else {
+                PutWait::wait(common_.put_wait_, [this, needed] { return hasRoom(needed) || isClosed(); }, &consumer_.read_index_);
+                if (isClosed()) {
+                    return;
+                }
+            }
+        }
+
+        auto write_index = producer_.write_index_2_;
+        if (to_end < size) {
+            new (&ring_[write_index & (capacity - 1)]) Header{padding_tag, uint32_t(to_end)};
+            write_index += to_end;
+        }
+        auto offset = write_index & (capacity - 1);
+        new (&ring_[offset]) Header{tag_of<M>(), uint32_t(size)};
+        new (&ring_[offset + header_size]) M(std::forward<Args>(args)...);
+        FASTCHAN_SCHEDULE_POINT();
+
+        producer_.write_index_2_ = write_index + size;
+        producer_.write_index_.store(producer_.write_index_2_, std::memory_order_release);
+
+        GetWait::notify(common_.get_wait_);
+
+        if constexpr (PutWait::returns_immediately) {
+            return true;
+        }
+    }
+
+    // get waits as per the get wait strategy for the next message and hands it to f(M &). It returns false rather
+    // than waiting once the channel's been closed and drained, or with ReturnImmediateStrategy when there's nothing
+    // to get yet.
+    template <class F>
+    bool get(F &&f) {
+        if (consumer_.read_index_2_ >= consumer_.write_index_cache_ && !awaitRecord()) {
+            return false;
+        }
+        visitNext(f);
+        release();
+        return true;
+    }
+
+    // drain hands up to max of the messages already there to f(M &) in order, releasing their space back to the
+    // producer in one go once they've all been visited. It never waits and returns the number of messages drained.
+    template <class F>
+    std::size_t drain(F &&f, std::size_t max = std::numeric_limits<std::size_t>::max()) {
+        consumer_.write_index_cache_ = producer_.write_index_.load(std::memory_order_acquire);
+        std::size_t count = 0;
+        while (count < max && consumer_.read_index_2_ < consumer_.write_index_cache_) {
+            visitNext(f);
+            ++count;
+        }
+        if (count > 0) {
+            release();
+        }
+        return count;
+    }
+
+    // try_get_for and try_get_until wait as per the get wait strategy, but give up once the deadline has passed or the
+    // channel's been closed and drained
+    template <class F, class Rep, class Period>
+    bool try_get_for(F &&f, const std::chrono::duration<Rep, Period> &timeout) {
+        return getUntil(f, Deadline(timeout));
+    }
+
+    template <class F, class Clock, class Duration>
+    bool try_get_until(F &&f, const std::chrono::time_point<Clock, Duration> &deadline) {
+        return getUntil(f, Deadline(deadline));
+    }
+
+    // close stops the channel taking any more messages and wakes up everything waiting on it, as SPSC's close does
+    void close() noexcept {
+        producer_.closed_.store(true, std::memory_order_seq_cst);
+        GetWait::notify(common_.get_wait_);
+        PutWait::notify(common_.put_wait_);
+    }
+
+    bool isClosed() const noexcept { return producer_.closed_.load(std::memory_order_acquire); }
+
+    // bytes is how much of the ring the messages waiting to be got take up, including their headers and padding
+    std::size_t bytes() const noexcept {
+        return producer_.write_index_.load(std::memory_order_acquire) - consumer_.read_index_.load(std::memory_order_acquire);
+    }
+
+    bool isEmpty() const noexcept {
+        return consumer_.read_index_.load(std::memory_order_acquire) >= producer_.write_index_.load(std::memory_order_acquire);
+    }
+
+   private:
+    bool hasRoom(std::size_t needed) const noexcept {
+        return producer_.write_index_2_ + needed <= consumer_.read_index_.load(std::memory_order_acquire) + capacity;
+    }
+
+    Header *headerAt(std::size_t index) noexcept { return std::launder(reinterpret_cast<Header *>(&ring_[index & (capacity - 1)])); }
+
+    template <std::size_t I, class F>
+    static void visitOne(std::byte *payload, F &f) {
+        using M = std::variant_alternative_t<I, std::variant<Types...>>;
+        auto *msg = std::launder(reinterpret_cast<M *>(payload));
+        f(*msg);
+        msg->~M();
+    }
+
+    template <class F, std::size_t... I>
+    static void dispatch(uint32_t tag, std::byte *payload, F &f, std::index_sequence<I...>) {
+        static constexpr void (*table[])(std::byte *, F &) = {&visitOne<I, F>...};
+        table[tag](payload, f);
+    }
+
+    // visitNext hands the next record to f, skipping the padding at the end of the ring. Padding is only ever
+    // published along with the record after it, so there always is one.
+    template <class F>
+    void visitNext(F &f) {
+        auto *header = headerAt(consumer_.read_index_2_);
+        if (header->tag == padding_tag) {
+            consumer_.read_index_2_ += header->size;
+            header = headerAt(consumer_.read_index_2_);
+        }
+        auto size = header->size;
+        dispatch(header->tag, reinterpret_cast<std::byte *>(header) + header_size, f, std::index_sequence_for<Types...>{});
+        consumer_.read_index_2_ += size;
+    }
+
+    void release() noexcept {
+        FASTCHAN_SCHEDULE_POINT();
+        consumer_.read_index_.store(consumer_.read_index_2_, std::memory_order_release);
+        PutWait::notify(common_.put_wait_);
+    }
+
+    // awaitRecord is get's slow path, as SPSC's awaitEntry is
+    bool awaitRecord() noexcept {
+        while (consumer_.read_index_2_ >= consumer_.write_index_cache_) {
+            consumer_.write_index_cache_ = producer_.write_index_.load(std::memory_order_acquire);
+            if (consumer_.read_index_2_ < consumer_.write_index_cache_) {
+                break;
+            }
+            if constexpr (GetWait::returns_immediately) {
+                return false;
+            } else {
+                if (isDrained()) {
+                    return false;
+                }
+                GetWait::wait(
+                    common_.get_wait_,
+                    [this] { return consumer_.read_index_2_ < producer_.write_index_.load(std::memory_order_acquire) || isClosed(); },
+                    &producer_.write_index_);
+            }
+        }
+        return true;
+    }
+
+    bool isDrained() noexcept {
+        if (!isClosed()) {
+            return false;
+        }
+        consumer_.write_index_cache_ = producer_.write_index_.load(std::memory_order_acquire);
+        return consumer_.read_index_2_ >= consumer_.write_index_cache_;
+    }
+
+    template <class F>
+    bool getUntil(F &f, const Deadline &deadline) {
+        while (consumer_.read_index_2_ >= consumer_.write_index_cache_) {
+            consumer_.write_index_cache_ = producer_.write_index_.load(std::memory_order_acquire);
+            if (consumer_.read_index_2_ < consumer_.write_index_cache_) {
+                break;
+            }
+            if (deadline.expired() || isDrained()) {
+                return false;
+            }
+            GetWait::wait_until(common_.get_wait_, [this] {
+                return consumer_.read_index_2_ < producer_.write_index_.load(std::memory_order_acquire) || isClosed();
+            }, deadline);
+        }
+
+        visitNext(f);
+        release();
+        return true;
+    }
+
+    alignas(std::max(record_align, hardware_destructive_interference_size)) std::byte ring_[capacity];
+
+    struct alignas(hardware_destructive_interference_size) Common {
+        GetWaitStrategy get_wait_{};
+        PutWaitStrategy put_wait_{};
+    };
+
+    // the orderings are SPSC's, with write_index_ and read_index_ for its next_free_index_ and reader_index_
+    struct alignas(hardware_destructive_interference_size) Producer {
+        std::size_t read_index_cache_{0};
+        std::size_t write_index_2_{0};
+        std::atomic<std::size_t> write_index_{0};
+        std::atomic_bool closed_{false};
+    };
+
+    struct alignas(hardware_destructive_interference_size) Consumer {
+        std::size_t write_index_cache_{0};
+        std::size_t read_index_2_{0};
+        std::atomic<std::size_t> read_index_{0};
+    };
+
+    Common common_;
+    Producer producer_;
+    Consumer consumer_;
+};
+
+}  // namespace fastchan
+
+#endif
@@ -1,7 +1,12 @@
+#include <atomic>
 #include <chrono>
 #include <condition_variable>
+#include <cstdint>
+#include <mutex>
 #include <ratio>
 #include <thread>
+#include <type_traits>
+#include <utility>
 
 #include "common.hpp"
 
@@ -10,60 +15,416 @@
 
 namespace fastchan {
 
-// WaitStrategyInterface is the interface for actual implementation of a wait strategy handler
+// Deadline is an absolute point in time for the timed put/get variants. expired() is cheap enough to be checked
+// on every iteration of a spin loop as it compares against cpu_ticks rather than reading the clock, while blocking
+// strategies park until time_point().
+class Deadline {
+   public:
+    template <class Rep, class Period>
+    explicit Deadline(const std::chrono::duration<Rep, Period> &timeout) noexcept
+        : Deadline(std::chrono::steady_clock::now() + std::chrono::ceil<std::chrono::steady_clock::duration>(timeout)) {}
+
+    template <class Clock, class Duration>
+    explicit Deadline(const std::chrono::time_point<Clock, Duration> &deadline) noexcept {
+        auto ticks_per_ns = cpu_ticks_per_ns();
+        auto now = std::chrono::steady_clock::now();
+        auto ticks = cpu_ticks();
+        if constexpr (std::is_same<Clock, std::chrono::steady_clock>::value) {
+            time_point_ = std::chrono::time_point_cast<std::chrono::steady_clock::duration>(deadline);
+        } else {
+            time_point_ = now + std::chrono::ceil<std::chrono::steady_clock::duration>(deadline - Clock::now());
+        }
+
+        auto remaining = std::chrono::duration_cast<std::chrono::nanoseconds>(time_point_ - now).count();
+        if (ticks_per_ns == 0) {
+            ticks_ = 0;
+        } else {
+            ticks_ = remaining > 0 ? ticks + uint64_t(double(remaining) * ticks_per_ns) : ticks;
+        }
+    }
+
+    // expired reads the steady clock instead for a deadline made before cpu_ticks was calibrated, whose ticks_ is 0
+    inline bool expired() const noexcept {
+        if (ticks_ == 0) {
+            return std::chrono::steady_clock::now() >= time_point_;
+        }
+        return cpu_ticks() >= ticks_;
+    }
+
+    inline const std::chrono::steady_clock::time_point &time_point() const noexcept { return time_point_; }
+
+   private:
+    std::chrono::steady_clock::time_point time_point_;
+    uint64_t ticks_;
+};
+
+// WaitStrategyInterface is the interface for actual implementation of a wait strategy handler. Besides wait,
+// wait_until and notify a strategy describes what it needs from the channels using it with these constants, which
+// WaitStrategyTraits reads. The defaults here are the conservative ones, for a strategy that may park until notified.
+// It leaves wait and wait_until to the strategy, so the traits only find a wait_until that's actually there.
+//
+// needs_notify:        notify has to be called after every state change the other side may be waiting on
+// can_block:           wait may park the thread, so it has to check the predicate rather than just back off
+// returns_immediately: put/get don't wait at all but report failure, as with ReturnImmediateStrategy
+// spin_budget:         how many times to pause and recheck the predicate before calling a blocking wait
+//
+// A strategy can also have a wait_on(p, watched), which the channels call instead of wait where they know which of
+// their indices the other side is going to write to next, so it can wait for that write rather than poll for it.
 template <typename Implementation>
 class WaitStrategyInterface {
    public:
-    template <class Predicate>
-    inline void wait(Predicate p) {}
+    static constexpr bool needs_notify = true;
+    static constexpr bool can_block = true;
+    static constexpr bool returns_immediately = false;
+    static constexpr uint32_t spin_budget = 0;
+
     inline void notify() {}
 };
 
 class ReturnImmediateStrategy : public WaitStrategyInterface<ReturnImmediateStrategy> {
    public:
+    static constexpr bool needs_notify = false;
+    static constexpr bool can_block = false;
+    static constexpr bool returns_immediately = true;
+
     template <class Predicate>
     inline void wait(Predicate p) {}
+    template <class Predicate>
+    inline void wait_until(Predicate p, const Deadline &deadline) {}
     inline void notify() {}
 };
 
 class NoOpWaitStrategy : public WaitStrategyInterface<NoOpWaitStrategy> {
    public:
+    static constexpr bool needs_notify = false;
+    static constexpr bool can_block = false;
+
     template <class Predicate>
     inline void wait(Predicate p) {}
+    template <class Predicate>
+    inline void wait_until(Predicate p, const Deadline &deadline) {}
     inline void notify() {}
 };
 
 class PauseWaitStrategy : public WaitStrategyInterface<PauseWaitStrategy> {
    public:
+    static constexpr bool needs_notify = false;
+    static constexpr bool can_block = false;
+
     template <class Predicate>
     inline void wait(Predicate p) {
         cpu_pause();
     }
+    template <class Predicate>
+    inline void wait_until(Predicate p, const Deadline &deadline) {
+        cpu_pause();
+    }
     inline void notify() {}
 };
 
 class YieldWaitStrategy : public WaitStrategyInterface<YieldWaitStrategy> {
    public:
+    static constexpr bool needs_notify = false;
+    static constexpr bool can_block = false;
+
     template <class Predicate>
     inline void wait(Predicate p) {
         std::this_thread::yield();
     }
+    template <class Predicate>
+    inline void wait_until(Predicate p, const Deadline &deadline) {
+        std::this_thread::yield();
+    }
     inline void notify() {}
 };
 
-class CVWaitStrategy : public WaitStrategyInterface<PauseWaitStrategy> {
+// CVWaitStrategy parks on a condition variable. A waiter raises parked_ before checking the predicate and the first
+// notify after that clears it under the mutex and wakes everyone up, so the notifies until the next park skip the mutex
+// and the notify_all. That's most of them on a busy channel, where the other side parks once and then has thousands
+// of notifies pile up behind it before it gets to run.
+//
+// The seq_cst fences make it a Dekker handshake against lost wakeups: the notifier's state change is before its fence
+// and its load of parked_ after it, while the waiter's store to parked_ is before its fence and the predicate after
+// it. One of them has to see the other's write, so either notify finds the waiter or the waiter finds the new state.
+// Waking up doesn't keep parked_ raised, so a waiter raises it again before every check and wait.
+class CVWaitStrategy : public WaitStrategyInterface<CVWaitStrategy> {
    public:
     template <class Predicate>
     inline void wait(Predicate p) {
         std::unique_lock<std::mutex> lock(mutex_);
-        cv_.wait_for(lock, std::chrono::nanoseconds(100), p);
+        park(lock, p, std::chrono::steady_clock::now() + std::chrono::nanoseconds(100));
+    }
+
+    // wait_until parks for the remaining time, which relies on the handshake above as nothing else wakes it up early
+    template <class Predicate>
+    inline void wait_until(Predicate p, const Deadline &deadline) {
+        std::unique_lock<std::mutex> lock(mutex_);
+        park(lock, p, deadline.time_point());
     }
 
-    inline void notify() { cv_.notify_all(); }
+    inline void notify() {
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (!parked_.load(std::memory_order_relaxed)) {
+            return;
+        }
+        std::lock_guard<std::mutex> lock(mutex_);
+        parked_.store(false, std::memory_order_relaxed);
+        cv_.notify_all();
+    }
 
    private:
+    template <class Predicate>
+    inline void park(std::unique_lock<std::mutex> &lock, Predicate &p, const std::chrono::steady_clock::time_point &until) {
+        do {
+            parked_.store(true, std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            if (p()) {
+                return;
+            }
+        } while (cv_.wait_until(lock, until) == std::cv_status::no_timeout);
+    }
+
     std::condition_variable cv_;
     std::mutex mutex_;
+    std::atomic_bool parked_{false};
+};
+
+// WFEWaitStrategy waits for the other side's write to the index it's watching rather than spinning on it. On aarch64
+// it arms the exclusive monitor on the index with a load exclusive and then waits for an event with wfe, which the
+// other side's store to the index raises, so the core idles rather than polling the line the other side's about to
+// write. Anything other than a write to the index, e.g. a close, is only seen once the kernel's event stream wakes it,
+// every 100us on Linux. The timed waits and waits without an index pause instead, as it does everywhere but aarch64.
+class WFEWaitStrategy : public WaitStrategyInterface<WFEWaitStrategy> {
+   public:
+    static constexpr bool needs_notify = false;
+    static constexpr bool can_block = false;
+
+    template <class Predicate>
+    inline void wait(Predicate p) {
+        cpu_pause();
+    }
+    template <class Predicate>
+    inline void wait_on(Predicate p, const void *watched) {
+#if defined(__aarch64__)
+        // a store to the index after the load exclusive clears the monitor and raises the event, so a write that lands
+        // between the predicate and the wfe wakes it straight away, and one before it is seen by the predicate
+        uint64_t seen;
+        asm volatile("ldxr %0, [%1]" : "=r"(seen) : "r"(watched) : "memory");
+        if (!p()) {
+            asm volatile("wfe" ::: "memory");
+        }
+#else
+        cpu_pause();
+#endif
+    }
+    template <class Predicate>
+    inline void wait_until(Predicate p, const Deadline &deadline) {
+        cpu_pause();
+    }
+    inline void notify() {}
+};
+
+namespace detail {
+
+#if defined(__x86_64__) || defined(__i386__)
+// the WAITPKG instructions, which are only there when cpu_has_waitpkg says so. The waits go into C0.1, the lighter of
+// the two sleeps, which wakes up quicker, until the TSC reaches until or the OS's limit on them runs out.
+inline void umonitor(const void *watched) noexcept { asm volatile("umonitor %0" ::"r"(watched) : "memory"); }
+
+inline void umwait(uint64_t until) noexcept {
+    asm volatile("umwait %0" ::"r"(1u), "a"(uint32_t(until)), "d"(uint32_t(until >> 32)) : "memory", "cc");
+}
+
+inline void tpause(uint64_t until) noexcept {
+    asm volatile("tpause %0" ::"r"(1u), "a"(uint32_t(until)), "d"(uint32_t(until >> 32)) : "memory", "cc");
+}
+#endif
+
+}  // namespace detail
+
+// TPauseWaitStrategy pauses with TPAUSE for up to ticks of the TSC at a time, rather than PAUSE's few dozen cycles.
+// The core sleeps in the meantime, so it uses less power and leaves more of the pipeline to an SMT sibling, at the
+// cost of noticing the other side up to ticks late. Without WAITPKG it's PauseWaitStrategy.
+template <uint32_t ticks = 1'000>
+class TPauseWaitStrategy : public WaitStrategyInterface<TPauseWaitStrategy<ticks>> {
+   public:
+    static constexpr bool needs_notify = false;
+    static constexpr bool can_block = false;
+
+    template <class Predicate>
+    inline void wait(Predicate p) {
+        pause();
+    }
+    template <class Predicate>
+    inline void wait_until(Predicate p, const Deadline &deadline) {
+        pause();
+    }
+    inline void notify() {}
+
+   private:
+    inline void pause() {
+#if defined(__x86_64__) || defined(__i386__)
+        if (cpu_has_waitpkg()) {
+            detail::tpause(cpu_ticks() + ticks);
+            return;
+        }
+#endif
+        cpu_pause();
+    }
+};
+
+// UMWaitStrategy waits for the other side's write to the index it's watching with UMONITOR and UMWAIT, which sleep
+// until the watched cache line's written or max_ticks of the TSC have passed. It wakes up on the write nearly as soon
+// as spinning would, but uses less power and leaves the pipeline to an SMT sibling in the meantime. Anything other than
+// a write to the index, e.g. a close, is only seen once max_ticks have passed, and the timed waits and waits without an
+// index TPAUSE for max_ticks instead. Without WAITPKG it's PauseWaitStrategy.
+template <uint32_t max_ticks = 20'000>
+class UMWaitStrategy : public WaitStrategyInterface<UMWaitStrategy<max_ticks>> {
+   public:
+    static constexpr bool needs_notify = false;
+    static constexpr bool can_block = false;
+
+    template <class Predicate>
+    inline void wait(Predicate p) {
+        fallback_.wait(p);
+    }
+    template <class Predicate>
+    inline void wait_on(Predicate p, const void *watched) {
+#if defined(__x86_64__) || defined(__i386__)
+        if (cpu_has_waitpkg()) {
+            // a write to the line after it's armed ends the wait straight away, and one before it is seen by p
+            detail::umonitor(watched);
+            if (!p()) {
+                detail::umwait(cpu_ticks() + max_ticks);
+            }
+            return;
+        }
+#endif
+        cpu_pause();
+    }
+    template <class Predicate>
+    inline void wait_until(Predicate p, const Deadline &deadline) {
+        fallback_.wait_until(p, deadline);
+    }
+    inline void notify() {}
+
+   private:
+    TPauseWaitStrategy<max_ticks> fallback_;
+};
+
+// SpinCVWaitStrategy spins for up to spins pauses before parking like CVWaitStrategy, which saves the mutex and the
+// futex round trip when the other side is about to catch up anyway. It's no use with both threads on one core.
+template <uint32_t spins>
+class SpinCVWaitStrategy : public CVWaitStrategy {
+   public:
+    static constexpr uint32_t spin_budget = spins;
+};
+
+namespace detail {
+
+template <class S, class = void>
+struct needs_notify : std::true_type {};
+template <class S>
+struct needs_notify<S, std::void_t<decltype(S::needs_notify)>> : std::bool_constant<S::needs_notify> {};
+
+template <class S, class = void>
+struct can_block : std::true_type {};
+template <class S>
+struct can_block<S, std::void_t<decltype(S::can_block)>> : std::bool_constant<S::can_block> {};
+
+template <class S, class = void>
+struct returns_immediately : std::false_type {};
+template <class S>
+struct returns_immediately<S, std::void_t<decltype(S::returns_immediately)>> : std::bool_constant<S::returns_immediately> {};
+
+template <class S, class = void>
+struct spin_budget : std::integral_constant<uint32_t, 0> {};
+template <class S>
+struct spin_budget<S, std::void_t<decltype(S::spin_budget)>> : std::integral_constant<uint32_t, S::spin_budget> {};
+
+template <class S, class = void>
+struct watches_index : std::false_type {};
+template <class S>
+struct watches_index<S, std::void_t<decltype(std::declval<S &>().wait_on(std::declval<bool (*)()>(), std::declval<const void *>()))>>
+    : std::true_type {};
+
+template <class S, class = void>
+struct supports_timeout : std::false_type {};
+template <class S>
+struct supports_timeout<S, std::void_t<decltype(std::declval<S &>().wait_until(std::declval<bool (*)()>(), std::declval<const Deadline &>()))>>
+    : std::true_type {};
+
+}  // namespace detail
+
+// WaitStrategyTraits is how the channels use a wait strategy, much like std::allocator_traits. It reads the constants
+// described on WaitStrategyInterface, falling back to the conservative defaults for any a strategy doesn't declare, so
+// a custom strategy only needs wait and notify to plug in. Everything a strategy doesn't need compiles out, e.g. notify
+// calls for spinning strategies. supports_timeout is whether there's a wait_until, without which the timed put/get
+// spin until the deadline instead, which is only allowed for strategies that can't block. watches_index is whether
+// there's a wait_on, without which wait with a watched index is the same as without.
+template <class WaitStrategy>
+struct WaitStrategyTraits {
+    static constexpr bool needs_notify = detail::needs_notify<WaitStrategy>::value;
+    static constexpr bool can_block = detail::can_block<WaitStrategy>::value;
+    static constexpr bool returns_immediately = detail::returns_immediately<WaitStrategy>::value;
+    static constexpr uint32_t spin_budget = detail::spin_budget<WaitStrategy>::value;
+    static constexpr bool supports_timeout = detail::supports_timeout<WaitStrategy>::value;
+    static constexpr bool watches_index = detail::watches_index<WaitStrategy>::value;
+
+    template <class Predicate>
+    [[gnu::always_inline]] static inline void wait(WaitStrategy &strategy, Predicate p) {
+        if constexpr (can_block && spin_budget > 0) {
+            for (uint32_t i = 0; i < spin_budget; ++i) {
+                if (p()) {
+                    return;
+                }
+                cpu_pause();
+            }
+        }
+        strategy.wait(p);
+    }
+
+    // wait with watched, the index the other side will write to when there's something to wait for
+    template <class Predicate>
+    [[gnu::always_inline]] static inline void wait(WaitStrategy &strategy, Predicate p, const void *watched) {
+        if constexpr (watches_index) {
+            if constexpr (can_block && spin_budget > 0) {
+                for (uint32_t i = 0; i < spin_budget; ++i) {
+                    if (p()) {
+                        return;
+                    }
+                    cpu_pause();
+                }
+            }
+            strategy.wait_on(p, watched);
+        } else {
+            wait(strategy, p);
+        }
+    }
+
+    template <class Predicate>
+    [[gnu::always_inline]] static inline void wait_until(WaitStrategy &strategy, Predicate p, const Deadline &deadline) {
+        if constexpr (supports_timeout) {
+            if constexpr (can_block && spin_budget > 0) {
+                for (uint32_t i = 0; i < spin_budget && !deadline.expired(); ++i) {
+                    if (p()) {
+                        return;
+                    }
+                    cpu_pause();
+                }
+            }
+            strategy.wait_until(p, deadline);
+        } else {
+            static_assert(!can_block, "a wait strategy that can block needs a wait_until for the timed put/get");
+            strategy.wait(p);
+        }
+    }
+
+    [[gnu::always_inline]] static inline void notify(WaitStrategy &strategy) {
+        if constexpr (needs_notify) {
+            strategy.notify();
+        }
+    }
 };
 
 }  // namespace fastchan
@@ -0,0 +1,291 @@
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+#include "common.hpp"
+#include "mpsc.hpp"
+#include "topology.hpp"
+#include "wait_strategy.hpp"
+
+#ifndef FASTCHANWORK_STEALING_HPP
+#define FASTCHANWORK_STEALING_HPP
+
+namespace fastchan {
+
+// WorkStealingDeque is a fixed size Chase-Lev deque, with the memory orderings from Le et al, "Correct and Efficient
+// Work-Stealing for Weak Memory Models". A single owner pushes and pops at the bottom, LIFO for locality, while any
+// number of thieves steal from the top, FIFO, with a single CAS. T is read by a thief before it wins the CAS on top, so
+// it has to be trivially copyable, e.g. a pointer or a small task descriptor.
+template <typename T, size_t min_size>
+class WorkStealingDeque {
+    static_assert(std::is_trivially_copyable<T>::value, "WorkStealingDeque requires a trivially copyable T");
+
+   public:
+    WorkStealingDeque() = default;
+
+    // push is owner only, it returns false if the deque is full
+    bool push(const T &value) noexcept {
+        auto bottom = owner_.bottom_.load(std::memory_order_relaxed);
+        if (bottom - owner_.top_cache_ > common_.index_mask_) {
+            owner_.top_cache_ = thieves_.top_.load(std::memory_order_acquire);
+            if (bottom - owner_.top_cache_ > common_.index_mask_) {
+                return false;
+            }
+        }
+
+        contents_[bottom & common_.index_mask_] = value;
+        std::atomic_thread_fence(std::memory_order_release);
+        owner_.bottom_.store(bottom + 1, std::memory_order_relaxed);
+        return true;
+    }
+
+    // pop is owner only and takes the most recently pushed entry
+    std::optional<T> pop() noexcept {
+        auto bottom = owner_.bottom_.load(std::memory_order_relaxed) - 1;
+        owner_.bottom_.store(bottom, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        auto top = thieves_.top_.load(std::memory_order_relaxed);
+
+        if (top > bottom) {
+            // empty
+            owner_.bottom_.store(bottom + 1, std::memory_order_relaxed);
+            return std::nullopt;
+        }
+
+        T value = contents_[bottom & common_.index_mask_];
+        if (top == bottom) {
+            // the last entry, race any thieves for it
+            bool won = thieves_.top_.compare_exchange_strong(top, top + 1, std::memory_order_seq_cst, std::memory_order_relaxed);
+            owner_.bottom_.store(bottom + 1, std::memory_order_relaxed);
+            if (!won) {
+                return std::nullopt;
+            }
+        }
+        return value;
+    }
+
+    // steal can be called from any thread and takes the oldest entry. It returns nullopt if the deque is empty or it
+    // lost a race for the entry to the owner or another thief.
+    std::optional<T> steal() noexcept {
+        auto top = thieves_.top_.load(std::memory_order_acquire);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        auto bottom = owner_.bottom_.load(std::memory_order_acquire);
+
+        if (top >= bottom) {
+            return std::nullopt;
+        }
+
+        T value = contents_[top & common_.index_mask_];
+        if (!thieves_.top_.compare_exchange_strong(top, top + 1, std::memory_order_seq_cst, std::memory_order_relaxed)) {
+            return std::nullopt;
+        }
+        return value;
+    }
+
+    std::size_t size() const noexcept {
+        auto bottom = owner_.bottom_.load(std::memory_order_acquire);
+        auto top = thieves_.top_.load(std::memory_order_acquire);
+        return bottom > top ? std::size_t(bottom - top) : 0;
+    }
+
+    bool isEmpty() const noexcept { return size() == 0; }
+
+   private:
+    std::array<T, roundUpNextPowerOfTwo(min_size)> contents_;
+
+    struct alignas(hardware_destructive_interference_size) Common {
+        const int64_t index_mask_ = int64_t(roundUpNextPowerOfTwo(min_size)) - 1;
+    };
+
+    // indices are signed as pop moves bottom below top for a moment on an empty deque
+    struct alignas(hardware_destructive_interference_size) Owner {
+        int64_t top_cache_{0};
+        std::atomic<int64_t> bottom_{0};
+    };
+
+    struct alignas(hardware_destructive_interference_size) Thieves {
+        std::atomic<int64_t> top_{0};
+    };
+
+    Common common_;
+    Owner owner_;
+    Thieves thieves_;
+};
+
+// Task is what a WorkStealingPool runs, fn(arg)
+struct Task {
+    void (*fn)(void *);
+    void *arg;
+};
+
+struct WorkerStats {
+    uint64_t executed = 0;
+    uint64_t stolen = 0;
+};
+
+// WorkStealingPool is a fixed set of workers, each with its own WorkStealingDeque. A task submitted from a worker goes
+// onto that worker's deque and one submitted from anywhere else goes round robin into a worker's MPSC inbox, which the
+// worker moves onto its deque. A worker runs its own tasks newest first and once it's out of work steals the oldest
+// from the others, backing off as per IdleWaitStrategy when there's nothing anywhere.
+template <size_t deque_size = 4096, class IdleWaitStrategy = YieldWaitStrategy>
+class WorkStealingPool {
+    using Idle = WaitStrategyTraits<IdleWaitStrategy>;
+
+   public:
+    explicit WorkStealingPool(std::size_t num_workers, Topology topology = {}) : topology_(std::move(topology)) {
+        for (std::size_t i = 0; i < num_workers; ++i) {
+            workers_.push_back(std::make_unique<Worker>());
+        }
+        for (std::size_t i = 0; i < num_workers; ++i) {
+            workers_[i]->thread_ = std::thread([this, i] { run(i); });
+        }
+    }
+
+    WorkStealingPool(const WorkStealingPool &) = delete;
+    WorkStealingPool &operator=(const WorkStealingPool &) = delete;
+
+    ~WorkStealingPool() { stop(); }
+
+    void submit(void (*fn)(void *), void *arg) { submit(Task{fn, arg}); }
+
+    void submit(const Task &task) {
+        auto &current = currentWorker();
+        if (current.pool_ == this) {
+            // a full deque means there's plenty to steal already, run it inline instead
+            if (!workers_[current.index_]->deque_.push(task)) {
+                task.fn(task.arg);
+                bump(workers_[current.index_]->executed_);
+            }
+            return;
+        }
+
+        auto index = next_inbox_.fetch_add(1, std::memory_order_relaxed) % workers_.size();
+        workers_[index]->inbox_.put(task);
+    }
+
+    // stop lets the workers finish every task submitted so far, along with what those spawn, then joins them
+    void stop() {
+        stop_.store(true, std::memory_order_release);
+        for (auto &worker : workers_) {
+            if (worker->thread_.joinable()) {
+                worker->thread_.join();
+            }
+        }
+    }
+
+    std::size_t size() const noexcept { return workers_.size(); }
+
+    std::vector<WorkerStats> stats() const {
+        std::vector<WorkerStats> stats;
+        for (auto &worker : workers_) {
+            stats.push_back(WorkerStats{worker->executed_.load(std::memory_order_relaxed), worker->stolen_.load(std::memory_order_relaxed)});
+        }
+        return stats;
+    }
+
+   private:
+    struct Current {
+        const WorkStealingPool *pool_ = nullptr;
+        std::size_t index_ = 0;
+    };
+
+    struct Worker {
+        WorkStealingDeque<Task, deque_size> deque_;
+        MPSC<Task, deque_size, YieldWaitStrategy, ReturnImmediateStrategy> inbox_;
+        alignas(hardware_destructive_interference_size) std::atomic<uint64_t> executed_{0};
+        std::atomic<uint64_t> stolen_{0};
+        std::thread thread_;
+    };
+
+    static Current &currentWorker() noexcept {
+        thread_local static Current current;
+        return current;
+    }
+
+    static inline void bump(std::atomic<uint64_t> &counter) noexcept {
+        counter.store(counter.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    }
+
+    void run(std::size_t index) {
+        topology_.pin(index);
+        currentWorker() = Current{this, index};
+
+        auto &self = *workers_[index];
+        IdleWaitStrategy idle;
+        uint64_t seed = index * 0x9E3779B97F4A7C15ull + 1;
+        while (true) {
+            if (auto task = self.deque_.pop()) {
+                task->fn(task->arg);
+                bump(self.executed_);
+                continue;
+            }
+
+            auto moved = self.inbox_.drain([&](const Task *tasks, std::size_t count) {
+                for (std::size_t i = 0; i < count; ++i) {
+                    if (!self.deque_.push(tasks[i])) {
+                        tasks[i].fn(tasks[i].arg);
+                        bump(self.executed_);
+                    }
+                }
+            });
+            if (moved) {
+                continue;
+            }
+
+            if (steal(index, seed)) {
+                continue;
+            }
+
+            // everything submitted before stop has been seen once a sweep after it comes up empty
+            if (stop_.load(std::memory_order_acquire) && !stealable()) {
+                break;
+            }
+            Idle::wait(idle, [&] { return !self.inbox_.isEmpty() || stealable(); });
+        }
+    }
+
+    // steal tries every other worker once, starting at a random one so thieves spread out
+    bool steal(std::size_t index, uint64_t &seed) {
+        seed ^= seed << 13;
+        seed ^= seed >> 7;
+        seed ^= seed << 17;
+        auto start = std::size_t(seed % workers_.size());
+        for (std::size_t i = 0; i < workers_.size(); ++i) {
+            auto victim = (start + i) % workers_.size();
+            if (victim == index) {
+                continue;
+            }
+            if (auto task = workers_[victim]->deque_.steal()) {
+                auto &self = *workers_[index];
+                task->fn(task->arg);
+                bump(self.executed_);
+                bump(self.stolen_);
+                return true;
+            }
+        }
+        return false;
+    }
+
+    bool stealable() const noexcept {
+        for (auto &worker : workers_) {
+            if (!worker->deque_.isEmpty() || !worker->inbox_.isEmpty()) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    const Topology topology_;
+    std::vector<std::unique_ptr<Worker>> workers_;
+    alignas(hardware_destructive_interference_size) std::atomic<std::size_t> next_inbox_{0};
+    std::atomic_bool stop_{false};
+};
+
+}  // namespace fastchan
+
+#endif
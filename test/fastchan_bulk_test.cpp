@@ -0,0 +1,133 @@
+#include <bulk.hpp>
+#include <cassert>
+#include <cstdint>
+#include <cstring>
+#include <mpsc.hpp>
+#include <spsc.hpp>
+#include <string>
+#include <thread>
+#include <vector>
+
+struct Tick {
+    uint64_t ts;
+    double px;
+    uint32_t qty;
+};
+
+enum class Side : uint32_t { Buy, Sell };
+
+struct Order {
+    uint32_t id;
+    Side side;
+    uint64_t ref;
+};
+
+void testBulkCopy() {
+    // small copies, and ones past the non-temporal threshold starting at unaligned offsets with a ragged tail
+    for (std::size_t count : {std::size_t(0), std::size_t(1), std::size_t(7), std::size_t(FASTCHAN_NONTEMPORAL_BYTES / sizeof(Tick) + 3)}) {
+        for (std::size_t offset = 0; offset < 3; ++offset) {
+            std::vector<Tick> src(count + offset), dst(count + offset);
+            for (std::size_t i = 0; i < src.size(); ++i) {
+                src[i] = Tick{i, double(i) / 2, uint32_t(i * 3)};
+            }
+            fastchan::bulkCopy(dst.data() + offset, src.data() + offset, count);
+            for (std::size_t i = offset; i < src.size(); ++i) {
+                assert(dst[i].ts == i && dst[i].px == double(i) / 2 && dst[i].qty == uint32_t(i * 3));
+            }
+        }
+    }
+
+    // not trivially copyable
+    std::vector<std::string> src{"a", "bb", std::string(100, 'c')}, dst(3);
+    fastchan::bulkCopy(dst.data(), src.data(), src.size());
+    assert(dst == src);
+}
+
+template <class T, class Make>
+void testBulkFindEverywhere(Make make) {
+    // the match at every position checks both the vector body and the scalar tail
+    for (std::size_t count = 0; count < 70; ++count) {
+        std::vector<T> values(count);
+        for (std::size_t i = 0; i < count; ++i) {
+            values[i] = make(i);
+        }
+        assert(fastchan::bulkFind(values.data(), count, make(1000)) == count);
+        for (std::size_t i = 0; i < count; ++i) {
+            assert(fastchan::bulkFind(values.data(), count, values[i]) == i);
+        }
+    }
+}
+
+void testBulkFind() {
+    testBulkFindEverywhere<uint64_t>([](std::size_t i) { return uint64_t(i) << 33; });
+    testBulkFindEverywhere<int32_t>([](std::size_t i) { return -int32_t(i); });
+    testBulkFindEverywhere<Side>([](std::size_t i) { return Side(i); });
+    testBulkFindEverywhere<double>([](std::size_t i) { return double(i) + 0.5; });
+
+    // the first of duplicates
+    std::vector<uint32_t> dups{5, 1, 9, 9, 1, 9, 9, 9, 9, 9, 9, 9, 9};
+    assert(fastchan::bulkFind(dups.data(), dups.size(), 9u) == 2);
+
+    for (std::size_t count = 0; count < 70; ++count) {
+        std::vector<Tick> ticks(count);
+        std::vector<Order> orders(count);
+        for (std::size_t i = 0; i < count; ++i) {
+            ticks[i] = Tick{uint64_t(i) << 40, double(i), uint32_t(i + 1)};
+            orders[i] = Order{uint32_t(i), i % 5 == 4 ? Side::Sell : Side::Buy, uint64_t(i) * 7};
+        }
+        assert(fastchan::bulkFind(ticks.data(), count, &Tick::qty, 0u) == count);
+        assert(fastchan::bulkFind(orders.data(), count, &Order::side, Side::Sell) == (count > 4 ? 4 : count));
+        for (std::size_t i = 0; i < count; ++i) {
+            assert(fastchan::bulkFind(ticks.data(), count, &Tick::ts, uint64_t(i) << 40) == i);
+            assert(fastchan::bulkFind(ticks.data(), count, &Tick::qty, uint32_t(i + 1)) == i);
+            assert(fastchan::bulkFind(ticks.data(), count, &Tick::px, double(i)) == i);
+            assert(fastchan::bulkFind(orders.data(), count, &Order::ref, uint64_t(i) * 7) == i);
+        }
+    }
+}
+
+template <class Chan>
+void testGetBatch() {
+    constexpr uint64_t iterations = 100'000;
+    Chan chan;
+
+    std::thread producer([&] {
+        std::vector<Tick> batch(37);
+        for (uint64_t i = 0; i < iterations; i += batch.size()) {
+            auto n = std::min<uint64_t>(batch.size(), iterations - i);
+            for (uint64_t j = 0; j < n; ++j) {
+                batch[j] = Tick{i + j, double(i + j), uint32_t(j)};
+            }
+            chan.putBatch(batch.data(), n);
+        }
+    });
+
+    std::vector<Tick> out(100);
+    uint64_t expected = 0;
+    while (expected < iterations) {
+        auto n = chan.getBatch(out.data(), out.size());
+        if (n == 0) {
+            std::this_thread::yield();
+        }
+        for (std::size_t i = 0; i < n; ++i) {
+            assert(out[i].ts == expected && out[i].px == double(expected));
+            ++expected;
+        }
+    }
+
+    producer.join();
+    assert(chan.isEmpty());
+    assert(chan.getBatch(out.data(), out.size()) == 0);
+}
+
+int main() {
+    testBulkCopy();
+    testBulkFind();
+
+    testGetBatch<fastchan::SPSC<Tick, 256, fastchan::YieldWaitStrategy, fastchan::YieldWaitStrategy>>();
+    testGetBatch<fastchan::SPSC<Tick, 4096, fastchan::CVWaitStrategy, fastchan::CVWaitStrategy>>();
+    testGetBatch<fastchan::MPSC<Tick, 256, fastchan::YieldWaitStrategy, fastchan::YieldWaitStrategy>>();
+    testGetBatch<fastchan::MPSC<Tick, 4096, fastchan::CVWaitStrategy, fastchan::CVWaitStrategy>>();
+
+    return 0;
+}
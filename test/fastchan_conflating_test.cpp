@@ -0,0 +1,153 @@
+#include <array>
+#include <atomic>
+#include <cassert>
+#include <conflating.hpp>
+#include <optional>
+#include <thread>
+
+template <class get_wait_strategy>
+auto getUpdate(fastchan::Conflating<int, 16, get_wait_strategy> &chan) {
+    if constexpr (std::is_same<get_wait_strategy, fastchan::ReturnImmediateStrategy>::value) {
+        auto val = chan.get();
+        while (!val) val = chan.get();
+        return *val;
+    } else {
+        return chan.get();
+    }
+}
+
+template <class get_wait_strategy>
+void testConflatingSingleThreaded_Overwrite() {
+    fastchan::Conflating<int, 16, get_wait_strategy> chan;
+
+    assert(chan.isEmpty());
+
+    // repeated puts on the same key collapse into a single update carrying the latest value
+    for (int i = 0; i < 100; ++i) {
+        chan.put(3, i);
+    }
+    assert(chan.size() == 1);
+
+    auto [key, value] = getUpdate(chan);
+    assert(key == 3);
+    assert(value == 99);
+    assert(chan.isEmpty());
+
+    if constexpr (std::is_same<get_wait_strategy, fastchan::ReturnImmediateStrategy>::value) {
+        assert(chan.get() == std::nullopt);
+    }
+}
+
+template <class get_wait_strategy>
+void testConflatingSingleThreaded_KeyOrder() {
+    fastchan::Conflating<int, 16, get_wait_strategy> chan;
+
+    // keys are delivered in the order they first became dirty
+    chan.put(5, 1);
+    chan.put(1, 2);
+    chan.put(5, 3);
+    chan.put(9, 4);
+    chan.put(1, 5);
+    assert(chan.size() == 3);
+
+    auto first = getUpdate(chan);
+    assert(first.first == 5 && first.second == 3);
+    auto second = getUpdate(chan);
+    assert(second.first == 1 && second.second == 5);
+    auto third = getUpdate(chan);
+    assert(third.first == 9 && third.second == 4);
+    assert(chan.isEmpty());
+
+    // a consumed key becomes dirty again on the next put
+    chan.put(5, 6);
+    auto fourth = getUpdate(chan);
+    assert(fourth.first == 5 && fourth.second == 6);
+}
+
+template <class get_wait_strategy>
+void testConflatingMultiThreaded() {
+    constexpr int num_keys = 16;
+    constexpr int iterations = 200'000;
+    fastchan::Conflating<int, num_keys, get_wait_strategy> chan;
+
+    std::thread producer([&] {
+        for (int i = 1; i <= iterations; ++i) {
+            chan.put(i % num_keys, i);
+        }
+    });
+
+    std::array<int, num_keys> last{};
+    int finished = 0;
+    while (finished < num_keys) {
+        auto [key, value] = getUpdate(chan);
+        // values only ever move forward and are never delivered twice
+        assert(value > last[key]);
+        last[key] = value;
+        if (value > iterations - num_keys) {
+            ++finished;
+        }
+    }
+
+    producer.join();
+
+    for (int key = 0; key < num_keys; ++key) {
+        assert(last[key] > iterations - num_keys);
+    }
+    assert(chan.isEmpty());
+}
+
+template <class get_wait_strategy>
+void testConflatingIsEmptyAgreesWithGet() {
+    constexpr int num_keys = 16;
+    constexpr int iterations = 200'000;
+    fastchan::Conflating<int, num_keys, get_wait_strategy> chan;
+
+    std::atomic_bool done{false};
+    std::thread producer([&] {
+        for (int i = 1; i <= iterations; ++i) {
+            chan.put(i % 2, i);
+        }
+        done = true;
+    });
+
+    // whenever isEmpty says there's something, get has it straight away, even with the keys a racing put queued
+    // again for values that were already delivered
+    std::array<int, num_keys> last{};
+    while (!done || !chan.isEmpty()) {
+        if (chan.isEmpty()) {
+            continue;
+        }
+        if constexpr (std::is_same<get_wait_strategy, fastchan::ReturnImmediateStrategy>::value) {
+            auto next = chan.get();
+            assert(next);
+            assert(next->second > last[next->first]);
+            last[next->first] = next->second;
+        } else {
+            auto [key, value] = chan.get();
+            assert(value > last[key]);
+            last[key] = value;
+        }
+    }
+
+    producer.join();
+    assert(chan.isEmpty() && chan.size() == 0);
+    assert(last[0] == iterations && last[1] == iterations - 1);
+}
+
+template <class get_wait_type>
+void testConflating() {
+    testConflatingSingleThreaded_Overwrite<get_wait_type>();
+    testConflatingSingleThreaded_KeyOrder<get_wait_type>();
+    testConflatingMultiThreaded<get_wait_type>();
+    testConflatingIsEmptyAgreesWithGet<get_wait_type>();
+}
+
+int main() {
+    testConflating<fastchan::PauseWaitStrategy>();
+    testConflating<fastchan::YieldWaitStrategy>();
+    testConflating<fastchan::NoOpWaitStrategy>();
+    testConflating<fastchan::CVWaitStrategy>();
+    testConflating<fastchan::ReturnImmediateStrategy>();
+
+    return 0;
+}
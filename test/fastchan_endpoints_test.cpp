@@ -0,0 +1,145 @@
+#include <cassert>
+#include <endpoints.hpp>
+#include <optional>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+using namespace std::chrono_literals;
+
+template <class put_wait_strategy, class get_wait_strategy>
+void testSingleThreaded() {
+    constexpr bool put_returns = std::is_same<put_wait_strategy, fastchan::ReturnImmediateStrategy>::value;
+
+    auto [tx, rx] = fastchan::make_spsc<int, 4, put_wait_strategy, get_wait_strategy>();
+
+    // the endpoints can be moved but never copied, so there's only ever one of each
+    static_assert(!std::is_copy_constructible<decltype(tx)>::value && !std::is_copy_assignable<decltype(tx)>::value);
+    static_assert(!std::is_copy_constructible<decltype(rx)>::value && !std::is_copy_assignable<decltype(rx)>::value);
+    static_assert(std::is_nothrow_move_constructible<decltype(tx)>::value && std::is_nothrow_move_constructible<decltype(rx)>::value);
+
+    assert(rx.isEmpty());
+    assert(rx.peek() == nullptr);
+    for (int i = 0; i < 4; ++i) {
+        tx.put(i);
+    }
+    assert(tx.isFull());
+    assert(rx.size() == 4);
+    if constexpr (put_returns) {
+        assert(!tx.put(4));
+    }
+    assert(!tx.try_put_for(4, 100us));
+
+    assert(*rx.peek() == 0);
+    assert(rx.get() == 0);
+    int value = 0;
+    assert(rx.get(value) && value == 1);
+    assert(rx.try_get_for(100us) == 2);
+
+    int out[4];
+    assert(rx.getBatch(out, 4) == 1 && out[0] == 3);
+    assert(rx.try_get_until(std::chrono::steady_clock::now() + 100us) == std::nullopt);
+
+    int values[] = {10, 11, 12};
+    assert(tx.putBatch(values, 3) == 3);
+    int sum = 0;
+    assert(rx.drain([&](const int *data, std::size_t count) {
+        for (std::size_t i = 0; i < count; ++i) {
+            sum += data[i];
+        }
+    }) == 3);
+    assert(sum == 33);
+
+    // both ends see a close from either
+    tx.put(13);
+    rx.close();
+    assert(tx.isClosed());
+    assert(!tx.try_put_for(14, 100us));
+    assert(rx.get(value) && value == 13);
+    assert(!rx.get(value));
+}
+
+template <class put_wait_strategy, class get_wait_strategy>
+void testDropCloses() {
+    // dropping the sender closes the channel, but what it put can still be got
+    {
+        auto [tx, rx] = fastchan::make_spsc<int, 4, put_wait_strategy, get_wait_strategy>();
+        {
+            auto sender = std::move(tx);
+            sender.put(1);
+        }
+        assert(rx.isClosed());
+        assert(rx.try_get_for(10s) == 1);
+        assert(rx.try_get_for(10s) == std::nullopt);
+    }
+
+    // and dropping the receiver closes it for the sender
+    {
+        auto [tx, rx] = fastchan::make_spsc<int, 4, put_wait_strategy, get_wait_strategy>();
+        { auto receiver = std::move(rx); }
+        assert(tx.isClosed());
+        assert(!tx.try_put_for(1, 10s));
+    }
+
+    // a moved from endpoint doesn't close anything, and assigning over an endpoint closes the channel it had
+    {
+        auto [tx, rx] = fastchan::make_spsc<int, 4, put_wait_strategy, get_wait_strategy>();
+        auto [other_tx, other_rx] = fastchan::make_spsc<int, 4, put_wait_strategy, get_wait_strategy>();
+        auto moved = std::move(tx);
+        assert(!moved.isClosed());
+        moved = std::move(other_tx);
+        assert(rx.isClosed());
+        assert(!other_rx.isClosed());
+        moved.put(7);
+        assert(other_rx.try_get_for(10s) == 7);
+    }
+}
+
+template <int iterations, class put_wait_strategy, class get_wait_strategy>
+void testMultiThreaded() {
+    constexpr bool put_returns = std::is_same<put_wait_strategy, fastchan::ReturnImmediateStrategy>::value;
+
+    auto [tx, rx] = fastchan::make_spsc<int, 64, put_wait_strategy, get_wait_strategy>();
+
+    // each endpoint is moved to the thread that uses it, and the producer dropping its end is what ends the stream
+    std::thread producer([tx = std::move(tx)]() mutable {
+        for (int i = 0; i < iterations; ++i) {
+            if constexpr (put_returns) {
+                while (!tx.put(i)) {
+                }
+            } else {
+                tx.put(i);
+            }
+        }
+    });
+
+    std::thread consumer([rx = std::move(rx)]() mutable {
+        int expected = 0;
+        while (auto value = rx.try_get_for(10s)) {
+            assert(*value == expected);
+            ++expected;
+        }
+        assert(expected == iterations);
+        assert(rx.isClosed());
+    });
+
+    producer.join();
+    consumer.join();
+}
+
+template <class put_wait_type, class get_wait_type>
+void testEndpoints() {
+    testSingleThreaded<put_wait_type, get_wait_type>();
+    testDropCloses<put_wait_type, get_wait_type>();
+    testMultiThreaded<10'000, put_wait_type, get_wait_type>();
+}
+
+int main() {
+    testEndpoints<fastchan::PauseWaitStrategy, fastchan::PauseWaitStrategy>();
+    testEndpoints<fastchan::YieldWaitStrategy, fastchan::YieldWaitStrategy>();
+    testEndpoints<fastchan::CVWaitStrategy, fastchan::CVWaitStrategy>();
+    testEndpoints<fastchan::ReturnImmediateStrategy, fastchan::YieldWaitStrategy>();
+    testEndpoints<fastchan::YieldWaitStrategy, fastchan::ReturnImmediateStrategy>();
+
+    return 0;
+}
@@ -0,0 +1,415 @@
+#include <fcntl.h>
+#include <sys/resource.h>
+#include <unistd.h>
+
+#include <cassert>
+#include <csignal>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <journal.hpp>
+#include <mpsc.hpp>
+#include <spsc.hpp>
+#include <string>
+#include <system_error>
+#include <thread>
+#include <vector>
+
+struct Tick {
+    uint64_t ts;
+    double px;
+    uint32_t qty;
+};
+
+std::string tempPath(const std::string &name) {
+    return (std::filesystem::temp_directory_path() / ("fastchan_" + std::to_string(::getpid()) + "_" + name)).string();
+}
+
+// readJournal checks the file structure and appends every record in it to records
+std::size_t readJournal(const std::string &path, std::vector<Tick> &records) {
+    std::ifstream in(path, std::ios::binary);
+    assert(in);
+
+    fastchan::JournalHeader header;
+    in.read(reinterpret_cast<char *>(&header), sizeof(header));
+    assert(std::memcmp(header.magic, fastchan::JournalHeader{}.magic, sizeof(header.magic)) == 0);
+    assert(header.record_size == sizeof(Tick));
+
+    std::size_t frames = 0;
+    uint64_t last_timestamp = 0;
+    fastchan::JournalFrame frame;
+    while (in.read(reinterpret_cast<char *>(&frame), sizeof(frame))) {
+        assert(frame.count > 0);
+        assert(frame.timestamp_ns >= last_timestamp);
+        last_timestamp = frame.timestamp_ns;
+
+        auto offset = records.size();
+        records.resize(offset + frame.count);
+        in.read(reinterpret_cast<char *>(&records[offset]), frame.count * sizeof(Tick));
+        assert(in);
+        ++frames;
+    }
+
+    return frames;
+}
+
+template <class put_wait_strategy, class get_wait_strategy>
+void testJournalTap() {
+    constexpr uint64_t iterations = 100'000;
+    fastchan::SPSC<Tick, 1024, put_wait_strategy, get_wait_strategy> chan;
+    auto path = tempPath("tap.journal");
+
+    {
+        fastchan::JournalTap<decltype(chan)> tap(chan, path);
+
+        std::thread producer([&] {
+            for (uint64_t i = 0; i < iterations; ++i) {
+                if constexpr (std::is_same<put_wait_strategy, fastchan::ReturnImmediateStrategy>::value) {
+                    while (!chan.put(Tick{i, double(i) / 2, uint32_t(i)})) {
+                    }
+                } else {
+                    chan.put(Tick{i, double(i) / 2, uint32_t(i)});
+                }
+            }
+        });
+
+        uint64_t recorded = 0;
+        while (recorded < iterations) {
+            recorded += tap.poll();
+        }
+        producer.join();
+
+        auto stats = tap.stats();
+        assert(stats.records == iterations);
+        assert(stats.files == 1);
+        assert(stats.bytes == sizeof(fastchan::JournalHeader) + stats.frames * sizeof(fastchan::JournalFrame) + iterations * sizeof(Tick));
+    }
+
+    // the file is trimmed to the last frame on close
+    std::vector<Tick> records;
+    auto frames = readJournal(path, records);
+    assert(frames > 0);
+    assert(std::filesystem::file_size(path) == sizeof(fastchan::JournalHeader) + frames * sizeof(fastchan::JournalFrame) + iterations * sizeof(Tick));
+    assert(records.size() == iterations);
+    for (uint64_t i = 0; i < iterations; ++i) {
+        assert(records[i].ts == i && records[i].px == double(i) / 2 && records[i].qty == uint32_t(i));
+    }
+
+    std::filesystem::remove(path);
+}
+
+void testJournalWraparound() {
+    fastchan::SPSC<Tick, 8, fastchan::NoOpWaitStrategy, fastchan::NoOpWaitStrategy> chan;
+    auto path = tempPath("wrap.journal");
+
+    {
+        fastchan::JournalTap<decltype(chan)> tap(chan, path);
+
+        for (uint64_t i = 0; i < 6; ++i) {
+            chan.put(Tick{i, 0, 0});
+        }
+        assert(tap.poll() == 6);
+
+        // the next 8 entries wrap around the end of the buffer so they go out as two frames
+        for (uint64_t i = 6; i < 14; ++i) {
+            chan.put(Tick{i, 0, 0});
+        }
+        assert(tap.poll() == 8);
+        assert(tap.stats().frames == 3);
+
+        // max limits how much is picked up in one go
+        for (uint64_t i = 14; i < 18; ++i) {
+            chan.put(Tick{i, 0, 0});
+        }
+        // and a wraparound splits it into two frames again
+        assert(tap.poll(3) == 3);
+        assert(tap.poll() == 1);
+        assert(tap.stats().frames == 6);
+        assert(tap.poll() == 0);
+    }
+
+    std::vector<Tick> records;
+    assert(readJournal(path, records) == 6);
+    assert(records.size() == 18);
+    for (uint64_t i = 0; i < 18; ++i) {
+        assert(records[i].ts == i);
+    }
+
+    std::filesystem::remove(path);
+}
+
+void testJournalRotation() {
+    constexpr uint64_t iterations = 10'000;
+    constexpr std::size_t rotate_bytes = 16 << 10;
+    fastchan::SPSC<Tick, 256, fastchan::NoOpWaitStrategy, fastchan::NoOpWaitStrategy> chan;
+    auto path = tempPath("rotate.journal");
+
+    uint64_t files = 0;
+    {
+        fastchan::JournalTap<decltype(chan)> tap(chan, path, rotate_bytes);
+        for (uint64_t i = 0; i < iterations; ++i) {
+            chan.put(Tick{i, 0, 0});
+            if (chan.isFull()) {
+                tap.poll();
+            }
+        }
+        tap.poll();
+
+        files = tap.stats().files;
+        assert(files > 1);
+    }
+
+    std::vector<Tick> records;
+    for (uint64_t file = 0; file < files; ++file) {
+        auto name = file ? path + "." + std::to_string(file) : path;
+        assert(std::filesystem::file_size(name) <= rotate_bytes);
+        readJournal(name, records);
+        std::filesystem::remove(name);
+    }
+
+    assert(records.size() == iterations);
+    for (uint64_t i = 0; i < iterations; ++i) {
+        assert(records[i].ts == i);
+    }
+}
+
+template <class Chan>
+void testJournalReplay() {
+    constexpr uint64_t frames = 5;
+    constexpr uint64_t per_frame = 100;
+    constexpr uint64_t spacing_ns = 1'000'000;
+    auto path = tempPath("replay.journal");
+
+    {
+        fastchan::JournalWriter<Tick> writer(path);
+        std::vector<Tick> batch(per_frame);
+        for (uint64_t frame = 0; frame < frames; ++frame) {
+            for (uint64_t i = 0; i < per_frame; ++i) {
+                batch[i] = Tick{frame * per_frame + i, 0, 0};
+            }
+            writer.append(batch.data(), batch.size(), 1'000'000'000 + frame * spacing_ns);
+        }
+    }
+
+    for (double speed : {0.0, 1.0, 4.0}) {
+        Chan chan;
+        std::thread consumer([&] {
+            for (uint64_t i = 0; i < frames * per_frame; ++i) {
+                auto val = chan.get();
+                if constexpr (std::is_same<decltype(val), Tick>::value) {
+                    assert(val.ts == i);
+                } else {
+                    while (!val) val = chan.get();
+                    assert(val->ts == i);
+                }
+            }
+        });
+
+        fastchan::JournalReplay<Chan> replay(chan, path);
+        auto stats = replay.run(speed);
+        consumer.join();
+
+        assert(stats.records == frames * per_frame);
+        assert(stats.frames == frames);
+        assert(stats.files == 1);
+        if (speed > 0) {
+            // frames go out no earlier than their recorded spacing allows
+            assert(stats.elapsed_ns >= uint64_t(double((frames - 1) * spacing_ns) / speed));
+        }
+    }
+
+    std::filesystem::remove(path);
+}
+
+template <class Chan>
+void testJournalReplayClosed() {
+    constexpr uint64_t frames = 5;
+    constexpr uint64_t per_frame = 100;
+    constexpr uint64_t got = 150;
+    auto path = tempPath("closed_replay.journal");
+
+    {
+        fastchan::JournalWriter<Tick> writer(path);
+        std::vector<Tick> batch(per_frame);
+        for (uint64_t frame = 0; frame < frames; ++frame) {
+            for (uint64_t i = 0; i < per_frame; ++i) {
+                batch[i] = Tick{frame * per_frame + i, 0, 0};
+            }
+            writer.append(batch.data(), batch.size(), 1'000'000'000 + frame);
+        }
+    }
+
+    // the consumer gives up part way through, with the replay stuck on a full channel
+    Chan chan;
+    std::thread consumer([&] {
+        Tick val;
+        for (uint64_t i = 0; i < got; ++i) {
+            while (!chan.get(val)) {
+            }
+            assert(val.ts == i);
+        }
+        chan.close();
+    });
+
+    auto stats = fastchan::JournalReplay<Chan>(chan, path).run(0);
+    consumer.join();
+
+    // it stops at the frame it was putting when the channel was closed, whatever's put is either got or left over
+    uint64_t left = 0;
+    Tick val;
+    while (chan.get(val)) {
+        ++left;
+    }
+    assert(stats.dropped > 0);
+    assert(stats.records == got + left);
+    assert(stats.records + stats.dropped == (stats.frames + 1) * per_frame);
+    assert(stats.frames < frames);
+
+    std::filesystem::remove(path);
+}
+
+// CountingYield backs off like YieldWaitStrategy but counts how often it's asked to
+struct CountingYield {
+    static constexpr bool needs_notify = false;
+    static constexpr bool can_block = false;
+    static inline uint64_t waits = 0;
+
+    template <class Predicate>
+    void wait(Predicate) {
+        ++waits;
+        std::this_thread::yield();
+    }
+    void notify() {}
+};
+
+void testJournalReplayBacksOff() {
+    constexpr uint64_t per_frame = 100;
+    auto path = tempPath("backoff_replay.journal");
+
+    {
+        fastchan::JournalWriter<Tick> writer(path);
+        std::vector<Tick> batch(per_frame);
+        for (uint64_t i = 0; i < per_frame; ++i) {
+            batch[i] = Tick{i, 0, 0};
+        }
+        writer.append(batch.data(), batch.size(), 1'000'000'000);
+    }
+
+    // a frame bigger than the channel doesn't go in with one putBatch, and in between the replay backs off rather than
+    // spin on putBatch
+    fastchan::SPSC<Tick, 16, fastchan::ReturnImmediateStrategy, fastchan::ReturnImmediateStrategy> chan;
+    std::thread consumer([&] {
+        for (uint64_t i = 0; i < per_frame; ++i) {
+            auto val = chan.get();
+            while (!val) val = chan.get();
+            assert(val->ts == i);
+        }
+    });
+
+    auto stats = fastchan::JournalReplay<decltype(chan), CountingYield>(chan, path).run(0);
+    consumer.join();
+    assert(stats.records == per_frame && stats.dropped == 0);
+    assert(CountingYield::waits > 0);
+
+    std::filesystem::remove(path);
+}
+
+void testJournalReplayRotatedAndTruncated() {
+    constexpr uint64_t iterations = 10'000;
+    fastchan::SPSC<Tick, 256, fastchan::NoOpWaitStrategy, fastchan::NoOpWaitStrategy> chan;
+    auto path = tempPath("rotated_replay.journal");
+
+    uint64_t files = 0;
+    {
+        fastchan::JournalTap<decltype(chan)> tap(chan, path, 16 << 10);
+        for (uint64_t i = 0; i < iterations; ++i) {
+            chan.put(Tick{i, 0, 0});
+            if (chan.isFull()) {
+                tap.poll();
+            }
+        }
+        tap.poll();
+        files = tap.stats().files;
+    }
+
+    // cut the last frame short as if the recorder died mid write
+    auto last = path + "." + std::to_string(files - 1);
+    uint64_t lost = 0;
+    fastchan::JournalReader<Tick>(last).forEachFrame([&](const fastchan::JournalFrame &frame, const Tick *) { lost = frame.count; });
+    std::filesystem::resize_file(last, std::filesystem::file_size(last) - sizeof(Tick) / 2);
+
+    fastchan::MPSC<Tick, 1024, fastchan::YieldWaitStrategy, fastchan::YieldWaitStrategy> replayed;
+    std::thread consumer([&] {
+        for (uint64_t i = 0; i < iterations - lost; ++i) {
+            assert(replayed.get().ts == i);
+        }
+    });
+
+    auto stats = fastchan::JournalReplay<decltype(replayed)>(replayed, path).run(0);
+    consumer.join();
+    assert(stats.files == files);
+    assert(stats.records == iterations - lost);
+    assert(replayed.isEmpty());
+
+    for (uint64_t file = 0; file < files; ++file) {
+        std::filesystem::remove(file ? path + "." + std::to_string(file) : path);
+    }
+}
+
+// a writer that can't size its first chunk throws without leaving its fd or a headerless file behind
+void testJournalOpenFails() {
+    auto path = tempPath("open_fails");
+
+    // a file size limit below the chunk makes the ftruncate fail with EFBIG rather than raise SIGXFSZ
+    auto old_handler = std::signal(SIGXFSZ, SIG_IGN);
+    rlimit old_limit;
+    assert(::getrlimit(RLIMIT_FSIZE, &old_limit) == 0);
+    rlimit limit = old_limit;
+    limit.rlim_cur = 1 << 20;
+    assert(::setrlimit(RLIMIT_FSIZE, &limit) == 0);
+
+    // the lowest free fd, which the writer's would take up if it leaked
+    int next_fd = ::open("/dev/null", O_RDONLY);
+    assert(next_fd >= 0);
+    ::close(next_fd);
+    bool threw = false;
+    try {
+        fastchan::JournalWriter<Tick> writer(path, 0, 4 << 20);
+    } catch (const std::system_error &) {
+        threw = true;
+    }
+
+    assert(::setrlimit(RLIMIT_FSIZE, &old_limit) == 0);
+    std::signal(SIGXFSZ, old_handler);
+
+    assert(threw);
+    assert(!std::filesystem::exists(path));
+    int fd = ::open("/dev/null", O_RDONLY);
+    assert(fd == next_fd);
+    ::close(fd);
+}
+
+int main() {
+    testJournalTap<fastchan::PauseWaitStrategy, fastchan::PauseWaitStrategy>();
+    testJournalTap<fastchan::YieldWaitStrategy, fastchan::YieldWaitStrategy>();
+    testJournalTap<fastchan::CVWaitStrategy, fastchan::CVWaitStrategy>();
+    testJournalTap<fastchan::ReturnImmediateStrategy, fastchan::ReturnImmediateStrategy>();
+
+    testJournalWraparound();
+    testJournalRotation();
+    testJournalOpenFails();
+
+    testJournalReplay<fastchan::SPSC<Tick, 64, fastchan::PauseWaitStrategy, fastchan::PauseWaitStrategy>>();
+    testJournalReplay<fastchan::SPSC<Tick, 64, fastchan::ReturnImmediateStrategy, fastchan::ReturnImmediateStrategy>>();
+    testJournalReplay<fastchan::MPSC<Tick, 64, fastchan::YieldWaitStrategy, fastchan::YieldWaitStrategy>>();
+    testJournalReplay<fastchan::MPSC<Tick, 64, fastchan::ReturnImmediateStrategy, fastchan::CVWaitStrategy>>();
+    testJournalReplayClosed<fastchan::SPSC<Tick, 64, fastchan::YieldWaitStrategy, fastchan::YieldWaitStrategy>>();
+    testJournalReplayClosed<fastchan::SPSC<Tick, 64, fastchan::ReturnImmediateStrategy, fastchan::ReturnImmediateStrategy>>();
+    testJournalReplayClosed<fastchan::MPSC<Tick, 64, fastchan::CVWaitStrategy, fastchan::CVWaitStrategy>>();
+    testJournalReplayClosed<fastchan::MPSC<Tick, 64, fastchan::ReturnImmediateStrategy, fastchan::YieldWaitStrategy>>();
+    testJournalReplayBacksOff();
+    testJournalReplayRotatedAndTruncated();
+
+    return 0;
+}
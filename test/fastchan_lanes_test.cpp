@@ -0,0 +1,279 @@
+#include <array>
+#include <cassert>
+#include <chrono>
+#include <cstdint>
+#include <lanes.hpp>
+#include <optional>
+#include <thread>
+#include <vector>
+
+using namespace std::chrono_literals;
+
+template <class T>
+struct is_optional : std::false_type {};
+template <class T>
+struct is_optional<std::optional<T>> : std::true_type {};
+
+template <class Chan>
+auto getValue(Chan &chan) {
+    auto val = chan.get();
+    if constexpr (is_optional<decltype(val)>::value) {
+        while (!val) val = chan.get();
+        return *val;
+    } else {
+        return val;
+    }
+}
+
+template <class Producer, class T>
+void putValue(Producer &producer, const T &value) {
+    if constexpr (std::is_same<decltype(producer.put(value)), bool>::value) {
+        while (!producer.put(value)) {
+        }
+    } else {
+        producer.put(value);
+    }
+}
+
+struct Event {
+    uint64_t ts;
+    uint64_t producer;
+};
+
+struct EventTime {
+    uint64_t operator()(const Event &e) const { return e.ts; }
+};
+
+void testRegistration() {
+    fastchan::LaneMPSC<int, 4, 3> chan;
+
+    auto a = chan.registerProducer();
+    auto b = chan.registerProducer();
+    auto c = chan.registerProducer();
+    assert(a && b && c);
+    assert(a->lane() == 0 && b->lane() == 1 && c->lane() == 2);
+    assert(!chan.registerProducer());
+
+    // the lowest free lane goes to the next producer, together with what's left in it
+    b->put(1);
+    b.reset();
+    auto d = chan.registerProducer();
+    assert(d && d->lane() == 1);
+    d->put(2);
+    assert(chan.size() == 2);
+    assert(chan.get() == 1 && chan.get() == 2);
+
+    // moving a handle keeps the lane claimed
+    auto moved = std::move(*d);
+    d.reset();
+    assert(!chan.registerProducer());
+    moved.put(3);
+    assert(chan.get() == 3 && chan.isEmpty());
+}
+
+void testRoundRobin() {
+    fastchan::LaneMPSC<int, 8, 3> chan;
+    auto a = chan.registerProducer();
+    auto b = chan.registerProducer();
+    auto c = chan.registerProducer();
+
+    for (int i = 0; i < 3; ++i) {
+        a->put(i);
+        b->put(10 + i);
+    }
+    c->put(20);
+
+    // one from each lane in turn, skipping the empty ones
+    std::vector<int> got;
+    for (int i = 0; i < 7; ++i) {
+        got.push_back(chan.get());
+    }
+    assert((got == std::vector<int>{0, 10, 20, 1, 11, 2, 12}));
+    assert(chan.isEmpty());
+
+    // getBatch takes each lane's entries in turn, carrying on from the lane after the last get
+    for (int i = 0; i < 3; ++i) {
+        a->put(i);
+        c->put(20 + i);
+    }
+    std::array<int, 8> out{};
+    assert(chan.getBatch(out.data(), 4) == 4);
+    assert(out[0] == 20 && out[1] == 21 && out[2] == 22 && out[3] == 0);
+    assert(chan.getBatch(out.data(), out.size()) == 2);
+    assert(out[0] == 1 && out[1] == 2);
+    assert(chan.getBatch(out.data(), out.size()) == 0);
+}
+
+void testByKey() {
+    fastchan::LaneMPSC<Event, 16, 4, fastchan::YieldWaitStrategy, fastchan::YieldWaitStrategy, fastchan::ByKey<EventTime>> chan;
+    std::vector<decltype(chan)::Producer> producers;
+    for (uint64_t p = 0; p < 4; ++p) {
+        producers.push_back(*chan.registerProducer());
+    }
+
+    // every lane is in order on its own, the consumer interleaves them by timestamp
+    for (uint64_t i = 0; i < 10; ++i) {
+        for (uint64_t p = 0; p < 4; ++p) {
+            producers[p].put(Event{i * 7 + (p * 3) % 7, p});
+        }
+    }
+
+    uint64_t last = 0;
+    for (int i = 0; i < 40; ++i) {
+        auto e = chan.get();
+        assert(e.ts >= last);
+        last = e.ts;
+    }
+    assert(chan.isEmpty());
+
+    // a lambda works as the key too
+    auto by_ts = [](const Event &e) { return e.ts; };
+    fastchan::LaneMPSC<Event, 4, 2, fastchan::YieldWaitStrategy, fastchan::YieldWaitStrategy, fastchan::ByKey<decltype(by_ts)>> lambda_chan(
+        fastchan::ByKey<decltype(by_ts)>{by_ts});
+    auto x = lambda_chan.registerProducer();
+    auto y = lambda_chan.registerProducer();
+    x->put(Event{5, 0});
+    y->put(Event{3, 1});
+    std::array<Event, 4> out{};
+    assert(lambda_chan.getBatch(out.data(), out.size()) == 2);
+    assert(out[0].ts == 3 && out[1].ts == 5);
+}
+
+template <uint64_t iterations, int num_producers, class put_wait_type, class get_wait_type>
+void testMultiThreaded() {
+    fastchan::LaneMPSC<Event, 64, num_producers, put_wait_type, get_wait_type> chan;
+
+    std::vector<std::thread> producers;
+    for (int p = 0; p < num_producers; ++p) {
+        producers.emplace_back([&, p] {
+            auto producer = chan.registerProducer();
+            assert(producer);
+            for (uint64_t i = 1; i <= iterations; ++i) {
+                putValue(*producer, Event{i, uint64_t(p)});
+            }
+        });
+    }
+
+    // every producer's entries arrive in the order it put them
+    std::array<uint64_t, num_producers> last{};
+    for (uint64_t i = 0; i < iterations * num_producers; ++i) {
+        auto e = getValue(chan);
+        assert(e.ts == last[e.producer] + 1);
+        last[e.producer] = e.ts;
+    }
+
+    for (auto &producer : producers) {
+        producer.join();
+    }
+    assert(chan.isEmpty());
+}
+
+void testTimed() {
+    fastchan::LaneMPSC<int, 2, 2, fastchan::CVWaitStrategy, fastchan::CVWaitStrategy> chan;
+    assert(!chan.try_get_for(1ms));
+
+    auto producer = chan.registerProducer();
+    assert(producer->try_put_for(1, 1ms) && producer->try_put_for(2, 1ms));
+    assert(!producer->try_put_for(3, 1ms));
+    assert(chan.try_get_for(1ms) == 1 && chan.try_get_for(1ms) == 2);
+
+    // parks on an empty channel until a producer on another lane wakes it up
+    std::thread late([&] {
+        auto other = chan.registerProducer();
+        std::this_thread::sleep_for(1ms);
+        other->put(4);
+    });
+    assert(chan.try_get_for(10s) == 4);
+    late.join();
+}
+
+template <class put_wait_type, class get_wait_type>
+void testClose() {
+    constexpr bool put_returns = std::is_same<put_wait_type, fastchan::ReturnImmediateStrategy>::value;
+    constexpr bool get_returns = std::is_same<get_wait_type, fastchan::ReturnImmediateStrategy>::value;
+
+    {
+        fastchan::LaneMPSC<int, 4, 2, put_wait_type, get_wait_type> chan;
+        auto a = chan.registerProducer();
+        auto b = chan.registerProducer();
+        a->put(1);
+        b->put(2);
+        chan.close();
+        assert(chan.isClosed());
+
+        // puts fail straight away on every lane
+        if constexpr (put_returns) {
+            assert(!a->put(3));
+        } else {
+            b->put(3);
+        }
+        assert(chan.size() == 2);
+
+        // gets drain what's left and then report closed rather than wait
+        int value = 0;
+        assert(chan.get(value) && value == 1);
+        assert(chan.try_get_for(10s) == 2);
+        assert(!chan.get(value));
+        assert(chan.try_get_for(10s) == std::nullopt);
+        if constexpr (get_returns) {
+            assert(chan.get() == std::nullopt);
+        } else {
+            assert(chan.get() == 0);
+        }
+    }
+
+    // a consumer waiting on empty lanes is woken by the close
+    if constexpr (!get_returns) {
+        fastchan::LaneMPSC<int, 4, 2, put_wait_type, get_wait_type> chan;
+        std::thread consumer([&] {
+            int value = 0;
+            assert(!chan.get(value));
+        });
+        std::this_thread::sleep_for(1ms);
+        chan.close();
+        consumer.join();
+    }
+
+    // as is a producer waiting on a full lane, and what's in it can still be got
+    if constexpr (!put_returns) {
+        fastchan::LaneMPSC<int, 2, 2, put_wait_type, get_wait_type> chan;
+        std::thread producer([&] {
+            auto p = chan.registerProducer();
+            p->put(1);
+            p->put(2);
+            p->put(3);
+        });
+        while (chan.size() < 2) {
+            std::this_thread::yield();
+        }
+        std::this_thread::sleep_for(1ms);
+        chan.close();
+        producer.join();
+        assert(chan.try_get_for(10s) == 1);
+        assert(chan.try_get_for(10s) == 2);
+        assert(chan.try_get_for(10s) == std::nullopt);
+    }
+}
+
+int main() {
+    testRegistration();
+    testRoundRobin();
+    testByKey();
+
+    // the strategies that only spin get fewer iterations as they spin out their whole time slice when there's only one core
+    testMultiThreaded<2'000, 2, fastchan::PauseWaitStrategy, fastchan::PauseWaitStrategy>();
+    testMultiThreaded<20'000, 3, fastchan::YieldWaitStrategy, fastchan::YieldWaitStrategy>();
+    testMultiThreaded<20'000, 5, fastchan::CVWaitStrategy, fastchan::CVWaitStrategy>();
+    testMultiThreaded<2'000, 3, fastchan::ReturnImmediateStrategy, fastchan::ReturnImmediateStrategy>();
+    testMultiThreaded<5'000, 2, fastchan::YieldWaitStrategy, fastchan::ReturnImmediateStrategy>();
+    testMultiThreaded<20'000, 8, fastchan::YieldWaitStrategy, fastchan::YieldWaitStrategy>();
+
+    testTimed();
+
+    testClose<fastchan::YieldWaitStrategy, fastchan::YieldWaitStrategy>();
+    testClose<fastchan::PauseWaitStrategy, fastchan::PauseWaitStrategy>();
+    testClose<fastchan::CVWaitStrategy, fastchan::CVWaitStrategy>();
+    testClose<fastchan::ReturnImmediateStrategy, fastchan::ReturnImmediateStrategy>();
+
+    return 0;
+}
@@ -0,0 +1,193 @@
+#include <atomic>
+#include <cassert>
+#include <chrono>
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <merge.hpp>
+#include <spsc.hpp>
+#include <thread>
+#include <vector>
+
+using namespace std::chrono_literals;
+
+struct Event {
+    uint64_t ts;
+    uint64_t lane;
+};
+
+struct EventTime {
+    uint64_t operator()(const Event &e) const { return e.ts; }
+};
+
+using Feed = fastchan::SPSC<Event, 16, fastchan::NoOpWaitStrategy, fastchan::NoOpWaitStrategy>;
+
+void testOrdering() {
+    std::vector<Feed> feeds(3);
+    fastchan::OrderedMerge<Feed, EventTime> merge({&feeds[0], &feeds[1], &feeds[2]});
+    assert(!merge.poll());
+
+    feeds[0].put(Event{1, 0});
+    feeds[0].put(Event{4, 0});
+    feeds[1].put(Event{2, 1});
+
+    // the third feed could still come up with something older
+    assert(!merge.poll());
+
+    feeds[2].put(Event{3, 2});
+    feeds[2].put(Event{9, 2});
+    assert(merge.poll()->ts == 1);
+    assert(merge.poll()->ts == 2);
+
+    // the second feed is empty now, but it's only been as far as 2
+    assert(!merge.poll());
+    feeds[1].put(Event{5, 1});
+    assert(merge.poll()->ts == 3);
+    assert(merge.poll()->ts == 4);
+
+    // the first feed is empty and has only been as far as 4, which holds up 5
+    assert(!merge.poll());
+    feeds[0].put(Event{6, 0});
+    feeds[1].put(Event{7, 1});
+    feeds[0].put(Event{8, 0});
+
+    std::vector<uint64_t> got;
+    assert(merge.drain([&](Event &&e) { got.push_back(e.ts); }) == 3);
+    assert((got == std::vector<uint64_t>{5, 6, 7}));
+
+    assert(!merge.poll());
+    feeds[1].put(Event{9, 1});
+    assert(merge.poll()->ts == 8);
+
+    // the tie on 9 is held up by the first feed, which has only been as far as 8
+    assert(!merge.poll());
+    feeds[0].put(Event{10, 0});
+    assert(merge.poll()->lane == 1);
+    assert(merge.poll()->lane == 2);
+    assert(!merge.poll());
+    assert(merge.late() == 0);
+}
+
+void testTies() {
+    std::vector<Feed> feeds(2);
+    fastchan::OrderedMerge<Feed, EventTime> merge({&feeds[0], &feeds[1]});
+
+    // on a tie the lower lane goes first, and an empty lane that's been as far as the key doesn't hold it up
+    feeds[1].put(Event{1, 1});
+    feeds[0].put(Event{1, 0});
+    assert(merge.poll()->lane == 0);
+    assert(merge.poll()->lane == 1);
+    feeds[1].put(Event{1, 1});
+    assert(merge.poll()->lane == 1);
+    assert(!merge.poll());
+
+    // a single channel is just passed through
+    Feed feed;
+    fastchan::OrderedMerge<Feed, EventTime> single({&feed});
+    assert(!single.poll());
+    feed.put(Event{2, 0});
+    assert(single.poll()->ts == 2);
+    assert(!single.poll());
+}
+
+void testLateness() {
+    // the third feed stays quiet, and with a second of lateness the others are held up for all of this
+    std::vector<Feed> feeds(3);
+    fastchan::OrderedMerge<Feed, EventTime> merge({&feeds[0], &feeds[1], &feeds[2]}, EventTime(), 1s);
+    feeds[0].put(Event{1, 0});
+    feeds[1].put(Event{2, 1});
+    assert(!merge.poll());
+    assert(!merge.try_get_for(1ms));
+
+    // and once it's caught up they're back in order without waiting
+    feeds[2].put(Event{3, 2});
+    feeds[2].put(Event{6, 2});
+    feeds[0].put(Event{4, 0});
+    feeds[1].put(Event{5, 1});
+    assert(merge.poll()->ts == 1);
+    assert(merge.poll()->ts == 2);
+    assert(merge.poll()->ts == 3);
+    assert(merge.poll()->ts == 4);
+    assert(!merge.try_get_for(1ms));
+    assert(merge.late() == 0);
+
+    // with a short lateness they get through once the quiet feed's held them up for long enough, each waiting for it
+    // all over again
+    std::vector<Feed> quiet(3);
+    fastchan::OrderedMerge<Feed, EventTime> impatient({&quiet[0], &quiet[1], &quiet[2]}, EventTime(), 5ms);
+    quiet[0].put(Event{1, 0});
+    quiet[1].put(Event{2, 1});
+    auto e = impatient.try_get_for(1s);
+    assert(e && e->ts == 1);
+    assert(impatient.late() == 1);
+    e = impatient.try_get_for(1s);
+    assert(e && e->ts == 2);
+    assert(impatient.late() == 2);
+
+    // with no lateness at all it's just the oldest of whatever's there
+    std::vector<Feed> more(2);
+    fastchan::OrderedMerge<Feed, EventTime> eager({&more[0], &more[1]}, EventTime(), 0ns);
+    more[1].put(Event{7, 1});
+    assert(eager.poll()->ts == 7);
+    more[0].put(Event{6, 0});
+    assert(eager.poll()->ts == 6);
+}
+
+template <class Chan, uint64_t iterations, int num_lanes, class idle_wait_type>
+void testMultiThreaded() {
+    std::vector<std::unique_ptr<Chan>> feeds;
+    std::vector<Chan *> chans;
+    for (int i = 0; i < num_lanes; ++i) {
+        feeds.push_back(std::make_unique<Chan>());
+        chans.push_back(feeds.back().get());
+    }
+    fastchan::OrderedMerge<Chan, EventTime, idle_wait_type> merge(chans);
+
+    // the timestamps come from one clock, so every feed is in order on its own but they interleave at random
+    std::atomic<uint64_t> clock{1};
+    std::vector<std::thread> producers;
+    for (int p = 0; p < num_lanes; ++p) {
+        producers.emplace_back([&, p] {
+            auto &feed = *feeds[p];
+            for (uint64_t i = 0; i < iterations; ++i) {
+                Event e{clock.fetch_add(1), uint64_t(p)};
+                if constexpr (std::is_same<decltype(feed.put(e)), bool>::value) {
+                    while (!feed.put(e)) {
+                    }
+                } else {
+                    feed.put(e);
+                }
+            }
+            // the end of every feed lets the others drain
+            feed.put(Event{std::numeric_limits<uint64_t>::max(), uint64_t(p)});
+        });
+    }
+
+    uint64_t last = 0;
+    for (uint64_t i = 0; i < iterations * num_lanes; ++i) {
+        auto e = merge.get();
+        assert(e.ts > last);
+        last = e.ts;
+    }
+    for (int p = 0; p < num_lanes; ++p) {
+        assert(merge.get().ts == std::numeric_limits<uint64_t>::max());
+    }
+
+    for (auto &producer : producers) {
+        producer.join();
+    }
+    assert(!merge.poll());
+    assert(merge.late() == 0);
+}
+
+int main() {
+    testOrdering();
+    testTies();
+    testLateness();
+
+    testMultiThreaded<fastchan::SPSC<Event, 64, fastchan::YieldWaitStrategy, fastchan::YieldWaitStrategy>, 20'000, 4, fastchan::YieldWaitStrategy>();
+    testMultiThreaded<fastchan::SPSC<Event, 64, fastchan::YieldWaitStrategy, fastchan::ReturnImmediateStrategy>, 20'000, 3, fastchan::CVWaitStrategy>();
+    testMultiThreaded<fastchan::SPSC<Event, 64, fastchan::YieldWaitStrategy, fastchan::YieldWaitStrategy>, 2'000, 2, fastchan::PauseWaitStrategy>();
+
+    return 0;
+}
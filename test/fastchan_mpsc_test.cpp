@@ -5,7 +5,9 @@
 #include <cstdint>
 #include <cstdio>
 #include <mpsc.hpp>
+#include <optional>
 #include <thread>
+#include <vector>
 
 using namespace std::chrono_literals;
 
@@ -182,6 +184,311 @@ void testMPSCMultiThreadedMultiProducer() {
     assert(chan.size() == 0);
 }
 
+template <int iterations, class put_wait_strategy, class get_wait_strategy>
+void testMPSCTimed() {
+    constexpr std::size_t chan_size = (iterations / 2) + 1;
+    fastchan::MPSC<int, chan_size, put_wait_strategy, get_wait_strategy> chan;
+
+    // times out on an empty channel
+    auto start = std::chrono::steady_clock::now();
+    assert(chan.try_get_for(200us) == std::nullopt);
+    assert(std::chrono::steady_clock::now() - start >= 200us);
+    assert(chan.try_get_until(std::chrono::steady_clock::now() + 100us) == std::nullopt);
+
+    for (int i = 0; i < iterations; ++i) {
+        assert(chan.try_put_for(i, 200us));
+    }
+
+    // times out on a full channel
+    start = std::chrono::steady_clock::now();
+    assert(!chan.try_put_for(iterations, 200us));
+    assert(std::chrono::steady_clock::now() - start >= 200us);
+    assert(!chan.try_put_until(iterations, std::chrono::system_clock::now() + 100us));
+
+    for (int i = 0; i < iterations; ++i) {
+        assert(chan.try_get_for(200us) == i);
+    }
+    assert(chan.isEmpty());
+
+    // a waiter is released as soon as the other side makes progress
+    std::thread producer([&] {
+        std::this_thread::sleep_for(1ms);
+        assert(chan.try_put_for(42, 10s));
+    });
+    assert(chan.try_get_for(10s) == 42);
+    producer.join();
+}
+
+template <int iterations, class put_wait_strategy, class get_wait_strategy>
+void testMPSCBatch() {
+    constexpr std::size_t chan_size = (iterations / 2) + 1;
+    fastchan::MPSC<int, chan_size, put_wait_strategy, get_wait_strategy> chan;
+
+    std::vector<int> values(iterations * 10);
+    for (std::size_t i = 0; i < values.size(); ++i) {
+        values[i] = int(i);
+    }
+
+    if constexpr (std::is_same<put_wait_strategy, fastchan::ReturnImmediateStrategy>::value) {
+        // only what fits goes in
+        assert(chan.putBatch(values.data(), iterations + 3) == iterations);
+        assert(chan.isFull());
+        assert(chan.putBatch(values.data(), 1) == 0);
+        for (int i = 0; i < iterations; ++i) {
+            if constexpr (std::is_same<get_wait_strategy, fastchan::ReturnImmediateStrategy>::value) {
+                while (!chan.get()) {
+                }
+            } else {
+                chan.get();
+            }
+        }
+    }
+
+    // batches larger than the buffer and wrapping around its end
+    std::thread producer([&] {
+        std::size_t done = 0;
+        while (done < values.size()) {
+            auto batch = std::min<std::size_t>(values.size() - done, 1 + done % (2 * iterations));
+            done += chan.putBatch(values.data() + done, batch);
+        }
+    });
+
+    for (std::size_t i = 0; i < values.size(); ++i) {
+        if constexpr (std::is_same<get_wait_strategy, fastchan::ReturnImmediateStrategy>::value) {
+            auto val = chan.get();
+            while (!val) val = chan.get();
+            assert(*val == int(i));
+        } else {
+            assert(chan.get() == int(i));
+        }
+    }
+
+    producer.join();
+    assert(chan.isEmpty());
+}
+
+template <int iterations, class put_wait_strategy, class get_wait_strategy>
+void testMPSCClose() {
+    constexpr bool put_returns = std::is_same<put_wait_strategy, fastchan::ReturnImmediateStrategy>::value;
+    constexpr bool get_returns = std::is_same<get_wait_strategy, fastchan::ReturnImmediateStrategy>::value;
+
+    {
+        fastchan::MPSC<int, 4, put_wait_strategy, get_wait_strategy> chan;
+        chan.put(1);
+        chan.put(2);
+        chan.close();
+        assert(chan.isClosed());
+
+        // puts fail straight away
+        if constexpr (put_returns) {
+            assert(!chan.put(3));
+        } else {
+            chan.put(3);
+        }
+        int values[] = {4, 5};
+        assert(chan.putBatch(values, 2) == 0);
+        assert(!chan.try_put_for(6, 10s));
+        assert(chan.size() == 2);
+
+        // gets drain what's left and then report closed rather than wait
+        int value = 0;
+        assert(chan.get(value) && value == 1);
+        assert(chan.try_get_for(10s) == 2);
+        assert(!chan.get(value));
+        assert(chan.try_get_for(10s) == std::nullopt);
+        if constexpr (get_returns) {
+            assert(chan.get() == std::nullopt);
+        } else {
+            assert(chan.get() == 0);
+        }
+    }
+
+    // a consumer waiting on an empty channel is woken by the close
+    if constexpr (!get_returns) {
+        fastchan::MPSC<int, 4, put_wait_strategy, get_wait_strategy> chan;
+        std::thread consumer([&] {
+            int value = 0;
+            assert(!chan.get(value));
+        });
+        std::this_thread::sleep_for(1ms);
+        chan.close();
+        consumer.join();
+    }
+
+    // as is a producer waiting on a full one, and what's in it can still be got
+    if constexpr (!put_returns) {
+        fastchan::MPSC<int, 2, put_wait_strategy, get_wait_strategy> chan;
+        chan.put(1);
+        chan.put(2);
+        std::thread producer([&] { chan.put(3); });
+        std::this_thread::sleep_for(1ms);
+        chan.close();
+        producer.join();
+        assert(chan.size() == 2);
+        assert(chan.try_get_for(10s) == 1);
+        assert(chan.try_get_for(10s) == 2);
+        assert(chan.try_get_for(10s) == std::nullopt);
+    }
+
+    // everything put before the close is got, however the consumer's waiting
+    {
+        fastchan::MPSC<int, 16, put_wait_strategy, get_wait_strategy> chan;
+        std::vector<std::thread> producers;
+        std::atomic<int> running{2};
+        for (int p = 0; p < 2; ++p) {
+            producers.emplace_back([&, p] {
+                for (int i = 0; i < iterations; ++i) {
+                    if constexpr (put_returns) {
+                        while (!chan.put(p * iterations + i)) {
+                        }
+                    } else {
+                        chan.put(p * iterations + i);
+                    }
+                }
+                if (--running == 0) {
+                    chan.close();
+                }
+            });
+        }
+
+        std::vector<int> last(2, -1);
+        int got = 0;
+        int value = 0;
+        while (true) {
+            if (chan.get(value)) {
+                // each producer's values arrive in order
+                assert(value % iterations > last[value / iterations]);
+                last[value / iterations] = value % iterations;
+                ++got;
+            } else if (!get_returns || (chan.isClosed() && chan.isEmpty())) {
+                break;
+            }
+        }
+        assert(got == 2 * iterations);
+        for (auto &producer : producers) {
+            producer.join();
+        }
+    }
+}
+
+template <int iterations, class put_wait_strategy, class get_wait_strategy>
+void testMPSCFetchAddClaim() {
+    constexpr bool put_returns = std::is_same<put_wait_strategy, fastchan::ReturnImmediateStrategy>::value;
+    constexpr bool get_returns = std::is_same<get_wait_strategy, fastchan::ReturnImmediateStrategy>::value;
+    using Chan = fastchan::MPSC<int, 4, put_wait_strategy, get_wait_strategy, fastchan::FetchAddClaim>;
+
+    auto getNext = [](Chan &chan) {
+        int value = 0;
+        while (!chan.get(value)) {
+        }
+        return value;
+    };
+
+    // puts that can give up still do when it's full, as they claim with a CAS
+    if constexpr (put_returns) {
+        Chan chan;
+        for (int i = 0; i < 4; ++i) {
+            assert(chan.put(i));
+        }
+        assert(!chan.put(4));
+        assert(chan.isFull());
+        assert(!chan.try_put_for(4, 1ms));
+        for (int i = 0; i < 4; ++i) {
+            assert(getNext(chan) == i);
+        }
+        assert(chan.put(4));
+        assert(getNext(chan) == 4);
+    } else {
+        // while the others wait their turn
+        Chan chan;
+        for (int i = 0; i < 4; ++i) {
+            chan.put(i);
+        }
+        std::thread producer([&] { chan.put(4); });
+        std::this_thread::sleep_for(1ms);
+        for (int i = 0; i <= 4; ++i) {
+            assert(getNext(chan) == i);
+        }
+        producer.join();
+
+        // a batch bigger than the buffer goes a buffer's worth at a time
+        std::vector<int> batch(iterations);
+        for (int i = 0; i < iterations; ++i) {
+            batch[i] = i;
+        }
+        std::thread batcher([&] { assert(chan.putBatch(batch.data(), batch.size()) == batch.size()); });
+        for (int i = 0; i < iterations; ++i) {
+            assert(getNext(chan) == i);
+        }
+        batcher.join();
+
+        // a put waiting on a full channel when it's closed is dropped, unless it's claimed a slot already, in which case
+        // it's got once the consumer's drained what's before it
+        for (int i = 0; i < 4; ++i) {
+            chan.put(i);
+        }
+        std::thread late([&] { chan.put(4); });
+        std::this_thread::sleep_for(1ms);
+        chan.close();
+        int got = 0;
+        int value = 0;
+        while (true) {
+            if (chan.get(value)) {
+                assert(value == got++);
+            } else if (!get_returns || (chan.isClosed() && chan.isEmpty())) {
+                break;
+            }
+        }
+        // an empty channel's not drained while there's a claim still to commit, which get only knows when it waits
+        late.join();
+        while (chan.get(value)) {
+            assert(value == got++);
+        }
+        assert(got == 4 || got == 5);
+        assert(chan.isEmpty());
+
+        // and those after the close are dropped
+        chan.put(5);
+        assert(!chan.get(value));
+    }
+
+    // producers mixing fetch_add and CAS claims, each one's values arriving in order with none lost
+    {
+        Chan chan;
+        std::vector<std::thread> producers;
+        for (int p = 0; p < 3; ++p) {
+            producers.emplace_back([&, p] {
+                for (int i = 0; i < iterations; ++i) {
+                    auto value = p * iterations + i;
+                    if constexpr (put_returns) {
+                        while (!chan.put(value)) {
+                            std::this_thread::yield();
+                        }
+                    } else if (i % 3 == 0) {
+                        assert(chan.try_put_for(value, 10s));
+                    } else {
+                        chan.put(value);
+                    }
+                }
+            });
+        }
+
+        std::vector<int> last(3, -1);
+        for (int i = 0; i < 3 * iterations; ++i) {
+            auto value = getNext(chan);
+            assert(value % iterations > last[value / iterations]);
+            last[value / iterations] = value % iterations;
+        }
+        for (auto &producer : producers) {
+            producer.join();
+        }
+        for (auto l : last) {
+            assert(l == iterations - 1);
+        }
+        assert(chan.isEmpty());
+    }
+}
+
 template <class put_wait_type, class get_wait_type>
 void testMPSC() {
     testMPSCSingleThreaded_Fill<4, put_wait_type, get_wait_type>();
@@ -203,6 +510,10 @@ void testMPSC() {
     } else {
         testMPSCMultiThreadedMultiProducer<4096, 2, put_wait_type, get_wait_type>();
     }
+
+    testMPSCBatch<4096, put_wait_type, get_wait_type>();
+    testMPSCTimed<4, put_wait_type, get_wait_type>();
+    testMPSCClose<1000, put_wait_type, get_wait_type>();
 }
 
 int main() {
@@ -221,5 +532,12 @@ int main() {
     testMPSC<fastchan::ReturnImmediateStrategy, fastchan::CVWaitStrategy>();
     testMPSC<fastchan::ReturnImmediateStrategy, fastchan::ReturnImmediateStrategy>();
 
+    // the spinning strategies get fewer iterations as they spin out their whole time slice when there's only one core
+    testMPSCFetchAddClaim<100, fastchan::PauseWaitStrategy, fastchan::PauseWaitStrategy>();
+    testMPSCFetchAddClaim<10'000, fastchan::YieldWaitStrategy, fastchan::YieldWaitStrategy>();
+    testMPSCFetchAddClaim<10'000, fastchan::CVWaitStrategy, fastchan::CVWaitStrategy>();
+    testMPSCFetchAddClaim<10'000, fastchan::CVWaitStrategy, fastchan::ReturnImmediateStrategy>();
+    testMPSCFetchAddClaim<10'000, fastchan::ReturnImmediateStrategy, fastchan::YieldWaitStrategy>();
+
     return 0;
 }
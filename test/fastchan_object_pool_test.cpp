@@ -0,0 +1,192 @@
+#include <array>
+#include <atomic>
+#include <cassert>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <mpsc.hpp>
+#include <mutex>
+#include <object_pool.hpp>
+#include <set>
+#include <spsc.hpp>
+#include <thread>
+#include <utility>
+#include <vector>
+
+struct Buffer {
+    uint64_t seq;
+    std::array<char, 240> payload;
+};
+
+// checkAllReturned takes everything in the pool to check nothing leaked or was handed out twice
+template <class Pool>
+void checkAllReturned(Pool &pool) {
+    std::vector<fastchan::Handle<Buffer>> handles;
+    std::set<Buffer *> distinct;
+    for (uint32_t i = 0; i < pool.size(); ++i) {
+        handles.push_back(pool.acquire());
+        assert(handles.back());
+        distinct.insert(handles.back().get());
+    }
+    assert(distinct.size() == pool.size());
+}
+
+void testObjectPoolSingleThreaded() {
+    fastchan::ObjectPool<Buffer, fastchan::ReturnImmediateStrategy> pool(4);
+
+    auto a = pool.acquire();
+    auto b = pool.acquire();
+    assert(a && b && a.get() != b.get());
+    a->seq = 1;
+    b->seq = 2;
+
+    {
+        auto c = pool.acquire();
+        auto d = pool.acquire();
+        assert(c && d);
+        // exhausted
+        assert(!pool.acquire());
+    }
+
+    // c and d went back when they went out of scope
+    auto e = pool.acquire();
+    assert(e);
+
+    // moving hands over ownership, the moved from handle is empty
+    auto moved = std::move(a);
+    assert(!a && moved && moved->seq == 1);
+    moved.reset();
+    assert(!moved);
+
+    // assigning over a handle returns what it held
+    e = std::move(b);
+    assert(e->seq == 2);
+
+    e.reset();
+    checkAllReturned(pool);
+}
+
+template <class Chan>
+void testObjectPoolThroughChannel(std::size_t num_producers) {
+    constexpr uint64_t iterations = 100'000;
+    fastchan::ObjectPool<Buffer> pool(64);
+    Chan chan;
+
+    std::vector<std::thread> producers;
+    for (std::size_t p = 0; p < num_producers; ++p) {
+        producers.emplace_back([&, p] {
+            for (uint64_t i = p; i < iterations; i += num_producers) {
+                auto buffer = pool.acquire();
+                buffer->seq = i;
+                buffer->payload.fill(char(i));
+                chan.put(std::move(buffer));
+            }
+        });
+    }
+
+    std::vector<bool> seen(iterations);
+    for (uint64_t i = 0; i < iterations; ++i) {
+        // the producers can only keep going as these go back to the pool
+        auto buffer = chan.get();
+        assert(buffer);
+        assert(!seen[buffer->seq]);
+        seen[buffer->seq] = true;
+        for (auto c : buffer->payload) {
+            assert(c == char(buffer->seq));
+        }
+    }
+
+    for (auto &producer : producers) {
+        producer.join();
+    }
+    checkAllReturned(pool);
+}
+
+void testFreeListMultiThreaded() {
+    constexpr uint32_t size = 8;
+    constexpr int iterations = 200'000;
+    fastchan::FreeList free_list(size);
+    std::array<std::atomic<int>, size> owners{};
+
+    std::vector<std::thread> threads;
+    for (int t = 0; t < 4; ++t) {
+        threads.emplace_back([&] {
+            for (int i = 0; i < iterations; ++i) {
+                auto index = free_list.pop();
+                if (index == fastchan::FreeList::npos) {
+                    std::this_thread::yield();
+                    continue;
+                }
+                // nobody else holds it
+                assert(owners[index].fetch_add(1) == 0);
+                owners[index].fetch_sub(1);
+                free_list.push(index);
+            }
+        });
+    }
+    for (auto &thread : threads) {
+        thread.join();
+    }
+
+    std::set<uint32_t> distinct;
+    for (uint32_t i = 0; i < size; ++i) {
+        auto index = free_list.pop();
+        assert(index < size);
+        distinct.insert(index);
+    }
+    assert(distinct.size() == size);
+    assert(free_list.pop() == fastchan::FreeList::npos);
+}
+
+// ParkingStrategy parks until it's notified, with no timeout, so an acquire that's never notified never wakes up
+struct ParkingStrategy {
+    template <class Predicate>
+    void wait(Predicate p) {
+        std::unique_lock<std::mutex> lock(mutex_);
+        cv_.wait(lock, p);
+    }
+    void notify() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        cv_.notify_all();
+    }
+
+    std::mutex mutex_;
+    std::condition_variable cv_;
+};
+
+template <class wait_strategy>
+void testReleaseWakesAcquire() {
+    fastchan::ObjectPool<Buffer, wait_strategy> pool(1);
+    auto held = pool.acquire();
+    held->seq = 7;
+
+    // an acquire on the empty pool waits until the object's released, and gets that one
+    std::atomic_bool acquired{false};
+    std::thread waiter([&] {
+        auto handle = pool.acquire();
+        assert(handle && handle->seq == 7);
+        acquired = true;
+    });
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    assert(!acquired);
+    held.reset();
+    waiter.join();
+    assert(acquired);
+
+    checkAllReturned(pool);
+}
+
+int main() {
+    testObjectPoolSingleThreaded();
+    testFreeListMultiThreaded();
+    testReleaseWakesAcquire<ParkingStrategy>();
+    testReleaseWakesAcquire<fastchan::CVWaitStrategy>();
+
+    using BufferHandle = fastchan::Handle<Buffer>;
+    testObjectPoolThroughChannel<fastchan::SPSC<BufferHandle, 1024, fastchan::YieldWaitStrategy, fastchan::YieldWaitStrategy>>(1);
+    testObjectPoolThroughChannel<fastchan::SPSC<BufferHandle, 16, fastchan::CVWaitStrategy, fastchan::CVWaitStrategy>>(1);
+    testObjectPoolThroughChannel<fastchan::MPSC<BufferHandle, 1024, fastchan::YieldWaitStrategy, fastchan::YieldWaitStrategy>>(4);
+    testObjectPoolThroughChannel<fastchan::MPSC<BufferHandle, 16, fastchan::CVWaitStrategy, fastchan::CVWaitStrategy>>(3);
+
+    return 0;
+}
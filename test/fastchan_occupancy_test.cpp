@@ -0,0 +1,183 @@
+#include <array>
+#include <cassert>
+#include <cstdint>
+#include <mpsc.hpp>
+#include <occupancy.hpp>
+#include <spsc.hpp>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+using namespace std::chrono_literals;
+
+void testStats() {
+    fastchan::OccupancyStats stats;
+    stats.capacity = 16;
+    assert(stats.total() == 0);
+    assert(stats.fullFraction() == 0);
+    assert(stats.recommendedCapacity() == 16);
+
+    // 50 empty, 40 at 2 to 3, 9 at 4 to 7 and 1 full
+    stats.samples[0] = 50;
+    stats.samples[2] = 40;
+    stats.samples[3] = 9;
+    stats.samples[5] = 1;
+    assert(stats.total() == 100);
+    assert(stats.fullFraction() == 0.01);
+    assert(stats.aboveFraction(4) == 0.1);
+    assert(stats.aboveFraction(3) == 0.1);
+    assert(stats.aboveFraction(8) == 0.01);
+    assert(stats.percentile(0.5) == 0);
+    assert(stats.percentile(0.9) == 3);
+    assert(stats.percentile(0.99) == 7);
+    assert(stats.percentile(1) == 16);
+
+    // full more often than asked for, so it can only say bigger
+    assert(stats.recommendedCapacity(0.001) == 32);
+    // or the smallest that would have been full no more than asked for
+    assert(stats.recommendedCapacity(0.01) == 8);
+    assert(stats.recommendedCapacity(0.1) == 4);
+    assert(stats.recommendedCapacity(0.5) == 2);
+}
+
+void testWatermark() {
+    fastchan::Monitored<fastchan::SPSC<int, 16, fastchan::ReturnImmediateStrategy, fastchan::ReturnImmediateStrategy>, 1> chan(0.75, 0.25);
+    assert(chan.capacity() == 16);
+    assert(!chan.isAboveWatermark());
+
+    std::vector<bool> changes;
+    chan.onWatermark([&](bool high) { changes.push_back(high); });
+
+    // the watermark goes high at 12 of 16, and only once however full it gets
+    for (int i = 0; i < 11; ++i) {
+        assert(chan.put(i));
+    }
+    assert(!chan.isAboveWatermark() && changes.empty());
+    assert(chan.put(11));
+    assert(chan.isAboveWatermark());
+    assert(changes == std::vector<bool>{true});
+    for (int i = 12; i < 16; ++i) {
+        assert(chan.put(i));
+    }
+    assert(!chan.put(16));
+    assert(changes.size() == 1);
+
+    // and stays high until it's down to 4, which a producer holding back its puts sees by asking
+    for (int i = 0; i < 10; ++i) {
+        assert(chan.get() == i);
+    }
+    assert(chan.put(16));
+    assert(chan.isAboveWatermark());
+    for (int i = 10; i < 14; ++i) {
+        assert(chan.get() == i);
+    }
+    assert(!chan.isAboveWatermark());
+    assert((changes == std::vector<bool>{true, false}));
+    assert(chan.put(17));
+
+    auto stats = chan.occupancy();
+    assert(stats.capacity == 16);
+    assert(stats.total() == 19);  // asking doesn't take a sample
+    assert(stats.high_crossings == 1);
+    // the put that filled it and the one that found it full
+    assert(stats.samples[5] == 2);
+    assert(stats.recommendedCapacity(0.2) == 16);
+    assert(stats.recommendedCapacity(0.01) == 32);
+
+    chan.resetOccupancy();
+    assert(chan.occupancy().total() == 0);
+    assert(chan.occupancy().high_crossings == 0);
+
+    // a channel that never gets past a couple of entries doesn't need 16
+    while (chan.get()) {
+    }
+    for (int i = 0; i < 1000; ++i) {
+        assert(chan.put(i));
+        assert(chan.get() == i);
+    }
+    stats = chan.occupancy();
+    assert(stats.total() == 1000 && stats.samples[1] == 1000);
+    assert(stats.percentile(1) == 1);
+    assert(stats.recommendedCapacity() == 2);
+}
+
+// put is noexcept, so a callback that throws mustn't take the producer down with it
+void testWatermarkThrows() {
+    fastchan::Monitored<fastchan::SPSC<int, 16, fastchan::ReturnImmediateStrategy, fastchan::ReturnImmediateStrategy>, 1> chan(0.75, 0.25);
+    int calls = 0;
+    chan.onWatermark([&](bool) {
+        ++calls;
+        throw std::runtime_error("throttle");
+    });
+
+    for (int i = 0; i < 12; ++i) {
+        assert(chan.put(i));
+    }
+    assert(chan.isAboveWatermark() && calls == 1);
+    for (int i = 0; i < 12; ++i) {
+        assert(chan.get() == i);
+    }
+    assert(!chan.isAboveWatermark() && calls == 2);
+}
+
+template <class put_wait_strategy, class get_wait_strategy>
+void testSampling() {
+    constexpr std::size_t producers = 3;
+    constexpr std::size_t per_producer = 32 * 1'000;
+
+    fastchan::Monitored<fastchan::MPSC<std::size_t, 64, put_wait_strategy, get_wait_strategy>> chan;
+
+    std::vector<std::thread> threads;
+    for (std::size_t p = 0; p < producers; ++p) {
+        threads.emplace_back([&] {
+            for (std::size_t i = 0; i < per_producer; ++i) {
+                chan.put(i);
+            }
+        });
+    }
+    for (std::size_t i = 0; i < producers * per_producer; ++i) {
+        chan.get();
+    }
+    for (auto &t : threads) {
+        t.join();
+    }
+
+    // every 32nd put on each producer, and never more than the capacity
+    auto stats = chan.occupancy();
+    assert(stats.total() == producers * per_producer / 32);
+    for (std::size_t bucket = fastchan::detail::occupancyBucket(64) + 1; bucket < stats.samples.size(); ++bucket) {
+        assert(stats.samples[bucket] == 0);
+    }
+    assert(stats.percentile(1) <= 64);
+}
+
+void testBatchAndTimed() {
+    fastchan::Monitored<fastchan::SPSC<int, 64, fastchan::PauseWaitStrategy, fastchan::PauseWaitStrategy>, 4> chan;
+
+    // a batch counts as many puts as it put, and takes one sample however many it spans
+    std::array<int, 10> values{};
+    assert(chan.putBatch(values.data(), values.size()) == 10);
+    assert(chan.occupancy().total() == 1);
+    assert(chan.occupancy().samples[fastchan::detail::occupancyBucket(10)] == 1);
+
+    // and the timed puts count the same as the others
+    assert(chan.try_put_for(1, 1ms));
+    assert(chan.try_put_until(2, std::chrono::steady_clock::now() + 1ms));
+    chan.put(3);
+    assert(chan.occupancy().total() == 1);
+    chan.put(4);
+    assert(chan.occupancy().total() == 2);
+    // 14 is in the same bucket as 10
+    assert(chan.occupancy().samples[fastchan::detail::occupancyBucket(14)] == 2);
+}
+
+int main() {
+    testStats();
+    testWatermark();
+    testWatermarkThrows();
+    testSampling<fastchan::YieldWaitStrategy, fastchan::YieldWaitStrategy>();
+    testSampling<fastchan::CVWaitStrategy, fastchan::CVWaitStrategy>();
+    testBatchAndTimed();
+
+    return 0;
+}
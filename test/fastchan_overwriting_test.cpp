@@ -0,0 +1,224 @@
+#include <array>
+#include <cassert>
+#include <chrono>
+#include <cstdint>
+#include <optional>
+#include <overwriting.hpp>
+#include <thread>
+#include <utility>
+
+template <class T>
+struct is_optional : std::false_type {};
+template <class T>
+struct is_optional<std::optional<T>> : std::true_type {};
+
+template <class Chan>
+auto getValue(Chan &chan) {
+    auto val = chan.get();
+    if constexpr (is_optional<decltype(val)>::value) {
+        while (!val) val = chan.get();
+        return *val;
+    } else {
+        return val;
+    }
+}
+
+template <int iterations, class Chan>
+void testOverwritingSingleThreaded_NoLap() {
+    Chan chan;
+
+    assert(chan.isEmpty());
+    for (int i = 0; i < iterations; ++i) {
+        chan.put(i);
+        assert(chan.size() == std::size_t(i + 1));
+    }
+
+    for (int i = 0; i < iterations; ++i) {
+        assert(getValue(chan) == i);
+    }
+
+    assert(chan.isEmpty());
+    assert(chan.dropped() == 0);
+}
+
+template <int iterations, class Chan>
+void testOverwritingSingleThreaded_Lap() {
+    Chan chan;
+
+    // the producer never blocks, it overwrites the oldest entries instead
+    for (int i = 0; i < iterations + 3; ++i) {
+        chan.put(i);
+    }
+    assert(chan.size() == iterations);
+
+    // the consumer notices it's been lapped and skips ahead to the oldest entry that survived
+    assert(getValue(chan) == 3);
+    assert(chan.dropped() == 3);
+    for (int i = 4; i < iterations + 3; ++i) {
+        assert(getValue(chan) == i);
+    }
+    assert(chan.isEmpty());
+
+    // lap by more than a full ring
+    for (int i = 0; i < 5 * iterations + 1; ++i) {
+        chan.put(i);
+    }
+    assert(getValue(chan) == 4 * iterations + 1);
+    assert(chan.dropped() == 3 + 4 * iterations + 1);
+}
+
+struct Wide {
+    uint64_t a;
+    uint64_t b;
+    uint64_t c;
+};
+
+template <int iterations, int num_producers, class Chan>
+void testOverwritingMultiThreaded() {
+    Chan chan;
+
+    constexpr uint64_t total_iterations = 1000 * iterations;
+    std::array<std::thread, num_producers> producers;
+    for (int p = 0; p < num_producers; ++p) {
+        producers[p] = std::thread([&, p] {
+            for (uint64_t i = 1; i <= total_iterations; ++i) {
+                uint64_t v = i * num_producers + p;
+                chan.put(Wide{v, v, v});
+            }
+        });
+    }
+
+    std::array<uint64_t, num_producers> last{};
+    uint64_t received = 0;
+    while (received + chan.dropped() < total_iterations * num_producers) {
+        auto val = getValue(chan);
+        // seqlock validation means a torn write is never handed out
+        assert(val.a == val.b && val.b == val.c);
+        // order per producer survives the drops
+        auto p = val.a % num_producers;
+        assert(val.a > last[p]);
+        last[p] = val.a;
+        ++received;
+    }
+
+    for (auto &producer : producers) {
+        producer.join();
+    }
+
+    assert(received + chan.dropped() == total_iterations * num_producers);
+}
+
+// Big takes long enough to copy that producers on a small ring regularly find a slot still being written a lap behind
+struct Big {
+    uint64_t a;
+    std::array<uint64_t, 256> pad;
+    uint64_t b;
+};
+
+template <class get_wait_type>
+void testOverwritingMultiThreaded_MidWrite() {
+    constexpr int num_producers = 3;
+    constexpr uint64_t total_iterations = 20'000;
+    fastchan::OverwritingMPSC<Big, 4, get_wait_type> chan;
+
+    std::array<std::thread, num_producers> producers;
+    for (int p = 0; p < num_producers; ++p) {
+        producers[p] = std::thread([&, p] {
+            Big big{};
+            for (uint64_t i = 1; i <= total_iterations; ++i) {
+                uint64_t v = i * num_producers + p;
+                big.a = big.b = v;
+                big.pad.fill(v);
+                chan.put(big);
+                // size and isEmpty are fine from any thread
+                assert(chan.size() <= 4);
+                (void)chan.isEmpty();
+            }
+        });
+    }
+
+    // a producer that gives up on a slot still being written counts its value as dropped, so everything's either
+    // got or dropped and what's got is whole and in order per producer
+    std::array<uint64_t, num_producers> last{};
+    uint64_t received = 0;
+    while (received + chan.dropped() < total_iterations * num_producers) {
+        auto val = getValue(chan);
+        assert(val.a == val.b && val.pad[0] == val.a && val.pad[255] == val.a);
+        auto p = val.a % num_producers;
+        assert(val.a > last[p]);
+        last[p] = val.a;
+        ++received;
+    }
+
+    for (auto &producer : producers) {
+        producer.join();
+    }
+
+    assert(received + chan.dropped() == total_iterations * num_producers);
+}
+
+// after a close the consumer gets what's left, laps included, and then reports closed rather than wait
+template <class Chan>
+void testOverwritingClose() {
+    constexpr bool get_returns = is_optional<decltype(std::declval<Chan &>().get())>::value;
+
+    {
+        Chan chan;
+        for (int i = 0; i < 6; ++i) {
+            chan.put(i);
+        }
+        chan.close();
+        assert(chan.isClosed());
+
+        // 4 slots, so the two oldest were overwritten
+        int value = -1;
+        for (int i = 2; i < 6; ++i) {
+            assert(chan.get(value) && value == i);
+        }
+        assert(chan.dropped() == 2);
+        assert(!chan.get(value));
+        if constexpr (get_returns) {
+            assert(chan.get() == std::nullopt);
+        } else {
+            assert(chan.get() == 0);
+        }
+    }
+
+    // a consumer waiting on an empty channel is woken by the close
+    if constexpr (!get_returns) {
+        Chan chan;
+        std::thread consumer([&] {
+            int value = 0;
+            assert(!chan.get(value));
+        });
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        chan.close();
+        consumer.join();
+    }
+}
+
+template <class get_wait_type>
+void testOverwriting() {
+    testOverwritingSingleThreaded_NoLap<64, fastchan::OverwritingSPSC<int, 64, get_wait_type>>();
+    testOverwritingSingleThreaded_NoLap<64, fastchan::OverwritingMPSC<int, 64, get_wait_type>>();
+    testOverwritingSingleThreaded_Lap<64, fastchan::OverwritingSPSC<int, 64, get_wait_type>>();
+    testOverwritingSingleThreaded_Lap<64, fastchan::OverwritingMPSC<int, 64, get_wait_type>>();
+
+    testOverwritingMultiThreaded<64, 1, fastchan::OverwritingSPSC<Wide, 64, get_wait_type>>();
+    testOverwritingMultiThreaded<64, 1, fastchan::OverwritingMPSC<Wide, 64, get_wait_type>>();
+    testOverwritingMultiThreaded<64, 3, fastchan::OverwritingMPSC<Wide, 64, get_wait_type>>();
+    testOverwritingMultiThreaded_MidWrite<get_wait_type>();
+
+    testOverwritingClose<fastchan::OverwritingSPSC<int, 4, get_wait_type>>();
+    testOverwritingClose<fastchan::OverwritingMPSC<int, 4, get_wait_type>>();
+}
+
+int main() {
+    testOverwriting<fastchan::PauseWaitStrategy>();
+    testOverwriting<fastchan::YieldWaitStrategy>();
+    testOverwriting<fastchan::NoOpWaitStrategy>();
+    testOverwriting<fastchan::CVWaitStrategy>();
+    testOverwriting<fastchan::ReturnImmediateStrategy>();
+
+    return 0;
+}
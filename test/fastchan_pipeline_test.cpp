@@ -0,0 +1,203 @@
+#include <cassert>
+#include <cstdint>
+#include <mpsc.hpp>
+#include <pipeline.hpp>
+#include <spsc.hpp>
+#include <thread>
+#include <topology.hpp>
+#include <vector>
+
+struct Raw {
+    uint64_t seq;
+    uint32_t px_ticks;
+};
+
+struct Normalized {
+    uint64_t seq;
+    double px;
+};
+
+template <class Chan>
+void putValue(Chan &chan, const typename Chan::value_type &value) {
+    if constexpr (std::is_same<typename Chan::put_t, bool>::value) {
+        while (!chan.put(value)) {
+            std::this_thread::yield();
+        }
+    } else {
+        chan.put(value);
+    }
+}
+
+template <class idle_wait_strategy, class put_wait_strategy, class get_wait_strategy, size_t chan_size>
+void testPipelineChain() {
+    constexpr uint64_t iterations = 100'000;
+    fastchan::Pipeline<idle_wait_strategy> pipeline(fastchan::Topology::fromAffinity(), 64);
+
+    auto &raw = pipeline.template channel<fastchan::SPSC<Raw, chan_size, put_wait_strategy, get_wait_strategy>>();
+    auto &normalized = pipeline.template stage<fastchan::SPSC<Normalized, chan_size, put_wait_strategy, get_wait_strategy>>(
+        "normalize", raw, [](const Raw &r) { return Normalized{r.seq, double(r.px_ticks) / 4}; });
+    auto &enriched = pipeline.template stage<fastchan::MPSC<Normalized, chan_size, put_wait_strategy, get_wait_strategy>>(
+        "enrich", normalized, [](const Normalized &n) { return Normalized{n.seq, n.px + 1}; });
+
+    uint64_t expected = 0;
+    pipeline.sink("publish", enriched, [&](const Normalized &n) {
+        // order is kept end to end
+        assert(n.seq == expected);
+        assert(n.px == double(n.seq % 1000) / 4 + 1);
+        ++expected;
+    });
+
+    pipeline.start();
+    for (uint64_t i = 0; i < iterations; ++i) {
+        putValue(raw, Raw{i, uint32_t(i % 1000)});
+    }
+    pipeline.stop();
+
+    // stop lets everything in flight through
+    assert(expected == iterations);
+
+    auto stats = pipeline.stats();
+    assert(stats.size() == 3);
+    assert(stats[0].name == "normalize" && stats[1].name == "enrich" && stats[2].name == "publish");
+    for (auto &stage : stats) {
+        assert(stage.items == iterations);
+        assert(stage.batches > 0 && stage.batches <= stage.polls);
+        assert(stage.avgBatch() <= 64);
+        assert(stage.occupancy_max <= chan_size);
+        assert(stage.busy_ns <= stage.elapsed_ns);
+        assert(stage.itemsPerSecond() > 0);
+    }
+}
+
+void testPipelineFanIn() {
+    constexpr uint64_t iterations = 50'000;
+    fastchan::Pipeline<> pipeline;
+
+    auto &left = pipeline.channel<fastchan::SPSC<uint64_t, 256>>();
+    auto &right = pipeline.channel<fastchan::SPSC<uint64_t, 256>>();
+    auto &merged = pipeline.channel<fastchan::MPSC<uint64_t, 256>>();
+    pipeline.stage("left", left, merged, [](uint64_t v) { return v * 2; });
+    pipeline.stage("right", right, merged, [](uint64_t v) { return v * 2 + 1; });
+
+    std::vector<uint64_t> seen(2 * iterations);
+    uint64_t batches = 0;
+    pipeline.sink("collect", merged, [&](const uint64_t *data, std::size_t count) {
+        ++batches;
+        for (std::size_t i = 0; i < count; ++i) {
+            ++seen[data[i]];
+        }
+    });
+
+    pipeline.start();
+    std::thread other([&] {
+        for (uint64_t i = 0; i < iterations; ++i) {
+            right.put(i);
+        }
+    });
+    for (uint64_t i = 0; i < iterations; ++i) {
+        left.put(i);
+    }
+    other.join();
+    pipeline.stop();
+
+    for (auto count : seen) {
+        assert(count == 1);
+    }
+    // a drain that wraps around the end of the buffer hands over two ranges, but it's still counted as one batch
+    assert(pipeline.stats()[2].batches <= batches && batches <= 2 * pipeline.stats()[2].batches);
+}
+
+template <class put_wait_strategy, class get_wait_strategy>
+void testPipelineClosedOutput() {
+    constexpr uint64_t iterations = 1'000;
+    constexpr uint64_t got = 100;
+    fastchan::Pipeline<> pipeline(fastchan::Topology{}, 8);
+
+    auto &raw = pipeline.channel<fastchan::SPSC<uint64_t, 64>>();
+    auto &out = pipeline.stage<fastchan::SPSC<uint64_t, 16, put_wait_strategy, get_wait_strategy>>("double", raw, [](uint64_t v) { return v * 2; });
+
+    pipeline.start();
+    std::thread source([&] {
+        for (uint64_t i = 0; i < iterations; ++i) {
+            raw.put(i);
+        }
+    });
+
+    // whatever reads the output gives up part way through, with the stage stuck on it being full
+    uint64_t v;
+    for (uint64_t i = 0; i < got; ++i) {
+        while (!out.get(v)) {
+        }
+        assert(v == i * 2);
+    }
+    out.close();
+
+    // the stage carries on draining its input, so neither the source nor stop get stuck behind it
+    source.join();
+    pipeline.stop();
+
+    uint64_t left = 0;
+    while (out.get(v)) {
+        ++left;
+    }
+    auto stats = pipeline.stats()[0];
+    assert(stats.items == iterations);
+    assert(stats.dropped > 0);
+    assert(got + left + stats.dropped == iterations);
+}
+
+// a pipeline runs once, any start after the first is ignored rather than replacing its running threads
+void testPipelineStartsOnce() {
+    fastchan::Pipeline<> pipeline;
+    auto &raw = pipeline.channel<fastchan::SPSC<uint64_t, 64>>();
+    uint64_t sum = 0;
+    pipeline.sink("sum", raw, [&](uint64_t v) { sum += v; });
+
+    pipeline.start();
+    pipeline.start();
+    for (uint64_t i = 1; i <= 10; ++i) {
+        raw.put(i);
+    }
+    pipeline.stop();
+    assert(sum == 55);
+
+    pipeline.start();
+    raw.put(100);
+    pipeline.stop();
+    assert(sum == 55);
+    assert(pipeline.stats()[0].items == 10);
+}
+
+void testTopology() {
+    fastchan::Topology none;
+    assert(none.coreFor(0) == -1);
+    assert(none.pin(3));
+
+    fastchan::Topology cores{4, 5, 7};
+    assert(cores.coreFor(0) == 4);
+    assert(cores.coreFor(2) == 7);
+    assert(cores.coreFor(3) == 4);
+
+    auto allowed = fastchan::Topology::fromAffinity();
+    assert(!allowed.cores().empty());
+    assert(allowed.pin(0));
+    assert(fastchan::Topology::fromAffinity(allowed.cores().size()).cores().empty());
+}
+
+int main() {
+    testTopology();
+
+    testPipelineChain<fastchan::YieldWaitStrategy, fastchan::YieldWaitStrategy, fastchan::YieldWaitStrategy, 1024>();
+    testPipelineChain<fastchan::PauseWaitStrategy, fastchan::PauseWaitStrategy, fastchan::PauseWaitStrategy, 1024>();
+    testPipelineChain<fastchan::CVWaitStrategy, fastchan::CVWaitStrategy, fastchan::CVWaitStrategy, 64>();
+    testPipelineChain<fastchan::YieldWaitStrategy, fastchan::ReturnImmediateStrategy, fastchan::ReturnImmediateStrategy, 16>();
+
+    testPipelineFanIn();
+    testPipelineStartsOnce();
+
+    testPipelineClosedOutput<fastchan::YieldWaitStrategy, fastchan::YieldWaitStrategy>();
+    testPipelineClosedOutput<fastchan::CVWaitStrategy, fastchan::CVWaitStrategy>();
+    testPipelineClosedOutput<fastchan::ReturnImmediateStrategy, fastchan::ReturnImmediateStrategy>();
+
+    return 0;
+}
@@ -0,0 +1,176 @@
+#include <atomic>
+#include <cassert>
+#include <chrono>
+#include <cstdint>
+#include <optional>
+#include <rpc.hpp>
+#include <thread>
+#include <vector>
+
+using namespace std::chrono_literals;
+
+struct Quote {
+    uint64_t id;
+    uint64_t price;
+};
+
+void testCalls() {
+    fastchan::RPCChannel<uint64_t, Quote, 4> rpc;
+    auto square = [](const uint64_t &id) { return Quote{id, id * id}; };
+
+    // nothing to serve yet
+    assert(rpc.serve(square) == 0);
+
+    auto a = rpc.call(2);
+    auto b = rpc.call(3);
+    assert(rpc.inFlight() == 2);
+    assert(!a.isReady() && !b.isReady());
+    assert(!b.try_get_for(1ms));
+
+    // the responses can be taken in any order, each caller gets its own
+    assert(rpc.serve(square) == 2);
+    assert(a.isReady() && b.isReady());
+    auto qb = b.get();
+    assert(qb.id == 3 && qb.price == 9);
+    auto qa = a.try_get_for(1ms);
+    assert(qa && qa->id == 2 && qa->price == 4);
+    assert(rpc.inFlight() == 0);
+
+    // only max_in_flight calls at a time
+    std::vector<decltype(rpc)::Future> futures;
+    for (uint64_t i = 0; i < 4; ++i) {
+        auto f = rpc.try_call(i);
+        assert(f);
+        futures.push_back(std::move(*f));
+    }
+    assert(!rpc.try_call(4));
+
+    // serve batches up to max
+    assert(rpc.serve(square, 3) == 3);
+    assert(rpc.serve(square, 3) == 1);
+    for (uint64_t i = 0; i < 4; ++i) {
+        assert(futures[i].get().price == i * i);
+    }
+    assert(rpc.inFlight() == 0);
+}
+
+void testAbandoned() {
+    fastchan::RPCChannel<uint64_t, uint64_t, 2> rpc;
+    auto twice = [](const uint64_t &v) { return v * 2; };
+
+    // a future dropped before the reply has its slot freed by the server once it's replied
+    { auto dropped = rpc.call(1); }
+    assert(rpc.inFlight() == 1);
+    assert(rpc.serve(twice) == 1);
+    assert(rpc.inFlight() == 0);
+
+    // and one dropped after the reply frees it itself
+    {
+        auto dropped = rpc.call(2);
+        assert(rpc.serve(twice) == 1);
+        assert(rpc.inFlight() == 1);
+    }
+    assert(rpc.inFlight() == 0);
+
+    // slots go around, moved futures keep theirs
+    for (uint64_t i = 0; i < 10; ++i) {
+        auto f = rpc.call(i);
+        auto g = std::move(f);
+        assert(rpc.serve(twice) == 1);
+        assert(g.get() == i * 2);
+    }
+    assert(rpc.inFlight() == 0);
+}
+
+template <uint64_t iterations, int num_clients, size_t max_in_flight, class request_wait_type, class reply_wait_type>
+void testMultiThreaded() {
+    fastchan::RPCChannel<uint64_t, uint64_t, max_in_flight, request_wait_type, reply_wait_type> rpc;
+
+    std::atomic_bool running{true};
+    std::thread server([&] {
+        while (running) {
+            rpc.try_serve_for([](const uint64_t &v) { return v + 1; }, 1ms);
+        }
+    });
+
+    // every client gets the response to its own request, some with a couple of calls in flight at a time
+    std::vector<std::thread> clients;
+    for (int c = 0; c < num_clients; ++c) {
+        clients.emplace_back([&, c] {
+            for (uint64_t i = 0; i < iterations; ++i) {
+                auto request = uint64_t(c) << 32 | i;
+                if (c % 2 == 0) {
+                    assert(rpc.call(request).get() == request + 1);
+                } else {
+                    auto first = rpc.call(request);
+                    auto second = rpc.call(request + 1);
+                    assert(second.get() == request + 2);
+                    assert(first.get() == request + 1);
+                }
+            }
+        });
+    }
+
+    for (auto &client : clients) {
+        client.join();
+    }
+    running = false;
+    server.join();
+    assert(rpc.inFlight() == 0);
+}
+
+void testValid() {
+    fastchan::RPCChannel<uint64_t, uint64_t, 2> rpc;
+    auto twice = [](const uint64_t &v) { return v * 2; };
+
+    auto a = rpc.call(1);
+    assert(a.valid());
+
+    // moving hands the call over, the future moved from isn't valid any more
+    auto b = std::move(a);
+    assert(!a.valid() && b.valid());
+
+    // a timed get that gives up leaves it valid, taking the response doesn't
+    assert(!b.try_get_for(1ms));
+    assert(b.valid());
+    assert(rpc.serve(twice) == 1);
+    assert(b.get() == 2);
+    assert(!b.valid());
+
+    // assigning a valid one makes it valid again
+    b = rpc.call(2);
+    assert(b.valid());
+    assert(rpc.serve(twice) == 1);
+    assert(b.try_get_for(1ms) == 4);
+    assert(!b.valid());
+    assert(rpc.inFlight() == 0);
+}
+
+void testTimed() {
+    fastchan::RPCChannel<int, int, 2, fastchan::CVWaitStrategy, fastchan::CVWaitStrategy> rpc;
+    auto negate = [](const int &v) { return -v; };
+    assert(rpc.try_serve_for(negate, 1ms) == 0);
+
+    // the server parks until a request arrives, the caller until its response does
+    std::thread server([&] { assert(rpc.try_serve_for(negate, 10s) == 1); });
+    std::this_thread::sleep_for(1ms);
+    auto f = rpc.call(5);
+    assert(f.try_get_for(10s) == -5);
+    server.join();
+}
+
+int main() {
+    testCalls();
+    testAbandoned();
+    testValid();
+
+    // the strategies that only spin get fewer iterations as they spin out their whole time slice when there's only one core
+    testMultiThreaded<200, 2, 4, fastchan::PauseWaitStrategy, fastchan::PauseWaitStrategy>();
+    testMultiThreaded<5'000, 4, 4, fastchan::YieldWaitStrategy, fastchan::YieldWaitStrategy>();
+    testMultiThreaded<5'000, 4, 3, fastchan::CVWaitStrategy, fastchan::CVWaitStrategy>();
+    testMultiThreaded<5'000, 8, 16, fastchan::YieldWaitStrategy, fastchan::CVWaitStrategy>();
+
+    testTimed();
+
+    return 0;
+}
@@ -0,0 +1,111 @@
+#include <array>
+#include <atomic>
+#include <cassert>
+#include <cstdint>
+#include <optional>
+#include <seqlock.hpp>
+#include <thread>
+
+struct Wide {
+    uint64_t a;
+    uint64_t b;
+    uint64_t c;
+    uint64_t d;
+};
+
+template <class wait_strategy>
+void testSeqLockSingleThreaded() {
+    fastchan::SeqLockCell<Wide, wait_strategy> cell;
+
+    assert(cell.version() == 0);
+    auto initial = cell.get();
+    assert(initial.a == 0 && initial.d == 0);
+
+    std::size_t version = 0;
+    if constexpr (std::is_same<wait_strategy, fastchan::ReturnImmediateStrategy>::value) {
+        // nothing new yet
+        assert(cell.getNext(version) == std::nullopt);
+    }
+
+    cell.put(Wide{1, 1, 1, 1});
+    assert(cell.version() == 2);
+
+    auto next = cell.getNext(version);
+    if constexpr (std::is_same<wait_strategy, fastchan::ReturnImmediateStrategy>::value) {
+        assert(next && next->a == 1);
+        assert(cell.getNext(version) == std::nullopt);
+    } else {
+        assert(next.a == 1);
+    }
+    assert(version == 2);
+
+    // readers that fall behind only see the latest value
+    cell.put(Wide{2, 2, 2, 2});
+    cell.put(Wide{3, 3, 3, 3});
+    auto latest = cell.getNext(version);
+    if constexpr (std::is_same<wait_strategy, fastchan::ReturnImmediateStrategy>::value) {
+        assert(latest && latest->a == 3);
+    } else {
+        assert(latest.a == 3);
+    }
+    assert(version == 6);
+}
+
+template <int num_readers, class wait_strategy>
+void testSeqLockMultiThreaded() {
+    constexpr uint64_t iterations = 200'000;
+    fastchan::SeqLockCell<Wide, wait_strategy> cell;
+
+    std::array<std::thread, num_readers> readers;
+    for (int r = 0; r < num_readers; ++r) {
+        readers[r] = std::thread([&] {
+            std::size_t version = 0;
+            uint64_t last = 0;
+            while (last < iterations) {
+                Wide val;
+                if constexpr (std::is_same<wait_strategy, fastchan::ReturnImmediateStrategy>::value) {
+                    auto next = cell.getNext(version);
+                    if (!next) {
+                        continue;
+                    }
+                    val = *next;
+                } else {
+                    val = cell.getNext(version);
+                }
+
+                // a torn read is never handed out and values never go backwards
+                assert(val.a == val.b && val.b == val.c && val.c == val.d);
+                assert(val.a > last);
+                last = val.a;
+            }
+        });
+    }
+
+    for (uint64_t i = 1; i <= iterations; ++i) {
+        cell.put(Wide{i, i, i, i});
+    }
+
+    for (auto &reader : readers) {
+        reader.join();
+    }
+
+    assert(cell.get().a == iterations);
+    assert(cell.version() == 2 * iterations);
+}
+
+template <class wait_type>
+void testSeqLock() {
+    testSeqLockSingleThreaded<wait_type>();
+    testSeqLockMultiThreaded<1, wait_type>();
+    testSeqLockMultiThreaded<4, wait_type>();
+}
+
+int main() {
+    testSeqLock<fastchan::PauseWaitStrategy>();
+    testSeqLock<fastchan::YieldWaitStrategy>();
+    testSeqLock<fastchan::NoOpWaitStrategy>();
+    testSeqLock<fastchan::CVWaitStrategy>();
+    testSeqLock<fastchan::ReturnImmediateStrategy>();
+
+    return 0;
+}
@@ -0,0 +1,259 @@
+#include <array>
+#include <cassert>
+#include <chrono>
+#include <cstdint>
+#include <optional>
+#include <sharded.hpp>
+#include <thread>
+#include <vector>
+
+using namespace std::chrono_literals;
+
+template <class T>
+struct is_optional : std::false_type {};
+template <class T>
+struct is_optional<std::optional<T>> : std::true_type {};
+
+template <class Chan>
+auto getValue(Chan &chan) {
+    auto val = chan.get();
+    if constexpr (is_optional<decltype(val)>::value) {
+        while (!val) val = chan.get();
+        return *val;
+    } else {
+        return val;
+    }
+}
+
+template <class Chan, class T>
+void putValue(Chan &chan, const T &value) {
+    if constexpr (std::is_same<decltype(chan.put(value)), bool>::value) {
+        while (!chan.put(value)) {
+        }
+    } else {
+        chan.put(value);
+    }
+}
+
+struct Event {
+    uint64_t seq;
+    uint64_t producer;
+};
+
+// Pinned puts to whichever shard the test points it at
+struct Pinned {
+    const std::size_t *shard;
+    std::size_t operator()() const noexcept { return *shard; }
+};
+
+void testShards() {
+    std::size_t shard = 0;
+    fastchan::ShardedMPSC<int, 4, 3, fastchan::YieldWaitStrategy, fastchan::YieldWaitStrategy, Pinned> chan(Pinned{&shard});
+    assert(chan.isEmpty());
+
+    // the affinity is taken modulo the shards
+    for (int i = 0; i < 4; ++i) {
+        chan.put(i);
+    }
+    shard = 4;
+    chan.put(10);
+    chan.put(11);
+    shard = 2;
+    chan.put(20);
+    assert(chan.size() == 7);
+
+    // a shard's worth from the first shard before moving on to the next
+    std::vector<int> got;
+    for (int i = 0; i < 7; ++i) {
+        got.push_back(chan.get());
+    }
+    assert((got == std::vector<int>{0, 1, 2, 3, 10, 11, 20}));
+    assert(chan.isEmpty());
+
+    // a shard that keeps filling up only gets a shard's worth at a time
+    shard = 0;
+    for (int i = 0; i < 4; ++i) {
+        chan.put(i);
+    }
+    shard = 1;
+    chan.put(10);
+    assert(chan.get() == 0 && chan.get() == 1);
+    shard = 0;
+    chan.put(4);
+    chan.put(5);
+    got.clear();
+    for (int i = 0; i < 5; ++i) {
+        got.push_back(chan.get());
+    }
+    assert((got == std::vector<int>{2, 3, 10, 4, 5}));
+
+    // getBatch takes everything each shard has in turn, starting from the shard the consumer is on
+    shard = 1;
+    chan.put(10);
+    chan.put(11);
+    shard = 0;
+    chan.put(0);
+    shard = 2;
+    chan.put(20);
+    std::array<int, 8> out{};
+    assert(chan.getBatch(out.data(), 3) == 3);
+    assert(out[0] == 0 && out[1] == 10 && out[2] == 11);
+    assert(chan.getBatch(out.data(), out.size()) == 1);
+    assert(out[0] == 20);
+    assert(chan.getBatch(out.data(), out.size()) == 0);
+
+    std::size_t drained = 0;
+    shard = 1;
+    chan.put(1);
+    assert(chan.drain([&](const int *data, std::size_t count) { drained += count * data[0]; }) == 1);
+    assert(drained == 1 && chan.isEmpty());
+}
+
+void testAffinity() {
+    // a thread always gets the same shard, and threads are spread across them
+    fastchan::ThreadAffinity affinity;
+    auto mine = affinity();
+    assert(affinity() == mine);
+    std::size_t theirs = mine;
+    std::thread([&] { theirs = affinity(); }).join();
+    assert(theirs != mine);
+
+    fastchan::CPUAffinity cpu;
+    assert(cpu() < 1024);
+}
+
+template <uint64_t iterations, int num_producers, size_t num_shards, class affinity_type, class put_wait_type, class get_wait_type>
+void testMultiThreaded() {
+    fastchan::ShardedMPSC<Event, 64, num_shards, put_wait_type, get_wait_type, affinity_type> chan;
+
+    std::vector<std::thread> producers;
+    for (int p = 0; p < num_producers; ++p) {
+        producers.emplace_back([&, p] {
+            for (uint64_t i = 1; i <= iterations; ++i) {
+                putValue(chan, Event{i, uint64_t(p)});
+            }
+        });
+    }
+
+    // with ThreadAffinity every producer's entries arrive in the order it put them, with CPUAffinity they all arrive
+    std::array<uint64_t, num_producers> last{};
+    std::array<uint64_t, num_producers> count{};
+    for (uint64_t i = 0; i < iterations * num_producers; ++i) {
+        auto e = getValue(chan);
+        if constexpr (std::is_same<affinity_type, fastchan::ThreadAffinity>::value) {
+            assert(e.seq == last[e.producer] + 1);
+        }
+        last[e.producer] = e.seq;
+        ++count[e.producer];
+    }
+
+    for (auto &producer : producers) {
+        producer.join();
+    }
+    for (auto c : count) {
+        assert(c == iterations);
+    }
+    assert(chan.isEmpty());
+}
+
+void testTimed() {
+    fastchan::ShardedMPSC<int, 2, 2, fastchan::CVWaitStrategy, fastchan::CVWaitStrategy> chan;
+    assert(!chan.try_get_for(1ms));
+
+    assert(chan.try_put_for(1, 1ms) && chan.try_put_for(2, 1ms));
+    assert(!chan.try_put_for(3, 1ms));
+    assert(chan.try_get_for(1ms) == 1 && chan.try_get_for(1ms) == 2);
+
+    // parks on an empty channel until a producer wakes it up
+    std::thread late([&] {
+        std::this_thread::sleep_for(1ms);
+        chan.put(4);
+    });
+    assert(chan.try_get_for(10s) == 4);
+    late.join();
+}
+
+template <class put_wait_type, class get_wait_type>
+void testClose() {
+    constexpr bool put_returns = std::is_same<put_wait_type, fastchan::ReturnImmediateStrategy>::value;
+    constexpr bool get_returns = std::is_same<get_wait_type, fastchan::ReturnImmediateStrategy>::value;
+
+    {
+        fastchan::ShardedMPSC<int, 4, 2, put_wait_type, get_wait_type> chan;
+        chan.put(1);
+        chan.put(2);
+        chan.close();
+        assert(chan.isClosed());
+
+        // puts fail straight away on every shard
+        if constexpr (put_returns) {
+            assert(!chan.put(3));
+        } else {
+            chan.put(3);
+        }
+        int values[] = {4, 5};
+        assert(chan.putBatch(values, 2) == 0);
+        assert(chan.size() == 2);
+
+        // gets drain what's left and then report closed rather than wait
+        int value = 0;
+        assert(chan.get(value) && value == 1);
+        assert(chan.try_get_for(10s) == 2);
+        assert(!chan.get(value));
+        assert(chan.try_get_for(10s) == std::nullopt);
+        if constexpr (get_returns) {
+            assert(chan.get() == std::nullopt);
+        } else {
+            assert(chan.get() == 0);
+        }
+    }
+
+    // a consumer waiting on empty shards is woken by the close
+    if constexpr (!get_returns) {
+        fastchan::ShardedMPSC<int, 4, 2, put_wait_type, get_wait_type> chan;
+        std::thread consumer([&] {
+            int value = 0;
+            assert(!chan.get(value));
+        });
+        std::this_thread::sleep_for(1ms);
+        chan.close();
+        consumer.join();
+    }
+
+    // as is a producer waiting on a full shard, and what's in it can still be got
+    if constexpr (!put_returns) {
+        fastchan::ShardedMPSC<int, 2, 1, put_wait_type, get_wait_type> chan;
+        chan.put(1);
+        chan.put(2);
+        std::thread producer([&] { chan.put(3); });
+        std::this_thread::sleep_for(1ms);
+        chan.close();
+        producer.join();
+        assert(chan.size() == 2);
+        assert(chan.try_get_for(10s) == 1);
+        assert(chan.try_get_for(10s) == 2);
+        assert(chan.try_get_for(10s) == std::nullopt);
+    }
+}
+
+int main() {
+    testShards();
+    testAffinity();
+
+    // the strategies that only spin get fewer iterations as they spin out their whole time slice when there's only one core
+    testMultiThreaded<2'000, 4, 2, fastchan::ThreadAffinity, fastchan::PauseWaitStrategy, fastchan::PauseWaitStrategy>();
+    testMultiThreaded<20'000, 8, 4, fastchan::ThreadAffinity, fastchan::YieldWaitStrategy, fastchan::YieldWaitStrategy>();
+    testMultiThreaded<20'000, 8, 3, fastchan::ThreadAffinity, fastchan::CVWaitStrategy, fastchan::CVWaitStrategy>();
+    testMultiThreaded<2'000, 4, 4, fastchan::ThreadAffinity, fastchan::ReturnImmediateStrategy, fastchan::ReturnImmediateStrategy>();
+    testMultiThreaded<20'000, 8, 4, fastchan::CPUAffinity, fastchan::YieldWaitStrategy, fastchan::YieldWaitStrategy>();
+    testMultiThreaded<5'000, 32, 8, fastchan::ThreadAffinity, fastchan::YieldWaitStrategy, fastchan::YieldWaitStrategy>();
+
+    testTimed();
+
+    testClose<fastchan::YieldWaitStrategy, fastchan::YieldWaitStrategy>();
+    testClose<fastchan::PauseWaitStrategy, fastchan::PauseWaitStrategy>();
+    testClose<fastchan::CVWaitStrategy, fastchan::CVWaitStrategy>();
+    testClose<fastchan::ReturnImmediateStrategy, fastchan::ReturnImmediateStrategy>();
+
+    return 0;
+}
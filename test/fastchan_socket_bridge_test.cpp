@@ -0,0 +1,258 @@
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <cassert>
+#include <chrono>
+#include <cstdint>
+#include <mpsc.hpp>
+#include <socket_bridge.hpp>
+#include <spsc.hpp>
+#include <thread>
+#include <utility>
+
+struct Msg {
+    uint64_t seq;
+    double px;
+    uint32_t qty;
+};
+
+// a pair of connected UDP sockets on loopback
+std::pair<int, int> udpPair() {
+    int a = ::socket(AF_INET, SOCK_DGRAM, 0);
+    int b = ::socket(AF_INET, SOCK_DGRAM, 0);
+    assert(a >= 0 && b >= 0);
+
+    sockaddr_in addr{};
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    socklen_t len = sizeof(addr);
+
+    sockaddr_in addr_a = addr, addr_b = addr;
+    assert(::bind(a, reinterpret_cast<sockaddr *>(&addr_a), len) == 0);
+    assert(::bind(b, reinterpret_cast<sockaddr *>(&addr_b), len) == 0);
+    assert(::getsockname(a, reinterpret_cast<sockaddr *>(&addr_a), &len) == 0);
+    assert(::getsockname(b, reinterpret_cast<sockaddr *>(&addr_b), &len) == 0);
+    assert(::connect(a, reinterpret_cast<sockaddr *>(&addr_b), len) == 0);
+    assert(::connect(b, reinterpret_cast<sockaddr *>(&addr_a), len) == 0);
+
+    return {a, b};
+}
+
+std::pair<int, int> streamPair() {
+    int fds[2];
+    assert(::socketpair(AF_UNIX, SOCK_STREAM, 0, fds) == 0);
+    return {fds[0], fds[1]};
+}
+
+template <class Out, class In>
+void testBridge(std::pair<int, int> sockets) {
+    constexpr uint64_t iterations = 20'000;
+    Out out;
+    In in;
+    fastchan::SocketSender<Out> sender(out, sockets.first);
+    fastchan::SocketReceiver<In> receiver(in, sockets.second);
+
+    std::thread producer([&] {
+        for (uint64_t i = 0; i < iterations; ++i) {
+            if constexpr (std::is_same<typename Out::put_t, bool>::value) {
+                while (!out.put(Msg{i, double(i) / 2, uint32_t(i)})) {
+                }
+            } else {
+                out.put(Msg{i, double(i) / 2, uint32_t(i)});
+            }
+        }
+    });
+
+    std::thread consumer([&] {
+        for (uint64_t i = 0; i < iterations; ++i) {
+            auto val = in.get();
+            if constexpr (std::is_same<decltype(val), Msg>::value) {
+                assert(val.seq == i && val.px == double(i) / 2 && val.qty == uint32_t(i));
+            } else {
+                while (!val) val = in.get();
+                assert(val->seq == i && val->px == double(i) / 2 && val->qty == uint32_t(i));
+            }
+        }
+    });
+
+    // forward in lockstep so a datagram socket buffer never overflows
+    uint64_t forwarded = 0, received = 0;
+    while (received < iterations) {
+        if (forwarded - received < 64) {
+            forwarded += sender.poll(64);
+        }
+        received += receiver.poll();
+    }
+
+    producer.join();
+    consumer.join();
+
+    assert(sender.stats().messages == iterations);
+    assert(receiver.stats().messages == iterations);
+    assert(receiver.stats().malformed == 0);
+    // batching means far fewer syscalls than messages
+    assert(sender.stats().syscalls < iterations / 2);
+
+    ::close(sockets.first);
+    ::close(sockets.second);
+}
+
+void testStreamPartialRecords() {
+    auto sockets = streamPair();
+    fastchan::SPSC<Msg, 16, fastchan::NoOpWaitStrategy, fastchan::NoOpWaitStrategy> in;
+    fastchan::SocketReceiver<decltype(in)> receiver(in, sockets.second);
+
+    // a record split across two writes only shows up once it's complete
+    Msg msgs[2] = {{1, 1.5, 1}, {2, 2.5, 2}};
+    auto *bytes = reinterpret_cast<const char *>(msgs);
+    assert(::write(sockets.first, bytes, sizeof(Msg) + 3) == sizeof(Msg) + 3);
+    assert(receiver.poll() == 1);
+    assert(receiver.poll() == 0);
+    assert(::write(sockets.first, bytes + sizeof(Msg) + 3, sizeof(Msg) - 3) == sizeof(Msg) - 3);
+    assert(receiver.poll() == 1);
+    assert(in.get().seq == 1);
+    assert(in.get().seq == 2);
+
+    ::close(sockets.first);
+    assert(receiver.poll() == 0);
+    assert(receiver.isClosed());
+    ::close(sockets.second);
+}
+
+void testDatagramBackpressure() {
+    auto sockets = udpPair();
+    fastchan::SPSC<Msg, 4, fastchan::ReturnImmediateStrategy, fastchan::NoOpWaitStrategy> in;
+    fastchan::SocketReceiver<decltype(in)> receiver(in, sockets.second);
+
+    // datagrams of the wrong size are dropped
+    char junk[3] = {};
+    assert(::send(sockets.first, junk, sizeof(junk), 0) == sizeof(junk));
+    for (uint64_t i = 0; i < 6; ++i) {
+        Msg msg{i, 0, 0};
+        assert(::send(sockets.first, &msg, sizeof(msg), 0) == sizeof(msg));
+    }
+
+    // only 4 fit, the rest are held back until there's room rather than dropped
+    uint64_t put = 0;
+    while (put < 4) {
+        put += receiver.poll();
+    }
+    assert(receiver.poll() == 0);
+    assert(receiver.stats().malformed == 1);
+
+    assert(in.get().seq == 0);
+    assert(in.get().seq == 1);
+    assert(receiver.poll() == 2);
+    for (uint64_t i = 2; i < 6; ++i) {
+        assert(in.get().seq == i);
+    }
+
+    ::close(sockets.first);
+    ::close(sockets.second);
+}
+
+void testStreamWrapsInOneSyscall() {
+    auto sockets = streamPair();
+    fastchan::SPSC<Msg, 16, fastchan::NoOpWaitStrategy, fastchan::NoOpWaitStrategy> out;
+    fastchan::SPSC<Msg, 64, fastchan::NoOpWaitStrategy, fastchan::NoOpWaitStrategy> in;
+    fastchan::SocketSender<decltype(out)> sender(out, sockets.first);
+    fastchan::SocketReceiver<decltype(in)> receiver(in, sockets.second);
+
+    uint64_t seq = 0;
+    for (int round = 0; round < 2; ++round) {
+        for (int i = 0; i < 10; ++i) {
+            out.put(Msg{seq++, 0, 0});
+        }
+        // the second round wraps around the end of the buffer and still goes out with one sendmsg
+        auto syscalls = sender.stats().syscalls;
+        assert(sender.poll() == 10);
+        assert(sender.stats().syscalls == syscalls + 1);
+    }
+
+    uint64_t received = 0;
+    while (received < seq) {
+        received += receiver.poll();
+    }
+    for (uint64_t i = 0; i < seq; ++i) {
+        assert(in.get().seq == i);
+    }
+
+    ::close(sockets.first);
+    ::close(sockets.second);
+}
+
+// a stream socket that nobody reads from, with a send buffer a lot smaller than what's in the channel
+template <class wait_strategy>
+void testSenderClose() {
+    auto sockets = streamPair();
+    int flags = ::fcntl(sockets.first, F_GETFL);
+    assert(::fcntl(sockets.first, F_SETFL, flags | O_NONBLOCK) == 0);
+    int buf = 4096;
+    assert(::setsockopt(sockets.first, SOL_SOCKET, SO_SNDBUF, &buf, sizeof(buf)) == 0);
+
+    constexpr uint64_t iterations = 4096;
+    fastchan::SPSC<Msg, iterations, fastchan::NoOpWaitStrategy, fastchan::NoOpWaitStrategy> out;
+    fastchan::SocketSender<decltype(out), wait_strategy> sender(out, sockets.first);
+    for (uint64_t i = 0; i < iterations; ++i) {
+        out.put(Msg{i, 0, 0});
+    }
+
+    // the sender's stuck waiting on the socket until it's closed, after which it gives up on the rest
+    std::size_t sent = 0;
+    std::thread forwarder([&] { sent = sender.poll(); });
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    sender.close();
+    forwarder.join();
+
+    assert(sender.isClosed());
+    assert(sent < iterations && sent == sender.stats().messages);
+    assert(sender.stats().dropped == iterations - sent);
+    assert(out.isEmpty());
+
+    // and forwards nothing from then on
+    out.put(Msg{iterations, 0, 0});
+    assert(sender.poll() == 0);
+
+    // the peer gets every record that was sent, and if the close tore the one after them the stream ends there
+    std::size_t received = 0;
+    bool ended = false;
+    char bytes[4096];
+    while (true) {
+        auto n = ::recv(sockets.second, bytes, sizeof(bytes), MSG_DONTWAIT);
+        if (n <= 0) {
+            ended = n == 0;
+            break;
+        }
+        received += std::size_t(n);
+    }
+    assert(received / sizeof(Msg) == sent);
+    assert(received % sizeof(Msg) == 0 || ended);
+
+    ::close(sockets.first);
+    ::close(sockets.second);
+}
+
+int main() {
+    using fastchan::MPSC;
+    using fastchan::SPSC;
+
+    testBridge<SPSC<Msg, 1024, fastchan::PauseWaitStrategy, fastchan::PauseWaitStrategy>, SPSC<Msg, 1024, fastchan::PauseWaitStrategy, fastchan::PauseWaitStrategy>>(
+        udpPair());
+    testBridge<MPSC<Msg, 1024, fastchan::YieldWaitStrategy, fastchan::YieldWaitStrategy>, MPSC<Msg, 1024, fastchan::YieldWaitStrategy, fastchan::YieldWaitStrategy>>(
+        udpPair());
+    testBridge<SPSC<Msg, 1024, fastchan::CVWaitStrategy, fastchan::CVWaitStrategy>, MPSC<Msg, 1024, fastchan::CVWaitStrategy, fastchan::CVWaitStrategy>>(
+        streamPair());
+    testBridge<MPSC<Msg, 64, fastchan::ReturnImmediateStrategy, fastchan::ReturnImmediateStrategy>,
+               SPSC<Msg, 64, fastchan::ReturnImmediateStrategy, fastchan::ReturnImmediateStrategy>>(streamPair());
+
+    testStreamPartialRecords();
+    testDatagramBackpressure();
+    testStreamWrapsInOneSyscall();
+    testSenderClose<fastchan::CVWaitStrategy>();
+    testSenderClose<fastchan::YieldWaitStrategy>();
+
+    return 0;
+}
@@ -1,8 +1,10 @@
+#include <algorithm>
 #include <cassert>
 #include <iostream>
 #include <optional>
 #include <spsc.hpp>
 #include <thread>
+#include <vector>
 
 using namespace std::chrono_literals;
 
@@ -117,11 +119,233 @@ void testSPSCMultiThreaded() {
     assert(chan.size() == 0);
 }
 
+template <int iterations, class put_wait_strategy, class get_wait_strategy>
+void testSPSCTimed() {
+    constexpr std::size_t chan_size = (iterations / 2) + 1;
+    fastchan::SPSC<int, chan_size, put_wait_strategy, get_wait_strategy> chan;
+
+    // times out on an empty channel
+    auto start = std::chrono::steady_clock::now();
+    assert(chan.try_get_for(200us) == std::nullopt);
+    assert(std::chrono::steady_clock::now() - start >= 200us);
+    assert(chan.try_get_until(std::chrono::steady_clock::now() + 100us) == std::nullopt);
+
+    for (int i = 0; i < iterations; ++i) {
+        assert(chan.try_put_for(i, 200us));
+    }
+
+    // times out on a full channel
+    start = std::chrono::steady_clock::now();
+    assert(!chan.try_put_for(iterations, 200us));
+    assert(std::chrono::steady_clock::now() - start >= 200us);
+    assert(!chan.try_put_until(iterations, std::chrono::system_clock::now() + 100us));
+
+    for (int i = 0; i < iterations; ++i) {
+        assert(chan.try_get_for(200us) == i);
+    }
+    assert(chan.isEmpty());
+
+    // a waiter is released as soon as the other side makes progress
+    std::thread producer([&] {
+        std::this_thread::sleep_for(1ms);
+        assert(chan.try_put_for(42, 10s));
+    });
+    assert(chan.try_get_for(10s) == 42);
+    producer.join();
+}
+
+template <int iterations, class put_wait_strategy, class get_wait_strategy>
+void testSPSCBatch() {
+    constexpr std::size_t chan_size = (iterations / 2) + 1;
+    fastchan::SPSC<int, chan_size, put_wait_strategy, get_wait_strategy> chan;
+
+    std::vector<int> values(iterations * 10);
+    for (std::size_t i = 0; i < values.size(); ++i) {
+        values[i] = int(i);
+    }
+
+    if constexpr (std::is_same<put_wait_strategy, fastchan::ReturnImmediateStrategy>::value) {
+        // only what fits goes in
+        assert(chan.putBatch(values.data(), iterations + 3) == iterations);
+        assert(chan.isFull());
+        assert(chan.putBatch(values.data(), 1) == 0);
+        for (int i = 0; i < iterations; ++i) {
+            if constexpr (std::is_same<get_wait_strategy, fastchan::ReturnImmediateStrategy>::value) {
+                while (!chan.get()) {
+                }
+            } else {
+                chan.get();
+            }
+        }
+    }
+
+    // batches larger than the buffer and wrapping around its end
+    std::thread producer([&] {
+        std::size_t done = 0;
+        while (done < values.size()) {
+            auto batch = std::min<std::size_t>(values.size() - done, 1 + done % (2 * iterations));
+            done += chan.putBatch(values.data() + done, batch);
+        }
+    });
+
+    for (std::size_t i = 0; i < values.size(); ++i) {
+        if constexpr (std::is_same<get_wait_strategy, fastchan::ReturnImmediateStrategy>::value) {
+            auto val = chan.get();
+            while (!val) val = chan.get();
+            assert(*val == int(i));
+        } else {
+            assert(chan.get() == int(i));
+        }
+    }
+
+    producer.join();
+    assert(chan.isEmpty());
+}
+
+template <int iterations, class put_wait_strategy, class get_wait_strategy>
+void testSPSCPeek() {
+    constexpr std::size_t chan_size = (iterations / 2) + 1;
+    fastchan::SPSC<int, chan_size, put_wait_strategy, get_wait_strategy> chan;
+
+    assert(chan.peek() == nullptr);
+    chan.put(1);
+    chan.put(2);
+    // peeking twice finds the same entry, which the next get then hands out
+    assert(chan.peek() != nullptr && *chan.peek() == 1);
+    assert(*chan.peek() == 1 && chan.size() == 2);
+    assert(chan.get() == 1);
+    assert(*chan.peek() == 2 && chan.get() == 2);
+    assert(chan.peek() == nullptr);
+
+    const int total_iterations = IterationsMultiplier * iterations;
+    std::thread producer([&] {
+        for (int i = 0; i < total_iterations; ++i) {
+            if constexpr (std::is_same<put_wait_strategy, fastchan::ReturnImmediateStrategy>::value) {
+                while (!chan.put(i)) {
+                }
+            } else {
+                chan.put(i);
+            }
+        }
+    });
+
+    for (int i = 0; i < total_iterations; ++i) {
+        const int *next = chan.peek();
+        while (next == nullptr) {
+            std::this_thread::yield();
+            next = chan.peek();
+        }
+        assert(*next == i);
+        // a get after a successful peek never comes back empty
+        assert(chan.get() == i);
+    }
+
+    producer.join();
+    assert(chan.peek() == nullptr);
+}
+
+template <int iterations, class put_wait_strategy, class get_wait_strategy>
+void testSPSCClose() {
+    constexpr bool put_returns = std::is_same<put_wait_strategy, fastchan::ReturnImmediateStrategy>::value;
+    constexpr bool get_returns = std::is_same<get_wait_strategy, fastchan::ReturnImmediateStrategy>::value;
+
+    {
+        fastchan::SPSC<int, 4, put_wait_strategy, get_wait_strategy> chan;
+        chan.put(1);
+        chan.put(2);
+        chan.close();
+        assert(chan.isClosed());
+
+        // puts fail straight away
+        if constexpr (put_returns) {
+            assert(!chan.put(3));
+        } else {
+            chan.put(3);
+        }
+        int values[] = {4, 5};
+        assert(chan.putBatch(values, 2) == 0);
+        assert(!chan.try_put_for(6, 10s));
+        assert(chan.size() == 2);
+
+        // gets drain what's left and then report closed rather than wait
+        int value = 0;
+        assert(chan.get(value) && value == 1);
+        assert(chan.try_get_for(10s) == 2);
+        assert(!chan.get(value));
+        assert(chan.try_get_for(10s) == std::nullopt);
+        if constexpr (get_returns) {
+            assert(chan.get() == std::nullopt);
+        } else {
+            assert(chan.get() == 0);
+        }
+    }
+
+    // a consumer waiting on an empty channel is woken by the close
+    if constexpr (!get_returns) {
+        fastchan::SPSC<int, 4, put_wait_strategy, get_wait_strategy> chan;
+        std::thread consumer([&] {
+            int value = 0;
+            assert(!chan.get(value));
+        });
+        std::this_thread::sleep_for(1ms);
+        chan.close();
+        consumer.join();
+    }
+
+    // as is a producer waiting on a full one, and what's in it can still be got
+    if constexpr (!put_returns) {
+        fastchan::SPSC<int, 2, put_wait_strategy, get_wait_strategy> chan;
+        chan.put(1);
+        chan.put(2);
+        std::thread producer([&] { chan.put(3); });
+        std::this_thread::sleep_for(1ms);
+        chan.close();
+        producer.join();
+        assert(chan.size() == 2);
+        assert(chan.try_get_for(10s) == 1);
+        assert(chan.try_get_for(10s) == 2);
+        assert(chan.try_get_for(10s) == std::nullopt);
+    }
+
+    // everything put before the close is got, however the consumer's waiting
+    {
+        fastchan::SPSC<int, 16, put_wait_strategy, get_wait_strategy> chan;
+        std::thread producer([&] {
+            for (int i = 0; i < iterations; ++i) {
+                if constexpr (put_returns) {
+                    while (!chan.put(i)) {
+                    }
+                } else {
+                    chan.put(i);
+                }
+            }
+            chan.close();
+        });
+
+        int expected = 0;
+        int value = 0;
+        while (true) {
+            if (chan.get(value)) {
+                assert(value == expected);
+                ++expected;
+            } else if (!get_returns || (chan.isClosed() && chan.isEmpty())) {
+                break;
+            }
+        }
+        assert(expected == iterations);
+        producer.join();
+    }
+}
+
 template <class put_wait_type, class get_wait_type>
 void testSPSC() {
     testSPSCSingleThreaded_Fill<4096, put_wait_type, get_wait_type>();
     testSPSCSingleThreaded_PutGet<4096, put_wait_type, get_wait_type>();
     testSPSCMultiThreaded<4096, put_wait_type, get_wait_type>();
+    testSPSCBatch<4096, put_wait_type, get_wait_type>();
+    testSPSCPeek<64, put_wait_type, get_wait_type>();
+    testSPSCTimed<4, put_wait_type, get_wait_type>();
+    testSPSCClose<1000, put_wait_type, get_wait_type>();
 }
 
 int main() {
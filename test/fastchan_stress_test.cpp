@@ -0,0 +1,310 @@
+#include <array>
+#include <atomic>
+#include <cassert>
+#include <cstdint>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+// every schedule point in the channels gets a random pause or yield, so the other side runs in the windows between a
+// write and its publish, a claim and its commit, or a check and a wait, far more often than it would otherwise
+namespace stress {
+void schedulePoint() noexcept;
+}
+#define FASTCHAN_SCHEDULE_POINT() stress::schedulePoint()
+
+#include <mpsc.hpp>
+#include <spsc.hpp>
+#include <variant.hpp>
+
+using namespace std::chrono_literals;
+
+namespace stress {
+
+std::atomic<uint64_t> next_seed{0x9e3779b97f4a7c15};
+
+// random is an xorshift with its own seed on every thread, cheap enough not to drown out what it's shaking up
+uint64_t random() noexcept {
+    thread_local uint64_t state = next_seed.fetch_add(0x9e3779b97f4a7c15, std::memory_order_relaxed) | 1;
+    state ^= state << 13;
+    state ^= state >> 7;
+    state ^= state << 17;
+    return state;
+}
+
+// schedulePoint does nothing most of the time, a few pauses some of the time and gives up the core now and then
+void schedulePoint() noexcept {
+    auto roll = random() % 64;
+    if (roll < 40) {
+        return;
+    }
+    if (roll < 62) {
+        for (auto i = roll - 40; i > 0; --i) {
+            fastchan::cpu_pause();
+        }
+        return;
+    }
+    std::this_thread::yield();
+}
+
+}  // namespace stress
+
+// Entry is spread over several words, all derived from which producer put it and its sequence number, so an entry
+// that's read before it's been fully written, or after it's been overwritten, doesn't check out
+struct Entry {
+    uint64_t producer;
+    uint64_t seq;
+    std::array<uint64_t, 4> check;
+
+    static Entry make(uint64_t producer, uint64_t seq) {
+        Entry e{producer, seq, {}};
+        for (std::size_t i = 0; i < e.check.size(); ++i) {
+            e.check[i] = (producer << 48) ^ (seq * 0x9e3779b97f4a7c15) ^ i;
+        }
+        return e;
+    }
+
+    bool valid() const { return *this == make(producer, seq); }
+
+    bool operator==(const Entry &other) const { return producer == other.producer && seq == other.seq && check == other.check; }
+};
+
+// Checker takes every entry the consumer gets, and asserts each producer's come in the order they were put with
+// none missed or repeated
+struct Checker {
+    std::vector<uint64_t> next;
+
+    explicit Checker(std::size_t producers) : next(producers, 0) {}
+
+    void operator()(const Entry &e) {
+        assert(e.valid());
+        assert(e.producer < next.size());
+        assert(e.seq == next[e.producer]);
+        ++next[e.producer];
+    }
+
+    void done(uint64_t per_producer) const {
+        for (auto n : next) {
+            assert(n == per_producer);
+        }
+    }
+};
+
+// produce puts per_producer entries, picking between put, putBatch and try_put_for at random so their paths interleave
+// with each other as well as with the consumer
+template <class Chan>
+void produce(Chan &chan, uint64_t producer, uint64_t per_producer) {
+    constexpr bool put_returns = std::is_same<typename Chan::put_t, bool>::value;
+
+    uint64_t seq = 0;
+    while (seq < per_producer) {
+        switch (stress::random() % 4) {
+            case 0: {
+                Entry batch[5];
+                std::size_t n = 0;
+                for (; n < 5 && seq + n < per_producer; ++n) {
+                    batch[n] = Entry::make(producer, seq + n);
+                }
+                std::size_t done = 0;
+                while ((done += chan.putBatch(batch + done, n - done)) < n) {
+                    std::this_thread::yield();
+                }
+                seq += n;
+                break;
+            }
+            case 1:
+                assert(chan.try_put_for(Entry::make(producer, seq), 10s));
+                ++seq;
+                break;
+            default:
+                if constexpr (put_returns) {
+                    while (!chan.put(Entry::make(producer, seq))) {
+                        std::this_thread::yield();
+                    }
+                } else {
+                    chan.put(Entry::make(producer, seq));
+                }
+                ++seq;
+                break;
+        }
+    }
+}
+
+// consume gets everything until the channel's closed and drained, picking between get, getBatch and try_get_for at
+// random. The gets that don't wait have nothing to get now and then, and only stop once the channel's closed.
+template <class Chan>
+void consume(Chan &chan, Checker &check) {
+    while (true) {
+        std::size_t got = 0;
+        switch (stress::random() % 4) {
+            case 0: {
+                Entry batch[7];
+                got = chan.getBatch(batch, 7);
+                for (std::size_t i = 0; i < got; ++i) {
+                    check(batch[i]);
+                }
+                break;
+            }
+            case 1:
+                if (auto e = chan.try_get_for(1ms)) {
+                    check(*e);
+                    got = 1;
+                }
+                break;
+            default: {
+                Entry e;
+                if (chan.get(e)) {
+                    check(e);
+                    got = 1;
+                }
+                break;
+            }
+        }
+        if (got == 0) {
+            if (chan.isClosed() && chan.isEmpty()) {
+                break;
+            }
+            std::this_thread::yield();
+        }
+    }
+}
+
+template <uint64_t per_producer, class put_wait_strategy, class get_wait_strategy>
+void testSPSC() {
+    for (int round = 0; round < 4; ++round) {
+        fastchan::SPSC<Entry, 8, put_wait_strategy, get_wait_strategy> chan;
+        Checker check(1);
+
+        std::thread producer([&] {
+            produce(chan, 0, per_producer);
+            chan.close();
+        });
+        consume(chan, check);
+        producer.join();
+
+        check.done(per_producer);
+    }
+}
+
+template <uint64_t per_producer, class put_wait_strategy, class get_wait_strategy, class claim_strategy = fastchan::CASClaim>
+void testMPSC() {
+    constexpr std::size_t producers = 3;
+
+    for (int round = 0; round < 4; ++round) {
+        fastchan::MPSC<Entry, 8, put_wait_strategy, get_wait_strategy, claim_strategy> chan;
+        Checker check(producers);
+
+        std::vector<std::thread> threads;
+        for (std::size_t i = 0; i < producers; ++i) {
+            threads.emplace_back([&, i] { produce(chan, i, per_producer); });
+        }
+        std::thread consumer([&] { consume(chan, check); });
+        for (auto &t : threads) {
+            t.join();
+        }
+        chan.close();
+        consumer.join();
+
+        check.done(per_producer);
+    }
+}
+
+struct Small {
+    uint64_t seq;
+};
+
+struct Large {
+    Entry entry;
+    std::array<uint64_t, 8> more;
+};
+
+// VariantSPSC gets a random mix of small and large records, so where the padding falls moves around from lap to lap
+template <uint64_t count, class put_wait_strategy, class get_wait_strategy>
+void testVariantSPSC() {
+    constexpr bool put_returns = std::is_same<put_wait_strategy, fastchan::ReturnImmediateStrategy>::value;
+
+    for (int round = 0; round < 4; ++round) {
+        fastchan::VariantSPSC<std::variant<Small, Large>, 512, put_wait_strategy, get_wait_strategy> chan;
+
+        std::thread producer([&] {
+            for (uint64_t seq = 0; seq < count; ++seq) {
+                auto put = [&](auto &&msg) {
+                    if constexpr (put_returns) {
+                        while (!chan.put(msg)) {
+                            std::this_thread::yield();
+                        }
+                    } else {
+                        chan.put(msg);
+                    }
+                };
+                if (stress::random() % 3 == 0) {
+                    Large large{Entry::make(0, seq), {}};
+                    large.more.fill(large.entry.check[0] + large.entry.check[1] + large.entry.check[2] + large.entry.check[3]);
+                    put(large);
+                } else {
+                    put(Small{seq});
+                }
+            }
+            chan.close();
+        });
+
+        uint64_t expected = 0;
+        auto check = [&](auto &m) {
+            using M = std::decay_t<decltype(m)>;
+            if constexpr (std::is_same<M, Small>::value) {
+                assert(m.seq == expected);
+            } else {
+                assert(m.entry.valid() && m.entry.seq == expected);
+                for (auto word : m.more) {
+                    assert(word == m.entry.check[0] + m.entry.check[1] + m.entry.check[2] + m.entry.check[3]);
+                }
+            }
+            ++expected;
+        };
+        while (true) {
+            std::size_t got = stress::random() % 2 == 0 ? chan.drain(check, 5) : chan.get(check);
+            if (got == 0) {
+                if (chan.isClosed() && chan.isEmpty()) {
+                    break;
+                }
+                std::this_thread::yield();
+            }
+        }
+        producer.join();
+
+        assert(expected == count);
+    }
+}
+
+template <uint64_t count, uint64_t mpsc_count, class put_wait_strategy, class get_wait_strategy>
+void testAll() {
+    testSPSC<count, put_wait_strategy, get_wait_strategy>();
+    testMPSC<mpsc_count, put_wait_strategy, get_wait_strategy>();
+    testVariantSPSC<count, put_wait_strategy, get_wait_strategy>();
+}
+
+int main() {
+    // the strategies that only spin get fewer entries as they spin out their whole time slice when there's only one core.
+    // That goes for ReturnImmediateStrategy puts on the MPSC too, as a producer waits its turn to commit by spinning,
+    // and the tests yield rather than spin when a ReturnImmediateStrategy put has to try again for the same reason.
+    testAll<500, 100, fastchan::PauseWaitStrategy, fastchan::PauseWaitStrategy>();
+    testAll<10'000, 10'000, fastchan::YieldWaitStrategy, fastchan::YieldWaitStrategy>();
+    testAll<10'000, 10'000, fastchan::CVWaitStrategy, fastchan::CVWaitStrategy>();
+    testAll<10'000, 10'000, fastchan::SpinCVWaitStrategy<64>, fastchan::SpinCVWaitStrategy<64>>();
+    testAll<10'000, 10'000, fastchan::CVWaitStrategy, fastchan::YieldWaitStrategy>();
+    testAll<500, 100, fastchan::WFEWaitStrategy, fastchan::WFEWaitStrategy>();
+    testAll<500, 100, fastchan::UMWaitStrategy<>, fastchan::TPauseWaitStrategy<>>();
+    testAll<10'000, 200, fastchan::ReturnImmediateStrategy, fastchan::CVWaitStrategy>();
+    testAll<10'000, 10'000, fastchan::YieldWaitStrategy, fastchan::ReturnImmediateStrategy>();
+    testAll<10'000, 200, fastchan::ReturnImmediateStrategy, fastchan::ReturnImmediateStrategy>();
+
+    // with FetchAddClaim put and putBatch claim with a fetch_add, and past the end of the buffer, while try_put_for
+    // claims with a CAS on the same index
+    testMPSC<100, fastchan::PauseWaitStrategy, fastchan::PauseWaitStrategy, fastchan::FetchAddClaim>();
+    testMPSC<10'000, fastchan::YieldWaitStrategy, fastchan::YieldWaitStrategy, fastchan::FetchAddClaim>();
+    testMPSC<10'000, fastchan::CVWaitStrategy, fastchan::CVWaitStrategy, fastchan::FetchAddClaim>();
+    testMPSC<10'000, fastchan::SpinCVWaitStrategy<64>, fastchan::YieldWaitStrategy, fastchan::FetchAddClaim>();
+    testMPSC<200, fastchan::ReturnImmediateStrategy, fastchan::CVWaitStrategy, fastchan::FetchAddClaim>();
+
+    return 0;
+}
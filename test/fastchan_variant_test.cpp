@@ -0,0 +1,226 @@
+#include <array>
+#include <atomic>
+#include <cassert>
+#include <cstdint>
+#include <string>
+#include <thread>
+#include <type_traits>
+#include <variant.hpp>
+#include <variant>
+
+using namespace std::chrono_literals;
+
+template <class... Fs>
+struct Overloaded : Fs... {
+    using Fs::operator()...;
+};
+template <class... Fs>
+Overloaded(Fs...) -> Overloaded<Fs...>;
+
+struct Heartbeat {
+    uint64_t seq;
+};
+
+struct Trade {
+    uint64_t seq;
+    double price;
+    uint32_t qty;
+};
+
+struct Snapshot {
+    uint64_t seq;
+    std::array<double, 20> levels;
+};
+
+// Counted keeps track of how many are alive, to check the channel destroys every message it constructs
+struct Counted {
+    static inline std::atomic<int> alive = 0;
+    uint64_t seq;
+    std::string name;
+
+    Counted(uint64_t s, std::string n) : seq(s), name(std::move(n)) { ++alive; }
+    Counted(const Counted &other) : seq(other.seq), name(other.name) { ++alive; }
+    ~Counted() { --alive; }
+};
+
+using Messages = std::variant<Heartbeat, Trade, Snapshot, Counted>;
+
+// putMessage puts the seq'th of a mix that has every type in it, tailing off towards the big ones
+template <class Chan>
+void putMessage(Chan &chan, uint64_t seq) {
+    switch (seq % 7) {
+        case 0:
+        case 1:
+        case 2:
+            chan.put(Trade{seq, double(seq) / 2, uint32_t(seq)});
+            break;
+        case 3:
+        case 4:
+            chan.put(Heartbeat{seq});
+            break;
+        case 5:
+            chan.template emplace<Counted>(seq, std::to_string(seq));
+            break;
+        default:
+            Snapshot snapshot{seq, {}};
+            snapshot.levels[19] = double(seq);
+            chan.put(snapshot);
+            break;
+    }
+}
+
+// checker returns a visitor that checks each message is the next in the sequence putMessage makes
+auto checker(uint64_t &expected) {
+    return Overloaded{
+        [&](Heartbeat &m) {
+            assert(m.seq == expected && (expected % 7 == 3 || expected % 7 == 4));
+            ++expected;
+        },
+        [&](Trade &m) {
+            assert(m.seq == expected && expected % 7 <= 2 && m.price == double(expected) / 2 && m.qty == uint32_t(expected));
+            ++expected;
+        },
+        [&](Snapshot &m) {
+            assert(m.seq == expected && expected % 7 == 6 && m.levels[19] == double(expected));
+            ++expected;
+        },
+        [&](Counted &m) {
+            assert(m.seq == expected && expected % 7 == 5 && m.name == std::to_string(expected));
+            ++expected;
+        },
+    };
+}
+
+void testSingleThreaded() {
+    fastchan::VariantSPSC<Messages, 4096, fastchan::ReturnImmediateStrategy, fastchan::ReturnImmediateStrategy> chan;
+    assert(chan.isEmpty());
+
+    uint64_t expected = 0;
+    assert(!chan.get(checker(expected)));
+
+    // records are only as big as their message, so many more small ones fit than big ones
+    std::size_t heartbeats = 0;
+    while (chan.put(Heartbeat{heartbeats})) {
+        ++heartbeats;
+    }
+    assert(chan.bytes() == 4096);
+    std::size_t got = 0;
+    assert(chan.drain([&](auto &m) {
+        using M = std::decay_t<decltype(m)>;
+        assert((std::is_same<M, Heartbeat>::value));
+        if constexpr (std::is_same<M, Heartbeat>::value) {
+            assert(m.seq == got);
+        }
+        ++got;
+    }) == heartbeats);
+    assert(chan.isEmpty());
+
+    std::size_t snapshots = 0;
+    while (chan.put(Snapshot{snapshots, {}})) {
+        ++snapshots;
+    }
+    assert(snapshots < heartbeats / 8);
+    assert(chan.drain([](auto &) {}, 2) == 2);
+    assert(chan.drain([](auto &) {}) == snapshots - 2);
+
+    // round and round the ring, padding out the end whenever a record doesn't fit before it
+    for (uint64_t seq = 0; seq < 10'000; ++seq) {
+        putMessage(chan, seq);
+        if (seq % 3 == 2) {
+            while (chan.get(checker(expected))) {
+            }
+        }
+    }
+    while (chan.get(checker(expected))) {
+    }
+    assert(expected == 10'000);
+    assert(chan.isEmpty());
+    assert(Counted::alive == 0);
+}
+
+void testDestroys() {
+    {
+        fastchan::VariantSPSC<Messages, 1024> chan;
+        chan.emplace<Counted>(1, "one");
+        chan.put(Counted(2, "two"));
+        chan.put(Heartbeat{3});
+        assert(Counted::alive == 2);
+
+        // a message is destroyed once it's been visited, the visitor can move out of it first
+        std::string name;
+        assert(chan.get(Overloaded{[&](Counted &m) { name = std::move(m.name); }, [](auto &) { assert(false); }}));
+        assert(name == "one");
+        assert(Counted::alive == 1);
+    }
+
+    // and whatever's left along with the channel
+    assert(Counted::alive == 0);
+}
+
+template <class put_wait_strategy, class get_wait_strategy>
+void testClose() {
+    fastchan::VariantSPSC<Messages, 1024, put_wait_strategy, get_wait_strategy> chan;
+    putMessage(chan, 0);
+    chan.close();
+    assert(chan.isClosed());
+
+    if constexpr (std::is_same<put_wait_strategy, fastchan::ReturnImmediateStrategy>::value) {
+        assert(!chan.put(Heartbeat{1}));
+    } else {
+        chan.put(Heartbeat{1});
+    }
+
+    // what was put before the close can still be got, and nothing after it
+    uint64_t expected = 0;
+    assert(chan.get(checker(expected)));
+    assert(!chan.get(checker(expected)));
+    assert(!chan.try_get_for(checker(expected), 10s));
+    assert(expected == 1);
+
+    // a consumer waiting for a message is woken by the close
+    if constexpr (!std::is_same<get_wait_strategy, fastchan::ReturnImmediateStrategy>::value) {
+        fastchan::VariantSPSC<Messages, 1024, put_wait_strategy, get_wait_strategy> waiting;
+        std::thread consumer([&] { assert(!waiting.get([](auto &) {})); });
+        std::this_thread::sleep_for(1ms);
+        waiting.close();
+        consumer.join();
+    }
+}
+
+template <uint64_t iterations, class put_wait_strategy, class get_wait_strategy>
+void testMultiThreaded() {
+    fastchan::VariantSPSC<Messages, 1024, put_wait_strategy, get_wait_strategy> chan;
+
+    std::thread producer([&] {
+        for (uint64_t seq = 0; seq < iterations; ++seq) {
+            putMessage(chan, seq);
+        }
+        chan.close();
+    });
+
+    uint64_t expected = 0;
+    auto check = checker(expected);
+    while (chan.get(check)) {
+    }
+    assert(expected == iterations);
+
+    producer.join();
+    assert(Counted::alive == 0);
+}
+
+int main() {
+    testSingleThreaded();
+    testDestroys();
+
+    testClose<fastchan::PauseWaitStrategy, fastchan::PauseWaitStrategy>();
+    testClose<fastchan::ReturnImmediateStrategy, fastchan::YieldWaitStrategy>();
+    testClose<fastchan::CVWaitStrategy, fastchan::CVWaitStrategy>();
+
+    // the strategies that only spin get fewer iterations as they spin out their whole time slice when there's only one core
+    testMultiThreaded<10'000, fastchan::PauseWaitStrategy, fastchan::PauseWaitStrategy>();
+    testMultiThreaded<100'000, fastchan::YieldWaitStrategy, fastchan::YieldWaitStrategy>();
+    testMultiThreaded<100'000, fastchan::CVWaitStrategy, fastchan::CVWaitStrategy>();
+    testMultiThreaded<100'000, fastchan::YieldWaitStrategy, fastchan::CVWaitStrategy>();
+
+    return 0;
+}
@@ -0,0 +1,321 @@
+#include <atomic>
+#include <cassert>
+#include <chrono>
+#include <cstdint>
+#include <mpsc.hpp>
+#include <optional>
+#include <spsc.hpp>
+#include <thread>
+#include <type_traits>
+#include <vector>
+#include <wait_strategy.hpp>
+
+using namespace std::chrono_literals;
+
+using fastchan::WaitStrategyTraits;
+
+static_assert(WaitStrategyTraits<fastchan::ReturnImmediateStrategy>::returns_immediately);
+static_assert(!WaitStrategyTraits<fastchan::ReturnImmediateStrategy>::needs_notify);
+static_assert(!WaitStrategyTraits<fastchan::PauseWaitStrategy>::needs_notify && !WaitStrategyTraits<fastchan::PauseWaitStrategy>::can_block);
+static_assert(!WaitStrategyTraits<fastchan::YieldWaitStrategy>::needs_notify && !WaitStrategyTraits<fastchan::YieldWaitStrategy>::can_block);
+static_assert(!WaitStrategyTraits<fastchan::NoOpWaitStrategy>::returns_immediately);
+static_assert(WaitStrategyTraits<fastchan::CVWaitStrategy>::needs_notify && WaitStrategyTraits<fastchan::CVWaitStrategy>::can_block);
+static_assert(WaitStrategyTraits<fastchan::CVWaitStrategy>::supports_timeout && WaitStrategyTraits<fastchan::CVWaitStrategy>::spin_budget == 0);
+static_assert(WaitStrategyTraits<fastchan::SpinCVWaitStrategy<128>>::spin_budget == 128);
+static_assert(!WaitStrategyTraits<fastchan::WFEWaitStrategy>::needs_notify && !WaitStrategyTraits<fastchan::WFEWaitStrategy>::can_block);
+static_assert(WaitStrategyTraits<fastchan::WFEWaitStrategy>::watches_index && !WaitStrategyTraits<fastchan::CVWaitStrategy>::watches_index);
+static_assert(!WaitStrategyTraits<fastchan::UMWaitStrategy<>>::needs_notify && !WaitStrategyTraits<fastchan::UMWaitStrategy<>>::can_block);
+static_assert(WaitStrategyTraits<fastchan::UMWaitStrategy<>>::watches_index && !WaitStrategyTraits<fastchan::TPauseWaitStrategy<>>::watches_index);
+static_assert(!WaitStrategyTraits<fastchan::TPauseWaitStrategy<>>::needs_notify && !WaitStrategyTraits<fastchan::TPauseWaitStrategy<>>::can_block);
+
+// MinimalStrategy only has wait and notify, so it gets the conservative defaults
+struct MinimalStrategy {
+    static inline std::atomic<uint64_t> notifies{0};
+
+    template <class Predicate>
+    void wait(Predicate p) {
+        while (!p()) {
+            std::this_thread::yield();
+        }
+    }
+    void notify() { notifies.fetch_add(1, std::memory_order_relaxed); }
+};
+
+static_assert(WaitStrategyTraits<MinimalStrategy>::needs_notify && WaitStrategyTraits<MinimalStrategy>::can_block);
+static_assert(!WaitStrategyTraits<MinimalStrategy>::supports_timeout && !WaitStrategyTraits<MinimalStrategy>::returns_immediately);
+
+// SilentSpinStrategy says it doesn't need notify, so the channels must never call it
+struct SilentSpinStrategy {
+    static constexpr bool needs_notify = false;
+    static constexpr bool can_block = false;
+    static inline std::atomic<uint64_t> notifies{0};
+
+    template <class Predicate>
+    void wait(Predicate) {
+        std::this_thread::yield();
+    }
+    void notify() { notifies.fetch_add(1, std::memory_order_relaxed); }
+};
+
+// TryStrategy behaves like ReturnImmediateStrategy
+struct TryStrategy {
+    static constexpr bool needs_notify = false;
+    static constexpr bool can_block = false;
+    static constexpr bool returns_immediately = true;
+
+    template <class Predicate>
+    void wait(Predicate) {}
+    void notify() {}
+};
+
+// WatchingStrategy yields like SilentSpinStrategy, but counts the waits that come with an index to watch
+struct WatchingStrategy : SilentSpinStrategy {
+    static inline std::atomic<uint64_t> watched_waits{0};
+
+    template <class Predicate>
+    void wait_on(Predicate, const void *watched) {
+        assert(watched != nullptr);
+        watched_waits.fetch_add(1, std::memory_order_relaxed);
+        std::this_thread::yield();
+    }
+};
+
+static_assert(WaitStrategyTraits<WatchingStrategy>::watches_index);
+
+// DerivedBlockingStrategy comes from the interface but has no wait_until of its own, which it doesn't inherit either,
+// so the timed put/get refuse to compile with it rather than spin until the deadline
+struct DerivedBlockingStrategy : fastchan::WaitStrategyInterface<DerivedBlockingStrategy> {
+    template <class Predicate>
+    void wait(Predicate p) {
+        while (!p()) {
+            std::this_thread::yield();
+        }
+    }
+};
+
+static_assert(!WaitStrategyTraits<DerivedBlockingStrategy>::supports_timeout && WaitStrategyTraits<DerivedBlockingStrategy>::can_block);
+
+// DerivedSpinStrategy is the same for one that can't block, whose timed put/get wait on it until the deadline
+struct DerivedSpinStrategy : fastchan::WaitStrategyInterface<DerivedSpinStrategy> {
+    static constexpr bool needs_notify = false;
+    static constexpr bool can_block = false;
+    static inline std::atomic<uint64_t> waits{0};
+
+    template <class Predicate>
+    void wait(Predicate) {
+        waits.fetch_add(1, std::memory_order_relaxed);
+        std::this_thread::yield();
+    }
+};
+
+static_assert(!WaitStrategyTraits<DerivedSpinStrategy>::supports_timeout);
+
+static_assert(std::is_same<fastchan::SPSC<int, 4, TryStrategy, TryStrategy>::put_t, bool>::value);
+static_assert(std::is_same<fastchan::SPSC<int, 4, TryStrategy, TryStrategy>::get_t, std::optional<int>>::value);
+static_assert(std::is_same<fastchan::MPSC<int, 4, MinimalStrategy, MinimalStrategy>::get_t, int>::value);
+
+template <class Chan>
+void testThreaded(std::size_t num_producers, uint64_t iterations = 100'000) {
+    Chan chan;
+
+    std::vector<std::thread> producers;
+    for (std::size_t p = 0; p < num_producers; ++p) {
+        producers.emplace_back([&, p] {
+            for (uint64_t i = p; i < iterations; i += num_producers) {
+                chan.put(i);
+            }
+        });
+    }
+
+    std::vector<bool> seen(iterations);
+    for (uint64_t i = 0; i < iterations; ++i) {
+        auto val = chan.get();
+        assert(!seen[val]);
+        seen[val] = true;
+    }
+
+    for (auto &producer : producers) {
+        producer.join();
+    }
+    assert(chan.isEmpty());
+}
+
+void testNotifyCompiledOut() {
+    testThreaded<fastchan::SPSC<uint64_t, 16, SilentSpinStrategy, SilentSpinStrategy>>(1);
+    testThreaded<fastchan::MPSC<uint64_t, 16, SilentSpinStrategy, SilentSpinStrategy>>(2);
+    assert(SilentSpinStrategy::notifies == 0);
+
+    testThreaded<fastchan::SPSC<uint64_t, 16, MinimalStrategy, MinimalStrategy>>(1);
+    testThreaded<fastchan::MPSC<uint64_t, 16, MinimalStrategy, MinimalStrategy>>(2);
+    assert(MinimalStrategy::notifies > 0);
+}
+
+void testCustomReturnImmediate() {
+    fastchan::SPSC<int, 2, TryStrategy, TryStrategy> chan;
+    assert(!chan.get());
+    assert(chan.put(1) && chan.put(2));
+    assert(!chan.put(3));
+    // as with ReturnImmediateStrategy a get may come back empty once while it refreshes its view of the producer
+    for (int i = 1; i <= 2; ++i) {
+        auto val = chan.get();
+        while (!val) val = chan.get();
+        assert(*val == i);
+    }
+    assert(!chan.get());
+}
+
+void testTimedWithoutWaitUntil() {
+    // a strategy that can't block gets by without wait_until, the timed calls spin on it until the deadline
+    fastchan::SPSC<int, 2, SilentSpinStrategy, SilentSpinStrategy> chan;
+    assert(!chan.try_get_for(1ms));
+    assert(chan.try_put_for(1, 1ms) && chan.try_put_for(2, 1ms));
+    assert(!chan.try_put_for(3, 1ms));
+    assert(chan.try_get_for(1ms) == 1 && chan.try_get_for(1ms) == 2);
+
+    // the same goes for one derived from the interface, whose own wait is what the timed calls end up in
+    fastchan::MPSC<int, 2, DerivedSpinStrategy, DerivedSpinStrategy> derived;
+    assert(!derived.try_get_for(1ms));
+    assert(DerivedSpinStrategy::waits > 0);
+    assert(derived.try_put_for(1, 1ms) && derived.try_put_for(2, 1ms));
+    auto waits = DerivedSpinStrategy::waits.load();
+    assert(!derived.try_put_for(3, 1ms));
+    assert(DerivedSpinStrategy::waits > waits);
+    assert(derived.try_get_for(1ms) == 1 && derived.try_get_for(1ms) == 2);
+}
+
+void testSpinCV() {
+    testThreaded<fastchan::SPSC<uint64_t, 16, fastchan::SpinCVWaitStrategy<64>, fastchan::SpinCVWaitStrategy<64>>>(1);
+    testThreaded<fastchan::MPSC<uint64_t, 16, fastchan::SpinCVWaitStrategy<64>, fastchan::SpinCVWaitStrategy<64>>>(3);
+
+    fastchan::SPSC<int, 2, fastchan::SpinCVWaitStrategy<1024>, fastchan::SpinCVWaitStrategy<1024>> chan;
+    auto start = std::chrono::steady_clock::now();
+    assert(!chan.try_get_for(5ms));
+    assert(std::chrono::steady_clock::now() - start >= 5ms);
+
+    std::thread producer([&] {
+        std::this_thread::sleep_for(1ms);
+        chan.put(42);
+    });
+    assert(chan.try_get_for(10s) == 42);
+    producer.join();
+}
+
+// the channels hand the index they're waiting on to a strategy that can watch it, for the waits on the other side
+void testWatchedIndex() {
+    testThreaded<fastchan::SPSC<uint64_t, 16, WatchingStrategy, WatchingStrategy>>(1);
+    testThreaded<fastchan::MPSC<uint64_t, 16, WatchingStrategy, WatchingStrategy>>(3);
+    assert(WatchingStrategy::watched_waits > 0);
+
+    // WFEWaitStrategy pauses rather than waiting for an event other than on aarch64, so it spins out its time slice
+    // when there's only one core, and gets fewer iterations for it
+    testThreaded<fastchan::SPSC<uint64_t, 16, fastchan::WFEWaitStrategy, fastchan::WFEWaitStrategy>>(1, 10'000);
+    testThreaded<fastchan::MPSC<uint64_t, 16, fastchan::WFEWaitStrategy, fastchan::WFEWaitStrategy>>(3, 10'000);
+
+    fastchan::SPSC<int, 2, fastchan::WFEWaitStrategy, fastchan::WFEWaitStrategy> chan;
+    assert(!chan.try_get_for(1ms));
+    chan.put(1);
+    chan.close();
+    assert(chan.try_get_for(1ms) == 1);
+    int value = 0;
+    assert(!chan.get(value));
+}
+
+// UMWaitStrategy and TPauseWaitStrategy are PauseWaitStrategy without WAITPKG, so they only sleep where cpuid says
+// they can, and get as few iterations as the other spinning strategies otherwise
+void testWaitPkg() {
+    const uint64_t iterations = fastchan::cpu_has_waitpkg() ? 100'000 : 2'000;
+
+    testThreaded<fastchan::SPSC<uint64_t, 16, fastchan::UMWaitStrategy<>, fastchan::UMWaitStrategy<>>>(1, iterations);
+    testThreaded<fastchan::MPSC<uint64_t, 16, fastchan::UMWaitStrategy<>, fastchan::UMWaitStrategy<>>>(3, iterations);
+    testThreaded<fastchan::SPSC<uint64_t, 16, fastchan::TPauseWaitStrategy<>, fastchan::TPauseWaitStrategy<>>>(1, iterations);
+    testThreaded<fastchan::MPSC<uint64_t, 16, fastchan::TPauseWaitStrategy<>, fastchan::TPauseWaitStrategy<>>>(3, iterations);
+
+    // a close isn't a write to the watched index, it's seen once the wait runs out
+    fastchan::SPSC<int, 2, fastchan::UMWaitStrategy<>, fastchan::UMWaitStrategy<>> chan;
+    std::thread consumer([&] {
+        int value = 0;
+        assert(!chan.get(value));
+    });
+    std::this_thread::sleep_for(1ms);
+    chan.close();
+    consumer.join();
+    assert(!chan.try_get_for(1ms));
+}
+
+// every round parks the waiter with a deadline far enough out that a lost wakeup shows up as a timeout
+void testNoLostWakeups() {
+    constexpr uint64_t rounds = 20'000;
+
+    // straight on the strategy, the notifier races the waiter's announcement on every round
+    {
+        fastchan::CVWaitStrategy strategy;
+        std::atomic<uint64_t> flag{0};
+        std::thread notifier([&] {
+            for (uint64_t i = 1; i <= rounds; ++i) {
+                flag.store(i, std::memory_order_relaxed);
+                strategy.notify();
+                while (flag.load(std::memory_order_relaxed) != 0) {
+                    std::this_thread::yield();
+                }
+            }
+        });
+        for (uint64_t i = 1; i <= rounds; ++i) {
+            strategy.wait_until([&] { return flag.load(std::memory_order_relaxed) == i; }, fastchan::Deadline(10s));
+            assert(flag.load(std::memory_order_relaxed) == i);
+            flag.store(0, std::memory_order_relaxed);
+        }
+        notifier.join();
+    }
+
+    // ping pong, so both sides park on an empty channel every round
+    {
+        fastchan::SPSC<uint64_t, 2, fastchan::CVWaitStrategy, fastchan::CVWaitStrategy> ping, pong;
+        std::thread echo([&] {
+            for (uint64_t i = 0; i < rounds; ++i) {
+                auto val = ping.try_get_for(10s);
+                assert(val == i);
+                assert(pong.try_put_for(*val, 10s));
+            }
+        });
+        for (uint64_t i = 0; i < rounds; ++i) {
+            assert(ping.try_put_for(i, 10s));
+            assert(pong.try_get_for(10s) == i);
+        }
+        echo.join();
+    }
+
+    // a full channel with producers parked on the consumer and on each other's commits
+    {
+        constexpr std::size_t num_producers = 4;
+        fastchan::MPSC<uint64_t, 2, fastchan::CVWaitStrategy, fastchan::CVWaitStrategy> chan;
+        std::vector<std::thread> producers;
+        for (std::size_t p = 0; p < num_producers; ++p) {
+            producers.emplace_back([&, p] {
+                for (uint64_t i = p; i < rounds; i += num_producers) {
+                    assert(chan.try_put_for(i, 10s));
+                }
+            });
+        }
+        std::vector<bool> seen(rounds);
+        for (uint64_t i = 0; i < rounds; ++i) {
+            auto val = chan.try_get_for(10s);
+            assert(val && !seen[*val]);
+            seen[*val] = true;
+        }
+        for (auto &producer : producers) {
+            producer.join();
+        }
+    }
+}
+
+int main() {
+    testNotifyCompiledOut();
+    testCustomReturnImmediate();
+    testTimedWithoutWaitUntil();
+    testSpinCV();
+    testWatchedIndex();
+    testWaitPkg();
+    testNoLostWakeups();
+
+    return 0;
+}
@@ -0,0 +1,162 @@
+#include <atomic>
+#include <cassert>
+#include <cstdint>
+#include <thread>
+#include <vector>
+#include <work_stealing.hpp>
+
+void testDequeSingleThreaded() {
+    fastchan::WorkStealingDeque<int, 4> deque;
+
+    assert(deque.isEmpty());
+    assert(!deque.pop());
+    assert(!deque.steal());
+
+    for (int i = 0; i < 4; ++i) {
+        assert(deque.push(i));
+    }
+    assert(deque.size() == 4);
+    assert(!deque.push(4));
+
+    // the owner takes the newest, thieves the oldest
+    assert(*deque.pop() == 3);
+    assert(*deque.steal() == 0);
+    assert(*deque.steal() == 1);
+    assert(*deque.pop() == 2);
+    assert(deque.isEmpty());
+    assert(!deque.pop());
+
+    // wraps around the end of the buffer
+    for (int round = 0; round < 10; ++round) {
+        assert(deque.push(round));
+        assert(deque.push(round + 100));
+        assert(*deque.steal() == round);
+        assert(*deque.pop() == round + 100);
+    }
+    assert(deque.isEmpty());
+}
+
+void testDequeMultiThreaded(std::size_t num_thieves) {
+    constexpr int64_t iterations = 500'000;
+    fastchan::WorkStealingDeque<int64_t, 256> deque;
+    std::vector<std::atomic<int>> taken(iterations);
+    std::atomic_bool done = false;
+
+    std::vector<std::thread> thieves;
+    for (std::size_t t = 0; t < num_thieves; ++t) {
+        thieves.emplace_back([&] {
+            while (!done.load()) {
+                if (auto val = deque.steal()) {
+                    taken[*val].fetch_add(1);
+                } else {
+                    std::this_thread::yield();
+                }
+            }
+        });
+    }
+
+    // the owner mixes pushes and pops so it races the thieves for the last entry
+    for (int64_t i = 0; i < iterations; ++i) {
+        while (!deque.push(i)) {
+            if (auto val = deque.pop()) {
+                taken[*val].fetch_add(1);
+            }
+        }
+        if (i % 3 == 0) {
+            if (auto val = deque.pop()) {
+                taken[*val].fetch_add(1);
+            }
+        }
+    }
+    while (auto val = deque.pop()) {
+        taken[*val].fetch_add(1);
+    }
+    done = true;
+    for (auto &thief : thieves) {
+        thief.join();
+    }
+
+    // every entry is taken exactly once
+    for (auto &count : taken) {
+        assert(count.load() == 1);
+    }
+}
+
+struct Range {
+    fastchan::WorkStealingPool<> *pool;
+    std::atomic<int64_t> *sum;
+    std::atomic<int64_t> *pending;
+    int64_t begin;
+    int64_t end;
+};
+
+// sums [begin, end) by splitting it in half until it's small enough, as a fork join
+void sumRange(void *arg) {
+    auto *range = static_cast<Range *>(arg);
+    while (range->end - range->begin > 64) {
+        auto mid = range->begin + (range->end - range->begin) / 2;
+        range->pending->fetch_add(1);
+        range->pool->submit(sumRange, new Range{range->pool, range->sum, range->pending, mid, range->end});
+        range->end = mid;
+    }
+
+    int64_t sum = 0;
+    for (auto i = range->begin; i < range->end; ++i) {
+        sum += i;
+    }
+    range->sum->fetch_add(sum);
+    range->pending->fetch_sub(1);
+    delete range;
+}
+
+void testPoolForkJoin(std::size_t num_workers) {
+    constexpr int64_t n = 1'000'000;
+    fastchan::WorkStealingPool<> pool(num_workers);
+    std::atomic<int64_t> sum = 0;
+    std::atomic<int64_t> pending = 1;
+
+    pool.submit(sumRange, new Range{&pool, &sum, &pending, 0, n});
+    while (pending.load() > 0) {
+        std::this_thread::yield();
+    }
+    assert(sum.load() == n * (n - 1) / 2);
+
+    pool.stop();
+    uint64_t executed = 0;
+    for (auto &stats : pool.stats()) {
+        executed += stats.executed;
+        assert(stats.stolen <= stats.executed);
+    }
+    assert(executed > n / 128);
+}
+
+void testPoolStopDrains() {
+    constexpr int tasks = 10'000;
+    std::atomic<int> ran = 0;
+    {
+        fastchan::WorkStealingPool<64> pool(3);
+        std::thread other([&] {
+            for (int i = 0; i < tasks; ++i) {
+                pool.submit([](void *arg) { static_cast<std::atomic<int> *>(arg)->fetch_add(1); }, &ran);
+            }
+        });
+        for (int i = 0; i < tasks; ++i) {
+            pool.submit([](void *arg) { static_cast<std::atomic<int> *>(arg)->fetch_add(1); }, &ran);
+        }
+        other.join();
+        // the destructor stops the pool, which runs everything submitted first
+    }
+    assert(ran.load() == 2 * tasks);
+}
+
+int main() {
+    testDequeSingleThreaded();
+    testDequeMultiThreaded(1);
+    testDequeMultiThreaded(3);
+
+    testPoolForkJoin(1);
+    testPoolForkJoin(4);
+    testPoolStopDrains();
+
+    return 0;
+}